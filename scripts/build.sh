@@ -2,3 +2,4 @@
 DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" >/dev/null && pwd )"
 cd $(dirname "${DIR}")
 ib yourcss/yourcss.so
+ib tools/yourcss
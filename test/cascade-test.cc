@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "test_element.h"
+#include <yourcss/cascade.h>
+#include <yourcss/matcher.h>
+#include <yourcss/parser.h>
+#include <yourcss/selector.h>
+
+using namespace yourcss;
+
+namespace {
+
+/* Stylesheets from each origin, cascaded, and the style of an element
+   which matched all their selectors. */
+struct sheets_t final {
+
+  explicit sheets_t(const char *author, const char *user = "", const char *user_agent = "") {
+    const char *sources[] = {user_agent, user, author};
+    cascade_t::origin_t origins[] = {cascade_t::USER_AGENT, cascade_t::USER, cascade_t::AUTHOR};
+    for (size_t i = 0; i < 3; ++i) {
+      sheets.push_back(std::make_unique<stylesheet_t>(parser_t(sources[i]).parse_stylesheet()));
+      tables.push_back(std::make_unique<selector_table_t>(*sheets.back()));
+      EXPECT_TRUE(tables.back()->get_errors().empty()) << sources[i];
+      cascade.add(*tables.back(), origins[i]);
+    }
+  }
+
+  /* The value, as a space-separated list of words, which won for the
+     property, or "-" if none did. */
+  std::string get(const char *property) {
+    std::vector<const selector_t *> matched;
+    for (const auto &table: tables) {
+      for (const auto &selector: table->get_selectors()) {
+        matched.push_back(&selector);
+      }
+    }
+    auto declaration = styler_t(cascade).get_style(matched)->get(cascade.find_property(property));
+    if (!declaration) {
+      return "-";
+    }
+    std::string result;
+    for (const auto &value: declaration->value) {
+      result += (result.empty() ? "" : " ") + std::string(value.text);
+    }
+    return result;
+  }
+
+  std::vector<std::unique_ptr<stylesheet_t>> sheets;
+
+  std::vector<std::unique_ptr<selector_table_t>> tables;
+
+  cascade_t cascade;
+
+};  // sheets_t
+
+}  // namespace
+
+TEST(cascade, specificity_and_order) {
+  sheets_t sheets(
+      "#i { color: green } p { color: red; margin: auto } .x { color: blue } "
+      "p { margin: none; margin: inherit } .y { padding: a } .x { padding: b } div, #i p { float: left }");
+  EXPECT_EQ(sheets.get("color"), "green");
+  EXPECT_EQ(sheets.get("margin"), "inherit");
+  EXPECT_EQ(sheets.get("padding"), "b");
+  EXPECT_EQ(sheets.get("float"), "left");
+  EXPECT_EQ(sheets.get("border"), "-");
+}
+
+TEST(cascade, importance_and_origins) {
+  sheets_t sheets(
+      "p { color: red !important; display: inline; float: right } #i { color: blue } "
+      "p { width: auto !important } #i { width: none !important }",
+      "p { float: left !important; display: flex }",
+      "p { color: black !important; display: block; width: min-content } @media print { p { clear: both } }");
+  EXPECT_EQ(sheets.get("color"), "black");
+  EXPECT_EQ(sheets.get("display"), "inline");
+  EXPECT_EQ(sheets.get("float"), "left");
+  EXPECT_EQ(sheets.get("width"), "none");
+  EXPECT_EQ(sheets.get("clear"), "both");
+}
+
+TEST(cascade, property_names) {
+  sheets_t sheets("p { COLOR: red; --Gap: wide; --gap: narrow } p::before { content: x; color: blue }");
+  EXPECT_EQ(sheets.get("color"), "red");
+  EXPECT_EQ(sheets.get("Color"), "red");
+  EXPECT_EQ(sheets.get("--Gap"), "wide");
+  EXPECT_EQ(sheets.get("--gap"), "narrow");
+  EXPECT_EQ(sheets.get("--GAP"), "-");
+  EXPECT_EQ(sheets.get("content"), "-");
+  EXPECT_EQ(sheets.cascade.find_property("nowhere"), cascade_t::none);
+  EXPECT_EQ(sheets.cascade.get_property_name(sheets.cascade.find_property("COLOR")), "color");
+}
+
+TEST(cascade, sort_keys) {
+  std::mt19937_64 random(3);
+  for (size_t size: {0, 1, 2, 63, 64, 65, 1000, 5000}) {
+    for (uint64_t mask: {~uint64_t(0), uint64_t(0xffff), uint64_t(0xe0000003ff000000)}) {
+      std::vector<uint64_t> keys(size), scratch(size);
+      for (auto &key: keys) {
+        key = random() & mask;
+      }
+      auto expected = keys;
+      std::sort(expected.begin(), expected.end());
+      styler_t::sort_keys(keys, scratch);
+      ASSERT_EQ(keys, expected) << size << ' ' << mask;
+    }
+  }
+}
+
+TEST(cascade, shares_styles) {
+  auto root = make_random_tree(13, 7);
+  auto sheet = parser_t(
+      "a { color: red } .xa { color: blue } .xb.yb { color: green } b .yc { margin: wide } "
+      "#ia { float: left } c > a { padding: narrow !important } .ya { padding: wide } "
+      "b a { display: none } :not(.xc) { border: none }").parse_stylesheet();
+  selector_table_t table(sheet);
+  cascade_t cascade;
+  cascade.add(table, cascade_t::AUTHOR);
+  matcher_t matcher(table);
+  styler_t styler(cascade);
+  size_t element_count = 0;
+  std::vector<std::pair<std::vector<const selector_t *>, const style_t *>> seen;
+  auto walk = [&](const test_element_t &element, auto &self) -> void {
+    std::vector<const selector_t *> matched;
+    matcher.match(element, matched);
+    auto style = styler.get_style(matched);
+    auto expected = styler_t(cascade).get_style(matched);
+    for (uint32_t property = 0; property < cascade.get_property_count(); ++property) {
+      ASSERT_EQ(style->get(property), expected->get(property));
+    }
+    seen.emplace_back(matched, style.get());
+    ++element_count;
+    matcher.push(element);
+    for (const auto &child: element.get_children()) {
+      self(*child, self);
+    }
+    matcher.pop();
+  };
+  walk(*root, walk);
+  EXPECT_GT(styler.get_shared_count(), element_count / 2);
+  /* Siblings which matched the same selectors got the very same style. */
+  for (size_t i = 1; i < seen.size(); ++i) {
+    if (seen[i].first == seen[i - 1].first) {
+      EXPECT_EQ(seen[i].second, seen[i - 1].second);
+    }
+  }
+}
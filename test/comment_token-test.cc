@@ -47,3 +47,13 @@ TEST(comment_token, comment_nasty) {
   EXPECT_EQ(token_t::kind_t::WHITESPACE_TOKEN, tokens[2]->get_kind());
   EXPECT_EQ(tokens[1]->get_text(), std::string("/* *O*R*  *N*A*S*T*Y* */"));
 }
+
+TEST(comment_token, comment_stars) {
+  lexer_t lexer("/* a **/ b /***/");
+  lexer.set_discard_comments(false);
+  auto tokens = lexer.lex();
+  ASSERT_EQ(tokens.size(), size_t(5));
+  EXPECT_EQ(tokens[0]->get_text(), std::string("/* a **/"));
+  EXPECT_EQ(token_t::kind_t::IDENT_TOKEN, tokens[2]->get_kind());
+  EXPECT_EQ(tokens[4]->get_text(), std::string("/***/"));
+}
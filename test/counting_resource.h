@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace yourcss {
+
+/* A memory resource which counts the allocations it passes on to its
+   upstream resource.  Use it as the resource a lexer allocates from, as
+   the upstream of a monotonic or pool resource, or as the default
+   resource to catch allocations which escape the one you meant to use. */
+class counting_resource_t final: public std::pmr::memory_resource {
+
+public:
+
+  explicit counting_resource_t(std::pmr::memory_resource *upstream_ = std::pmr::new_delete_resource()):
+    upstream(upstream_),
+    allocation_count(0),
+    byte_count(0),
+    live_byte_count(0),
+    peak_byte_count(0) {}
+
+  /* The number of allocations made through us. */
+  size_t get_allocation_count() const {
+    return allocation_count;
+  }
+
+  /* The number of bytes allocated through us. */
+  size_t get_byte_count() const {
+    return byte_count;
+  }
+
+  /* The number of bytes allocated through us and not yet deallocated. */
+  size_t get_live_byte_count() const {
+    return live_byte_count;
+  }
+
+  /* The most bytes that have been live at once. */
+  size_t get_peak_byte_count() const {
+    return peak_byte_count;
+  }
+
+private:
+
+  virtual void *do_allocate(size_t bytes, size_t alignment) override {
+    ++allocation_count;
+    byte_count += bytes;
+    live_byte_count += bytes;
+    if (live_byte_count > peak_byte_count) {
+      peak_byte_count = live_byte_count;
+    }
+    return upstream->allocate(bytes, alignment);
+  }
+
+  virtual void do_deallocate(void *p, size_t bytes, size_t alignment) override {
+    live_byte_count -= bytes;
+    upstream->deallocate(p, bytes, alignment);
+  }
+
+  virtual bool do_is_equal(const std::pmr::memory_resource &that) const noexcept override {
+    return this == &that;
+  }
+
+  std::pmr::memory_resource *upstream;
+
+  size_t allocation_count;
+
+  size_t byte_count;
+
+  size_t live_byte_count;
+
+  size_t peak_byte_count;
+
+};  // counting_resource_t
+
+/* While one of these is alive, the default memory resource is the given
+   resource. */
+class default_resource_scope_t final {
+
+public:
+
+  explicit default_resource_scope_t(std::pmr::memory_resource *resource):
+    prev(std::pmr::set_default_resource(resource)) {}
+
+  default_resource_scope_t(const default_resource_scope_t &) = delete;
+
+  default_resource_scope_t &operator=(const default_resource_scope_t &) = delete;
+
+  ~default_resource_scope_t() {
+    std::pmr::set_default_resource(prev);
+  }
+
+private:
+
+  std::pmr::memory_resource *prev;
+
+};  // default_resource_scope_t
+
+}  // yourcss
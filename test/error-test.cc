@@ -0,0 +1,67 @@
+#include <cstring>
+#include <string>
+#include <gtest/gtest.h>
+#include <yourcss/lexer.h>
+#include "new_count.h"
+
+using namespace yourcss;
+
+namespace {
+
+/* Lex the source and return the error it raises, or fail. */
+template <typename fn_t>
+void expect_lexer_error(const char *src, fn_t &&check) {
+  try {
+    lexer_t(src).lex();
+    ADD_FAILURE() << "no error lexing " << src;
+  } catch (const lexer_t::lexer_error_t &error) {
+    check(error);
+  }
+}
+
+}  // namespace
+
+TEST(error, bad_number) {
+  expect_lexer_error("a { b: 1..2 }", [](const lexer_t::lexer_error_t &error) {
+    EXPECT_EQ(error.get_code(), lexer_t::lexer_error_t::BAD_NUMBER);
+    EXPECT_EQ(error.get_pos().get_line(), uint64_t(1));
+    EXPECT_EQ(error.get_pos().get_col(), uint64_t(10));
+    EXPECT_EQ(error.get_offset(), size_t(9));
+  });
+}
+
+TEST(error, bad_string) {
+  expect_lexer_error("a { b: \"x\ny\" }", [](const lexer_t::lexer_error_t &error) {
+    EXPECT_EQ(error.get_code(), lexer_t::lexer_error_t::BAD_STRING);
+    EXPECT_EQ(error.get_offset(), size_t(9));
+  });
+}
+
+TEST(error, bad_unicode_range) {
+  expect_lexer_error("U+00zz", [](const lexer_t::lexer_error_t &error) {
+    EXPECT_EQ(error.get_code(), lexer_t::lexer_error_t::BAD_UNICODE_RANGE);
+  });
+}
+
+TEST(error, what_is_formatted_once) {
+  expect_lexer_error("U+00zz", [](const lexer_t::lexer_error_t &error) {
+    const char *msg = error.what();
+    EXPECT_EQ(std::string(msg), "line 1, col 5; unexpected character in consume_unicode_range()::start");
+    EXPECT_EQ(error.what(), msg);
+  });
+}
+
+TEST(error, throw_and_catch_without_allocating) {
+  pos_t pos;
+  size_t new_count = get_global_new_count();
+  size_t caught = 0;
+  for (int i = 0; i < 100; ++i) {
+    try {
+      throw lexer_error_t(pos, 0, lexer_error_t::BAD_NUMBER, "bad");
+    } catch (const yourcss::error_t &error) {
+      caught += std::strlen(static_cast<const lexer_t::lexer_error_t &>(error).get_detail());
+    }
+  }
+  EXPECT_EQ(get_global_new_count(), new_count);
+  EXPECT_EQ(caught, size_t(300));
+}
@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include <yourcss/lexer.h>
+#include <yourcss/token.h>
+#include "counting_resource.h"
+
+using namespace yourcss;
+
+TEST(filter, defaults_to_comments) {
+  lexer_t lexer("a /* b */ c");
+  EXPECT_EQ(lexer.get_filter(), token_t::get_mask(token_t::COMMENT_TOKEN));
+  lexer.set_discard_comments(false);
+  EXPECT_EQ(lexer.get_filter(), token_t::kind_mask_t(0));
+  auto tokens = lexer.lex();
+  ASSERT_EQ(tokens.size(), size_t(5));
+  EXPECT_EQ(token_t::kind_t::COMMENT_TOKEN, tokens[2]->get_kind());
+}
+
+TEST(filter, whitespace_suppression) {
+  const char *src = R"(
+    .cool a {
+      margin: 1px 2px;
+    }
+  )";
+  lexer_t lexer(src);
+  lexer.set_filter(lexer.get_filter() | token_t::get_mask(token_t::WHITESPACE_TOKEN));
+  auto tokens = lexer.lex();
+  ASSERT_EQ(tokens.size(), size_t(10));
+  EXPECT_EQ(token_t::kind_t::DELIM_TOKEN, tokens[0]->get_kind());
+  EXPECT_TRUE(tokens[0]->is_preceded_by_whitespace());
+  EXPECT_EQ(token_t::kind_t::IDENT_TOKEN, tokens[1]->get_kind());
+  EXPECT_FALSE(tokens[1]->is_preceded_by_whitespace());
+  EXPECT_EQ(token_t::kind_t::IDENT_TOKEN, tokens[2]->get_kind());
+  EXPECT_TRUE(tokens[2]->is_preceded_by_whitespace());
+  EXPECT_EQ(token_t::kind_t::LEFT_BRACE_TOKEN, tokens[3]->get_kind());
+  EXPECT_EQ(token_t::kind_t::IDENT_TOKEN, tokens[4]->get_kind());
+  EXPECT_EQ(token_t::kind_t::COLON_TOKEN, tokens[5]->get_kind());
+  EXPECT_FALSE(tokens[5]->is_preceded_by_whitespace());
+  EXPECT_EQ(token_t::kind_t::DIMENSION_TOKEN, tokens[6]->get_kind());
+  EXPECT_EQ(token_t::kind_t::DIMENSION_TOKEN, tokens[7]->get_kind());
+  EXPECT_TRUE(tokens[7]->is_preceded_by_whitespace());
+  EXPECT_EQ(token_t::kind_t::SEMICOLON_TOKEN, tokens[8]->get_kind());
+  EXPECT_EQ(token_t::kind_t::RIGHT_BRACE_TOKEN, tokens[9]->get_kind());
+  EXPECT_TRUE(tokens[9]->is_preceded_by_whitespace());
+}
+
+TEST(filter, whitespace_kept) {
+  auto tokens = lexer_t("a b").lex();
+  ASSERT_EQ(tokens.size(), size_t(3));
+  EXPECT_FALSE(tokens[1]->is_preceded_by_whitespace());
+  EXPECT_TRUE(tokens[2]->is_preceded_by_whitespace());
+}
+
+TEST(filter, whitespace_through_comment) {
+  lexer_t lexer("a /* x */b");
+  lexer.set_filter(token_t::get_mask(token_t::COMMENT_TOKEN) | token_t::get_mask(token_t::WHITESPACE_TOKEN));
+  auto tokens = lexer.lex();
+  ASSERT_EQ(tokens.size(), size_t(2));
+  EXPECT_TRUE(tokens[1]->is_preceded_by_whitespace());
+}
+
+TEST(filter, sub_lexer_kinds) {
+  lexer_t lexer("@media a(b) 1px 2% 3 url(x) u+0000ff;");
+  lexer.set_filter(
+    token_t::get_mask(token_t::AT_KEYWORD_TOKEN) |
+    token_t::get_mask(token_t::FUNCTION_TOKEN) |
+    token_t::get_mask(token_t::DIMENSION_TOKEN) |
+    token_t::get_mask(token_t::PERCENTAGE_TOKEN) |
+    token_t::get_mask(token_t::NUMBER_TOKEN) |
+    token_t::get_mask(token_t::URL_TOKEN) |
+    token_t::get_mask(token_t::UNICODE_RANGE_TOKEN) |
+    token_t::get_mask(token_t::WHITESPACE_TOKEN));
+  auto tokens = lexer.lex();
+  ASSERT_EQ(tokens.size(), size_t(3));
+  EXPECT_EQ(token_t::kind_t::IDENT_TOKEN, tokens[0]->get_kind());
+  EXPECT_EQ(tokens[0]->get_text(), std::string("b"));
+  EXPECT_EQ(token_t::kind_t::RIGHT_PAREN_TOKEN, tokens[1]->get_kind());
+  EXPECT_EQ(token_t::kind_t::SEMICOLON_TOKEN, tokens[2]->get_kind());
+}
+
+TEST(filter, dropped_kinds_never_allocated) {
+  /* Every name, string and url is longer than any small string buffer, so
+     making its text would have to allocate. */
+  const char *src =
+    "  { } ; : , ( ) [ ] /* a comment longer than a small string */ ~= |= ^= $= *="
+    " 'a string longer than a small string buffer' #a-hash-longer-than-a-small-string"
+    " an-ident-longer-than-a-small-string a-function-longer-than-a-small-string(x)"
+    " @an-at-keyword-longer-than-a-small-string 12a-unit-longer-than-a-small-string"
+    " url(a/url/longer/than/a/small/string.png) url('a/quoted/url/longer/than/a/small/string')  ";
+  counting_resource_t resource;
+  lexer_t lexer(src, &resource);
+  lexer.set_filter(~token_t::kind_mask_t(0));
+  auto tokens = lexer.lex();
+  EXPECT_EQ(tokens.size(), size_t(0));
+  EXPECT_EQ(resource.get_allocation_count(), size_t(0));
+}
+
+TEST(filter, delimiters_advance) {
+  lexer_t lexer("a > b!");
+  lexer.set_filter(token_t::get_mask(token_t::WHITESPACE_TOKEN));
+  auto tokens = lexer.lex();
+  ASSERT_EQ(tokens.size(), size_t(4));
+  EXPECT_EQ(tokens[1]->get_text(), std::string(">"));
+  EXPECT_TRUE(tokens[1]->is_preceded_by_whitespace());
+  EXPECT_EQ(tokens[3]->get_text(), std::string("!"));
+}
@@ -71,6 +71,22 @@ TEST(ident_token, url_identifier_single_quote) {
   EXPECT_EQ(tokens[1]->get_text(), std::string("http://danielhood.com"));
 }
 
+TEST(ident_token, bad_url_remnants) {
+  const char *src = R"(
+    url(a bc{) url('a' b\)c) url(a\
+b);
+  )";
+  auto tokens = lexer_t(src).lex();
+  ASSERT_EQ(tokens.size(), size_t(8));
+  EXPECT_EQ(token_t::kind_t::BAD_URL_TOKEN, tokens[1]->get_kind());
+  EXPECT_EQ(tokens[1]->get_text(), std::string("a"));
+  EXPECT_EQ(token_t::kind_t::WHITESPACE_TOKEN, tokens[2]->get_kind());
+  EXPECT_EQ(token_t::kind_t::BAD_URL_TOKEN, tokens[3]->get_kind());
+  EXPECT_EQ(tokens[3]->get_text(), std::string("a"));
+  EXPECT_EQ(token_t::kind_t::BAD_URL_TOKEN, tokens[5]->get_kind());
+  EXPECT_EQ(token_t::kind_t::SEMICOLON_TOKEN, tokens[6]->get_kind());
+}
+
 TEST(ident_token, url_identifier_single_quote_ws_begin) {
   const char *src = R"(
     url( 'http://danielhood.com');
@@ -125,3 +141,19 @@ TEST(ident_token, url_identifier_double_quote_ws_nice) {
   EXPECT_EQ(token_t::kind_t::SEMICOLON_TOKEN, tokens[2]->get_kind());
   EXPECT_EQ(tokens[1]->get_text(), std::string("http://danielhood.com"));
 }
+
+TEST(ident_token, hyphen_identifier) {
+  const char *src = R"(
+    -moz-box --main-color -\*x - -1 -->
+  )";
+  auto tokens = lexer_t(src).lex();
+  EXPECT_EQ(token_t::kind_t::IDENT_TOKEN, tokens[1]->get_kind());
+  EXPECT_EQ(tokens[1]->get_text(), std::string("-moz-box"));
+  EXPECT_EQ(token_t::kind_t::IDENT_TOKEN, tokens[3]->get_kind());
+  EXPECT_EQ(tokens[3]->get_text(), std::string("--main-color"));
+  EXPECT_EQ(token_t::kind_t::IDENT_TOKEN, tokens[5]->get_kind());
+  EXPECT_EQ(tokens[5]->get_text(), std::string("-\\*x"));
+  EXPECT_EQ(token_t::kind_t::DELIM_TOKEN, tokens[7]->get_kind());
+  EXPECT_EQ(token_t::kind_t::NUMBER_TOKEN, tokens[9]->get_kind());
+  EXPECT_EQ(token_t::kind_t::CDC_TOKEN, tokens[11]->get_kind());
+}
@@ -0,0 +1,77 @@
+#include <memory_resource>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include <yourcss/lexer.h>
+#include <yourcss/token.h>
+
+using namespace yourcss;
+
+namespace {
+
+const char *src = R"(
+  /* box */
+  .a > b[href|="en"] {
+    margin: 1px 2px;
+    color: red;
+  }
+)";
+
+std::string describe(const token_list_t &tokens) {
+  std::string text;
+  for (const auto &token: tokens) {
+    text += token->get_name();
+    text += ' ';
+    text += token->get_text();
+    text += '\n';
+  }
+  return text;
+}
+
+}  // namespace
+
+TEST(lexer_config, options_come_from_config) {
+  std::pmr::monotonic_buffer_resource arena;
+  lexer_config_t config(token_t::get_mask(token_t::WHITESPACE_TOKEN), &arena);
+  lexer_t lexer(config, src);
+  EXPECT_EQ(lexer.get_filter(), token_t::get_mask(token_t::WHITESPACE_TOKEN));
+  EXPECT_EQ(lexer.get_resource(), &arena);
+  auto tokens = lexer.lex();
+  ASSERT_FALSE(tokens.empty());
+  EXPECT_EQ(tokens[0]->get_kind(), token_t::COMMENT_TOKEN);
+}
+
+TEST(lexer_config, default_matches_lexer) {
+  lexer_config_t config;
+  EXPECT_EQ(describe(lexer_t(config, src).lex()), describe(lexer_t(src).lex()));
+}
+
+TEST(lexer_config, bounded) {
+  lexer_config_t config;
+  std::string text = "a b";
+  auto tokens = lexer_t(config, text.data(), text.data() + 1).lex();
+  ASSERT_EQ(tokens.size(), size_t(1));
+  EXPECT_EQ(tokens[0]->get_text(), "a");
+}
+
+TEST(lexer_config, shared_across_threads) {
+  std::pmr::synchronized_pool_resource pool;
+  const lexer_config_t config(token_t::get_mask(token_t::COMMENT_TOKEN), &pool);
+  std::string expected = describe(lexer_t(config, src).lex());
+  std::vector<std::string> results(8);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < results.size(); ++i) {
+    threads.emplace_back([&config, &results, i] {
+      for (int j = 0; j < 50; ++j) {
+        results[i] = describe(lexer_t(config, src).lex());
+      }
+    });
+  }
+  for (auto &thread: threads) {
+    thread.join();
+  }
+  for (const auto &result: results) {
+    EXPECT_EQ(result, expected);
+  }
+}
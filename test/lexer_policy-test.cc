@@ -0,0 +1,63 @@
+#include <string>
+#include <gtest/gtest.h>
+#include <yourcss/lexer.h>
+#include <yourcss/token.h>
+
+using namespace yourcss;
+
+namespace {
+
+const char *src = R"(
+  /* box */
+  .a > b {
+    margin: 1px 2px;
+    color: red;
+  }
+)";
+
+}  // namespace
+
+TEST(lexer_policy, bulk_matches_filtered_default) {
+  lexer_t lexer(src);
+  lexer.set_filter(bulk_lexer_policy_t::filter);
+  auto expected = lexer.lex();
+  auto actual = bulk_lexer_t(src).lex();
+  ASSERT_EQ(actual.size(), expected.size());
+  for (size_t i = 0; i < actual.size(); ++i) {
+    EXPECT_EQ(actual[i]->get_kind(), expected[i]->get_kind());
+    EXPECT_EQ(actual[i]->get_text(), expected[i]->get_text());
+    EXPECT_EQ(actual[i]->is_preceded_by_whitespace(), expected[i]->is_preceded_by_whitespace());
+  }
+}
+
+TEST(lexer_policy, bulk_skips_positions) {
+  auto tokens = bulk_lexer_t(src).lex();
+  ASSERT_FALSE(tokens.empty());
+  for (const auto &token: tokens) {
+    EXPECT_EQ(token->get_pos().get_offset(), uint64_t(0));
+  }
+}
+
+TEST(lexer_policy, policy_filter_ignores_runtime_filter) {
+  bulk_lexer_t lexer(src);
+  lexer.set_discard_comments(false);
+  for (const auto &token: lexer.lex()) {
+    EXPECT_NE(token->get_kind(), token_t::COMMENT_TOKEN);
+    EXPECT_NE(token->get_kind(), token_t::WHITESPACE_TOKEN);
+  }
+}
+
+TEST(lexer_policy, bulk_recovers_from_errors) {
+  bulk_lexer_t lexer("a { b: 1..2; c: d }");
+  auto tokens = lexer.lex();
+  ASSERT_EQ(lexer.get_errors().size(), size_t(1));
+  EXPECT_EQ(lexer.get_errors()[0].get_code(), lexer_error_t::BAD_NUMBER);
+  EXPECT_EQ(lexer.get_errors()[0].get_offset(), uint64_t(9));
+  ASSERT_FALSE(tokens.empty());
+  EXPECT_EQ(tokens.back()->get_kind(), token_t::RIGHT_BRACE_TOKEN);
+  EXPECT_EQ(tokens[tokens.size() - 2]->get_text(), "d");
+}
+
+TEST(lexer_policy, default_throws) {
+  EXPECT_THROW(lexer_t("a { b: 1..2 }").lex(), lexer_error_t);
+}
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+#include "test_element.h"
+#include <yourcss/matcher.h>
+#include <yourcss/parser.h>
+#include <yourcss/selector.h>
+
+using namespace yourcss;
+
+namespace {
+
+/* The indices of the rules in the css whose selectors match the element,
+   with its ancestors pushed first if we're asked to. */
+std::string match(const char *css, const test_element_t &element, bool is_pushed = true) {
+  auto sheet = parser_t(css).parse_stylesheet();
+  selector_table_t table(sheet);
+  EXPECT_TRUE(table.get_errors().empty()) << css;
+  matcher_t matcher(table);
+  std::vector<const test_element_t *> ancestors;
+  for (auto ancestor = element.get_parent(); is_pushed && ancestor; ancestor = ancestor->get_parent()) {
+    ancestors.push_back(static_cast<const test_element_t *>(ancestor));
+  }
+  std::reverse(ancestors.begin(), ancestors.end());
+  for (auto ancestor: ancestors) {
+    matcher.push(*ancestor);
+  }
+  std::vector<const selector_t *> matched;
+  matcher.match(element, matched);
+  std::string result;
+  for (auto selector: matched) {
+    result += (result.empty() ? "" : " ") + std::to_string(selector->rule - sheet.get_rules().begin());
+  }
+  return result;
+}
+
+/* A small document:
+
+     html
+       body#top.page
+         div#main.a.b[data-x][lang]
+           p.first p.second span p.third
+         ul
+           li li li li li */
+struct document_t final {
+
+  document_t():
+    html("html"),
+    body(html.add("body", {{"id", "top"}, {"class", "page"}})),
+    div(body.add("div", {{"id", "main"}, {"class", "a b"}, {"data-x", "Foo-bar baz"}, {"lang", "en-US"}})),
+    first(div.add("p", {{"class", "first"}})),
+    second(div.add("p", {{"class", "second"}})),
+    span(div.add("span")),
+    third(div.add("p", {{"class", "third"}})),
+    ul(body.add("ul")) {
+    for (int i = 0; i < 5; ++i) {
+      ul.add("li");
+    }
+  }
+
+  test_element_t &get_li(size_t idx) const {
+    return *ul.get_children()[idx];
+  }
+
+  test_element_t html, &body, &div, &first, &second, &span, &third, &ul;
+
+};  // document_t
+
+}  // namespace
+
+TEST(matcher, compounds_and_combinators) {
+  document_t doc;
+  const char *css =
+      "div {} #main {} .a.b {} .a.c {} body > div {} html > div {} html div {} p + span {} "
+      "p ~ span {} span + p {} p + p {} .page p.second {} * {} #top > #main > p.first {}";
+  EXPECT_EQ(match(css, doc.div), "0 1 2 4 6 12");
+  EXPECT_EQ(match(css, doc.first), "12 13");
+  EXPECT_EQ(match(css, doc.second), "10 11 12");
+  EXPECT_EQ(match(css, doc.span), "7 8 12");
+  EXPECT_EQ(match(css, doc.third), "9 12");
+  EXPECT_EQ(match(css, doc.second, false), "10 11 12");
+}
+
+TEST(matcher, attributes) {
+  document_t doc;
+  const char *css =
+      "[data-x] {} [data-x=\"Foo-bar baz\"] {} [data-x=\"foo-bar BAZ\" i] {} [data-x~=baz] {} "
+      "[data-x~=Foo] {} [data-x|=Foo] {} [lang|=en] {} [lang|=EN i] {} [data-x^=Foo] {} "
+      "[data-x$=baz] {} [data-x*=\"-bar \"] {} [data-x*=\"\"] {} [missing] {} [DATA-X] {} "
+      "[data-x=foo-bar] {} [lang|=e] {}";
+  EXPECT_EQ(match(css, doc.div), "0 1 2 3 5 6 7 8 9 10 13");
+  EXPECT_EQ(match(css, doc.span), "");
+}
+
+TEST(matcher, pseudo_classes) {
+  document_t doc;
+  const char *css =
+      ":first-child {} :last-child {} :nth-child(2n+1) {} :nth-child(2) {} :nth-last-child(2) {} "
+      ":nth-child(-n+2) {} :only-child {} :root {} li:hover {} :lang(en) {}";
+  EXPECT_EQ(match(css, doc.get_li(0)), "0 2 5");
+  EXPECT_EQ(match(css, doc.get_li(1)), "3 5");
+  EXPECT_EQ(match(css, doc.get_li(3)), "4");
+  EXPECT_EQ(match(css, doc.get_li(4)), "1 2");
+  EXPECT_EQ(match(css, doc.html), "0 1 2 5 6 7");
+  doc.first.states = {"hover", "langen"};
+  EXPECT_EQ(match(css, doc.first), "0 2 5 9");
+  doc.get_li(2).states = {"hover"};
+  EXPECT_EQ(match(css, doc.get_li(2)), "2 8");
+}
+
+TEST(matcher, of_type) {
+  document_t doc;
+  const char *css =
+      "p:first-of-type {} p:last-of-type {} span:only-of-type {} p:nth-of-type(2) {} "
+      ":nth-last-of-type(1) {} p:only-of-type {}";
+  EXPECT_EQ(match(css, doc.first), "0");
+  EXPECT_EQ(match(css, doc.second), "3");
+  EXPECT_EQ(match(css, doc.span), "2 4");
+  EXPECT_EQ(match(css, doc.third), "1 4");
+}
+
+TEST(matcher, arguments) {
+  document_t doc;
+  const char *css = ":not(p) {} p:not(.first, .third) {} :is(.first, .third) {} :where(div) > p {} :not(div p) {}";
+  EXPECT_EQ(match(css, doc.second), "1 3");
+  EXPECT_EQ(match(css, doc.third), "2 3");
+  EXPECT_EQ(match(css, doc.ul), "0 4");
+}
+
+TEST(matcher, filter_rejects_without_walking_up) {
+  test_element_t root("html");
+  test_element_t *leaf = &root;
+  for (int i = 0; i < 100; ++i) {
+    leaf = &leaf->add("div");
+  }
+  leaf = &leaf->add("span");
+  const char *css = ".missing span {} #nope div span {} html span {}";
+  test_element_t::parent_count = 0;
+  EXPECT_EQ(match(css, *leaf, false), "2");
+  EXPECT_GT(test_element_t::parent_count, size_t(200));
+  size_t unfiltered_count = test_element_t::parent_count;
+  test_element_t::parent_count = 0;
+  EXPECT_EQ(match(css, *leaf), "2");
+  /* The walk up to collect the ancestors to push is ours, not the
+     matcher's. */
+  EXPECT_LT(test_element_t::parent_count, unfiltered_count / 2);
+  auto sheet = parser_t(css).parse_stylesheet();
+  selector_table_t table(sheet);
+  matcher_t matcher(table);
+  matcher.push(root);
+  std::vector<const selector_t *> matched;
+  matcher.match(*root.get_children()[0], matched);
+  EXPECT_TRUE(matched.empty());
+  EXPECT_EQ(matcher.get_filtered_count(), size_t(2));
+}
+
+TEST(matcher, filter_agrees_with_walking_up) {
+  auto root_ptr = make_random_tree(7, 6);
+  const auto &root = *root_ptr;
+  auto sheet = parser_t(
+      "a b {} a > b c {} .xa .yb {} #ia c {} #ib > .xc + b {} b ~ .ya a {} .xb #ic .yc {} "
+      ":not(.xa) c {} :is(#ia, .yc) > b {} a b c a {} .xa.ya .xb.yb .xc.yc {}").parse_stylesheet();
+  selector_table_t table(sheet);
+  matcher_t filtered(table), unfiltered(table);
+  size_t match_count = 0;
+  auto walk = [&](const test_element_t &node, auto &self) -> void {
+    std::vector<const selector_t *> expected, actual;
+    unfiltered.match(node, expected);
+    filtered.match(node, actual);
+    ASSERT_EQ(actual, expected);
+    match_count += actual.size();
+    filtered.push(node);
+    for (const auto &child: node.get_children()) {
+      self(*child, self);
+    }
+    filtered.pop();
+  };
+  walk(root, walk);
+  EXPECT_GT(match_count, size_t(0));
+  EXPECT_GT(filtered.get_filtered_count(), size_t(0));
+}
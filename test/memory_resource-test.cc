@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include <yourcss/lexer.h>
+#include <yourcss/token.h>
+#include "counting_resource.h"
+#include "new_count.h"
+
+using namespace yourcss;
+
+namespace {
+
+const char *src = R"(
+  @media screen {
+    .cool a#b[href^="x"] {
+      something: 123;
+      margin: -1.5em 10% 0;
+      asdf: url(http://danielhood.com);
+      font: bold 12px/1.2 "Helvetica", sans-serif;
+      unicode-range: U+0000aa-00ffff;
+    }
+  }
+)";
+
+}  // namespace
+
+TEST(memory_resource, tokens_come_from_resource) {
+  counting_resource_t resource;
+  counting_resource_t fallback;
+  default_resource_scope_t scope(&fallback);
+  auto tokens = lexer_t(src, &resource).lex();
+  EXPECT_GT(tokens.size(), size_t(0));
+  EXPECT_GE(resource.get_allocation_count(), tokens.size());
+  EXPECT_EQ(fallback.get_allocation_count(), size_t(0));
+  EXPECT_EQ(tokens.get_allocator().resource(), &resource);
+  for (const auto &token: tokens) {
+    EXPECT_EQ(token->get_allocator().resource(), &resource);
+  }
+}
+
+TEST(memory_resource, zero_allocations_per_token) {
+  static char buffer[1 << 16];
+  counting_resource_t upstream;
+  counting_resource_t fallback;
+  size_t token_count = 0;
+  size_t new_count = get_global_new_count();
+  {
+    std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), &upstream);
+    default_resource_scope_t scope(&fallback);
+    auto tokens = lexer_t(src, &arena).lex();
+    token_count = tokens.size();
+  }
+  EXPECT_GT(token_count, size_t(50));
+  EXPECT_EQ(get_global_new_count(), new_count);
+  EXPECT_EQ(upstream.get_allocation_count(), size_t(0));
+  EXPECT_EQ(fallback.get_allocation_count(), size_t(0));
+}
+
+TEST(memory_resource, pool_resource) {
+  std::pmr::unsynchronized_pool_resource pool;
+  auto tokens = lexer_t("a { b: 1px }", &pool).lex();
+  ASSERT_EQ(tokens.size(), size_t(10));
+  EXPECT_EQ(token_t::kind_t::DIMENSION_TOKEN, tokens[7]->get_kind());
+  EXPECT_EQ(tokens[7]->get_text(), std::string("1px"));
+}
+
+TEST(memory_resource, default_resource) {
+  auto tokens = lexer_t("a").lex();
+  ASSERT_EQ(tokens.size(), size_t(1));
+  EXPECT_EQ(tokens.get_allocator().resource(), std::pmr::get_default_resource());
+}
@@ -0,0 +1,128 @@
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <gtest/gtest.h>
+#include <yourcss/lexer.h>
+#include <yourcss/minifier.h>
+
+using namespace yourcss;
+
+namespace {
+
+std::string minify(const char *src) {
+  std::ostringstream strm;
+  minifier_t::minify(src, src + std::strlen(src), strm);
+  return strm.str();
+}
+
+/* The kinds and texts of the tokens of the text, whitespace left out,
+   and the texts of numbers and hashes too, since they're rewritten.  A
+   zero length may become a number. */
+std::string lex_all(const char *src) {
+  std::string result;
+  for (const auto &token: lexer_t(src).lex()) {
+    auto kind = token->get_kind();
+    switch (kind) {
+      case token_t::WHITESPACE_TOKEN: {
+        break;
+      }
+      case token_t::NUMBER_TOKEN:
+      case token_t::DIMENSION_TOKEN: {
+        result += "NUMERIC\n";
+        break;
+      }
+      case token_t::PERCENTAGE_TOKEN:
+      case token_t::HASH_TOKEN: {
+        result += std::string(token_t::get_desc_view(kind)) + '\n';
+        break;
+      }
+      default: {
+        result += std::string(token_t::get_desc_view(kind)) + ' ' + token->get_text() + '\n';
+        break;
+      }
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+TEST(minifier, whitespace_and_comments) {
+  EXPECT_EQ(minify("  /* x */ a  >  b ,  c ~ d  {  color : red  ;  }  "), "a>b,c~d{color:red}");
+  EXPECT_EQ(minify(".a .b, .a:hover, .a :hover { }"), ".a .b,.a:hover,.a :hover{}");
+  EXPECT_EQ(minify("a + b { width: calc( 1px + 2px - 3px ) }"), "a+b{width:calc(1px + 2px - 3px)}");
+  EXPECT_EQ(minify("a { color: red !important ; }"), "a{color:red!important}");
+  EXPECT_EQ(minify("@media screen and (min-width: 10px) { a { b: c } }"), "@media screen and (min-width:10px){a{b:c}}");
+  EXPECT_EQ(minify("\n\t\r\n"), "");
+}
+
+TEST(minifier, nested_rules) {
+  /* An ident and a colon at the start of a statement may be a selector
+     with a pseudo-class rather than a property. */
+  EXPECT_EQ(minify("div { p :hover { color: red } }"), "div{p :hover{color:red}}");
+  EXPECT_EQ(minify("div { p :is(.a) { } a ::before { } b :/**/c { } }"), "div{p :is(.a){}a ::before{}b :c{}}");
+  EXPECT_EQ(minify("div { p:hover #AABBCC { color : #FFFFFF } }"), "div{p:hover #AABBCC{color:#fff}}");
+  EXPECT_EQ(minify("a { color : red; b :1px; border: solid #FFFFFF }"), "a{color:red;b:1px;border:solid #fff}");
+}
+
+TEST(minifier, separates_tokens_which_would_run_together) {
+  EXPECT_EQ(minify("a/**/b"), "a b");
+  EXPECT_EQ(minify("a { margin: 1px/**/-2px }"), "a{margin:1px -2px}");
+  EXPECT_EQ(minify("a { b: 1.0/**/.5 }"), "a{b:1 .5}");
+  EXPECT_EQ(minify("a { b: 0px/**/% }"), "a{b:0 %}");
+  EXPECT_EQ(minify("a { b: x/**/( }"), "a{b:x (}");
+  EXPECT_EQ(minify("a { b: + .5; c: . 5; d: / * }"), "a{b:+ .5;c:. 5;d:/ *}");
+  EXPECT_EQ(minify("[a | = b] [c ~ = d] [e |= 'f' ]"), "[a | = b] [c~ = d] [e|='f']");
+}
+
+TEST(minifier, numbers) {
+  EXPECT_EQ(minify("a { b: 0.50px 0px -0 +1.5 00.0% 010 1.50E+00em 2e-03 1e0 -.250 }"), "a{b:.5px 0 0 1.5 0% 10 1.5em 2e-3 1 -.25}");
+  EXPECT_EQ(minify("a { b: 0s 0deg 0% 0PX }"), "a{b:0s 0deg 0% 0}");
+  EXPECT_EQ(minify("a { b: calc(0px + 1em); flex: 1 1 0px; --c: 0px }"), "a{b:calc(0px + 1em);flex:1 1 0px;--c:0px}");
+  /* Numbers outside declarations are left alone, as in An+B. */
+  EXPECT_EQ(minify("li:nth-child( 2n + 01 ) { }"), "li:nth-child(2n + 01){}");
+  EXPECT_EQ(minify("@media (min-width: 0.50px) { }"), "@media (min-width:0.50px){}");
+}
+
+TEST(minifier, colors) {
+  EXPECT_EQ(minify("a { color: #FFFFFF; b: #AaBbCc88; c: #aabbcd; d: #Abc; e: #ABCDEFG }"), "a{color:#fff;b:#abc8;c:#aabbcd;d:#abc;e:#ABCDEFG}");
+  EXPECT_EQ(minify("a { background: linear-gradient(#000000, #112233) }"), "a{background:linear-gradient(#000,#123)}");
+  /* IDs are case-sensitive, and custom properties are left as they are. */
+  EXPECT_EQ(minify("#AABBCC { --c: #FFFFFF } @media x { #FFFFFF { } }"), "#AABBCC{--c:#FFFFFF}@media x{#FFFFFF{}}");
+}
+
+TEST(minifier, semicolons) {
+  EXPECT_EQ(minify("a { b: c;; d: e; } f { ; }"), "a{b:c;d:e}f{}");
+  EXPECT_EQ(minify("@import 'x.css' ; @import url( y.css );"), "@import 'x.css';@import url( y.css );");
+  EXPECT_EQ(minify("@font-face { src: url(a) ; } @page { margin: 0in ; }"), "@font-face{src:url(a)}@page{margin:0}");
+}
+
+TEST(minifier, keeps_the_meaning) {
+  const char *src = R"css(
+@charset "utf-8";
+@import url("a b.css") screen;
+/* header */
+html, body > .main  :is(#Nav, .x)::before { content: 'a  "b' ; margin : 0px auto -0.5em +1.50% }
+@media (max-width: 600px) and (orientation: landscape) {
+  .a\:b .c[href ^= 'x'] { color: #AABBCC !important; transition: opacity .30s ease-in 0s }
+}
+@keyframes spin { from { transform: rotate(0deg) } 50.0% { opacity: 0.0 } to { transform: rotate(360deg) } }
+.d { width: calc(100% - 2 * 1.0em); grid-area: 1 / 2 / 3; font: 12px/1.50 serif }
+)css";
+  auto minified = minify(src);
+  EXPECT_LT(minified.size(), std::strlen(src) * 6 / 7);
+  EXPECT_EQ(minify(minified.c_str()), minified);
+  EXPECT_EQ(lex_all(minified.c_str()), lex_all(src));
+}
+
+TEST(minifier, visitor) {
+  const char *src = "a { b : 0.50px ; }";
+  std::ostringstream strm;
+  {
+    minifier_t minifier(src, strm, 1);
+    lexer_t(lexer_config_t(0), src).lex(minifier);
+    minifier.finish();
+    EXPECT_EQ(minifier.get_byte_count(), uint64_t(9));
+  }
+  EXPECT_EQ(strm.str(), "a{b:.5px}");
+}
@@ -0,0 +1,37 @@
+#include "new_count.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace yourcss {
+
+namespace {
+
+std::atomic<size_t> global_new_count(0);
+
+}  // namespace
+
+size_t get_global_new_count() {
+  return global_new_count;
+}
+
+}  // yourcss
+
+void *operator new(size_t size) {
+  ++yourcss::global_new_count;
+  if (void *p = std::malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+  std::free(p);
+}
+
+/* The sized delete frees through the unsized one, so the two can't come
+   apart. */
+void operator delete(void *p, size_t) noexcept {
+  operator delete(p);
+}
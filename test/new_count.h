@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+
+namespace yourcss {
+
+/* The number of times the global operator new has been called.  The
+   counting is done by the replacement operator new in new_count.cc,
+   which is linked only into the tests which include this header. */
+size_t get_global_new_count();
+
+}  // yourcss
@@ -274,3 +274,11 @@ TEST(numeric_token, dimension_weird_escaped_name) {
   EXPECT_EQ(token_t::kind_t::WHITESPACE_TOKEN, tokens[2]->get_kind());
   EXPECT_EQ(tokens[1]->get_text(), std::string("123-moz\\*cool"));
 }
+
+TEST(numeric_token, percentage_then_semicolon) {
+  auto tokens = lexer_t("2%;").lex();
+  ASSERT_EQ(tokens.size(), size_t(2));
+  EXPECT_EQ(token_t::kind_t::PERCENTAGE_TOKEN, tokens[0]->get_kind());
+  EXPECT_EQ(tokens[0]->get_text(), std::string("2%"));
+  EXPECT_EQ(token_t::kind_t::SEMICOLON_TOKEN, tokens[1]->get_kind());
+}
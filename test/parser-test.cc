@@ -0,0 +1,345 @@
+#include <string>
+#include <gtest/gtest.h>
+#include <yourcss/parser.h>
+
+using namespace yourcss;
+
+namespace {
+
+const char *src = R"css(<!--
+@charset "utf-8";
+@import url(theme.css) screen;
+.a > b, #c[d="e"]:hover {
+  color: red;
+  -webkit-transition: all 1s;
+  --main-bg: {x};
+  margin: 0 auto !IMPORTANT;
+  background: rgb(1, 2, calc(3 + 4)) url(x.png);
+}
+@media (min-width: 600px) {
+  .f { width: 50%; }
+  @supports (display: grid) { .g { display: grid } }
+}
+@font-face { font-family: "X"; src: url(x.woff) }
+@-webkit-keyframes spin { from { opacity: 0 } 100% { opacity: 1 } }
+@unknown foo { bar ; baz }
+-->)css";
+
+/* The prelude, as text, with whitespace where there was some. */
+std::string join(const node_list_t<component_value_t> &values) {
+  std::string result;
+  for (const auto &value: values) {
+    if (value.preceded_by_whitespace && !result.empty()) {
+      result += ' ';
+    }
+    switch (value.kind) {
+      case component_value_t::TOKEN: {
+        switch (value.token_kind) {
+          case token_t::HASH_TOKEN: result += '#'; break;
+          case token_t::COLON_TOKEN: result += ':'; break;
+          case token_t::SEMICOLON_TOKEN: result += ';'; break;
+          case token_t::COMMA_TOKEN: result += ','; break;
+          case token_t::RIGHT_BRACE_TOKEN: result += '}'; break;
+          default: break;
+        }
+        result += std::string(value.text);
+        break;
+      }
+      case component_value_t::FUNCTION: {
+        result += std::string(value.text) + "(" + join(value.values) + ")";
+        break;
+      }
+      case component_value_t::BLOCK: {
+        const char *brackets =
+            (value.token_kind == token_t::LEFT_BRACE_TOKEN) ? "{}" :
+            (value.token_kind == token_t::LEFT_BRACKET_TOKEN) ? "[]" : "()";
+        result += brackets[0] + join(value.values) + brackets[1];
+        break;
+      }
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+TEST(parser, stylesheet) {
+  auto sheet = parser_t(src).parse_stylesheet();
+  EXPECT_TRUE(sheet.get_errors().empty());
+  const auto &rules = sheet.get_rules();
+  ASSERT_EQ(rules.size(), size_t(7));
+
+  EXPECT_EQ(rules[0].kind, rule_t::AT);
+  EXPECT_EQ(rules[0].name, "charset");
+  EXPECT_EQ(rules[0].block.kind, block_t::NONE);
+  EXPECT_EQ(rules[0].prelude[0].token_kind, token_t::STRING_TOKEN);
+  EXPECT_EQ(rules[1].name, "import");
+  EXPECT_EQ(join(rules[1].prelude), "theme.css screen");
+
+  const auto &style = rules[2];
+  EXPECT_EQ(style.kind, rule_t::QUALIFIED);
+  EXPECT_EQ(style.pos.get_line(), uint64_t(4));
+  EXPECT_EQ(join(style.prelude), ".a > b, #c[d=e]:hover");
+  EXPECT_EQ(style.block.kind, block_t::DECLARATIONS);
+  const auto &declarations = style.block.declarations;
+  ASSERT_EQ(declarations.size(), size_t(5));
+  EXPECT_EQ(declarations[0].name, "color");
+  EXPECT_EQ(join(declarations[0].value), "red");
+  EXPECT_EQ(declarations[1].name, "-webkit-transition");
+  EXPECT_EQ(join(declarations[1].value), "all 1s");
+  EXPECT_EQ(declarations[1].value[1].value, 1.0);
+  EXPECT_EQ(declarations[2].name, "--main-bg");
+  EXPECT_EQ(join(declarations[2].value), "{x}");
+  EXPECT_EQ(declarations[3].name, "margin");
+  EXPECT_EQ(join(declarations[3].value), "0 auto");
+  EXPECT_TRUE(declarations[3].important);
+  EXPECT_FALSE(declarations[2].important);
+  EXPECT_EQ(join(declarations[4].value), "rgb(1, 2, calc(3 + 4)) x.png");
+  EXPECT_EQ(declarations[4].pos.get_line(), uint64_t(9));
+  EXPECT_EQ(declarations[4].pos.get_col(), uint64_t(3));
+
+  const auto &media = rules[3];
+  EXPECT_EQ(media.name, "media");
+  EXPECT_EQ(join(media.prelude), "(min-width: 600px)");
+  ASSERT_EQ(media.block.kind, block_t::RULES);
+  ASSERT_EQ(media.block.rules.size(), size_t(2));
+  EXPECT_EQ(media.block.rules[0].block.declarations[0].value[0].value, 50.0);
+  const auto &supports = media.block.rules[1];
+  EXPECT_EQ(supports.name, "supports");
+  ASSERT_EQ(supports.block.rules.size(), size_t(1));
+  EXPECT_EQ(join(supports.block.rules[0].prelude), ".g");
+  EXPECT_EQ(join(supports.block.rules[0].block.declarations[0].value), "grid");
+
+  EXPECT_EQ(rules[4].block.kind, block_t::DECLARATIONS);
+  EXPECT_EQ(rules[4].block.declarations.size(), size_t(2));
+
+  const auto &keyframes = rules[5];
+  ASSERT_EQ(keyframes.block.kind, block_t::RULES);
+  ASSERT_EQ(keyframes.block.rules.size(), size_t(2));
+  EXPECT_EQ(join(keyframes.block.rules[1].prelude), "100%");
+  EXPECT_EQ(join(keyframes.block.rules[1].block.declarations[0].value), "1");
+
+  EXPECT_EQ(rules[6].block.kind, block_t::VALUES);
+  EXPECT_EQ(join(rules[6].block.values), "bar ; baz");
+}
+
+TEST(parser, dimension_values_are_only_the_number) {
+  /* The number is 0 and the unit is x10px; strtod would read 16. */
+  auto sheet = parser_t("a { width: 0x10px; height: 1.5e1em }").parse_stylesheet();
+  const auto &declarations = sheet.get_rules()[0].block.declarations;
+  ASSERT_EQ(declarations.size(), size_t(2));
+  EXPECT_EQ(declarations[0].value[0].token_kind, token_t::DIMENSION_TOKEN);
+  EXPECT_EQ(declarations[0].value[0].value, 0.0);
+  EXPECT_EQ(declarations[1].value[0].value, 15.0);
+}
+
+TEST(parser, recovers_from_bad_declarations) {
+  auto sheet = parser_t("a { color red; (x: y); width: 1px; 5 } b { c: d }").parse_stylesheet();
+  ASSERT_EQ(sheet.get_rules().size(), size_t(2));
+  const auto &declarations = sheet.get_rules()[0].block.declarations;
+  ASSERT_EQ(declarations.size(), size_t(1));
+  EXPECT_EQ(declarations[0].name, "width");
+  ASSERT_EQ(sheet.get_errors().size(), size_t(3));
+  EXPECT_EQ(sheet.get_errors()[0].get_code(), parser_error_t::BAD_DECLARATION);
+  EXPECT_EQ(sheet.get_errors()[0].get_pos().get_col(), uint64_t(11));
+  EXPECT_EQ(sheet.get_rules()[1].block.declarations.size(), size_t(1));
+}
+
+TEST(parser, unexpected_end) {
+  auto sheet = parser_t("a { b: c(d, [e").parse_stylesheet();
+  ASSERT_EQ(sheet.get_rules().size(), size_t(1));
+  EXPECT_EQ(join(sheet.get_rules()[0].block.declarations[0].value), "c(d, [e])");
+  EXPECT_EQ(sheet.get_errors().size(), size_t(3));
+  for (const auto &error: sheet.get_errors()) {
+    EXPECT_EQ(error.get_code(), parser_error_t::UNEXPECTED_END);
+  }
+  auto dropped = parser_t("a { } b c").parse_stylesheet();
+  EXPECT_EQ(dropped.get_rules().size(), size_t(1));
+  EXPECT_EQ(dropped.get_errors().size(), size_t(1));
+}
+
+TEST(parser, stray_brace_at_top_level) {
+  auto sheet = parser_t("} a { b: c }").parse_stylesheet();
+  ASSERT_EQ(sheet.get_rules().size(), size_t(1));
+  EXPECT_EQ(join(sheet.get_rules()[0].prelude), "} a");
+}
+
+TEST(parser, nodes_outlive_a_move) {
+  stylesheet_t moved;
+  {
+    auto sheet = parser_t("a { b: c }").parse_stylesheet();
+    moved = std::move(sheet);
+  }
+  EXPECT_EQ(moved.get_rules()[0].block.declarations[0].name, "b");
+}
+
+TEST(parser, at_rule_kinds) {
+  EXPECT_EQ(block_t::get_at_rule_kind("MEDIA"), block_t::RULES);
+  EXPECT_EQ(block_t::get_at_rule_kind("-moz-document"), block_t::RULES);
+  EXPECT_EQ(block_t::get_at_rule_kind("page"), block_t::DECLARATIONS);
+  EXPECT_EQ(block_t::get_at_rule_kind("top-left"), block_t::DECLARATIONS);
+  EXPECT_EQ(block_t::get_at_rule_kind("--media"), block_t::VALUES);
+  EXPECT_EQ(block_t::get_at_rule_kind("whatever"), block_t::VALUES);
+}
+
+TEST(parser, lazy_blocks_expand_as_eager_ones_parse) {
+  auto eager = parser_t(src).parse_stylesheet();
+  parser_t parser(src);
+  parser.set_lazy(true);
+  auto lazy = parser.parse_stylesheet();
+  EXPECT_TRUE(lazy.get_errors().empty());
+  ASSERT_EQ(lazy.get_rules().size(), eager.get_rules().size());
+  const auto &style = lazy.get_rules()[2];
+  EXPECT_EQ(join(style.prelude), ".a > b, #c[d=e]:hover");
+  EXPECT_TRUE(style.block.is_deferred);
+  EXPECT_TRUE(style.block.declarations.empty());
+  const auto &block = lazy.expand(style.block);
+  EXPECT_FALSE(block.is_deferred);
+  const auto &expected = eager.get_rules()[2].block.declarations;
+  ASSERT_EQ(block.declarations.size(), expected.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(block.declarations[i].name, expected[i].name);
+    EXPECT_EQ(join(block.declarations[i].value), join(expected[i].value));
+    EXPECT_EQ(block.declarations[i].important, expected[i].important);
+    EXPECT_EQ(block.declarations[i].pos.get_line(), expected[i].pos.get_line());
+    EXPECT_EQ(block.declarations[i].pos.get_col(), expected[i].pos.get_col());
+    EXPECT_EQ(block.declarations[i].pos.get_offset(), expected[i].pos.get_offset());
+  }
+  /* Expanding again gives back what we have. */
+  EXPECT_EQ(lazy.expand(style.block).declarations.begin(), block.declarations.begin());
+  /* Blocks of rules are parsed as usual, but the blocks in them wait. */
+  const auto &media = lazy.get_rules()[3];
+  ASSERT_EQ(media.block.rules.size(), size_t(2));
+  EXPECT_TRUE(media.block.rules[0].block.is_deferred);
+  EXPECT_EQ(media.block.rules[1].pos.get_offset(), eager.get_rules()[3].block.rules[1].pos.get_offset());
+  EXPECT_EQ(join(lazy.expand(lazy.get_rules()[4].block).declarations[1].value), "x.woff");
+  EXPECT_EQ(lazy.get_rules()[6].block.kind, block_t::VALUES);
+}
+
+TEST(parser, lazy_blocks_skip_brackets_in_strings_comments_and_escapes) {
+  const char *text = "a { b: \"}\" '{'; /* } */ c: \\} (}) [ ) ] { ] }; d: e }\nf\n{ g: h } i { j";
+  parser_t parser(text);
+  parser.set_lazy(true);
+  auto sheet = parser.parse_stylesheet();
+  ASSERT_EQ(sheet.get_rules().size(), size_t(3));
+  EXPECT_EQ(join(sheet.get_rules()[1].prelude), "f");
+  EXPECT_EQ(sheet.get_rules()[1].pos.get_line(), uint64_t(2));
+  EXPECT_EQ(sheet.get_rules()[2].pos.get_col(), uint64_t(10));
+  ASSERT_EQ(sheet.get_errors().size(), size_t(1));
+  EXPECT_EQ(sheet.get_errors()[0].get_code(), parser_error_t::UNEXPECTED_END);
+  const auto &declarations = sheet.expand(sheet.get_rules()[0].block).declarations;
+  ASSERT_EQ(declarations.size(), size_t(3));
+  EXPECT_EQ(declarations[1].name, "c");
+  EXPECT_EQ(declarations[2].name, "d");
+  EXPECT_EQ(sheet.expand(sheet.get_rules()[2].block).declarations.size(), size_t(0));
+  EXPECT_EQ(sheet.get_errors().size(), size_t(2));
+  /* An escaped quote doesn't end a string. */
+  parser_t escaped("a { b: 'c\\'}' } d { }");
+  escaped.set_lazy(true);
+  EXPECT_EQ(escaped.parse_stylesheet().get_rules().size(), size_t(2));
+}
+
+TEST(parser, lazy_blocks_skip_urls) {
+  /* Brackets, quotes and comment openers in a url are all part of it. */
+  for (const char *text: {
+      "a{b:url(x{y)} c{d:e}",
+      "a{b:url(x[y)} c{d:e}",
+      "a{b:url(x(y)} c{d:e}",
+      "a{b:url(/*.png)} c{d:e} f{g:h}",
+      "a{b:url(it's.png)} c{d:e}\nf{g:h}",
+      "a{b:url( \"{\" ) url('x' {y)} c{d:myurl(e)}"}) {
+    auto eager = parser_t(text).parse_stylesheet();
+    parser_t parser(text);
+    parser.set_lazy(true);
+    auto lazy = parser.parse_stylesheet();
+    ASSERT_EQ(lazy.get_rules().size(), eager.get_rules().size()) << text;
+    for (size_t i = 0; i < eager.get_rules().size(); ++i) {
+      const auto &rule = lazy.get_rules()[i], &expected = eager.get_rules()[i];
+      EXPECT_EQ(join(rule.prelude), join(expected.prelude)) << text;
+      EXPECT_EQ(rule.pos.get_offset(), expected.pos.get_offset()) << text;
+      const auto &declarations = lazy.expand(rule.block).declarations;
+      ASSERT_EQ(declarations.size(), expected.block.declarations.size()) << text;
+      for (size_t j = 0; j < declarations.size(); ++j) {
+        EXPECT_EQ(declarations[j].name, expected.block.declarations[j].name) << text;
+        EXPECT_EQ(join(declarations[j].value), join(expected.block.declarations[j].value)) << text;
+      }
+    }
+    EXPECT_EQ(lazy.get_errors().size(), eager.get_errors().size()) << text;
+  }
+}
+
+TEST(parser, parallel_parse_matches_serial_parse) {
+  /* Enough rules to be cut into a few pieces, with all the things which
+     could confuse the cutting. */
+  std::string text = "<!-- @charset \"utf-8\";\n";
+  for (int i = 0; i < 4000; ++i) {
+    text += ".a" + std::to_string(i) + " > b[c='}'], d:not(.e) { color: red; /* } */ f: g(\"{\") }\n";
+    if (i % 50 == 0) {
+      text += "@media (x: y) { .h { i: j } @supports (k) { .l { m: n } } }\n} stray { o: p }\n";
+    }
+    if (i % 700 == 0) {
+      text += "bad { q r; (s) } @import url(t);\n";
+    }
+  }
+  text += "--> u { v: w";
+  thread_pool_t pool(4);
+  for (bool is_lazy: {false, true}) {
+    parser_t serial_parser(text.c_str());
+    serial_parser.set_lazy(is_lazy);
+    auto serial = serial_parser.parse_stylesheet();
+    parser_t parallel_parser(text.c_str());
+    parallel_parser.set_lazy(is_lazy);
+    auto parallel = parallel_parser.parse_stylesheet(pool);
+    const auto &expected = serial.get_rules(), &actual = parallel.get_rules();
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+      ASSERT_EQ(actual[i].pos.get_offset(), expected[i].pos.get_offset());
+      ASSERT_EQ(actual[i].pos.get_line(), expected[i].pos.get_line());
+      ASSERT_EQ(actual[i].pos.get_col(), expected[i].pos.get_col());
+      ASSERT_EQ(join(actual[i].prelude), join(expected[i].prelude));
+      const auto &actual_block = parallel.expand(actual[i].block), &expected_block = serial.expand(expected[i].block);
+      ASSERT_EQ(actual_block.declarations.size(), expected_block.declarations.size());
+      for (size_t j = 0; j < expected_block.declarations.size(); ++j) {
+        ASSERT_EQ(actual_block.declarations[j].pos.get_offset(), expected_block.declarations[j].pos.get_offset());
+        ASSERT_EQ(join(actual_block.declarations[j].value), join(expected_block.declarations[j].value));
+      }
+      ASSERT_EQ(actual_block.rules.size(), expected_block.rules.size());
+    }
+    ASSERT_EQ(parallel.get_errors().size(), serial.get_errors().size());
+    EXPECT_GT(serial.get_errors().size(), size_t(5));
+    for (size_t i = 0; i < serial.get_errors().size(); ++i) {
+      EXPECT_EQ(parallel.get_errors()[i].get_pos().get_offset(), serial.get_errors()[i].get_pos().get_offset());
+      EXPECT_EQ(parallel.get_errors()[i].get_code(), serial.get_errors()[i].get_code());
+    }
+  }
+}
+
+TEST(parser, parallel_parse_throws_the_first_error) {
+  std::string text;
+  for (int i = 0; i < 20000; ++i) {
+    text += ".a" + std::to_string(i) + " { b: c }\n";
+    if (i == 9000 || i == 15000) {
+      text += ".d { e: 1.x }\n";
+    }
+  }
+  uint64_t expected = 0;
+  try {
+    parser_t(text.c_str()).parse_stylesheet();
+  } catch (const yourcss::error_t &error) {
+    expected = error.get_pos().get_offset();
+  }
+  ASSERT_NE(expected, uint64_t(0));
+  thread_pool_t pool(4);
+  try {
+    parser_t(text.c_str()).parse_stylesheet(pool);
+    FAIL();
+  } catch (const yourcss::error_t &error) {
+    EXPECT_EQ(error.get_pos().get_offset(), expected);
+  }
+}
+
+TEST(parser, parallel_parse_of_a_small_text_is_serial) {
+  thread_pool_t pool(2);
+  auto sheet = parser_t("a { b: c } d { e: f }").parse_stylesheet(pool);
+  EXPECT_EQ(sheet.get_rules().size(), size_t(2));
+}
@@ -0,0 +1,70 @@
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <gtest/gtest.h>
+#include <yourcss/lexer.h>
+#include <yourcss/token.h>
+
+using namespace yourcss;
+
+TEST(pos, offset_follows_lines_and_cols) {
+  pos_t pos;
+  EXPECT_EQ(pos.get_offset(), uint64_t(0));
+  pos.next_col();
+  pos.next_col();
+  pos.next_line();
+  pos.next_col();
+  EXPECT_EQ(pos.get_line(), uint64_t(2));
+  EXPECT_EQ(pos.get_col(), uint64_t(2));
+  EXPECT_EQ(pos.get_offset(), uint64_t(4));
+}
+
+TEST(pos, no_overflow_past_32_bits) {
+  uint64_t big = uint64_t(1) << 33;
+  pos_t pos(1, big, big);
+  pos.next_col();
+  EXPECT_EQ(pos.get_col(), big + 1);
+  EXPECT_EQ(pos.get_offset(), big + 1);
+}
+
+TEST(pos, offsets_slice_the_source) {
+  const char *src = "a {\n  color: red;\n}";
+  auto tokens = lexer_t(src).lex();
+  for (const auto &token: tokens) {
+    auto text = token->get_text();
+    if (!text.empty()) {
+      EXPECT_EQ(std::string(src + token->get_pos().get_offset(), text.size()), text);
+    }
+  }
+}
+
+TEST(pos, positions_survive_lookahead) {
+  auto tokens = lexer_t("@-\nx\n  y").lex();
+  auto last = tokens.back();
+  EXPECT_EQ(last->get_text(), "y");
+  EXPECT_EQ(last->get_pos().get_line(), uint64_t(3));
+  EXPECT_EQ(last->get_pos().get_col(), uint64_t(3));
+  EXPECT_EQ(last->get_pos().get_offset(), uint64_t(7));
+}
+
+TEST(pos, bounded_text_needs_no_terminator) {
+  std::string src = "a { b: 1 }";
+  const char text[] = {'a', ' ', '1', 'e', '5'};
+  auto tokens = lexer_t(text, text + sizeof(text)).lex();
+  ASSERT_EQ(tokens.size(), size_t(3));
+  EXPECT_EQ(tokens[2]->get_text(), "1e5");
+  auto stops = lexer_t(src.data(), src.data() + 3).lex();
+  ASSERT_EQ(stops.size(), size_t(3));
+  EXPECT_EQ(stops[2]->get_kind(), token_t::LEFT_BRACE_TOKEN);
+}
+
+TEST(pos, pieces_report_absolute_positions) {
+  const char *src = "a {}\nb {}";
+  const char *piece = std::strchr(src, 'b');
+  pos_t start(2, 1, static_cast<uint64_t>(piece - src));
+  auto tokens = lexer_t(piece, src + std::strlen(src), start).lex();
+  ASSERT_FALSE(tokens.empty());
+  EXPECT_EQ(tokens[0]->get_pos().get_line(), uint64_t(2));
+  EXPECT_EQ(tokens[0]->get_pos().get_offset(), uint64_t(5));
+  EXPECT_EQ(tokens.back()->get_pos().get_offset(), uint64_t(8));
+}
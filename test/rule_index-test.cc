@@ -0,0 +1,140 @@
+#include <atomic>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "test_element.h"
+#include <yourcss/matcher.h>
+#include <yourcss/parser.h>
+#include <yourcss/rule_index.h>
+#include <yourcss/selector.h>
+#include <yourcss/thread_pool.h>
+
+using namespace yourcss;
+
+namespace {
+
+/* The bucket's selector indices, space-separated. */
+std::string render(const rule_index_t::bucket_t &bucket) {
+  std::string result;
+  for (auto idx: bucket) {
+    result += (result.empty() ? "" : " ") + std::to_string(idx);
+  }
+  return result;
+}
+
+/* The bucket of the name, or an empty one if it was never interned. */
+rule_index_t::bucket_t find(const rule_index_t &index, simple_selector_t::kind_t kind, const char *name) {
+  return index.find(kind, index.get_table().get_atoms().find(name));
+}
+
+/* The selectors matching each element of the tree, root first, with
+   the index or without it. */
+std::vector<std::vector<const selector_t *>> match_all(
+    const test_element_t &root, const selector_table_t &table, const rule_index_t *index) {
+  matcher_t matcher(table);
+  std::vector<std::vector<const selector_t *>> result;
+  auto walk = [&](const test_element_t &element, auto &self) -> void {
+    result.emplace_back();
+    if (index) {
+      matcher.match(element, *index, result.back());
+    } else {
+      matcher.match(element, result.back());
+    }
+    matcher.push(element);
+    for (const auto &child: element.get_children()) {
+      self(*child, self);
+    }
+    matcher.pop();
+  };
+  walk(root, walk);
+  return result;
+}
+
+/* Rules in the style of a framework: each keyed on a class, a few on an ID
+   or a type, and some on nothing. */
+const char *random_css =
+    "a {} b {} c {} * {} [title] {} :hover {} .xa {} .xb {} .xc {} .ya {} .yb {} .yc {} #ia {} #ib {} #ic {} "
+    "a b {} a > b c {} .xa .yb {} #ia c {} #ib > .xc + b {} b ~ .ya a {} .xb #ic .yc {} :not(.xa) c {} "
+    ":is(#ia, .yc) > b {} a b c a {} .xa.ya .xb.yb .xc.yc {} a.xa {} .ya.xb {} #ia.xa.ya {} .zz {} #zz b {} "
+    "a .xa, b .xa, .yb.xa {} .xa::before {}";
+
+}  // namespace
+
+TEST(rule_index, buckets_by_rightmost_key) {
+  auto sheet = parser_t(
+      "#a.b c {} .b.c {} div.x {} div {} * {} [x] {} :hover {} a #b {} .c > span {} ::before {} "
+      "DIV#b.y {} .x {}").parse_stylesheet();
+  selector_table_t table(sheet);
+  ASSERT_TRUE(table.get_errors().empty());
+  rule_index_t index(table);
+  EXPECT_EQ(render(find(index, simple_selector_t::TAG, "c")), "0");
+  EXPECT_EQ(render(find(index, simple_selector_t::CLASS, "b")), "1");
+  EXPECT_EQ(render(find(index, simple_selector_t::CLASS, "x")), "2 11");
+  EXPECT_EQ(render(find(index, simple_selector_t::TAG, "div")), "3");
+  EXPECT_EQ(render(find(index, simple_selector_t::ID, "b")), "7 10");
+  EXPECT_EQ(render(find(index, simple_selector_t::TAG, "span")), "8");
+  EXPECT_EQ(render(index.get_universal()), "4 5 6 9");
+  EXPECT_EQ(index.get_bucket_count(), size_t(6));
+  EXPECT_TRUE(find(index, simple_selector_t::ID, "a").empty());
+  EXPECT_TRUE(find(index, simple_selector_t::CLASS, "c").empty());
+  EXPECT_TRUE(find(index, simple_selector_t::CLASS, "y").empty());
+  EXPECT_TRUE(find(index, simple_selector_t::TAG, "nowhere").empty());
+  EXPECT_EQ(rule_index_t::get_key(table, table.get_selectors()[4]), nullptr);
+}
+
+TEST(rule_index, many_buckets) {
+  std::string css;
+  for (int i = 0; i < 3000; ++i) {
+    css += ".c" + std::to_string(i % 1000) + ", #i" + std::to_string(i % 7) + " {}\n";
+  }
+  auto sheet = parser_t(css.c_str()).parse_stylesheet();
+  selector_table_t table(sheet);
+  rule_index_t index(table);
+  EXPECT_EQ(index.get_bucket_count(), size_t(1007));
+  EXPECT_TRUE(index.get_universal().empty());
+  for (int i = 0; i < 1000; ++i) {
+    auto name = "c" + std::to_string(i);
+    auto bucket = find(index, simple_selector_t::CLASS, name.c_str());
+    ASSERT_EQ(bucket.size(), size_t(3)) << name;
+    for (size_t j = 0; j < 3; ++j) {
+      EXPECT_EQ(bucket.begin()[j], (j * 1000 + size_t(i)) * 2);
+    }
+  }
+  EXPECT_EQ(find(index, simple_selector_t::ID, "i3").size(), size_t(429));
+}
+
+TEST(rule_index, agrees_with_matching_everything) {
+  auto root = make_random_tree(11, 6);
+  auto sheet = parser_t(random_css).parse_stylesheet();
+  selector_table_t table(sheet);
+  ASSERT_TRUE(table.get_errors().empty());
+  rule_index_t index(table);
+  auto expected = match_all(*root, table, nullptr);
+  auto actual = match_all(*root, table, &index);
+  ASSERT_EQ(actual.size(), expected.size());
+  size_t match_count = 0;
+  for (size_t i = 0; i < actual.size(); ++i) {
+    ASSERT_EQ(actual[i], expected[i]) << i;
+    match_count += actual[i].size();
+  }
+  EXPECT_GT(match_count, actual.size());
+}
+
+TEST(rule_index, shared_across_threads) {
+  auto root = make_random_tree(5, 5);
+  auto sheet = parser_t(random_css).parse_stylesheet();
+  selector_table_t table(sheet);
+  const rule_index_t index(table);
+  auto expected = match_all(*root, table, nullptr);
+  std::atomic<size_t> mismatch_count(0);
+  thread_pool_t pool(4);
+  for (int i = 0; i < 16; ++i) {
+    pool.submit([&] {
+      if (match_all(*root, table, &index) != expected) {
+        ++mismatch_count;
+      }
+    });
+  }
+  pool.wait();
+  EXPECT_EQ(mismatch_count.load(), size_t(0));
+}
@@ -1,9 +1,96 @@
+#include <string>
 #include <gtest/gtest.h>
 #include <yourcss/lexer.h>
+#include <yourcss/parser.h>
+#include <yourcss/selector.h>
 #include <yourcss/token.h>
 
 using namespace yourcss;
 
+namespace {
+
+/* A sheet and the selectors compiled from it. */
+struct compiled_t final {
+
+  explicit compiled_t(const char *src):
+    sheet(parser_t(src).parse_stylesheet()),
+    table(sheet) {}
+
+  stylesheet_t sheet;
+
+  selector_table_t table;
+
+};  // compiled_t
+
+std::string render(const selector_table_t &table, const selector_t &selector);
+
+/* The simple selector as CSS. */
+std::string render(const selector_table_t &table, const simple_selector_t &simple) {
+  const auto &atoms = table.get_atoms();
+  std::string name(atoms.get_text(simple.name)), value(atoms.get_text(simple.value));
+  switch (simple.kind) {
+    case simple_selector_t::ID: return '#' + name;
+    case simple_selector_t::CLASS: return '.' + name;
+    case simple_selector_t::TAG: return name;
+    case simple_selector_t::UNIVERSAL: return "*";
+    case simple_selector_t::ATTRIBUTE: {
+      const char *matches[] = {"", "=", "~=", "|=", "^=", "$=", "*="};
+      return '[' + name + matches[simple.match] + value + (simple.is_case_insensitive ? " i]" : "]");
+    }
+    case simple_selector_t::PSEUDO_CLASS: return ':' + name + (value.empty() ? "" : '(' + value + ')');
+    case simple_selector_t::NTH: {
+      return ':' + name + '(' + std::to_string(simple.nth.a) + "n" + (simple.nth.b < 0 ? "" : "+")
+          + std::to_string(simple.nth.b) + ')';
+    }
+    case simple_selector_t::NOT:
+    case simple_selector_t::IS: {
+      std::string result = ':' + name + '(';
+      for (uint32_t i = 0; i < simple.arguments.count; ++i) {
+        result += (i ? ", " : "") + render(table, table.get_arguments()[simple.arguments.first + i]);
+      }
+      return result + ')';
+    }
+  }
+  return "?";
+}
+
+/* The selector as laid out: compound by compound from right to left, each
+   followed by the combinator to the next. */
+std::string render(const selector_table_t &table, const selector_t &selector) {
+  std::string result;
+  for (uint32_t i = selector.first; i < selector.first + selector.count; ++i) {
+    const auto &simple = table.get_simple_selectors()[i];
+    result += render(table, simple);
+    const char *relations[] = {"", " ", " > ", " + ", " ~ ", ""};
+    result += relations[simple.relation];
+  }
+  auto pseudo_element = table.get_atoms().get_text(selector.pseudo_element);
+  if (!pseudo_element.empty()) {
+    result += "::" + std::string(pseudo_element);
+  }
+  return result;
+}
+
+/* The only selector in the text, laid out, or its error. */
+std::string compile(const char *src) {
+  compiled_t compiled(src);
+  const auto &table = compiled.table;
+  if (!table.get_errors().empty()) {
+    return table.get_errors().front().get_detail();
+  }
+  EXPECT_EQ(table.get_selectors().size(), size_t(1)) << src;
+  return table.get_selectors().empty() ? "" : render(table, table.get_selectors()[0]);
+}
+
+/* The specificity of the only selector in the text. */
+uint32_t get_specificity(const char *src) {
+  compiled_t compiled(src);
+  EXPECT_EQ(compiled.table.get_selectors().size(), size_t(1)) << src;
+  return compiled.table.get_selectors().empty() ? 0 : compiled.table.get_selectors()[0].specificity;
+}
+
+}  // namespace
+
 TEST(selector, at_regular_name) {
   const char *src = R"(
     .cool {
@@ -32,3 +119,166 @@ TEST(selector, at_regular_name) {
   EXPECT_EQ(token_t::kind_t::WHITESPACE_TOKEN, tokens[17]->get_kind());
   EXPECT_EQ(token_t::kind_t::RIGHT_BRACE_TOKEN, tokens[18]->get_kind());
 }
+
+TEST(selector, lays_out_compounds_right_to_left) {
+  EXPECT_EQ(compile("a > b.c + d ~ e f {}"), "f e ~ d + .cb > a");
+  EXPECT_EQ(compile("a>b{}"), "b > a");
+  EXPECT_EQ(compile("a\t/* x */\n b {}"), "b a");
+  compiled_t compiled("a > .b {}");
+  const auto &simple_selectors = compiled.table.get_simple_selectors();
+  ASSERT_EQ(simple_selectors.size(), size_t(2));
+  EXPECT_EQ(simple_selectors[0].kind, simple_selector_t::CLASS);
+  EXPECT_EQ(simple_selectors[0].relation, simple_selector_t::CHILD);
+  EXPECT_EQ(simple_selectors[1].kind, simple_selector_t::TAG);
+  EXPECT_EQ(simple_selectors[1].relation, simple_selector_t::LAST);
+  EXPECT_EQ(compiled.table.get_selectors()[0].rule, &compiled.sheet.get_rules()[0]);
+}
+
+TEST(selector, sorts_compounds_and_drops_redundant_universals) {
+  EXPECT_EQ(compile("a:hover[x].b#c {}"), "#c.ba[x]:hover");
+  EXPECT_EQ(compile("*.a {}"), ".a");
+  EXPECT_EQ(compile("* {}"), "*");
+  EXPECT_EQ(compile("*|* > ns|a |b {}"), "b a > *");
+}
+
+TEST(selector, interns_names) {
+  compiled_t compiled("DIV.Foo#Bar, div.foo, [HREF] {}");
+  const auto &atoms = compiled.table.get_atoms();
+  const auto &selectors = compiled.table.get_selectors();
+  ASSERT_EQ(selectors.size(), size_t(3));
+  EXPECT_EQ(render(compiled.table, selectors[0]), "#Bar.Foodiv");
+  EXPECT_EQ(render(compiled.table, selectors[2]), "[href]");
+  /* Types and attribute names are lowered; classes and IDs aren't. */
+  const auto &simple_selectors = compiled.table.get_simple_selectors();
+  EXPECT_EQ(simple_selectors[2].name, simple_selectors[4].name);
+  EXPECT_NE(simple_selectors[1].name, simple_selectors[3].name);
+  EXPECT_EQ(atoms.find("Foo"), simple_selectors[1].name);
+  EXPECT_EQ(atoms.find("bar"), atom_table_t::none);
+  EXPECT_EQ(atoms.get_text(atom_table_t::none), "");
+}
+
+TEST(selector, attribute_matchers) {
+  EXPECT_EQ(compile("[a] {}"), "[a]");
+  EXPECT_EQ(compile("[a=b] {}"), "[a=b]");
+  EXPECT_EQ(compile("[a~='b c'] {}"), "[a~=b c]");
+  EXPECT_EQ(compile("[a|=b] {}"), "[a|=b]");
+  EXPECT_EQ(compile("[a^=b] {}"), "[a^=b]");
+  EXPECT_EQ(compile("[a$=b] {}"), "[a$=b]");
+  EXPECT_EQ(compile("[a*=b] {}"), "[a*=b]");
+  EXPECT_EQ(compile("[ a = \"B\" i ] {}"), "[a=b i]");
+  EXPECT_EQ(compile("[a=B s] {}"), "[a=B]");
+  EXPECT_EQ(compile("[*|a=b] {}"), "[a=b]");
+  EXPECT_EQ(compile("[a=b c] {}"), "unexpected in an attribute selector");
+  EXPECT_EQ(compile("[a=] {}"), "expected an attribute value");
+  EXPECT_EQ(compile("[=b] {}"), "expected an attribute name");
+}
+
+TEST(selector, pseudo_classes_and_elements) {
+  EXPECT_EQ(compile("A:HOVER::Before {}"), "a:hover::before");
+  EXPECT_EQ(compile("a:after {}"), "a::after");
+  EXPECT_EQ(compile("::selection {}"), "*::selection");
+  EXPECT_EQ(compile("a::before:hover {}"), "a:hover::before");
+  EXPECT_EQ(compile("a:lang(en) {}"), "a:lang(en)");
+  EXPECT_EQ(compile("a::before b {}"), "pseudo-element not at the end of the selector");
+  EXPECT_EQ(compile("a::before.b {}"), "only pseudo-classes may follow a pseudo-element");
+  EXPECT_EQ(compile("a::before::after {}"), "more than one pseudo-element");
+  EXPECT_EQ(compile(":not(::before) {}"), "pseudo-element in the argument of a pseudo-class");
+  EXPECT_EQ(compile("a: hover {}"), "expected a name after ':'");
+}
+
+TEST(selector, nth) {
+  EXPECT_EQ(compile(":nth-child(2n+1) {}"), ":nth-child(2n+1)");
+  EXPECT_EQ(compile(":nth-child( 2n - 1 ) {}"), ":nth-child(2n-1)");
+  EXPECT_EQ(compile(":nth-child(2n-1) {}"), ":nth-child(2n-1)");
+  EXPECT_EQ(compile(":nth-last-child(-n+3) {}"), ":nth-last-child(-1n+3)");
+  EXPECT_EQ(compile(":nth-of-type(n) {}"), ":nth-of-type(1n+0)");
+  EXPECT_EQ(compile(":nth-child(+5) {}"), ":nth-child(0n+5)");
+  EXPECT_EQ(compile(":NTH-CHILD(ODD) {}"), ":nth-child(2n+1)");
+  EXPECT_EQ(compile(":nth-child(even) {}"), ":nth-child(2n+0)");
+  EXPECT_EQ(compile(":nth-child(x) {}"), "expected an+b");
+  EXPECT_EQ(compile(":nth-child(2n+) {}"), "expected an+b");
+  EXPECT_EQ(compile(":nth-child(2n+1 of .a) {}"), "only an+b is supported as the argument of an :nth-*()");
+}
+
+TEST(selector, arguments) {
+  EXPECT_EQ(compile("a:not(.b, c .d) {}"), "a:not(.b, .d c)");
+  EXPECT_EQ(compile(":is(:not(.a), .b) {}"), ":is(:not(.a), .b)");
+  EXPECT_EQ(compile(":where(a) {}"), ":where(a)");
+  EXPECT_EQ(compile(":is() {}"), "expected a selector");
+  compiled_t compiled(":is(:not(.a), .b) {}");
+  const auto &arguments = compiled.table.get_arguments();
+  ASSERT_EQ(arguments.size(), size_t(3));
+  for (const auto &argument: arguments) {
+    EXPECT_EQ(argument.rule, nullptr);
+  }
+}
+
+TEST(selector, specificity) {
+  auto make = selector_table_t::make_specificity;
+  EXPECT_EQ(get_specificity("* {}"), make(0, 0, 0));
+  EXPECT_EQ(get_specificity("li {}"), make(0, 0, 1));
+  EXPECT_EQ(get_specificity("ul li::before {}"), make(0, 0, 3));
+  EXPECT_EQ(get_specificity("ul ol+li {}"), make(0, 0, 3));
+  EXPECT_EQ(get_specificity("h1 + *[rel=up] {}"), make(0, 1, 1));
+  EXPECT_EQ(get_specificity("ul ol li.red {}"), make(0, 1, 3));
+  EXPECT_EQ(get_specificity("li.red.level {}"), make(0, 2, 1));
+  EXPECT_EQ(get_specificity("#x34y {}"), make(1, 0, 0));
+  EXPECT_EQ(get_specificity("#s12:not(FOO) {}"), make(1, 0, 1));
+  EXPECT_EQ(get_specificity(".foo :is(.bar, #baz) {}"), make(1, 1, 0));
+  EXPECT_EQ(get_specificity(":where(#a, .b) c {}"), make(0, 0, 1));
+  EXPECT_EQ(get_specificity(":nth-child(2n):hover {}"), make(0, 2, 0));
+  EXPECT_LT(make(0, 1023, 1023), make(1, 0, 0));
+  EXPECT_EQ(make(0, 5000, 0), make(0, 1023, 0));
+}
+
+TEST(selector, bad_selectors_drop_the_rule) {
+  EXPECT_EQ(compile("a, {}"), "expected a selector after ','");
+  EXPECT_EQ(compile(", a {}"), "expected a selector");
+  EXPECT_EQ(compile("> a {}"), "expected a compound selector");
+  EXPECT_EQ(compile("a > > b {}"), "expected a compound selector");
+  EXPECT_EQ(compile("a > {}"), "selector ends with a combinator");
+  EXPECT_EQ(compile("a..b {}"), "expected a class name after '.'");
+  EXPECT_EQ(compile(".a b|{}"), "expected a type or '*' after the namespace");
+  EXPECT_EQ(compile("#12 {}"), "unexpected in a selector");
+  EXPECT_EQ(compile(".a.b c {}"), "c .a.b");
+  compiled_t compiled("a {} b:not(c, ) {} d {}");
+  const auto &table = compiled.table;
+  ASSERT_EQ(table.get_selectors().size(), size_t(2));
+  EXPECT_EQ(render(table, table.get_selectors()[1]), "d");
+  EXPECT_EQ(table.get_simple_selectors().size(), size_t(2));
+  EXPECT_TRUE(table.get_arguments().empty());
+  ASSERT_EQ(table.get_errors().size(), size_t(1));
+  EXPECT_EQ(table.get_errors()[0].get_code(), parser_error_t::BAD_SELECTOR);
+}
+
+TEST(selector, nested_rules) {
+  compiled_t compiled(R"(
+    a {}
+    @media screen { b {} @supports (x: y) { c {} } }
+    @-webkit-keyframes k { from {} 50% {} }
+    @font-face { src: url(x) }
+  )");
+  const auto &table = compiled.table;
+  ASSERT_EQ(table.get_selectors().size(), size_t(3));
+  EXPECT_EQ(render(table, table.get_selectors()[2]), "c");
+  EXPECT_TRUE(table.get_errors().empty());
+}
+
+TEST(selector, group_filter) {
+  auto sheet = parser_t(R"(
+    a {}
+    @media print { b {} }
+    @supports (x: y) { c {} @media print { d {} } @media screen { e {} } }
+  )").parse_stylesheet();
+  /* Take what's for the screen. */
+  selector_table_t::group_filter_t filter = [](const rule_t &rule) {
+    return rule.name != "media" || (!rule.prelude.empty() && rule.prelude.begin()->text != "print");
+  };
+  selector_table_t table(sheet, filter);
+  std::string names;
+  for (const auto &selector: table.get_selectors()) {
+    names += render(table, selector);
+  }
+  EXPECT_EQ(names, "ace");
+  EXPECT_EQ(selector_table_t(sheet).get_selectors().size(), size_t(5));
+}
@@ -47,6 +47,30 @@ TEST(simple_token, hash_name) {
   EXPECT_EQ(tokens[1]->get_text(), std::string("asdf"));
 }
 
+TEST(simple_token, hash_digits) {
+  const char *src = R"(
+    #00ff00 #a1
+  )";
+  auto tokens = lexer_t(src).lex();
+  EXPECT_EQ(token_t::kind_t::HASH_TOKEN, tokens[1]->get_kind());
+  EXPECT_EQ(tokens[1]->get_text(), std::string("00ff00"));
+  EXPECT_EQ(tokens[1]->get_type_flag(), token_t::UNRESTRICTED);
+  EXPECT_EQ(token_t::kind_t::HASH_TOKEN, tokens[3]->get_kind());
+  EXPECT_EQ(tokens[3]->get_type_flag(), token_t::ID);
+}
+
+TEST(simple_token, escaped_quote_string) {
+  const char *src = R"(
+    'it\'s' "a \"b\"" x
+  )";
+  auto tokens = lexer_t(src).lex();
+  EXPECT_EQ(token_t::kind_t::STRING_TOKEN, tokens[1]->get_kind());
+  EXPECT_EQ(tokens[1]->get_text(), std::string("it\\'s"));
+  EXPECT_EQ(token_t::kind_t::STRING_TOKEN, tokens[3]->get_kind());
+  EXPECT_EQ(tokens[3]->get_text(), std::string("a \\\"b\\\""));
+  EXPECT_EQ(token_t::kind_t::IDENT_TOKEN, tokens[5]->get_kind());
+}
+
 TEST(simple_token, simple_string) {
   const char *src = R"(
     "this is a string?"
@@ -0,0 +1,150 @@
+#include <random>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include <yourcss/error.h>
+#include <yourcss/lexer.h>
+#include <yourcss/skimmer.h>
+#include <yourcss/token.h>
+
+using namespace yourcss;
+
+namespace {
+
+const char *src = R"css(
+@import "base.css";
+@import url(theme.css) screen;
+@import url( 'print.css' ) print;
+/* url(commented.png) @import "commented.css"; */
+.a { background: url(a.png) no-repeat; }
+.b::after { content: "url(not-a-url.png)"; }
+.c { background-image: url("b.png"), url( c.png ); }
+.d { mask: myurl(nope.png); cursor: url(d\).cur), auto; }
+.e { background: url(bad"url.png); }
+#url(x) { }
+.f { a: URL(upper.png); b: -url(dash.png); c: \41 url(escaped.png); d: url(g\
+h.png); }
+)css";
+
+/* The references in the text, as lexer_t finds them, written out with
+   their offsets.  False if the text doesn't lex. */
+bool find_by_lexing(const std::string &text, std::vector<std::string> &refs) {
+  refs.clear();
+  bool after_import = false;
+  try {
+    for (const auto &token: lexer_t(text.c_str()).lex()) {
+      auto kind = token->get_kind();
+      if (kind == token_t::WHITESPACE_TOKEN || kind == token_t::COMMENT_TOKEN) {
+        continue;
+      }
+      if ((kind == token_t::URL_TOKEN && !token->get_text_view().empty()) ||
+          (after_import && kind == token_t::STRING_TOKEN)) {
+        refs.push_back(
+            std::string(after_import ? "import " : "url ") + std::string(token->get_text_view()) +
+            " at " + std::to_string(token->get_pos().get_offset()));
+      }
+      after_import = false;
+      if (kind == token_t::AT_KEYWORD_TOKEN) {
+        std::string name(token->get_text_view());
+        for (auto &c: name) {
+          c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        after_import = (name == "@import");
+      }
+    }
+  } catch (const yourcss::error_t &) {
+    return false;
+  }
+  return true;
+}
+
+std::vector<std::string> skim(const std::string &text) {
+  std::vector<std::string> refs;
+  for (const auto &ref: skimmer_t(text.c_str()).skim()) {
+    refs.push_back(
+        std::string(ref.kind == reference_t::IMPORT ? "import " : "url ") + std::string(ref.text) +
+        " at " + std::to_string(ref.pos.get_offset()));
+  }
+  return refs;
+}
+
+}  // namespace
+
+TEST(skimmer, finds_references) {
+  auto refs = skimmer_t(src).skim();
+  std::vector<std::string> texts;
+  for (const auto &ref: refs) {
+    texts.push_back(std::string(ref.kind == reference_t::IMPORT ? "import " : "url ") + std::string(ref.text));
+  }
+  std::vector<std::string> expected = {
+    "import base.css",
+    "import theme.css",
+    "import print.css",
+    "url a.png",
+    "url b.png",
+    "url c.png",
+    "url d\\).cur",
+  };
+  EXPECT_EQ(texts, expected);
+}
+
+TEST(skimmer, matches_the_lexer) {
+  std::mt19937 random(42);
+  const char *pieces[] = {
+    "url(", "url( ", "URL(", "u", "rl(", "(", ")", "{", "}", ";", "\"", "'", "\\", "/*", "*/",
+    " ", "a", "x.png", "\n", "-", "<!--", "#", "@", "@import", "@IMPORT ", "1",
+  };
+  std::uniform_int_distribution<size_t> pick(0, sizeof(pieces) / sizeof(pieces[0]) - 1), length(0, 60);
+  size_t lexed = 0, found = 0;
+  std::vector<std::string> expected;
+  for (int round = 0; round < 20000; ++round) {
+    std::string text;
+    for (size_t count = length(random); count; --count) {
+      text += pieces[pick(random)];
+    }
+    if (!find_by_lexing(text, expected)) {
+      continue;
+    }
+    ++lexed;
+    found += expected.size();
+    ASSERT_EQ(skim(text), expected) << text;
+  }
+  EXPECT_GT(lexed, size_t(1000));
+  EXPECT_GT(found, size_t(1000));
+}
+
+TEST(skimmer, positions_match_lexer) {
+  const char *sheet = "@import 'x.css';\n\na { b: url(y.png) }\n  c { d: url( \"z.png\" ) }";
+  std::vector<pos_t> expected;
+  bool after_import = false;
+  for (const auto &token: lexer_t(sheet).lex()) {
+    if (token->get_kind() == token_t::URL_TOKEN ||
+        (after_import && token->get_kind() == token_t::STRING_TOKEN)) {
+      expected.push_back(token->get_pos());
+    }
+    if (token->get_kind() != token_t::WHITESPACE_TOKEN) {
+      after_import = (token->get_kind() == token_t::AT_KEYWORD_TOKEN);
+    }
+  }
+  auto refs = skimmer_t(sheet).skim();
+  ASSERT_EQ(refs.size(), expected.size());
+  for (size_t i = 0; i < refs.size(); ++i) {
+    EXPECT_EQ(refs[i].pos.get_line(), expected[i].get_line()) << i;
+    EXPECT_EQ(refs[i].pos.get_col(), expected[i].get_col()) << i;
+    EXPECT_EQ(refs[i].pos.get_offset(), expected[i].get_offset()) << i;
+    EXPECT_EQ(sheet + refs[i].pos.get_offset(), refs[i].text.data()) << i;
+  }
+}
+
+TEST(skimmer, bounded) {
+  std::string sheet = "a { b: url(x.png) } c { d: url(y.png) }";
+  auto refs = skimmer_t(sheet.data(), sheet.data() + 20).skim();
+  ASSERT_EQ(refs.size(), size_t(1));
+  EXPECT_EQ(refs[0].text, "x.png");
+}
+
+TEST(skimmer, unterminated) {
+  EXPECT_TRUE(skimmer_t("a { b: url(x.png").skim().size() == 1);
+  EXPECT_TRUE(skimmer_t("/* url(x.png)").skim().empty());
+  EXPECT_TRUE(skimmer_t("a { content: \"url(x.png)").skim().empty());
+}
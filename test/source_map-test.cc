@@ -0,0 +1,136 @@
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include <yourcss/minifier.h>
+#include <yourcss/pos.h>
+#include <yourcss/source_map.h>
+
+using namespace yourcss;
+
+namespace {
+
+std::string vlq(int64_t n) {
+  std::string out;
+  source_map_writer_t::put_vlq(out, n);
+  return out;
+}
+
+/* A mapping, decoded, with every field absolute. */
+struct mapping_t final {
+
+  int64_t line, col, source, original_line, original_col;
+
+};  // mapping_t
+
+std::vector<mapping_t> decode(std::string_view mappings) {
+  static constexpr std::string_view digits =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::vector<mapping_t> result;
+  int64_t fields[5] = {};
+  size_t at = 0;
+  auto read = [&]() {
+    uint64_t value = 0;
+    for (unsigned shift = 0; ; shift += 5) {
+      auto digit = digits.find(mappings[at++]);
+      value |= uint64_t(digit & 0x1f) << shift;
+      if (!(digit & 0x20)) {
+        break;
+      }
+    }
+    return (value & 1) ? -static_cast<int64_t>(value >> 1) : static_cast<int64_t>(value >> 1);
+  };
+  while (at < mappings.size()) {
+    if (mappings[at] == ';') {
+      ++fields[0];
+      fields[1] = 0;
+      ++at;
+      continue;
+    }
+    if (mappings[at] == ',') {
+      ++at;
+      continue;
+    }
+    for (size_t i = 1; i < 5; ++i) {
+      fields[i] += read();
+    }
+    result.push_back(mapping_t{fields[0], fields[1], fields[2], fields[3], fields[4]});
+  }
+  return result;
+}
+
+}  // namespace
+
+TEST(source_map, vlq) {
+  EXPECT_EQ(vlq(0), "A");
+  EXPECT_EQ(vlq(1), "C");
+  EXPECT_EQ(vlq(-1), "D");
+  EXPECT_EQ(vlq(15), "e");
+  EXPECT_EQ(vlq(16), "gB");
+  EXPECT_EQ(vlq(-16), "hB");
+  EXPECT_EQ(vlq(123), "2H");
+  EXPECT_EQ(vlq(INT64_MIN).size(), size_t(13));
+}
+
+TEST(source_map, mappings) {
+  source_map_writer_t map;
+  EXPECT_EQ(map.add_source("a.css"), uint32_t(0));
+  EXPECT_EQ(map.add_source("b \"c\".css"), uint32_t(1));
+  map.add(0, 0, pos_t(1, 1, 0));
+  map.add(0, 5, pos_t(1, 7, 6));
+  map.add(2, 0, pos_t(3, 1, 20));
+  map.add(2, 3, pos_t(1, 2, 1), 1);
+  EXPECT_EQ(map.get_mappings(), "AAAA,KAAM;;AAEN,GCFC");
+  EXPECT_EQ(map.get_mapping_count(), uint64_t(4));
+  EXPECT_THROW(map.add(2, 2, pos_t()), std::invalid_argument);
+  EXPECT_THROW(map.add(1, 9, pos_t()), std::invalid_argument);
+  std::ostringstream strm;
+  map.write(strm, "out.css");
+  EXPECT_EQ(
+      strm.str(),
+      "{\"version\":3,\"file\":\"out.css\",\"sources\":[\"a.css\",\"b \\\"c\\\".css\"],"
+      "\"names\":[],\"mappings\":\"AAAA,KAAM;;AAEN,GCFC\"}\n");
+}
+
+TEST(source_map, minifier) {
+  const char *src =
+      "@import url(\n"
+      "  'a.css' );\n"
+      "a > b {\n"
+      "  color : red;\n"
+      "  content: \"x\" ;\n"
+      "  margin: 0 u+00aaaa-ffffff;\n"
+      "}\n";
+  source_map_writer_t map;
+  map.add_source("in.css");
+  std::ostringstream strm;
+  minifier_t::minify(src, src + std::strlen(src), strm, &map);
+  auto out = strm.str();
+  EXPECT_EQ(out, "@import url(\n  'a.css' );a>b{color:red;content:\"x\";margin:0 u+00aaaa-ffffff}");
+  /* Each token but punctuation maps back to where it starts in the
+     source. */
+  std::vector<size_t> out_lines = {0}, src_lines = {0};
+  for (size_t i = 0; i < out.size(); ++i) {
+    if (out[i] == '\n') {
+      out_lines.push_back(i + 1);
+    }
+  }
+  for (size_t i = 0; src[i]; ++i) {
+    if (src[i] == '\n') {
+      src_lines.push_back(i + 1);
+    }
+  }
+  auto mappings = decode(map.get_mappings());
+  ASSERT_EQ(mappings.size(), map.get_mapping_count());
+  ASSERT_EQ(mappings.size(), size_t(12));
+  for (const auto &mapping: mappings) {
+    EXPECT_EQ(mapping.source, 0);
+    auto out_at = out_lines.at(static_cast<size_t>(mapping.line)) + static_cast<size_t>(mapping.col);
+    auto src_at = src_lines.at(static_cast<size_t>(mapping.original_line)) + static_cast<size_t>(mapping.original_col);
+    EXPECT_EQ(out.at(out_at), src[src_at]) << out.substr(out_at);
+  }
+  EXPECT_EQ(mappings[2].line, 1);
+  EXPECT_EQ(mappings[2].col, 12);
+}
@@ -0,0 +1,109 @@
+#include <limits>
+#include <string>
+#include <gtest/gtest.h>
+#include <yourcss/lexer.h>
+#include <yourcss/static_lexer.h>
+#include <yourcss/tokens/number_token.h>
+
+using namespace yourcss;
+
+namespace {
+
+constexpr auto theme = lex_static(R"(
+  /* default theme */
+  body { margin: 8px; font: 12px/1.5 "Helvetica", sans-serif; }
+  a:hover, a[href^='http'] { color: rgb(0, 0, 238); width: 50%; }
+  @media print { .note { display: none } }
+)");
+
+static_assert(theme.size() > 50, "theme lexes at compile time");
+static_assert(theme[0].kind == token_t::WHITESPACE_TOKEN, "leading whitespace");
+static_assert(theme[1].kind == token_t::WHITESPACE_TOKEN, "comment dropped");
+static_assert(theme[2].kind == token_t::IDENT_TOKEN, "body");
+static_assert(theme.get_text(theme[2]) == "body", "text slices the source");
+static_assert(theme[2].pos.get_line() == 3, "line");
+static_assert(theme[2].pos.get_col() == 3, "col");
+
+}  // namespace
+
+TEST(static_lexer, matches_lexer) {
+  auto tokens = lexer_t(R"(
+  /* default theme */
+  body { margin: 8px; font: 12px/1.5 "Helvetica", sans-serif; }
+  a:hover, a[href^='http'] { color: rgb(0, 0, 238); width: 50%; }
+  @media print { .note { display: none } }
+)").lex();
+  ASSERT_EQ(theme.size(), tokens.size());
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    EXPECT_EQ(theme[i].kind, tokens[i]->get_kind()) << i;
+    EXPECT_EQ(theme[i].preceded_by_whitespace, tokens[i]->is_preceded_by_whitespace()) << i;
+    EXPECT_EQ(theme[i].pos.get_line(), tokens[i]->get_pos().get_line()) << i;
+    /* lexer_t strips the quotes from strings and positions them after the
+       opening quote; our text is the exact source. */
+    auto offset = (theme[i].kind == token_t::STRING_TOKEN) ? 1u : 0u;
+    EXPECT_EQ(theme[i].pos.get_col() + offset, tokens[i]->get_pos().get_col()) << i;
+  }
+}
+
+TEST(static_lexer, numbers) {
+  constexpr auto tokens = lex_static("1 -2.5 3e2 +.5% 10px");
+  static_assert(tokens.size() == 9, "count");
+  static_assert(tokens[0].type_flag == token_t::INTEGER, "integer");
+  static_assert(tokens[2].value == -2.5, "negative");
+  static_assert(tokens[4].value == 300, "exponent");
+  static_assert(tokens[6].kind == token_t::PERCENTAGE_TOKEN, "percentage");
+  static_assert(tokens[6].value == 0.5, "percentage value");
+  static_assert(tokens[8].kind == token_t::DIMENSION_TOKEN, "dimension");
+  EXPECT_EQ(tokens.get_text(tokens[8]), "10px");
+}
+
+TEST(static_lexer, big_exponents) {
+  static constexpr char src[] = "1e99999999 1e-99999999 1.5e300 2e-3 -7E+22 0e999 0.1 3.14159 1.005e-2";
+  constexpr auto tokens = lex_static(src);
+  static_assert(tokens[0].value == std::numeric_limits<double>::infinity(), "overflows to infinity");
+  static_assert(tokens[2].value == 0, "underflows to zero");
+  auto expected = lexer_t(src).lex();
+  ASSERT_EQ(tokens.size(), expected.size());
+  for (size_t i = 0; i < tokens.size(); i += 2) {
+    auto value = get_numeric_value(*expected[i]);
+    if (i == 4) {
+      /* Past 1e22 the power isn't exact, but it's close. */
+      EXPECT_NEAR(tokens[i].value / value, 1.0, 1e-14) << i;
+    } else {
+      EXPECT_EQ(tokens[i].value, value) << i;
+    }
+  }
+}
+
+TEST(static_lexer, cdo_and_cdc) {
+  static constexpr char src[] = "<!-- a --> b -->c --d -- >";
+  constexpr auto tokens = lex_static(src);
+  static_assert(tokens[4].kind == token_t::CDC_TOKEN, "--> is a CDC, not an ident");
+  auto expected = lexer_t(src).lex();
+  ASSERT_EQ(tokens.size(), expected.size());
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    EXPECT_EQ(tokens[i].kind, expected[i]->get_kind()) << i;
+  }
+}
+
+TEST(static_lexer, urls_and_functions) {
+  constexpr auto tokens = lex_static("url(a.png) url('b.png') calc(1)");
+  static_assert(tokens[0].kind == token_t::URL_TOKEN, "url");
+  static_assert(tokens[2].kind == token_t::FUNCTION_TOKEN, "quoted url is a function");
+  static_assert(tokens[3].kind == token_t::STRING_TOKEN, "quoted url");
+  EXPECT_EQ(tokens.get_text(tokens[0]), "url(a.png)");
+  EXPECT_EQ(tokens.get_text(tokens[6]), "calc(");
+}
+
+TEST(static_lexer, errors_throw_at_runtime) {
+  const char unterminated[] = "a { content: \"x\n\" }";
+  try {
+    lex_static(unterminated);
+    ADD_FAILURE() << "no error";
+  } catch (const lexer_error_t &error) {
+    EXPECT_EQ(error.get_code(), lexer_error_t::BAD_STRING);
+    EXPECT_EQ(error.get_offset(), uint64_t(15));
+  }
+  const char escaped[] = "a\\62 c";
+  EXPECT_THROW(lex_static(escaped), lexer_error_t);
+}
@@ -0,0 +1,193 @@
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include <yourcss/error.h>
+#include <yourcss/lexer.h>
+#include <yourcss/structural_index.h>
+
+using namespace yourcss;
+
+namespace {
+
+/* The structural characters of the text, found a byte at a time. */
+std::vector<uint64_t> find_slowly(const std::string &text) {
+  std::vector<uint64_t> offsets;
+  size_t size = std::strlen(text.c_str());
+  for (size_t i = 0; i < size; ++i) {
+    char c = text[i];
+    if (c == '\\') {
+      ++i;
+    } else if (c == '"' || c == '\'') {
+      for (++i; i < size && text[i] != c && text[i] != '\n'; ++i) {
+        if (text[i] == '\\') {
+          ++i;
+        }
+      }
+    } else if (c == '/' && i + 1 < size && text[i + 1] == '*') {
+      auto close = text.find("*/", i + 2);
+      i = (close == std::string::npos || close >= size) ? size : close + 1;
+    } else if (std::strchr("{}()[];:,", c)) {
+      offsets.push_back(i);
+    }
+  }
+  return offsets;
+}
+
+/* The structural characters of the text, as lexer_t finds them: the
+   single-character tokens and the '(' which ends each function.  False
+   if the text doesn't lex. */
+bool find_by_lexing(const std::string &text, std::vector<uint64_t> &offsets) {
+  offsets.clear();
+  try {
+    for (const auto &token: lexer_t(text.c_str()).lex()) {
+      auto offset = token->get_pos().get_offset();
+      switch (token->get_kind()) {
+        case token_t::LEFT_BRACE_TOKEN:
+        case token_t::RIGHT_BRACE_TOKEN:
+        case token_t::LEFT_PAREN_TOKEN:
+        case token_t::RIGHT_PAREN_TOKEN:
+        case token_t::LEFT_BRACKET_TOKEN:
+        case token_t::RIGHT_BRACKET_TOKEN:
+        case token_t::SEMICOLON_TOKEN:
+        case token_t::COLON_TOKEN:
+        case token_t::COMMA_TOKEN: {
+          offsets.push_back(offset);
+          break;
+        }
+        case token_t::FUNCTION_TOKEN: {
+          offsets.push_back(offset + token->get_text_view().size() - 1);
+          break;
+        }
+        default: {
+          break;
+        }
+      }
+    }
+  } catch (const yourcss::error_t &) {
+    return false;
+  }
+  return true;
+}
+
+std::vector<uint64_t> find(const std::string &text) {
+  return structural_index_t(text.data(), text.data() + text.size()).get_offsets();
+}
+
+}  // namespace
+
+TEST(structural_index, skips_strings_comments_and_escapes) {
+  std::string text = "a{b:\"}\";c:'{\\'}';/* { */d:\\};e:f(x,[y])}";
+  std::vector<uint64_t> expected = {1, 3, 7, 9, 16, 25, 28, 30, 32, 34, 35, 37, 38, 39};
+  EXPECT_EQ(find(text), expected);
+  EXPECT_EQ(find_slowly(text), expected);
+}
+
+TEST(structural_index, carries_state_across_blocks) {
+  /* Put each awkward pair of characters across a 64-byte boundary. */
+  for (const char *pair: {"/*", "*/", "\\\\", "\\}", "\\\"", "\"}"}) {
+    for (size_t pad = 60; pad < 66; ++pad) {
+      std::string text = std::string(pad, 'x') + pair + "x*/{;}\"}\n}" + std::string(70, 'y') + "}";
+      EXPECT_EQ(find(text), find_slowly(text)) << pair << " at " << pad;
+    }
+  }
+}
+
+TEST(structural_index, matches_a_byte_at_a_time) {
+  std::mt19937 random(42);
+  const char alphabet[] = "{}()[];:,\"'\\/*\n ab";
+  std::uniform_int_distribution<size_t> pick(0, sizeof(alphabet) - 2), length(0, 300);
+  for (int round = 0; round < 2000; ++round) {
+    std::string text(length(random), ' ');
+    for (auto &c: text) {
+      c = alphabet[pick(random)];
+    }
+    ASSERT_EQ(find(text), find_slowly(text)) << text;
+  }
+}
+
+TEST(structural_index, skips_urls) {
+  std::vector<std::string> texts = {
+    "a{b:url(x{y)} c{d:e}",
+    "a{b:url(x[y)} c{d:e}",
+    "a{b:url(x(y)} c{d:e}",
+    "a{b:url(/*.png)} c{d:e} f{g:h}",
+    "a{b:url(it's.png)} c{d:e}\nf{g:h}",
+    "a{b:url( \"{\" )} c{d:url('x' {y)}",
+    "a{b:url(x\\)y{)} c{d:url(x\\\\)}",
+    "a{b:url(x y{z)} c{d:url(x\\\ny)}",
+    "a{b:myurl(x{y)} c{d:URL(e)} f{g:-url(h)} i{j:#url(k)} l{m:1url(n)}",
+    "<!--url({) a{b:\\41 url(c)} d{e:\\\\41 url({)}",
+  };
+  for (const auto &text: texts) {
+    std::vector<uint64_t> expected;
+    ASSERT_TRUE(find_by_lexing(text, expected)) << text;
+    EXPECT_EQ(find(text), expected) << text;
+  }
+}
+
+TEST(structural_index, carries_urls_across_blocks) {
+  for (const char *url: {"url(", "url(x{y)", "url(\"{\" {)", "url(x\\){)", "url(/*{)"}) {
+    for (size_t pad = 55; pad < 66; ++pad) {
+      std::string text = std::string(pad, ' ') + url + std::string(70, '{') + ")}" + std::string(70, 'y') + "}";
+      std::vector<uint64_t> expected;
+      ASSERT_TRUE(find_by_lexing(text, expected)) << text;
+      EXPECT_EQ(find(text), expected) << url << " at " << pad;
+    }
+  }
+}
+
+TEST(structural_index, matches_the_lexer) {
+  std::mt19937 random(42);
+  const char *pieces[] = {
+    "url(", "url( ", "u", "rl(", "l(", "{", "}", "(", ")", "[", "]", ";", ":", ",", "\"", "'",
+    "\\", "/*", "*/", " ", "a", "\n", "-", "<!--", "#", "@", "1",
+  };
+  std::uniform_int_distribution<size_t> pick(0, sizeof(pieces) / sizeof(pieces[0]) - 1), length(0, 120);
+  size_t lexed = 0;
+  std::vector<uint64_t> expected;
+  for (int round = 0; round < 20000; ++round) {
+    std::string text;
+    for (size_t count = length(random); count; --count) {
+      text += pieces[pick(random)];
+    }
+    if (!find_by_lexing(text, expected)) {
+      continue;
+    }
+    ++lexed;
+    ASSERT_EQ(find(text), expected) << text;
+  }
+  EXPECT_GT(lexed, size_t(1000));
+}
+
+TEST(structural_index, stops_at_null) {
+  std::string text("a{}\0{}", 6);
+  structural_index_t index(text.data(), text.data() + text.size());
+  EXPECT_EQ(index.get_offsets().size(), size_t(2));
+  EXPECT_EQ(index.get_end(), text.data() + 3);
+}
+
+TEST(structural_index, find_closing) {
+  std::string text = "a { b: f(}) [ ) ] { ] } ; } c [ d";
+  structural_index_t index(text.data(), text.data() + text.size());
+  const auto &offsets = index.get_offsets();
+  size_t closing = index.find_closing(0);
+  ASSERT_LT(closing, offsets.size());
+  EXPECT_EQ(offsets[closing], text.size() - 7);
+  EXPECT_EQ(index.at(index.find_closing(2)), ')');
+  EXPECT_EQ(index.find_closing(closing + 1), offsets.size());
+}
+
+TEST(structural_index, find_rule_ends) {
+  std::string text = "@import 'a'; a { b: c(}) } } d { } @media e { f { } } g(x{y}) { }";
+  structural_index_t index(text.data(), text.data() + text.size());
+  std::vector<uint64_t> expected = {26, 34, 53, 65};
+  EXPECT_EQ(index.find_rule_ends(0), expected);
+  expected = {34, 65};
+  EXPECT_EQ(index.find_rule_ends(30), expected);
+  text = "a { b: url(}) } c { d: url(x{) } e { }";
+  structural_index_t urls(text.data(), text.data() + text.size());
+  expected = {15, 32, 38};
+  EXPECT_EQ(urls.find_rule_ends(0), expected);
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <yourcss/matcher.h>
+
+namespace yourcss {
+
+/* The attributes of a node, in order. */
+using attributes_t = std::vector<std::pair<std::string, std::string>>;
+
+/* Just enough of a DOM to match selectors against. */
+class test_element_t final: public element_t {
+
+public:
+
+  /* A root. */
+  explicit test_element_t(std::string tag_, attributes_t attributes_ = {}):
+    parent(nullptr),
+    index(0),
+    tag(std::move(tag_)),
+    attributes(std::move(attributes_)) {
+    std::string_view classes_attribute;
+    if (get_attribute("class", classes_attribute)) {
+      for (size_t start = 0; start < classes_attribute.size();) {
+        auto stop = std::min(classes_attribute.find(' ', start), classes_attribute.size());
+        if (stop > start) {
+          classes.emplace_back(classes_attribute.substr(start, stop - start));
+        }
+        start = stop + 1;
+      }
+    }
+  }
+
+  /* A new last child. */
+  test_element_t &add(std::string tag_, attributes_t attributes_ = {}) {
+    children.push_back(std::make_unique<test_element_t>(std::move(tag_), std::move(attributes_)));
+    children.back()->parent = this;
+    children.back()->index = children.size() - 1;
+    return *children.back();
+  }
+
+  const std::vector<std::unique_ptr<test_element_t>> &get_children() const {
+    return children;
+  }
+
+  virtual const element_t *get_parent() const override {
+    ++parent_count;
+    return parent;
+  }
+
+  virtual const element_t *get_previous_sibling() const override {
+    return (parent && index > 0) ? parent->children[index - 1].get() : nullptr;
+  }
+
+  virtual const element_t *get_next_sibling() const override {
+    return (parent && index + 1 < parent->children.size()) ? parent->children[index + 1].get() : nullptr;
+  }
+
+  virtual std::string_view get_tag() const override {
+    return tag;
+  }
+
+  virtual std::string_view get_id() const override {
+    std::string_view id;
+    get_attribute("id", id);
+    return id;
+  }
+
+  virtual size_t get_class_count() const override {
+    return classes.size();
+  }
+
+  virtual std::string_view get_class(size_t idx) const override {
+    return classes[idx];
+  }
+
+  virtual bool get_attribute(std::string_view name, std::string_view &value) const override {
+    for (const auto &attribute: attributes) {
+      if (attribute.first == name) {
+        value = attribute.second;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  virtual bool matches_pseudo_class(std::string_view name, std::string_view argument) const override {
+    return std::find(states.begin(), states.end(), std::string(name) + std::string(argument)) != states.end();
+  }
+
+  /* The pseudo-classes we're in, with any argument appended. */
+  std::vector<std::string> states;
+
+  /* The number of calls to get_parent(), on any node. */
+  static inline size_t parent_count = 0;
+
+private:
+
+  test_element_t *parent;
+
+  size_t index;
+
+  std::string tag;
+
+  attributes_t attributes;
+
+  std::vector<std::string> classes;
+
+  std::vector<std::unique_ptr<test_element_t>> children;
+
+};  // test_element_t
+
+/* A random tree, depth levels deep below the root.  Each element has one
+   to three children; each is an a, b or c, has a class from xa to xc and
+   another from ya to yc and, now and then, an ID from ia to ic. */
+inline std::unique_ptr<test_element_t> make_random_tree(unsigned seed, int depth) {
+  std::mt19937 random(seed);
+  const char *names[] = {"a", "b", "c"};
+  std::uniform_int_distribution<size_t> pick(0, 2), child_count(1, 3);
+  auto root = std::make_unique<test_element_t>("a");
+  std::vector<test_element_t *> level = {root.get()};
+  for (int i = 0; i < depth; ++i) {
+    std::vector<test_element_t *> next;
+    for (auto element: level) {
+      for (size_t n = child_count(random); n; --n) {
+        attributes_t attributes = {{"class", std::string("x") + names[pick(random)] + " y" + names[pick(random)]}};
+        if (pick(random) == 0) {
+          attributes.emplace_back("id", std::string("i") + names[pick(random)]);
+        }
+        next.push_back(&element->add(names[pick(random)], attributes));
+      }
+    }
+    level = next;
+  }
+  return root;
+}
+
+}  // yourcss
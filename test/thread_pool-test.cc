@@ -0,0 +1,64 @@
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include <yourcss/thread_pool.h>
+
+using namespace yourcss;
+
+TEST(thread_pool, runs_every_task) {
+  thread_pool_t pool(4);
+  EXPECT_EQ(pool.get_thread_count(), size_t(4));
+  std::vector<std::atomic<int>> runs(1000);
+  for (auto &run: runs) {
+    pool.submit([&run] { ++run; });
+  }
+  pool.wait();
+  for (const auto &run: runs) {
+    EXPECT_EQ(run.load(), 1);
+  }
+}
+
+TEST(thread_pool, tasks_can_submit_tasks) {
+  thread_pool_t pool(3);
+  std::atomic<int> count(0);
+  for (int i = 0; i < 10; ++i) {
+    pool.submit([&pool, &count] {
+      for (int j = 0; j < 10; ++j) {
+        pool.submit([&count] { ++count; });
+      }
+    });
+  }
+  pool.wait();
+  EXPECT_EQ(count.load(), 100);
+}
+
+TEST(thread_pool, idle_workers_steal) {
+  thread_pool_t pool(2);
+  std::atomic<int> count(0);
+  /* Every other task lands on the first worker, which is kept busy by
+     the first task, so the second worker has to take them. */
+  pool.submit([] { std::this_thread::sleep_for(std::chrono::milliseconds(200)); });
+  for (int i = 0; i < 99; ++i) {
+    pool.submit([&count] { ++count; });
+  }
+  pool.wait();
+  EXPECT_EQ(count.load(), 99);
+  EXPECT_GT(pool.get_steal_count(), size_t(0));
+}
+
+TEST(thread_pool, wait_rethrows) {
+  thread_pool_t pool(2);
+  std::atomic<int> count(0);
+  pool.submit([] { throw std::runtime_error("boom"); });
+  for (int i = 0; i < 10; ++i) {
+    pool.submit([&count] { ++count; });
+  }
+  EXPECT_THROW(pool.wait(), std::runtime_error);
+  EXPECT_EQ(count.load(), 10);
+  pool.submit([&count] { ++count; });
+  EXPECT_NO_THROW(pool.wait());
+  EXPECT_EQ(count.load(), 11);
+}
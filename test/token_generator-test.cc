@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <yourcss/lexer.h>
+#include <yourcss/token_generator.h>
+#include "counting_resource.h"
+
+#if __cplusplus >= 202002L
+
+using namespace yourcss;
+
+namespace {
+
+/* A toy consumer standing in for a parser: counts declarations. */
+size_t count_declarations(generator_t<token_ref_t> tokens) {
+  size_t count = 0;
+  for (const auto &token: tokens) {
+    if (token->get_kind() == token_t::COLON_TOKEN) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+}  // namespace
+
+TEST(token_generator, matches_lex) {
+  const char *src = R"(
+    .cool {
+      something: 123;
+      asdf: url(http://danielhood.com);
+    }
+  )";
+  auto expected = lexer_t(src).lex();
+  lexer_t lexer(src);
+  size_t i = 0;
+  for (const auto &token: generate_tokens(lexer)) {
+    ASSERT_LT(i, expected.size());
+    EXPECT_EQ(expected[i]->get_kind(), token->get_kind());
+    EXPECT_EQ(expected[i]->get_text(), token->get_text());
+    ++i;
+  }
+  EXPECT_EQ(i, expected.size());
+}
+
+TEST(token_generator, filter_pipeline) {
+  lexer_t lexer("a { b: 1; c: 2 }");
+  auto tokens = filter_tokens(generate_tokens(lexer), token_t::get_mask(token_t::WHITESPACE_TOKEN));
+  std::string kinds;
+  for (const auto &token: tokens) {
+    kinds += token->get_name() + " ";
+  }
+  EXPECT_EQ(kinds, std::string(
+    "IDENT_TOKEN LEFT_BRACE_TOKEN IDENT_TOKEN COLON_TOKEN NUMBER_TOKEN SEMICOLON_TOKEN "
+    "IDENT_TOKEN COLON_TOKEN NUMBER_TOKEN RIGHT_BRACE_TOKEN "));
+}
+
+TEST(token_generator, constant_memory) {
+  std::string src;
+  for (int i = 0; i < 2000; ++i) {
+    src += ".rule-" + std::to_string(i) + " { margin: 1px 2px; color: red; }\n";
+  }
+  counting_resource_t all_at_once;
+  size_t token_count = lexer_t(src.c_str(), &all_at_once).lex().size();
+  counting_resource_t streamed;
+  lexer_t lexer(src.c_str(), &streamed);
+  size_t declaration_count = count_declarations(
+    filter_tokens(generate_tokens(lexer), token_t::get_mask(token_t::WHITESPACE_TOKEN)));
+  EXPECT_EQ(declaration_count, size_t(4000));
+  EXPECT_GT(token_count, size_t(30000));
+  EXPECT_LT(streamed.get_peak_byte_count(), size_t(1024));
+  EXPECT_GT(all_at_once.get_peak_byte_count(), size_t(1024) * 1024);
+}
+
+TEST(token_generator, propagates_errors) {
+  lexer_t lexer("a \"unterminated\n\"");
+  auto tokens = generate_tokens(lexer);
+  EXPECT_THROW({
+    for (const auto &token: tokens) {
+      (void) token;
+    }
+  }, lexer_t::lexer_error_t);
+}
+
+#endif
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <yourcss/lexer.h>
+#include <yourcss/token_pipeline.h>
+
+using namespace yourcss;
+
+namespace {
+
+std::string make_sheet(int rule_count) {
+  std::string src;
+  for (int i = 0; i < rule_count; ++i) {
+    src += ".rule-" + std::to_string(i) + " { margin: 1px 2.5em; width: 50%; content: \"x\"; }\n";
+  }
+  return src;
+}
+
+}  // namespace
+
+TEST(token_pipeline, matches_lex) {
+  auto src = make_sheet(3000);
+  auto expected = lexer_t(src.c_str()).lex();
+  token_pipeline_t pipeline(src.c_str(), token_t::get_mask(token_t::COMMENT_TOKEN), 2);
+  size_t i = 0;
+  size_t batch_count = 0;
+  while (auto batch = pipeline.next_batch()) {
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(batch) % cache_line_size, uintptr_t(0));
+    ++batch_count;
+    for (size_t j = 0; j < batch->token_count; ++j) {
+      const auto &token = batch->tokens[j];
+      ASSERT_LT(i, expected.size());
+      EXPECT_EQ(expected[i]->get_kind(), token.kind);
+      EXPECT_EQ(expected[i]->get_text_view(), batch->get_text(token));
+      EXPECT_EQ(expected[i]->get_pos().get_line(), token.pos.get_line());
+      EXPECT_EQ(expected[i]->is_preceded_by_whitespace(), token.preceded_by_whitespace);
+      ++i;
+    }
+  }
+  EXPECT_EQ(i, expected.size());
+  EXPECT_GT(batch_count, size_t(10));
+  EXPECT_EQ(pipeline.next_batch(), nullptr);
+}
+
+TEST(token_pipeline, values) {
+  token_pipeline_t pipeline("1px 2.5 50%", token_t::get_mask(token_t::WHITESPACE_TOKEN));
+  auto batch = pipeline.next_batch();
+  ASSERT_NE(batch, nullptr);
+  ASSERT_EQ(batch->token_count, size_t(3));
+  EXPECT_EQ(batch->tokens[0].kind, token_t::DIMENSION_TOKEN);
+  EXPECT_EQ(batch->tokens[0].value, 1.0);
+  EXPECT_EQ(batch->tokens[0].type_flag, token_t::INTEGER);
+  EXPECT_EQ(batch->tokens[1].value, 2.5);
+  EXPECT_EQ(batch->tokens[1].type_flag, token_t::NUMBER);
+  EXPECT_EQ(batch->tokens[2].kind, token_t::PERCENTAGE_TOKEN);
+  EXPECT_EQ(batch->tokens[2].value, 50.0);
+  EXPECT_EQ(pipeline.next_batch(), nullptr);
+}
+
+TEST(token_pipeline, dimension_values_are_only_the_number) {
+  /* The number is 0 and the unit is x10px; strtod would read 16. */
+  token_pipeline_t pipeline("0x10px 1e3em", token_t::get_mask(token_t::WHITESPACE_TOKEN));
+  auto batch = pipeline.next_batch();
+  ASSERT_NE(batch, nullptr);
+  ASSERT_EQ(batch->token_count, size_t(2));
+  EXPECT_EQ(batch->tokens[0].kind, token_t::DIMENSION_TOKEN);
+  EXPECT_EQ(batch->tokens[0].value, 0.0);
+  EXPECT_EQ(batch->tokens[1].kind, token_t::DIMENSION_TOKEN);
+  EXPECT_EQ(batch->tokens[1].value, 1000.0);
+}
+
+TEST(token_pipeline, consumer_stops_early) {
+  auto src = make_sheet(20000);
+  token_pipeline_t pipeline(src.c_str(), 0, 2);
+  ASSERT_NE(pipeline.next_batch(), nullptr);
+}
+
+TEST(token_pipeline, rethrows_lexer_errors) {
+  std::string src = make_sheet(1000) + "a \"unterminated\n\"";
+  token_pipeline_t pipeline(src.c_str());
+  size_t token_count = 0;
+  EXPECT_THROW({
+    while (auto batch = pipeline.next_batch()) {
+      token_count += batch->token_count;
+    }
+  }, lexer_t::lexer_error_t);
+  EXPECT_GT(token_count, size_t(1000));
+}
@@ -0,0 +1,143 @@
+#include <ostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include <yourcss/lexer.h>
+#include <yourcss/token.h>
+#include <yourcss/token_writer.h>
+#include "new_count.h"
+
+using namespace yourcss;
+
+namespace {
+
+const char *src = R"css(
+@import url(a.css);
+.a > b[href^='x"y'] { margin: -1.5em 10%; }
+/* multi
+   line */
+)css";
+
+std::string write_all(const token_list_t &tokens, token_writer_t::format_t format, size_t buffer_size = token_writer_t::default_buffer_size) {
+  std::ostringstream strm;
+  {
+    token_writer_t writer(strm, format, buffer_size);
+    for (const auto &token: tokens) {
+      writer(token);
+    }
+  }
+  return strm.str();
+}
+
+/* Counts the bytes written to it and throws them away. */
+struct counting_buf_t final: std::streambuf {
+
+  std::streamsize xsputn(const char *, std::streamsize count) override {
+    byte_count += static_cast<size_t>(count);
+    return count;
+  }
+
+  int_type overflow(int_type c) override {
+    ++byte_count;
+    return traits_type::not_eof(c);
+  }
+
+  size_t byte_count = 0;
+
+};  // counting_buf_t
+
+uint64_t read_varint(const std::string &data, size_t &at) {
+  uint64_t n = 0;
+  for (int shift = 0; ; shift += 7) {
+    auto byte = static_cast<unsigned char>(data.at(at++));
+    n |= uint64_t(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return n;
+    }
+  }
+}
+
+}  // namespace
+
+TEST(token_writer, text_matches_operator) {
+  auto tokens = lexer_t(src).lex();
+  std::ostringstream expected;
+  for (const auto &token: tokens) {
+    expected << *token << '\n';
+  }
+  EXPECT_EQ(write_all(tokens, token_writer_t::TEXT), expected.str());
+  EXPECT_EQ(write_all(tokens, token_writer_t::TEXT, 1), expected.str());
+}
+
+TEST(token_writer, ndjson) {
+  auto tokens = lexer_t(lexer_config_t(0), "a 'x\"y' /*\n\t\x01*/").lex();
+  tokens.push_back(token_t::make(pos_t(2, 1, 20), token_t::STRING_TOKEN, std::string("\\")));
+  std::string expected =
+    "{\"line\":1,\"col\":1,\"offset\":0,\"kind\":\"IDENT_TOKEN\",\"text\":\"a\",\"ws\":false}\n"
+    "{\"line\":1,\"col\":2,\"offset\":1,\"kind\":\"WHITESPACE_TOKEN\",\"text\":\"\",\"ws\":false}\n"
+    "{\"line\":1,\"col\":4,\"offset\":3,\"kind\":\"STRING_TOKEN\",\"text\":\"x\\\"y\",\"ws\":true}\n"
+    "{\"line\":1,\"col\":8,\"offset\":7,\"kind\":\"WHITESPACE_TOKEN\",\"text\":\"\",\"ws\":false}\n"
+    "{\"line\":1,\"col\":9,\"offset\":8,\"kind\":\"COMMENT_TOKEN\",\"text\":\"/*\\n\\t\\u0001*/\",\"ws\":true}\n"
+    "{\"line\":2,\"col\":1,\"offset\":20,\"kind\":\"STRING_TOKEN\",\"text\":\"\\\\\",\"ws\":false}\n";
+  EXPECT_EQ(write_all(tokens, token_writer_t::NDJSON), expected);
+}
+
+TEST(token_writer, binary_round_trip) {
+  auto tokens = lexer_t(src).lex();
+  std::string data = write_all(tokens, token_writer_t::BINARY, 16);
+  ASSERT_EQ(data.substr(0, token_writer_t::magic.size()), token_writer_t::magic);
+  size_t at = token_writer_t::magic.size();
+  uint64_t offset = 0, line = 0;
+  for (const auto &token: tokens) {
+    auto kind = static_cast<unsigned char>(data.at(at++));
+    offset += read_varint(data, at);
+    line += read_varint(data, at);
+    uint64_t col = read_varint(data, at);
+    size_t size = read_varint(data, at);
+    std::string text = data.substr(at, size);
+    at += size;
+    EXPECT_EQ(kind & 0x7f, token->get_kind());
+    EXPECT_EQ((kind & 0x80) != 0, token->is_preceded_by_whitespace());
+    EXPECT_EQ(offset, token->get_pos().get_offset());
+    EXPECT_EQ(line, token->get_pos().get_line());
+    EXPECT_EQ(col, token->get_pos().get_col());
+    EXPECT_EQ(text, token->get_text());
+  }
+  EXPECT_EQ(at, data.size());
+}
+
+TEST(token_writer, sources) {
+  auto tokens = lexer_t("a").lex();
+  std::ostringstream strm;
+  {
+    token_writer_t writer(strm, token_writer_t::NDJSON);
+    writer.begin_source("x\".css");
+    writer(tokens[0]);
+  }
+  EXPECT_EQ(strm.str(),
+    "{\"source\":\"x\\\".css\"}\n"
+    "{\"line\":1,\"col\":1,\"offset\":0,\"kind\":\"IDENT_TOKEN\",\"text\":\"a\",\"ws\":false}\n");
+}
+
+TEST(token_writer, long_text_and_no_allocation) {
+  std::string sheet = "a { content: \"" + std::string(1000, 'x') + "\" }\n";
+  for (int i = 0; i < 1000; ++i) {
+    sheet += ".a" + std::to_string(i) + " { color: red; }\n";
+  }
+  auto tokens = lexer_t(sheet.c_str()).lex();
+  for (auto format: {token_writer_t::TEXT, token_writer_t::NDJSON, token_writer_t::BINARY}) {
+    counting_buf_t buf;
+    std::ostream strm(&buf);
+    token_writer_t writer(strm, format, 256);
+    size_t new_count = get_global_new_count();
+    for (const auto &token: tokens) {
+      writer(token);
+    }
+    writer.flush();
+    EXPECT_EQ(get_global_new_count(), new_count) << format;
+    EXPECT_GT(buf.byte_count, sheet.size()) << format;
+    EXPECT_EQ(writer.get_token_count(), tokens.size());
+  }
+}
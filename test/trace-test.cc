@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <thread>
+#include <yourcss/lexer.h>
+#include <yourcss/trace.h>
+
+using namespace yourcss;
+
+TEST(trace, disabled_records_nothing) {
+  trace_t::clear();
+  trace_t::set_enabled(false);
+  {
+    trace_t::span_t span("nothing", 0);
+  }
+  EXPECT_EQ(trace_t::get_event_count(), size_t(0));
+}
+
+TEST(trace, span_byte_range) {
+  trace_t::clear();
+  trace_t::set_enabled(true);
+  const char *src = "abcdef";
+  const char *cursor = src + 1;
+  {
+    trace_t::span_t span("scan", &cursor, src);
+    cursor += 3;
+  }
+  {
+    trace_t::span_t span("manual", 2);
+    span.set_end_offset(5);
+  }
+  trace_t::set_enabled(false);
+  EXPECT_EQ(trace_t::get_event_count(), size_t(2));
+  std::ostringstream strm;
+  trace_t::write_json(strm);
+  auto json = strm.str();
+  EXPECT_NE(json.find("\"name\":\"scan\""), std::string::npos);
+  EXPECT_NE(json.find("\"args\":{\"begin\":1,\"end\":4}"), std::string::npos);
+  EXPECT_NE(json.find("\"args\":{\"begin\":2,\"end\":5}"), std::string::npos);
+  EXPECT_NE(json.find("\"ph\":\"X\""), std::string::npos);
+}
+
+TEST(trace, many_threads) {
+  trace_t::clear();
+  trace_t::set_enabled(true);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([]() {
+      for (int j = 0; j < 3000; ++j) {
+        trace_t::span_t span("work", static_cast<size_t>(j));
+      }
+    });
+  }
+  for (auto &thread: threads) {
+    thread.join();
+  }
+  trace_t::set_enabled(false);
+  EXPECT_EQ(trace_t::get_event_count(), size_t(12000));
+  trace_t::clear();
+  EXPECT_EQ(trace_t::get_event_count(), size_t(0));
+}
+
+TEST(trace, lexer_spans) {
+  trace_t::clear();
+  trace_t::set_enabled(true);
+  auto tokens = lexer_t(".a { width: 10px; }").lex();
+  trace_t::set_enabled(false);
+#ifdef YOURCSS_ENABLE_TRACE
+  EXPECT_GT(trace_t::get_event_count(), size_t(0));
+#else
+  EXPECT_EQ(trace_t::get_event_count(), size_t(0));
+#endif
+  trace_t::clear();
+}
@@ -0,0 +1,88 @@
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include <yourcss/lexer.h>
+#include <yourcss/token.h>
+
+using namespace yourcss;
+
+namespace {
+
+std::string make_sheet() {
+  std::string sheet = "@charset \"utf-8\";\n@import \"a.css\";\n@import url(b.css);\n";
+  for (int i = 0; i < 10000; ++i) {
+    sheet += ".a" + std::to_string(i) + " { color: red; }\n";
+  }
+  return sheet;
+}
+
+}  // namespace
+
+TEST(visitor, visits_every_token) {
+  const char *src = "a { b: c }";
+  auto expected = lexer_t(src).lex();
+  std::vector<std::shared_ptr<token_t>> actual;
+  bool finished = lexer_t(src).lex([&actual](std::shared_ptr<token_t> &&token) {
+    actual.push_back(std::move(token));
+    return true;
+  });
+  EXPECT_TRUE(finished);
+  ASSERT_EQ(actual.size(), expected.size());
+  for (size_t i = 0; i < actual.size(); ++i) {
+    EXPECT_EQ(actual[i]->get_kind(), expected[i]->get_kind());
+    EXPECT_EQ(actual[i]->get_text(), expected[i]->get_text());
+  }
+}
+
+TEST(visitor, stops_at_first_charset) {
+  std::string sheet = make_sheet();
+  lexer_t lexer(sheet.c_str());
+  std::string charset;
+  bool is_next = false;
+  bool finished = lexer.lex([&](std::shared_ptr<token_t> &&token) {
+    if (token->get_kind() == token_t::WHITESPACE_TOKEN) {
+      return true;
+    }
+    if (is_next && token->get_kind() == token_t::STRING_TOKEN) {
+      charset = token->get_text();
+      return false;
+    }
+    is_next = (token->get_kind() == token_t::AT_KEYWORD_TOKEN && token->get_text() == "@charset");
+    return true;
+  });
+  EXPECT_FALSE(finished);
+  EXPECT_EQ(charset, "utf-8");
+  EXPECT_LT(lexer.get_next_cursor() - sheet.c_str(), 20);
+}
+
+TEST(visitor, collects_imports_until_first_rule) {
+  std::string sheet = make_sheet();
+  lexer_t lexer(sheet.c_str());
+  std::vector<std::string> imports;
+  bool in_import = false;
+  lexer.lex([&](std::shared_ptr<token_t> &&token) {
+    switch (token->get_kind()) {
+      case token_t::AT_KEYWORD_TOKEN: {
+        in_import = (token->get_text() == "@import");
+        return true;
+      }
+      case token_t::STRING_TOKEN:
+      case token_t::URL_TOKEN: {
+        if (in_import) {
+          imports.push_back(token->get_text());
+        }
+        return true;
+      }
+      case token_t::LEFT_BRACE_TOKEN: {
+        return false;
+      }
+      default: {
+        return true;
+      }
+    }
+  });
+  ASSERT_EQ(imports.size(), size_t(2));
+  EXPECT_EQ(imports[0], "a.css");
+  EXPECT_EQ(imports[1], "b.css");
+  EXPECT_LT(lexer.get_next_cursor() - sheet.c_str(), 80);
+}
@@ -0,0 +1,106 @@
+#include <sstream>
+#include <string>
+#include <gtest/gtest.h>
+#include <yourcss/lexer.h>
+#include <yourcss/token.h>
+#include <yourcss/window_lexer.h>
+
+using namespace yourcss;
+
+namespace {
+
+const char *src = R"(
+  @media screen {
+    .cool a#b[href^="x"] {
+      something: 123;
+      margin: -1.5em 10% 0;
+      asdf: url(http://danielhood.com/a/rather/long/path/to/something.png);
+      font: bold 12px/1.2 "Helvetica Neue, a long font family name", sans-serif;
+      /* a comment which goes on for quite a while, longer than any window */
+      unicode-range: U+0000aa-00ffff;
+    }
+  }
+)";
+
+std::string describe(const token_t &token) {
+  std::ostringstream strm;
+  strm << token.get_pos() << "; " << token.get_pos().get_offset() << "; " << token.get_name() << "; " << token.get_text() << "; " << token.is_preceded_by_whitespace();
+  return strm.str();
+}
+
+std::vector<std::string> lex_window(const std::string &text, size_t window_size, size_t *peak = nullptr) {
+  std::istringstream strm(text);
+  std::vector<std::string> result;
+  window_lexer_t lexer(strm, lexer_config_t(), window_size);
+  lexer.lex([&result](std::shared_ptr<token_t> &&token) {
+    result.push_back(describe(*token));
+    return true;
+  });
+  if (peak) {
+    *peak = lexer.get_peak_window_size();
+  }
+  return result;
+}
+
+}  // namespace
+
+TEST(window_lexer, matches_lexer_at_any_window_size) {
+  std::vector<std::string> expected;
+  for (const auto &token: lexer_t(src).lex()) {
+    expected.push_back(describe(*token));
+  }
+  for (size_t window_size: {1, 2, 3, 7, 16, 64, 1024}) {
+    EXPECT_EQ(lex_window(src, window_size), expected) << window_size;
+  }
+}
+
+TEST(window_lexer, comments_kept) {
+  lexer_config_t config(0);
+  std::vector<std::string> expected;
+  for (const auto &token: lexer_t(config, src).lex()) {
+    expected.push_back(describe(*token));
+  }
+  std::istringstream strm(src);
+  std::vector<std::string> actual;
+  window_lexer_t(strm, config, 8).lex([&actual](std::shared_ptr<token_t> &&token) {
+    actual.push_back(describe(*token));
+    return true;
+  });
+  EXPECT_EQ(actual, expected);
+}
+
+TEST(window_lexer, memory_independent_of_input_size) {
+  std::string text;
+  for (int i = 0; i < 20000; ++i) {
+    text += ".a" + std::to_string(i) + " { color: red; margin: 1px 2px; }\n";
+  }
+  size_t peak = 0;
+  size_t token_count = lex_window(text, 4096, &peak).size();
+  EXPECT_GT(token_count, size_t(20000 * 10));
+  EXPECT_EQ(peak, size_t(4096));
+}
+
+TEST(window_lexer, window_grows_for_long_tokens) {
+  std::string text = "a \"" + std::string(10000, 'x') + "\" b";
+  size_t peak = 0;
+  auto tokens = lex_window(text, 64, &peak);
+  ASSERT_EQ(tokens.size(), size_t(5));
+  EXPECT_GE(peak, size_t(8192));
+  EXPECT_LE(peak, size_t(32768));
+}
+
+TEST(window_lexer, errors_still_thrown) {
+  std::istringstream strm("a { b: 1..2 }");
+  window_lexer_t lexer(strm, lexer_config_t(), 4);
+  EXPECT_THROW(lexer.lex([](std::shared_ptr<token_t> &&) { return true; }), lexer_error_t);
+}
+
+TEST(window_lexer, visitor_stops) {
+  std::istringstream strm(src);
+  size_t count = 0;
+  bool finished = window_lexer_t(strm, lexer_config_t(), 16).lex([&count](std::shared_ptr<token_t> &&) {
+    return ++count < 3;
+  });
+  EXPECT_FALSE(finished);
+  EXPECT_EQ(count, size_t(3));
+}
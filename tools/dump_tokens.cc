@@ -0,0 +1,81 @@
+/* Dump the tokens of CSS files, or of stdin, to stdout.
+
+     dump_tokens [--format=text|ndjson|binary] [--comments] [file ...]
+
+   Each file is lexed through a window_lexer_t, so files of any size are
+   dumped in bounded memory.  See token_writer_t for the formats. */
+
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <yourcss/error.h>
+#include <yourcss/lexer.h>
+#include <yourcss/token_writer.h>
+#include <yourcss/window_lexer.h>
+
+using namespace yourcss;
+
+namespace {
+
+int usage(const char *argv0) {
+  std::cerr << "usage: " << argv0 << " [--format=text|ndjson|binary] [--comments] [file ...]\n";
+  return 2;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  token_writer_t::format_t format = token_writer_t::TEXT;
+  token_t::kind_mask_t filter = token_t::get_mask(token_t::COMMENT_TOKEN);
+  std::vector<const char *> paths;
+  for (int i = 1; i < argc; ++i) {
+    const char *arg = argv[i];
+    if (std::strcmp(arg, "--format=text") == 0) {
+      format = token_writer_t::TEXT;
+    } else if (std::strcmp(arg, "--format=ndjson") == 0) {
+      format = token_writer_t::NDJSON;
+    } else if (std::strcmp(arg, "--format=binary") == 0) {
+      format = token_writer_t::BINARY;
+    } else if (std::strcmp(arg, "--comments") == 0) {
+      filter = 0;
+    } else if (arg[0] == '-' && arg[1] != '\0') {
+      return usage(argv[0]);
+    } else {
+      paths.push_back(arg);
+    }
+  }
+  std::ios_base::sync_with_stdio(false);
+  lexer_config_t config(filter);
+  token_writer_t writer(std::cout, format);
+  auto dump = [&](std::istream &strm, const char *name) {
+    if (!paths.empty()) {
+      writer.begin_source(name);
+    }
+    try {
+      window_lexer_t(strm, config).lex(std::ref(writer));
+    } catch (const yourcss::error_t &error) {
+      writer.flush();
+      std::cerr << name << ": " << error.what() << '\n';
+      return false;
+    }
+    return true;
+  };
+  bool ok = true;
+  if (paths.empty()) {
+    ok = dump(std::cin, "<stdin>");
+  }
+  for (const char *path: paths) {
+    std::ifstream strm(path, std::ios::binary);
+    if (!strm) {
+      std::cerr << path << ": cannot open\n";
+      ok = false;
+      continue;
+    }
+    ok = dump(strm, path) && ok;
+  }
+  writer.flush();
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+/* Minify a CSS file, or stdin, to stdout.
+
+     minify [--source-map=path] [file]
+
+   The whole file is read into memory, since minifier_t slices tokens out
+   of the source text; the output goes out through the minifier's own
+   buffer as it's made.  With --source-map, a source map is written to
+   the path and a comment pointing to it ends the output. */
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <yourcss/error.h>
+#include <yourcss/minifier.h>
+#include <yourcss/source_map.h>
+
+using namespace yourcss;
+
+namespace {
+
+int usage(const char *argv0) {
+  std::cerr << "usage: " << argv0 << " [--source-map=path] [file]\n";
+  return 2;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  static constexpr char source_map_flag[] = "--source-map=";
+  const char *map_path = nullptr;
+  const char *path = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    const char *arg = argv[i];
+    if (std::strncmp(arg, source_map_flag, sizeof(source_map_flag) - 1) == 0) {
+      map_path = arg + sizeof(source_map_flag) - 1;
+    } else if ((arg[0] == '-' && arg[1] != '\0') || path) {
+      return usage(argv[0]);
+    } else {
+      path = arg;
+    }
+  }
+  std::ios_base::sync_with_stdio(false);
+  const char *name = path ? path : "<stdin>";
+  std::string src;
+  if (path) {
+    std::ifstream strm(path, std::ios::binary);
+    if (!strm) {
+      std::cerr << path << ": cannot open\n";
+      return 1;
+    }
+    src.assign(std::istreambuf_iterator<char>(strm), std::istreambuf_iterator<char>());
+  } else {
+    src.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+  }
+  source_map_writer_t source_map;
+  source_map.add_source(path ? path : "");
+  try {
+    minifier_t::minify(src.data(), src.data() + src.size(), std::cout, map_path ? &source_map : nullptr);
+  } catch (const yourcss::error_t &error) {
+    std::cout.flush();
+    std::cerr << name << ": " << error.what() << '\n';
+    return 1;
+  }
+  if (map_path) {
+    std::ofstream strm(map_path, std::ios::binary);
+    if (!strm) {
+      std::cerr << map_path << ": cannot open\n";
+      return 1;
+    }
+    source_map.write(strm);
+    std::cout << "\n/*# sourceMappingURL=" << map_path << " */\n";
+  }
+  return 0;
+}
@@ -0,0 +1,249 @@
+/* Run the library over many files at once.
+
+     yourcss lex|parse [--jobs=N] [--split] [--quiet] path ...
+
+   Each path is a file, a directory (searched for .css files) or, if it
+   starts with '@', a file listing one path per line.  The files are lexed
+   or parsed on a thread_pool_t, biggest first, and we print how long
+   each took and the throughput overall.  With --split, the files are
+   parsed one at a time instead, each cut into pieces which are parsed on
+   the pool. */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory_resource>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include <yourcss/error.h>
+#include <yourcss/lexer.h>
+#include <yourcss/parser.h>
+#include <yourcss/thread_pool.h>
+
+using namespace yourcss;
+
+namespace {
+
+namespace fs = std::filesystem;
+
+using clock_type = std::chrono::steady_clock;
+
+/* A file to work on, and what became of it. */
+struct job_t final {
+
+  /* Where the file is. */
+  std::string path;
+
+  /* Its size when we listed it, or 0 if we couldn't tell. */
+  uintmax_t size = 0;
+
+  /* The number of tokens, or of top-level rules, we found. */
+  size_t item_count = 0;
+
+  /* How long it took, reading included. */
+  double seconds = 0;
+
+  /* Why it failed, or empty if it didn't. */
+  std::string error;
+
+};  // job_t
+
+int usage(const char *argv0) {
+  std::cerr << "usage: " << argv0 << " lex|parse [--jobs=N] [--split] [--quiet] path ...\n";
+  return 2;
+}
+
+/* Add the file, with its size or why we couldn't get it. */
+void add_file(const std::string &path, std::vector<job_t> &jobs) {
+  std::error_code error;
+  auto size = fs::file_size(path, error);
+  job_t job;
+  job.path = path;
+  if (error) {
+    job.error = error.message();
+  } else {
+    job.size = size;
+  }
+  jobs.push_back(std::move(job));
+}
+
+/* Add the file, every .css file under the directory, or every path in
+   the list. */
+void add_path(const std::string &path, std::vector<job_t> &jobs) {
+  if (!path.empty() && path[0] == '@') {
+    std::ifstream list(path.substr(1));
+    if (!list) {
+      std::cerr << path.substr(1) << ": cannot open\n";
+      return;
+    }
+    for (std::string line; std::getline(list, line);) {
+      if (!line.empty()) {
+        add_path(line, jobs);
+      }
+    }
+    return;
+  }
+  std::error_code error;
+  if (fs::is_directory(path, error)) {
+    for (fs::recursive_directory_iterator iter(path, error), end; !error && iter != end; iter.increment(error)) {
+      if (iter->is_regular_file(error) && iter->path().extension() == ".css") {
+        add_file(iter->path().string(), jobs);
+      }
+    }
+  } else {
+    add_file(path, jobs);
+    return;
+  }
+  if (error) {
+    std::cerr << path << ": " << error.message() << '\n';
+  }
+}
+
+/* Read the whole file into text, or say why we couldn't. */
+bool read_file(job_t &job, std::string &text) {
+  std::ifstream strm(job.path, std::ios::binary);
+  if (!strm) {
+    job.error = "cannot open";
+    return false;
+  }
+  text.resize(static_cast<size_t>(job.size));
+  strm.read(&text[0], static_cast<std::streamsize>(text.size()));
+  text.resize(static_cast<size_t>(strm.gcount()));
+  return true;
+}
+
+void lex_file(job_t &job) {
+  auto start = clock_type::now();
+  std::string text;
+  if (!read_file(job, text)) {
+    return;
+  }
+  /* The tokens all go when the file is done, so hand them out from one
+     arena and free it in one go. */
+  std::pmr::monotonic_buffer_resource arena(text.size() * 4 + 4096);
+  lexer_config_t config(token_t::get_mask(token_t::COMMENT_TOKEN), &arena);
+  try {
+    job.item_count = lexer_t(config, text.data(), text.data() + text.size()).lex().size();
+  } catch (const yourcss::error_t &error) {
+    job.error = error.what();
+  }
+  job.seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+/* Parse the file, in pieces on the pool if there is one. */
+void parse_file(job_t &job, thread_pool_t *pool) {
+  auto start = clock_type::now();
+  std::string text;
+  if (!read_file(job, text)) {
+    return;
+  }
+  try {
+    parser_t parser(text.data(), text.data() + text.size());
+    auto sheet = pool ? parser.parse_stylesheet(*pool) : parser.parse_stylesheet();
+    job.item_count = sheet.get_rules().size();
+    if (!sheet.get_errors().empty()) {
+      job.error = sheet.get_errors().front().what();
+    }
+  } catch (const yourcss::error_t &error) {
+    job.error = error.what();
+  }
+  job.seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+/* Do the work on the job, taking anything thrown as the job failing, so
+   nothing escapes a worker. */
+template <typename work_t>
+void run(job_t &job, const work_t &work) {
+  try {
+    work(job);
+  } catch (const std::exception &error) {
+    job.error = error.what();
+  }
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    return usage(argv[0]);
+  }
+  void (*work)(job_t &);
+  const char *unit;
+  if (std::strcmp(argv[1], "lex") == 0) {
+    work = lex_file;
+    unit = "tokens";
+  } else if (std::strcmp(argv[1], "parse") == 0) {
+    work = [](job_t &job) { parse_file(job, nullptr); };
+    unit = "rules";
+  } else {
+    return usage(argv[0]);
+  }
+  size_t thread_count = 0;
+  bool is_quiet = false, is_split = false;
+  std::vector<job_t> jobs;
+  for (int i = 2; i < argc; ++i) {
+    const char *arg = argv[i];
+    if (std::strncmp(arg, "--jobs=", 7) == 0) {
+      thread_count = std::strtoul(arg + 7, nullptr, 10);
+    } else if (std::strcmp(arg, "--quiet") == 0) {
+      is_quiet = true;
+    } else if (std::strcmp(arg, "--split") == 0 && work != lex_file) {
+      is_split = true;
+    } else if (arg[0] == '-') {
+      return usage(argv[0]);
+    } else {
+      add_path(arg, jobs);
+    }
+  }
+  /* Biggest first, so no big file is left to start once the rest are done. */
+  std::stable_sort(jobs.begin(), jobs.end(), [](const job_t &a, const job_t &b) {
+    return a.size > b.size;
+  });
+  auto start = clock_type::now();
+  size_t steal_count;
+  {
+    thread_pool_t pool(thread_count);
+    thread_count = pool.get_thread_count();
+    for (auto &job: jobs) {
+      /* Failed already, when we listed it. */
+      if (!job.error.empty()) {
+        continue;
+      }
+      if (is_split) {
+        run(job, [&pool](job_t &target) { parse_file(target, &pool); });
+      } else {
+        pool.submit([&job, work] { run(job, work); });
+      }
+    }
+    pool.wait();
+    steal_count = pool.get_steal_count();
+  }
+  double seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+  uintmax_t byte_count = 0;
+  size_t item_count = 0, error_count = 0;
+  for (const auto &job: jobs) {
+    byte_count += job.size;
+    item_count += job.item_count;
+    if (!job.error.empty()) {
+      ++error_count;
+      std::cerr << job.path << ": " << job.error << '\n';
+    }
+    if (!is_quiet) {
+      std::printf("%10.3f ms %12ju bytes %10zu %s  %s\n", job.seconds * 1000, job.size, job.item_count, unit, job.path.c_str());
+    }
+  }
+  std::printf(
+      "%zu files, %ju bytes, %zu %s, %zu errors in %.3f s on %zu threads (%zu steals); %.1f MB/s\n",
+      jobs.size(), byte_count, item_count, unit, error_count, seconds, thread_count, steal_count,
+      seconds > 0 ? static_cast<double>(byte_count) / seconds / 1e6 : 0.0);
+  return error_count ? 1 : 0;
+}
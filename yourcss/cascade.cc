@@ -0,0 +1,206 @@
+#include "cascade.h"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+namespace yourcss {
+
+namespace {
+
+/* True if the property is a custom one, whose name keeps its case. */
+bool is_custom(std::string_view name) {
+  return name.size() >= 2 && name[0] == '-' && name[1] == '-';
+}
+
+/* Where declarations from the origin go in the cascade, lowest first:
+   normal user agent, user and author declarations, then important
+   author, user and user agent ones. */
+uint64_t get_level(cascade_t::origin_t origin, bool important) noexcept {
+  return static_cast<uint64_t>(important ? 5 - origin : origin);
+}
+
+}  // namespace
+
+style_t::style_t(size_t property_count):
+  values(property_count, nullptr) {}
+
+const declaration_t *style_t::get(uint32_t property) const noexcept {
+  return property < values.size() ? values[property] : nullptr;
+}
+
+size_t style_t::get_property_count() const noexcept {
+  return values.size();
+}
+
+cascade_t::cascade_t() {}
+
+void cascade_t::add(const selector_table_t &table, origin_t origin) {
+  const auto &selectors = table.get_selectors();
+  tables.push_back(table_t{selectors.data(), selectors.data() + selectors.size(), applied.size()});
+  applied.reserve(applied.size() + selectors.size());
+  for (const auto &selector: selectors) {
+    /* A rule with a list of selectors is met once for each, but its
+       declarations are numbered, in order of appearance, the first time. */
+    const auto &declarations = selector.rule->block.declarations;
+    auto result = rule_entries.emplace(selector.rule, static_cast<uint32_t>(entries.size()));
+    if (result.second) {
+      if (entries.size() + declarations.size() >= (uint64_t(1) << order_bits)) {
+        throw std::length_error("too many declarations to cascade");
+      }
+      for (const auto &declaration: declarations) {
+        auto property = is_custom(declaration.name)
+            ? properties.intern(declaration.name) : properties.intern_lower(declaration.name);
+        entries.push_back(entry_t{&declaration, property, declaration.important});
+      }
+    }
+    uint64_t first = result.first->second;
+    uint64_t specificity = uint64_t(selector.specificity) << order_bits;
+    applied.push_back(applied_t{
+        result.first->second, static_cast<uint32_t>(declarations.size()),
+        (get_level(origin, false) << (specificity_bits + order_bits)) | specificity | first,
+        (get_level(origin, true) << (specificity_bits + order_bits)) | specificity | first});
+  }
+}
+
+uint32_t cascade_t::find_property(std::string_view name) const {
+  if (is_custom(name)) {
+    return properties.find(name);
+  }
+  std::string lowered(name);
+  for (auto &c: lowered) {
+    if (c >= 'A' && c <= 'Z') {
+      c = static_cast<char>(c - 'A' + 'a');
+    }
+  }
+  return properties.find(lowered);
+}
+
+std::string_view cascade_t::get_property_name(uint32_t property) const noexcept {
+  return properties.get_text(property);
+}
+
+size_t cascade_t::get_property_count() const noexcept {
+  return properties.size();
+}
+
+const cascade_t::applied_t *cascade_t::find_applied(const selector_t *selector) const noexcept {
+  std::less<const selector_t *> less;
+  for (const auto &table: tables) {
+    if (!less(selector, table.begin) && less(selector, table.end)) {
+      return &applied[table.first + static_cast<size_t>(selector - table.begin)];
+    }
+  }
+  return nullptr;
+}
+
+styler_t::styler_t(const cascade_t &cascade_):
+  cascade(cascade_),
+  next_cached(0),
+  shared_count(0) {}
+
+std::shared_ptr<const style_t> styler_t::get_style(const std::vector<const selector_t *> &matched) {
+  selectors.clear();
+  uint64_t hash = 0xcbf29ce484222325;
+  for (auto selector: matched) {
+    if (selector->pseudo_element == atom_table_t::none) {
+      selectors.push_back(selector);
+      hash = (hash ^ reinterpret_cast<uintptr_t>(selector)) * 0x100000001b3;
+    }
+  }
+  for (const auto &cached: cache) {
+    if (cached.hash == hash && cached.matched == selectors) {
+      ++shared_count;
+      return cached.style;
+    }
+  }
+  auto style = make_style();
+  if (cache.size() < cache_size) {
+    cache.push_back(cached_t{hash, selectors, style});
+  } else {
+    auto &cached = cache[next_cached];
+    cached.hash = hash;
+    cached.matched.assign(selectors.begin(), selectors.end());
+    cached.style = style;
+  }
+  next_cached = (next_cached + 1) % cache_size;
+  return style;
+}
+
+size_t styler_t::get_shared_count() const noexcept {
+  return shared_count;
+}
+
+void styler_t::sort_keys(std::vector<uint64_t> &keys, std::vector<uint64_t> &scratch) noexcept {
+  auto size = keys.size();
+  /* An element seldom gets more than a few dozen declarations, which an
+     insertion sort handles in less time than it takes a radix sort to
+     count them. */
+  if (size < 64) {
+    for (size_t i = 1; i < size; ++i) {
+      auto key = keys[i];
+      auto j = i;
+      for (; j && keys[j - 1] > key; --j) {
+        keys[j] = keys[j - 1];
+      }
+      keys[j] = key;
+    }
+    return;
+  }
+  /* Otherwise, least significant byte first, counting all eight bytes in
+     one pass.  Most keys share their top bytes, the origin and much of the
+     specificity, so a byte which is the same in every key is skipped. */
+  uint32_t counts[8][256] = {};
+  for (auto key: keys) {
+    for (unsigned byte = 0; byte < 8; ++byte) {
+      ++counts[byte][(key >> (byte * 8)) & 0xff];
+    }
+  }
+  auto *from = &keys, *to = &scratch;
+  for (unsigned byte = 0; byte < 8; ++byte) {
+    auto shift = byte * 8;
+    auto &count = counts[byte];
+    if (count[((*from)[0] >> shift) & 0xff] == size) {
+      continue;
+    }
+    uint32_t start = 0;
+    for (auto &n: count) {
+      auto next = start + n;
+      n = start;
+      start = next;
+    }
+    for (auto key: *from) {
+      (*to)[count[(key >> shift) & 0xff]++] = key;
+    }
+    std::swap(from, to);
+  }
+  if (from != &keys) {
+    keys.swap(scratch);
+  }
+}
+
+std::shared_ptr<const style_t> styler_t::make_style() {
+  keys.clear();
+  for (auto selector: selectors) {
+    auto applied = cascade.find_applied(selector);
+    if (!applied) {
+      continue;
+    }
+    for (uint32_t i = 0; i < applied->count; ++i) {
+      const auto &entry = cascade.entries[applied->first + i];
+      keys.push_back((entry.important ? applied->important_key : applied->normal_key) + i);
+    }
+  }
+  scratch.resize(keys.size());
+  sort_keys(keys, scratch);
+  auto style = std::make_shared<style_t>(cascade.get_property_count());
+  constexpr uint64_t order_mask = (uint64_t(1) << cascade_t::order_bits) - 1;
+  for (auto key: keys) {
+    const auto &entry = cascade.entries[key & order_mask];
+    style->values[entry.property] = entry.declaration;
+  }
+  return style;
+}
+
+}  // yourcss
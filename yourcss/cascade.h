@@ -0,0 +1,249 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "parser.h"
+#include "selector.h"
+
+namespace yourcss {
+
+/* The cascaded value of each property for an element: the declaration
+   which won, or null where none applied.  Shared between all elements
+   which end up with the same declarations, so treat it as read-only. */
+class style_t final {
+
+public:
+
+  /* With room for the properties, none applied. */
+  explicit style_t(size_t property_count);
+
+  /* The declaration which won for the property, which is an ID from
+     cascade_t::find_property(), or null. */
+  const declaration_t *get(uint32_t property) const noexcept;
+
+  /* The number of property IDs. */
+  size_t get_property_count() const noexcept;
+
+private:
+
+  /* Applies declarations to us. */
+  friend class styler_t;
+
+  /* Indexed by property ID. */
+  std::vector<const declaration_t *> values;
+
+};  // style_t
+
+/* The declarations of the style rules of some selector tables, ready to
+   be cascaded.  Each declaration gets a 64-bit sort key up front, which
+   packs, from the top down, its origin and importance, the specificity of
+   the selector it's applied by, and its order of appearance, so cascading
+   is a matter of sorting the keys of the declarations of the matched
+   selectors and applying them in that order, the last one for a property
+   winning.  Property names are interned into small IDs, and a style_t is
+   an array indexed by them.
+
+   We apply every selector a table holds, and know nothing of media or
+   other conditions: which rules in @media, @supports and the like apply
+   is decided when the table is built, by the filter given to
+   selector_table_t::add_rules().  A table built without one applies all
+   of them.
+
+   Add tables before styling anything.  After that we don't change, and
+   any number of styler_ts on any number of threads may share us.  The
+   rules' blocks must have been parsed; a lazy parser's must have been
+   expanded. */
+class cascade_t final {
+
+public:
+
+  /* Where a stylesheet comes from.  Normal declarations from later
+     origins beat those from earlier ones, and important ones the other
+     way round. */
+  enum origin_t {
+    USER_AGENT,
+    USER,
+    AUTHOR,
+  };  // cascade_t::origin_t
+
+  /* Empty. */
+  cascade_t();
+
+  cascade_t(cascade_t &&) noexcept = default;
+
+  /* Add the declarations of the table's selectors' rules, as coming
+     from the origin and, within it, after those of the tables already
+     added.  The table, and the rules it came from, must outlive us. */
+  void add(const selector_table_t &table, origin_t origin);
+
+  /* The ID of the named property, or none if no rule sets it.  Names are
+     matched without regard to ASCII case, except custom properties. */
+  uint32_t find_property(std::string_view name) const;
+
+  /* The name of the property with the ID, lowered. */
+  std::string_view get_property_name(uint32_t property) const noexcept;
+
+  /* The number of property IDs, counting none. */
+  size_t get_property_count() const noexcept;
+
+  /* The ID meaning no property. */
+  static constexpr uint32_t none = atom_table_t::none;
+
+private:
+
+  /* Reads our tables. */
+  friend class styler_t;
+
+  /* The number of bits of a sort key given to the order of appearance,
+     below the specificity. */
+  static constexpr unsigned order_bits = 31;
+
+  /* The number of bits above those given to specificity, below the
+     origin and importance. */
+  static constexpr unsigned specificity_bits = 30;
+
+  /* A declaration, in order of appearance. */
+  struct entry_t final {
+
+    /* The declaration. */
+    const declaration_t *declaration;
+
+    /* Its property's ID. */
+    uint32_t property;
+
+    /* True if it's !important. */
+    bool important;
+
+  };  // cascade_t::entry_t
+
+  /* The declarations one of our tables' selectors applies. */
+  struct applied_t final {
+
+    /* The index in entries of the first of the rule's declarations. */
+    uint32_t first;
+
+    /* The number of the rule's declarations. */
+    uint32_t count;
+
+    /* The sort key of the first declaration, if it's normal; add an
+       entry's offset from first for the rest. */
+    uint64_t normal_key;
+
+    /* As normal_key, for important declarations. */
+    uint64_t important_key;
+
+  };  // cascade_t::applied_t
+
+  /* A table we've added. */
+  struct table_t final {
+
+    /* The table's selectors. */
+    const selector_t *begin, *end;
+
+    /* The index in applied of the first one's. */
+    size_t first;
+
+  };  // cascade_t::table_t
+
+  /* What the selector, one of our tables', applies, or null if it isn't
+     one of theirs. */
+  const applied_t *find_applied(const selector_t *selector) const noexcept;
+
+  /* Property names to IDs. */
+  atom_table_t properties;
+
+  /* The declarations of the rules of our tables' selectors, in order. */
+  std::vector<entry_t> entries;
+
+  /* The index in entries of each rule's first declaration. */
+  std::unordered_map<const rule_t *, uint32_t> rule_entries;
+
+  /* Parallel to the selectors of our tables, in the order we added
+     them. */
+  std::vector<applied_t> applied;
+
+  /* See table_t. */
+  std::vector<table_t> tables;
+
+};  // cascade_t
+
+/* Cascades the declarations of the selectors matched against elements,
+   and shares the resulting style_ts between elements which matched the
+   same selectors.
+
+   An element's cascaded values depend only on which selectors it
+   matched, so two elements which matched the same ones get the very same
+   style.  On a big page that's most of them: the items of a list, the
+   cells of a table and the cards of a feed match the same rules as the
+   siblings and cousins styled just before them.  We keep the styles of
+   the last few distinct lists of matched selectors, and an element
+   matching one of those lists is given its style without sorting or
+   allocating anything.
+
+   One per thread; the cascade may be shared. */
+class styler_t final {
+
+public:
+
+  /* The number of recent styles we keep for sharing. */
+  static constexpr size_t cache_size = 32;
+
+  /* Styling with the cascade, which must outlive us. */
+  explicit styler_t(const cascade_t &cascade_);
+
+  /* The style of an element which matched the selectors, as matcher_t
+     finds them, of the cascade's tables.  Selectors of pseudo-elements
+     style those rather than the element, and are passed over. */
+  std::shared_ptr<const style_t> get_style(const std::vector<const selector_t *> &matched);
+
+  /* The number of styles get_style() has shared rather than built. */
+  size_t get_shared_count() const noexcept;
+
+  /* Sort the keys, using scratch, which must be as big, for space.  The
+     result ends up in keys. */
+  static void sort_keys(std::vector<uint64_t> &keys, std::vector<uint64_t> &scratch) noexcept;
+
+private:
+
+  /* A style we can share. */
+  struct cached_t final {
+
+    /* The hash of matched. */
+    uint64_t hash;
+
+    /* The selectors matched, pseudo-elements left out. */
+    std::vector<const selector_t *> matched;
+
+    /* The style they cascade to. */
+    std::shared_ptr<const style_t> style;
+
+  };  // styler_t::cached_t
+
+  /* Cascade the selectors in selectors into a new style. */
+  std::shared_ptr<const style_t> make_style();
+
+  /* See constructor. */
+  const cascade_t &cascade;
+
+  /* The selectors being styled, pseudo-elements left out. */
+  std::vector<const selector_t *> selectors;
+
+  /* The sort keys of their declarations, and room to sort them. */
+  std::vector<uint64_t> keys, scratch;
+
+  /* The styles we can share, the one to replace next at next_cached. */
+  std::vector<cached_t> cache;
+
+  /* See cache. */
+  size_t next_cached;
+
+  /* See accessor. */
+  size_t shared_count;
+
+};  // styler_t
+
+}  // yourcss
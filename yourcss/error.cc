@@ -1,33 +1,29 @@
 #include "error.h"
 
+#include <sstream>
+
 namespace yourcss {
 
 const char *error_t::what() const noexcept {
-  if (strm) {
-    msg = strm->str();
-    strm.reset();
+  if (msg.empty()) {
+    try {
+      std::ostringstream strm;
+      strm << pos << "; ";
+      write_msg(strm);
+      msg = strm.str();
+    } catch (...) {
+      return "error (no memory to describe it)";
+    }
   }
   return msg.c_str();
 }
 
-error_t::error_t(const pos_t &pos):
-  strm(std::make_unique<std::ostringstream>()),
-  sep_needed(false) {
-  get_strm() << pos;
-  end_section();
-}
-
-void error_t::end_section() {
-  sep_needed = true;
+const pos_t &error_t::get_pos() const noexcept {
+  return pos;
 }
 
-std::ostream &error_t::get_strm() const {
-  if (sep_needed) {
-    (*strm) << "; ";
-    sep_needed = false;
-  }
-  return *strm;
-}
+error_t::error_t(const pos_t &pos_) noexcept:
+  pos(pos_) {}
 
 error_t::~error_t() = default;
 
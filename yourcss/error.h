@@ -1,46 +1,44 @@
 #pragma once
 
 #include <exception>
-#include <memory>
-#include <sstream>
+#include <ostream>
 #include <string>
 #include "pos.h"
 
 namespace yourcss {
 
-/* The base for all the kinds of errors we throw. */
+/* The base for all the kinds of errors we throw.  Constructing one only
+   records plain data; the diagnostic message isn't formatted until the
+   first call to what(), so code which catches and carries on pays nothing
+   for messages it never reads. */
 class error_t: public std::exception {
 
 public:
 
-  /* Return our diagnostic message. */
+  /* Return our diagnostic message, formatting it on the first call.  Not
+     safe to call on the same error from two threads at once. */
   virtual const char *what() const noexcept override final;
 
+  /* Where the error happened. */
+  const pos_t &get_pos() const noexcept;
+
   virtual ~error_t() override;
 
 protected:
 
   /* Do-little. */
-  error_t(const pos_t &pos);
-
-  /* Mark the end of a section of a diagnostic message.  The classes which
-     inehrit from us will use this in their constructors. */
-  void end_section();
+  error_t(const pos_t &pos) noexcept;
 
-  /* The stream to which to write our diagnostic message.  The classes which
-     inehrit from us will use this in their constructors. */
-  std::ostream &get_strm() const;
+  /* Write the sections of our diagnostic message which follow the
+     position, separated by "; ".  Called at most once. */
+  virtual void write_msg(std::ostream &strm) const = 0;
 
 private:
 
-  /* A string-builder we use to build our diagnostic message. */
-  mutable std::unique_ptr<std::ostringstream> strm;
-
-  /* If true, then the next time we add to the message, we'll insert a
-     separator character first. */
-  mutable bool sep_needed;
+  /* See accessor. */
+  pos_t pos;
 
-  /* Our diagnostic message. */
+  /* Our diagnostic message, or empty if what() hasn't been called. */
   mutable std::string msg;
 
 };  // error_t
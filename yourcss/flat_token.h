@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include "pos.h"
+#include "token.h"
+
+namespace yourcss {
+
+/* A token flattened into plain data, so it can be copied around in bulk
+   without touching the allocator.  The text lives elsewhere, in whatever
+   holds the token; text_offset and text_size locate it there. */
+struct flat_token_t final {
+
+  /* See token_t. */
+  token_t::kind_t kind;
+
+  /* See token_t. */
+  token_t::type_flag_t type_flag;
+
+  /* See token_t. */
+  bool preceded_by_whitespace;
+
+  /* See token_t. */
+  pos_t pos;
+
+  /* The numeric value of a number, percentage or dimension; otherwise 0. */
+  double value;
+
+  /* Where the text is, within the text of whatever holds the token. */
+  uint32_t text_offset, text_size;
+
+};  // flat_token_t
+
+}  // yourcss
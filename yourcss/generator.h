@@ -0,0 +1,193 @@
+#pragma once
+
+#if __cplusplus >= 202002L
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace yourcss {
+
+/* A lazily evaluated sequence of values, produced by a coroutine which
+   co_yields them.  The coroutine runs only as far as it must to produce
+   the next value, so a chain of generators, each consuming the one before
+   it, runs in lock step on one thread without buffering.
+
+   Needs C++20; see cpp20-debug.cfg. */
+template <typename val_t>
+class generator_t final {
+
+public:
+
+  class promise_type;
+
+  using handle_t = std::coroutine_handle<promise_type>;
+
+  /* The state shared between the coroutine and its consumer. */
+  class promise_type final {
+
+  public:
+
+    generator_t get_return_object() noexcept {
+      return generator_t(handle_t::from_promise(*this));
+    }
+
+    std::suspend_always initial_suspend() const noexcept {
+      return {};
+    }
+
+    std::suspend_always final_suspend() const noexcept {
+      return {};
+    }
+
+    /* The value lives in the coroutine's frame until it resumes, so we
+       can hand out its address rather than copying it. */
+    std::suspend_always yield_value(std::remove_reference_t<val_t> &value) noexcept {
+      current = std::addressof(value);
+      return {};
+    }
+
+    std::suspend_always yield_value(std::remove_reference_t<val_t> &&value) noexcept {
+      current = std::addressof(value);
+      return {};
+    }
+
+    void return_void() const noexcept {}
+
+    void unhandled_exception() noexcept {
+      error = std::current_exception();
+    }
+
+    /* Don't allow co_await in a generator. */
+    template <typename that_t>
+    std::suspend_never await_transform(that_t &&) = delete;
+
+    /* The most recently yielded value. */
+    std::remove_reference_t<val_t> &get_current() const noexcept {
+      return *current;
+    }
+
+    /* Throw whatever the coroutine threw, if anything. */
+    void rethrow_if_error() const {
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    }
+
+  private:
+
+    std::remove_reference_t<val_t> *current = nullptr;
+
+    std::exception_ptr error;
+
+  };  // generator_t<val_t>::promise_type
+
+  /* Walks the values, resuming the coroutine on each step. */
+  class iterator_t final {
+
+  public:
+
+    using iterator_category = std::input_iterator_tag;
+
+    using difference_type = std::ptrdiff_t;
+
+    using value_type = std::remove_cvref_t<val_t>;
+
+    using reference = std::remove_reference_t<val_t> &;
+
+    using pointer = std::remove_reference_t<val_t> *;
+
+    iterator_t() noexcept = default;
+
+    explicit iterator_t(handle_t handle_) noexcept:
+      handle(handle_) {}
+
+    iterator_t &operator++() {
+      handle.resume();
+      if (handle.done()) {
+        handle.promise().rethrow_if_error();
+      }
+      return *this;
+    }
+
+    void operator++(int) {
+      ++*this;
+    }
+
+    reference operator*() const noexcept {
+      return handle.promise().get_current();
+    }
+
+    pointer operator->() const noexcept {
+      return std::addressof(operator*());
+    }
+
+    friend bool operator==(const iterator_t &that, std::default_sentinel_t) noexcept {
+      return !that.handle || that.handle.done();
+    }
+
+  private:
+
+    handle_t handle;
+
+  };  // generator_t<val_t>::iterator_t
+
+  generator_t() noexcept = default;
+
+  generator_t(generator_t &&that) noexcept:
+    handle(std::exchange(that.handle, nullptr)) {}
+
+  generator_t &operator=(generator_t &&that) noexcept {
+    if (this != &that) {
+      reset();
+      handle = std::exchange(that.handle, nullptr);
+    }
+    return *this;
+  }
+
+  generator_t(const generator_t &) = delete;
+
+  generator_t &operator=(const generator_t &) = delete;
+
+  ~generator_t() {
+    reset();
+  }
+
+  /* Run the coroutine up to its first value.  Call this only once. */
+  iterator_t begin() {
+    if (handle) {
+      handle.resume();
+      if (handle.done()) {
+        handle.promise().rethrow_if_error();
+      }
+    }
+    return iterator_t(handle);
+  }
+
+  std::default_sentinel_t end() const noexcept {
+    return std::default_sentinel;
+  }
+
+private:
+
+  explicit generator_t(handle_t handle_) noexcept:
+    handle(handle_) {}
+
+  void reset() noexcept {
+    if (handle) {
+      handle.destroy();
+      handle = nullptr;
+    }
+  }
+
+  handle_t handle;
+
+};  // generator_t<val_t>
+
+}  // yourcss
+
+#endif
@@ -3,10 +3,13 @@
 namespace yourcss {
 
 /* Report the file and line at which we iced. */
-ice_t::ice_t(const pos_t &pos, const char *file, int line_number): error_t(pos) {
-  get_strm() << "internal compiler error";
-  end_section();
-  get_strm() << file << ", " << line_number;
+ice_t::ice_t(const pos_t &pos, const char *file_, int line_number_) noexcept:
+  error_t(pos),
+  file(file_),
+  line_number(line_number_) {}
+
+void ice_t::write_msg(std::ostream &strm) const {
+  strm << "internal compiler error; " << file << ", " << line_number;
 }
 
 ice_t::~ice_t() = default;
@@ -10,11 +10,23 @@ class ice_t final: public error_t {
 
 public:
 
-  /* Report the file and line at which we iced. */
-  ice_t(const pos_t &pos, const char *file, int line_number);
+  /* Report the file and line at which we iced.  The file name must
+     outlive us; __FILE__ does. */
+  ice_t(const pos_t &pos, const char *file, int line_number) noexcept;
 
   virtual ~ice_t() override;
 
+private:
+
+  /* See ice_t(). */
+  virtual void write_msg(std::ostream &strm) const override;
+
+  /* Where in our own source we iced. */
+  const char *file;
+
+  /* See file. */
+  int line_number;
+
 };  // ice_t
 
 }  // biglr
@@ -1,71 +1,236 @@
 #include "lexer.h"
 
+/* Trace the rest of the enclosing scope, if the policy asks for it. */
+#define YOURCSS_LEXER_SPAN(name) \
+  typename trace_t::template span_if_t<policy_t::trace> \
+      YOURCSS_TRACE_CAT(yourcss_lexer_span_, __LINE__)((name), &cursor, origin)
+
 namespace yourcss {
 
-lexer_t::lexer_error_t::lexer_error_t(const lexer_t *lexer, const char *msg):
-  error_t(lexer->pos) { get_strm() << msg; }
+lexer_error_t::lexer_error_t(const pos_t &pos, uint64_t offset_, code_t code_, const char *detail_) noexcept:
+  error_t(pos),
+  code(code_),
+  offset(offset_),
+  detail(detail_) {}
+
+lexer_error_t::code_t lexer_error_t::get_code() const noexcept {
+  return code;
+}
+
+uint64_t lexer_error_t::get_offset() const noexcept {
+  return offset;
+}
+
+const char *lexer_error_t::get_detail() const noexcept {
+  return detail;
+}
+
+void lexer_error_t::write_msg(std::ostream &strm) const {
+  strm << detail;
+}
+
+lexer_error_t::~lexer_error_t() = default;
 
-lexer_t::lexer_error_t::~lexer_error_t() = default;
+template <typename policy_t>
+void basic_lexer_t<policy_t>::print_tokens(const std::vector<token_t> &tokens) {
+  for (const auto &token: tokens) {
+    std::cout << token << '\n';
+  }
+  std::cout.flush();
+}
 
-void lexer_t::print_tokens(const std::vector<token_t> &tokens) {
+template <typename policy_t>
+void basic_lexer_t<policy_t>::print_tokens(const std::vector<std::shared_ptr<token_t>> &tokens) {
   for (const auto &token: tokens) {
-    std::cout << token << std::endl;
+    std::cout << (*token) << '\n';
   }
+  std::cout.flush();
 }
 
-void lexer_t::print_tokens(const std::vector<std::shared_ptr<token_t>> &tokens) {
+template <typename policy_t>
+void basic_lexer_t<policy_t>::print_tokens(const token_list_t &tokens) {
   for (const auto &token: tokens) {
-    std::cout << (*token) << std::endl;
+    std::cout << (*token) << '\n';
   }
+  std::cout.flush();
+}
+
+lexer_config_t::lexer_config_t(token_t::kind_mask_t filter_, std::pmr::memory_resource *resource_) noexcept:
+  filter(filter_),
+  resource(resource_) {}
+
+token_t::kind_mask_t lexer_config_t::get_filter() const noexcept {
+  return filter;
+}
+
+std::pmr::memory_resource *lexer_config_t::get_resource() const noexcept {
+  return resource;
 }
 
-lexer_t::lexer_t(const char *next_cursor_):
-  discard_comments(true),
+template <typename policy_t>
+basic_lexer_t<policy_t>::basic_lexer_t(const char *next_cursor_, std::pmr::memory_resource *resource):
+  basic_lexer_t(lexer_config_t(token_t::get_mask(token_t::COMMENT_TOKEN), resource), next_cursor_) {}
+
+template <typename policy_t>
+basic_lexer_t<policy_t>::basic_lexer_t(
+    const char *begin, const char *end, const pos_t &start,
+    std::pmr::memory_resource *resource):
+  basic_lexer_t(lexer_config_t(token_t::get_mask(token_t::COMMENT_TOKEN), resource), begin, end, start) {}
+
+template <typename policy_t>
+basic_lexer_t<policy_t>::basic_lexer_t(const lexer_config_t &config, const char *next_cursor_):
+  alloc(config.get_resource()),
+  errors(alloc),
+  filter(config.get_filter()),
+  preceded_by_whitespace(false),
+  origin(next_cursor_),
+  limit(nullptr),
+  reached_limit(false),
   next_cursor(next_cursor_),
   is_ready(false),
+  cursor(next_cursor_),
   anchor(nullptr) {}
 
-char lexer_t::peek() const {
+template <typename policy_t>
+basic_lexer_t<policy_t>::basic_lexer_t(
+    const lexer_config_t &config,
+    const char *begin, const char *end, const pos_t &start):
+  basic_lexer_t(config, begin) {
+  limit = end;
+  next_pos = start;
+}
+
+template <typename policy_t>
+char basic_lexer_t<policy_t>::peek() {
   if (!is_ready) {
     cursor = next_cursor;
     pos = next_pos;
-    switch (*cursor) {
+    if (cursor == limit) {
+      reached_limit = true;
+    }
+    switch (cursor == limit ? '\0' : *cursor) {
       case '\0': {
         break;
       }
       case '\n': {
         ++next_cursor;
-        next_pos.next_line();
+        if constexpr (policy_t::track_pos) {
+          next_pos.next_line();
+        }
         break;
       }
       default: {
         ++next_cursor;
-        next_pos.next_col();
+        if constexpr (policy_t::track_pos) {
+          next_pos.next_col();
+        }
       }
     }  // switch
     is_ready = true;
   }
-  return *cursor;
+  return cursor == limit ? '\0' : *cursor;
+}
+
+template <typename policy_t>
+char basic_lexer_t<policy_t>::peek_ahead(size_t count) {
+  peek();
+  for (const char *c = cursor; ; ++c) {
+    if (c == limit) {
+      reached_limit = true;
+      break;
+    }
+    if (!*c) {
+      break;
+    }
+    if (!count) {
+      return *c;
+    }
+    --count;
+  }
+  return '\0';
+}
+
+template <typename policy_t>
+std::pmr::memory_resource *basic_lexer_t<policy_t>::get_resource() const {
+  return alloc.resource();
+}
+
+template <typename policy_t>
+const std::pmr::vector<lexer_error_t> &basic_lexer_t<policy_t>::get_errors() const {
+  return errors;
+}
+
+template <typename policy_t>
+const char *basic_lexer_t<policy_t>::get_next_cursor() const {
+  return is_ready ? cursor : next_cursor;
+}
+
+template <typename policy_t>
+const pos_t &basic_lexer_t<policy_t>::get_next_pos() const {
+  return is_ready ? pos : next_pos;
+}
+
+template <typename policy_t>
+bool basic_lexer_t<policy_t>::has_passed_whitespace() const {
+  return preceded_by_whitespace;
 }
 
-void lexer_t::set_discard_comments(bool discard_comments_) {
-  discard_comments = discard_comments_;
+template <typename policy_t>
+void basic_lexer_t<policy_t>::set_passed_whitespace(bool passed_whitespace) {
+  preceded_by_whitespace = passed_whitespace;
 }
 
-char lexer_t::reset_cursor(const char *saved_cursor) {
+template <typename policy_t>
+bool basic_lexer_t<policy_t>::has_reached_limit() const {
+  return reached_limit;
+}
+
+template <typename policy_t>
+void basic_lexer_t<policy_t>::fail(lexer_error_t::code_t code, const char *detail) const {
+  uint64_t offset = pos.get_offset();
+  if constexpr (!policy_t::track_pos) {
+    offset += static_cast<uint64_t>(cursor - origin);
+  }
+  throw lexer_error_t(pos, offset, code, detail);
+}
+
+template <typename policy_t>
+void basic_lexer_t<policy_t>::set_discard_comments(bool discard_comments) {
+  if (discard_comments) {
+    filter |= token_t::get_mask(token_t::COMMENT_TOKEN);
+  } else {
+    filter &= ~token_t::get_mask(token_t::COMMENT_TOKEN);
+  }
+}
+
+template <typename policy_t>
+void basic_lexer_t<policy_t>::set_filter(token_t::kind_mask_t filter_) {
+  filter = filter_;
+}
+
+template <typename policy_t>
+token_t::kind_mask_t basic_lexer_t<policy_t>::get_filter() const {
+  return filter;
+}
+
+template <typename policy_t>
+char basic_lexer_t<policy_t>::reset_cursor(const char *saved_cursor, const pos_t &saved_pos) {
   is_ready = false;
   next_cursor = saved_cursor;
+  next_pos = saved_pos;
   char c = peek();
   return c;
 }
 
-char lexer_t::pop() {
+template <typename policy_t>
+char basic_lexer_t<policy_t>::pop() {
   char c = peek();
   is_ready = false;
   return c;
 }
 
-void lexer_t::set_anchor() const {
+template <typename policy_t>
+void basic_lexer_t<policy_t>::set_anchor() {
   anchor_pos = pos;
 
   if (anchor) {
@@ -75,52 +240,101 @@ void lexer_t::set_anchor() const {
   anchor = cursor;
 }
 
-std::string lexer_t::pop_anchor() {
+template <typename policy_t>
+std::pmr::string basic_lexer_t<policy_t>::pop_anchor() {
   if (!anchor) {
-    for (const auto &token: tokens) {
-      std::cout << token << std::endl;
-    }
     throw ice_t(pos, __FILE__, __LINE__);
   }
 
-  std::string text(anchor, static_cast<size_t>(cursor - anchor));
+  std::pmr::string text(anchor, static_cast<size_t>(cursor - anchor), alloc);
   anchor = nullptr;
   return text;
 }
 
-void lexer_t::add_single_token(token_t::kind_t kind) {
+template <typename policy_t>
+double basic_lexer_t<policy_t>::to_number(const std::pmr::string &text) const {
+  YOURCSS_LEXER_SPAN("to_number");
+  return std::strtod(text.c_str(), nullptr);
+}
+
+template <typename policy_t>
+void basic_lexer_t<policy_t>::drop_anchor() {
+  if (!anchor) {
+    throw ice_t(pos, __FILE__, __LINE__);
+  }
+  anchor = nullptr;
+}
+
+template <typename policy_t>
+void basic_lexer_t<policy_t>::add_single_token(token_t::kind_t kind) {
   set_anchor();
   pop();
-  pop_anchor();
-  tokens.push_back(token_t::make(anchor_pos, kind));
+  drop_anchor();
+  if (keeps(kind)) {
+    add_token(token_t::make(anchor_pos, kind, alloc));
+  }
+}
+
+template <typename policy_t>
+bool basic_lexer_t<policy_t>::keeps(token_t::kind_t kind) const {
+  return !((policy_t::filter | filter) & token_t::get_mask(kind));
 }
 
-bool lexer_t::is_name_point(char c) {
+template <typename policy_t>
+void basic_lexer_t<policy_t>::add_token(std::shared_ptr<token_t> &&token) {
+  if (!token || !keeps(token->get_kind())) {
+    return;
+  }
+  token->set_preceded_by_whitespace(preceded_by_whitespace);
+  preceded_by_whitespace = false;
+  pending = std::move(token);
+}
+
+template <typename policy_t>
+void basic_lexer_t<policy_t>::add_token(const pos_t &at, token_t::kind_t kind, std::pmr::string &&text) {
+  if (keeps(kind)) {
+    add_token(token_t::make(at, kind, std::move(text)));
+  }
+}
+
+template <typename policy_t>
+void basic_lexer_t<policy_t>::add_token(const pos_t &at, token_t::kind_t kind, std::string_view text) {
+  if (keeps(kind)) {
+    add_token(token_t::make(at, kind, std::pmr::string(text, alloc)));
+  }
+}
+
+template <typename policy_t>
+bool basic_lexer_t<policy_t>::is_name_point(char c) {
   if (is_name_start(c) || isdigit(c) || c == '-') {
     return true;
   }
   return false;
 }
 
-bool lexer_t::is_name_start(char c) {
+template <typename policy_t>
+bool basic_lexer_t<policy_t>::is_name_start(char c) {
   if (isalpha(c) || c == '_' || is_non_ascii(c)) {
     return true;
   }
   return false;
 }
 
-bool lexer_t::is_non_ascii(char c) {
+template <typename policy_t>
+bool basic_lexer_t<policy_t>::is_non_ascii(char c) {
   if (static_cast<unsigned char> (c) > 127) {
     return true;
   }
   return false;
 }
 
-bool lexer_t::peek_is_identifier() {
+template <typename policy_t>
+bool basic_lexer_t<policy_t>::peek_is_identifier() {
   char first = peek();
   const char *cursor_anchor = cursor;
+  pos_t pos_anchor = pos;
   if (first == '\0' || isspace(first)) {
-    reset_cursor(cursor_anchor);
+    reset_cursor(cursor_anchor, pos_anchor);
     return false;
   }
 
@@ -129,7 +343,7 @@ bool lexer_t::peek_is_identifier() {
     pop();
     char second = peek();
     if (second == '\0' || isspace(second)) {
-      reset_cursor(cursor_anchor);
+      reset_cursor(cursor_anchor, pos_anchor);
       return false;
     }
     // is second a valid escape
@@ -138,19 +352,19 @@ bool lexer_t::peek_is_identifier() {
       char third = peek();
       // is third a new line character
       if (third == '\n') {
-        reset_cursor(cursor_anchor);
+        reset_cursor(cursor_anchor, pos_anchor);
         return false;
       }
       // is valid start identifier
-      reset_cursor(cursor_anchor);
+      reset_cursor(cursor_anchor, pos_anchor);
       return true;
     }
     // is second a name start code point?
     if (is_name_start(second)) {
-      reset_cursor(cursor_anchor);
+      reset_cursor(cursor_anchor, pos_anchor);
       return true;
     }
-    reset_cursor(cursor_anchor);
+    reset_cursor(cursor_anchor, pos_anchor);
     return false;
   }
 
@@ -165,18 +379,19 @@ bool lexer_t::peek_is_identifier() {
     char second = peek();
     // is third a new line character
     if (second == '\n') {
-      reset_cursor(cursor_anchor);
+      reset_cursor(cursor_anchor, pos_anchor);
       return false;
     }
     // is valid escape
-    reset_cursor(cursor_anchor);
+    reset_cursor(cursor_anchor, pos_anchor);
     return true;
   }
 
   return false;
 }
 
-std::string lexer_t::consume_escape() {
+template <typename policy_t>
+std::pmr::string basic_lexer_t<policy_t>::consume_escape() {
   int num_hex_consumed = 0;
   const char *anchor_escape = cursor;
   enum {
@@ -207,7 +422,7 @@ std::string lexer_t::consume_escape() {
           pop();
           go = false;
         } else {
-          throw lexer_error_t(this, "unexpected new line in escape body consume_escape()::escape_body");
+          fail(lexer_error_t::BAD_ESCAPE, "unexpected new line in escape body consume_escape()::escape_body");
         }
         break;
       }
@@ -215,7 +430,7 @@ std::string lexer_t::consume_escape() {
       case hex_body: {
         if (isxdigit(c)) {
           if (num_hex_consumed >= 6) {
-            throw lexer_error_t(this, "hex number can only contain 6 digits in consume_escape()::hex_body");
+            fail(lexer_error_t::BAD_ESCAPE, "hex number can only contain 6 digits in consume_escape()::hex_body");
           }
           num_hex_consumed += 1;
           pop();
@@ -232,26 +447,29 @@ std::string lexer_t::consume_escape() {
 
     }
   }
-  return std::string{anchor_escape, static_cast<size_t>(cursor - anchor_escape)};
+  return std::pmr::string{anchor_escape, static_cast<size_t>(cursor - anchor_escape), alloc};
 }
 
-bool lexer_t::peek_is_escape() {
-  const char *anchor_escape = cursor;
+template <typename policy_t>
+bool basic_lexer_t<policy_t>::peek_is_escape() {
   char c = peek();
+  const char *anchor_escape = cursor;
+  pos_t pos_escape = pos;
   if (c != '\\') {
     return false;
   }
   pop();
   c = peek();
   if (c == '\n') {
-    reset_cursor(anchor_escape);
+    reset_cursor(anchor_escape, pos_escape);
     return false;
   }
-  reset_cursor(anchor_escape);
+  reset_cursor(anchor_escape, pos_escape);
   return true;
 }
 
-std::string lexer_t::consume_name() {
+template <typename policy_t>
+std::string_view basic_lexer_t<policy_t>::consume_name() {
   const char *anchor_name = cursor;
   bool go = true;
   while (go) {
@@ -268,13 +486,15 @@ std::string lexer_t::consume_name() {
       }
     }
   }
-  return std::string{anchor_name, static_cast<size_t>(cursor - anchor_name)};
+  return std::string_view(anchor_name, static_cast<size_t>(cursor - anchor_name));
 }
 
-std::shared_ptr<token_t> lexer_t::lex_url_token() {
+template <typename policy_t>
+std::shared_ptr<token_t> basic_lexer_t<policy_t>::lex_url_token() {
+  YOURCSS_LEXER_SPAN("lex_url_token");
   auto url_pos = pos;
   const char *anchor_url = cursor;
-  std::string text;
+  std::string_view text;
   bool bad = false;
   bool go = true;
   enum {
@@ -292,7 +512,7 @@ std::shared_ptr<token_t> lexer_t::lex_url_token() {
       case start: {
         switch (c) {
           case '\0': {
-            text = std::string{anchor_url, static_cast<size_t>(cursor - anchor_url)};
+            text = std::string_view(anchor_url, static_cast<size_t>(cursor - anchor_url));
             go = false;
             break;
           }
@@ -370,7 +590,6 @@ std::shared_ptr<token_t> lexer_t::lex_url_token() {
           break;
         }
         state = bad_url;
-        pop();
         break;
       }
 
@@ -400,7 +619,7 @@ std::shared_ptr<token_t> lexer_t::lex_url_token() {
             break;
           }
           case ')': {
-            text = std::string{anchor_url, static_cast<size_t>(cursor - anchor_url)};
+            text = std::string_view(anchor_url, static_cast<size_t>(cursor - anchor_url));
             pop();
             go = false;
             break;
@@ -410,12 +629,13 @@ std::shared_ptr<token_t> lexer_t::lex_url_token() {
               consume_escape();
               break;
             }
-            bad = true;
+            text = std::string_view(anchor_url, static_cast<size_t>(cursor - anchor_url));
+            state = bad_url;
             break;
           }
           default: {
             if (isspace(c)) {
-              text = std::string{anchor_url, static_cast<size_t>(cursor - anchor_url)};
+              text = std::string_view(anchor_url, static_cast<size_t>(cursor - anchor_url));
               state = white_space_end;
               pop();
               break;
@@ -438,15 +658,21 @@ std::shared_ptr<token_t> lexer_t::lex_url_token() {
             go = false;
             break;
           }
-          case '\'': {
+          case '\\': {
             if (peek_is_escape()) {
               consume_escape();
               break;
             }
+            pop();
             break;
           }
           case ')': {
             go = false;
+            pop();
+            break;
+          }
+          default: {
+            pop();
             break;
           }
         }
@@ -454,20 +680,23 @@ std::shared_ptr<token_t> lexer_t::lex_url_token() {
       }
     }
   } while (go);
-  if (bad) {
-    return token_t::make(url_pos, token_t::BAD_URL_TOKEN, std::move(text));
+  auto kind = bad ? token_t::BAD_URL_TOKEN : token_t::URL_TOKEN;
+  if (!keeps(kind)) {
+    return nullptr;
   }
-  return token_t::make(url_pos, token_t::URL_TOKEN, std::move(text));
+  return token_t::make(url_pos, kind, std::pmr::string(text, alloc));
 }
 
-std::string lexer_t::consume_string(char ending_point) {
+template <typename policy_t>
+std::string_view basic_lexer_t<policy_t>::consume_string(char ending_point) {
+  YOURCSS_LEXER_SPAN("consume_string");
   const char *anchor_string = cursor;
+  enum {
+    start,
+    back_slash,
+  } state = start;
   do {
     char c = peek();
-    enum {
-      start,
-      back_slash,
-    } state = start;
     switch (state) {
       case start: {
         switch (c) {
@@ -477,14 +706,14 @@ std::string lexer_t::consume_string(char ending_point) {
             break;
           }
           case '\n': {
-            throw lexer_error_t(this, "unexpected new line in lex_string_token()::start");
+            fail(lexer_error_t::BAD_STRING, "unexpected new line in lex_string_token()::start");
           }
           case '\0': {
-            return std::string{anchor_string, static_cast<size_t>(cursor - anchor_string)};
+            return std::string_view(anchor_string, static_cast<size_t>(cursor - anchor_string));
           }
           default: {
             if (c == ending_point) {
-              std::string result{anchor_string, static_cast<size_t>(cursor - anchor_string)};
+              std::string_view result(anchor_string, static_cast<size_t>(cursor - anchor_string));
               pop();
               return result;
             }
@@ -495,52 +724,56 @@ std::string lexer_t::consume_string(char ending_point) {
         break;
       }
       case back_slash: {
-        switch (c) {
-          case '\n': {
-            pop();
-            state = start;
-            break;
-          }
-          default: {
-            if (peek_is_escape()) {
-              consume_escape();
-            } else {
-              pop();
-            }
-            state = start;
-            break;
-          }
+        /* The backslash escapes what follows, a newline or a quote
+           included.  The rest of a hex escape is ordinary text here. */
+        if (c == '\0') {
+          return std::string_view(anchor_string, static_cast<size_t>(cursor - anchor_string));
         }
+        pop();
+        state = start;
         break;
       }
     }
   } while (true);
 }
 
-std::shared_ptr<token_t> lexer_t::lex_ident_token() {
+template <typename policy_t>
+std::shared_ptr<token_t> basic_lexer_t<policy_t>::lex_ident_token() {
+  YOURCSS_LEXER_SPAN("lex_ident_token");
   set_anchor();
   auto text = consume_name();
   char c = peek();
   if (text == "url" && c == '(') {
-    pop_anchor();
+    drop_anchor();
     pop();
     c = peek();
     return lex_url_token();
   } else if (c == '(') {
-    pop_anchor();
+    auto ident_pos = anchor_pos;
+    drop_anchor();
     set_anchor();
     pop();
     peek();
-    auto left_paren_token = token_t::make(anchor_pos, token_t::DELIM_TOKEN, pop_anchor());
-    auto ident_token = token_t::make(anchor_pos, token_t::IDENT_TOKEN, std::move(text));
-    return function_token_t::make(*ident_token, *left_paren_token);
+    if (!keeps(token_t::FUNCTION_TOKEN)) {
+      drop_anchor();
+      return nullptr;
+    }
+    auto left_paren_text = pop_anchor();
+    token_t left_paren_token(anchor_pos, token_t::DELIM_TOKEN, std::move(left_paren_text), alloc);
+    token_t ident_token(ident_pos, token_t::IDENT_TOKEN, std::pmr::string(text, alloc), alloc);
+    return function_token_t::make(ident_token, left_paren_token, alloc);
   } else {
-    pop_anchor();
-    return token_t::make(anchor_pos, token_t::IDENT_TOKEN, std::move(text));
+    drop_anchor();
+    if (!keeps(token_t::IDENT_TOKEN)) {
+      return nullptr;
+    }
+    return token_t::make(anchor_pos, token_t::IDENT_TOKEN, std::pmr::string(text, alloc));
   }
 }
 
-std::shared_ptr<token_t> lexer_t::lex_numeric_token() {
+template <typename policy_t>
+std::shared_ptr<token_t> basic_lexer_t<policy_t>::lex_numeric_token() {
+  YOURCSS_LEXER_SPAN("lex_numeric_token");
   // dimension token
   auto flag = token_t::type_flag_t::INTEGER;
   set_anchor();
@@ -582,7 +815,7 @@ std::shared_ptr<token_t> lexer_t::lex_numeric_token() {
               state = number;
               break;
             }
-            throw lexer_error_t(this, "unexpected char in lex_numeric_token()::start");
+            fail(lexer_error_t::BAD_NUMBER, "unexpected char in lex_numeric_token()::start");
           }
         }
         break;
@@ -599,7 +832,7 @@ std::shared_ptr<token_t> lexer_t::lex_numeric_token() {
           state = number;
           break;
         }
-        throw lexer_error_t(this, "unexpected char in lex_numeric_token()::start");
+        fail(lexer_error_t::BAD_NUMBER, "unexpected char in lex_numeric_token()::start");
       }
 
       // number can only end with a digit
@@ -623,39 +856,43 @@ std::shared_ptr<token_t> lexer_t::lex_numeric_token() {
           default: {
             if (c == 'e' || c == 'E') {
               state = exponent;
-              
-              ++cursor;
-              if (*cursor == '+' || *cursor == '-') {
-                ++cursor;
-                if (isdigit(*cursor)) {
-                  state = exponent;
+              char after = peek_ahead(1);
+              if (after == '+' || after == '-') {
+                if (isdigit(peek_ahead(2))) {
                   flag = token_t::type_flag_t::NUMBER;
-                  --cursor;
-                  --cursor;
                   pop();
                   break;
                 }
-                --cursor;
-              } else if (isdigit(*cursor)) {
-                state = exponent;
+              } else if (isdigit(after)) {
                 flag = token_t::type_flag_t::NUMBER;
-                --cursor;
                 pop();
                 break;
               }
-              --cursor;
             }
             if (peek_is_identifier()) {
+              if (!keeps(token_t::DIMENSION_TOKEN)) {
+                drop_anchor();
+                consume_name();
+                return nullptr;
+              }
               auto text = pop_anchor();
-              double num_value = stod(text);
-              auto number = number_token_t::make(anchor_pos, token_t::NUMBER_TOKEN, std::move(text), num_value);
-              number->set_type_flag(flag);
-              auto identifier = lex_ident_token();
-              auto token = dimension_token_t::make(*number, *identifier);
-              return std::move(token);
+              peek();
+              auto unit_pos = pos;
+              auto unit = consume_name();
+              double num_value = to_number(text);
+              number_token_t number(anchor_pos, token_t::NUMBER_TOKEN, std::move(text), num_value, alloc);
+              number.set_type_flag(flag);
+              token_t identifier(unit_pos, token_t::IDENT_TOKEN, std::pmr::string(unit, alloc), alloc);
+              auto token = dimension_token_t::make(number, identifier, alloc);
+              token->set_type_flag(flag);
+              return token;
             } else {
+              if (!keeps(token_t::NUMBER_TOKEN)) {
+                drop_anchor();
+                return nullptr;
+              }
               auto text = pop_anchor();
-              double num_value = stod(text);
+              double num_value = to_number(text);
               auto token = number_token_t::make(anchor_pos, token_t::NUMBER_TOKEN, std::move(text), num_value);
               token->set_type_flag(flag);
               return std::move(token);
@@ -667,7 +904,7 @@ std::shared_ptr<token_t> lexer_t::lex_numeric_token() {
 
       case point: {
         if (consumed_point) {
-          throw lexer_error_t(this, "unexpected extra point in lex_numeric_token()::point");
+          fail(lexer_error_t::BAD_NUMBER, "unexpected extra point in lex_numeric_token()::point");
         }
         flag = token_t::type_flag_t::NUMBER;
         consumed_point = true;
@@ -676,12 +913,12 @@ std::shared_ptr<token_t> lexer_t::lex_numeric_token() {
           pop();
           break;
         }
-        throw lexer_error_t(this, "unexpected character after number decimal point in lex_number_token()::point");
+        fail(lexer_error_t::BAD_NUMBER, "unexpected character after number decimal point in lex_number_token()::point");
       }
 
       case exponent: {
         if (consumed_e) {
-          throw lexer_error_t(this, "unexpected extra exponent in lex_number_token()::exponent");
+          fail(lexer_error_t::BAD_NUMBER, "unexpected extra exponent in lex_number_token()::exponent");
         }
         consumed_e = true;
         switch (c) {
@@ -697,7 +934,7 @@ std::shared_ptr<token_t> lexer_t::lex_numeric_token() {
               pop();
               break;
             }
-            throw lexer_error_t(this, "unexpected character after number decimal point in lex_number_token()::exponent");
+            fail(lexer_error_t::BAD_NUMBER, "unexpected character after number decimal point in lex_number_token()::exponent");
           }
         }
         break;
@@ -705,7 +942,7 @@ std::shared_ptr<token_t> lexer_t::lex_numeric_token() {
 
       case exponent_mod: {
         if (!isdigit(c)) {
-          throw lexer_error_t(this, "unexpected non digit in lex_number_token()::exponent_mod");
+          fail(lexer_error_t::BAD_NUMBER, "unexpected non digit in lex_number_token()::exponent_mod");
         }
         state = number;
         pop();
@@ -713,9 +950,12 @@ std::shared_ptr<token_t> lexer_t::lex_numeric_token() {
       }
 
       case percent: {
-        pop();
+        if (!keeps(token_t::PERCENTAGE_TOKEN)) {
+          drop_anchor();
+          return nullptr;
+        }
         auto text = pop_anchor();
-        double num = stod(text);
+        double num = to_number(text);
         auto token = number_token_t::make(anchor_pos, token_t::PERCENTAGE_TOKEN, std::move(text), num);
         token->set_type_flag(flag);
         return std::move(token);
@@ -725,7 +965,19 @@ std::shared_ptr<token_t> lexer_t::lex_numeric_token() {
   return nullptr;
 }
 
-std::shared_ptr<token_t> lexer_t::lex_comment_token() {
+template <typename policy_t>
+std::shared_ptr<token_t> basic_lexer_t<policy_t>::make_comment_token() {
+  if (!keeps(token_t::COMMENT_TOKEN)) {
+    drop_anchor();
+    return nullptr;
+  }
+  auto text = pop_anchor();
+  return token_t::make(anchor_pos, token_t::COMMENT_TOKEN, std::move(text));
+}
+
+template <typename policy_t>
+std::shared_ptr<token_t> basic_lexer_t<policy_t>::lex_comment_token() {
+  YOURCSS_LEXER_SPAN("lex_comment_token");
   set_anchor();
   enum {
     start,
@@ -771,8 +1023,7 @@ std::shared_ptr<token_t> lexer_t::lex_comment_token() {
             break;
           }
           case '\0': {
-            auto text = pop_anchor();
-            return token_t::make(anchor_pos, token_t::COMMENT_TOKEN, std::move(text));
+            return make_comment_token();
           }
           default: {
             pop();
@@ -786,12 +1037,15 @@ std::shared_ptr<token_t> lexer_t::lex_comment_token() {
           case '/': {
             pop();
             c = peek();
-            auto text = pop_anchor();
-            return token_t::make(anchor_pos, token_t::COMMENT_TOKEN, std::move(text));
+            return make_comment_token();
           }
           case '\0': {
-            auto text = pop_anchor();
-            return token_t::make(anchor_pos, token_t::COMMENT_TOKEN, std::move(text));
+            return make_comment_token();
+          }
+          case '*': {
+            /* A run of stars can still be closed by a slash. */
+            pop();
+            break;
           }
           default: {
             state = comment_body;
@@ -806,7 +1060,9 @@ std::shared_ptr<token_t> lexer_t::lex_comment_token() {
   return nullptr;
 }
 
-std::shared_ptr<token_t> lexer_t::lex_at_keyword_token() {
+template <typename policy_t>
+std::shared_ptr<token_t> basic_lexer_t<policy_t>::lex_at_keyword_token() {
+  YOURCSS_LEXER_SPAN("lex_at_keyword_token");
   set_anchor();
   char c = peek();
   if (c != '@') {
@@ -814,19 +1070,30 @@ std::shared_ptr<token_t> lexer_t::lex_at_keyword_token() {
     throw ice_t(pos, __FILE__, __LINE__);
   }
   pop();
-  auto text = pop_anchor();
-  auto at_token = token_t::make(anchor_pos, token_t::DELIM_TOKEN, std::move(text));
-  auto ident_token = lex_ident_token();
-  return at_keyword_token_t::make(*at_token, *ident_token);
+  peek();
+  if (!keeps(token_t::AT_KEYWORD_TOKEN)) {
+    drop_anchor();
+    consume_name();
+    return nullptr;
+  }
+  auto at_text = pop_anchor();
+  auto at_pos = anchor_pos;
+  auto name_pos = pos;
+  auto name = consume_name();
+  token_t at_token(at_pos, token_t::DELIM_TOKEN, std::move(at_text), alloc);
+  token_t ident_token(name_pos, token_t::IDENT_TOKEN, std::pmr::string(name, alloc), alloc);
+  return at_keyword_token_t::make(at_token, ident_token, alloc);
 }
 
-std::shared_ptr<token_t> lexer_t::lex_unicode_range() {
+template <typename policy_t>
+std::shared_ptr<token_t> basic_lexer_t<policy_t>::lex_unicode_range() {
+  YOURCSS_LEXER_SPAN("lex_unicode_range");
   const char *anchor_start = cursor;
   const char *anchor_end = nullptr;
   pos_t start_pos = pos;
   pos_t end_pos = pos;
-  std::string hex_start_text;
-  std::string hex_end_text;
+  std::pmr::string hex_start_text(alloc);
+  std::pmr::string hex_end_text(alloc);
   int num_consumed = 0;
   enum {
     start,
@@ -843,7 +1110,7 @@ std::shared_ptr<token_t> lexer_t::lex_unicode_range() {
           pop();
           c = peek();
           if (++num_consumed == 6) {
-            hex_start_text = std::string{anchor_start, static_cast<size_t>(cursor - anchor_start)};
+            hex_start_text = std::pmr::string{anchor_start, static_cast<size_t>(cursor - anchor_start), alloc};
             state = hex_start;
           }
         } else if (c == '?') {
@@ -852,13 +1119,14 @@ std::shared_ptr<token_t> lexer_t::lex_unicode_range() {
             state = question_range;
           }
         } else {
-          throw lexer_error_t(this, "unexpected character in consume_unicode_range()::start");
+          fail(lexer_error_t::BAD_UNICODE_RANGE, "unexpected character in consume_unicode_range()::start");
         }
         break;
       }
       case hex_start: {
         if (c == '-') {
           const char *reset = cursor;
+          pos_t reset_pos = pos;
           pop();
           c = peek();
           if (isxdigit(c)) {
@@ -867,7 +1135,7 @@ std::shared_ptr<token_t> lexer_t::lex_unicode_range() {
             state = hex_end;
             num_consumed = 0;
           } else {
-            reset_cursor(reset);
+            reset_cursor(reset, reset_pos);
             hex_end_text = hex_start_text;
             go = false;
           }
@@ -882,11 +1150,11 @@ std::shared_ptr<token_t> lexer_t::lex_unicode_range() {
           pop();
           c = peek();
           if (++num_consumed == 6) {
-            hex_end_text = std::string{anchor_end, static_cast<size_t>(cursor - anchor_end)};
+            hex_end_text = std::pmr::string{anchor_end, static_cast<size_t>(cursor - anchor_end), alloc};
             go = false;
           }
         } else {
-          throw lexer_error_t(this, "unexpected character in consume_unicode_range()::hex_end");
+          fail(lexer_error_t::BAD_UNICODE_RANGE, "unexpected character in consume_unicode_range()::hex_end");
         }
         break;
       }
@@ -909,16 +1177,50 @@ std::shared_ptr<token_t> lexer_t::lex_unicode_range() {
       }
     }
   } while (go);
-  int num_start = stoi(hex_start_text, nullptr, 16);
-  int num_end = stoi(hex_end_text, nullptr, 16);
-  auto start_hex_token = number_token_t::make(start_pos, token_t::NUMBER_TOKEN, std::move(hex_start_text), static_cast<double>(num_start));
-  auto end_hex_token = number_token_t::make(end_pos, token_t::NUMBER_TOKEN, std::move(hex_end_text), static_cast<double>(num_end));
-  start_hex_token->set_type_flag(token_t::type_flag_t::INTEGER);
-  end_hex_token->set_type_flag(token_t::type_flag_t::INTEGER);
-  return unicode_range_token_t::make(*start_hex_token, *end_hex_token);
+  if (!keeps(token_t::UNICODE_RANGE_TOKEN)) {
+    return nullptr;
+  }
+  long num_start = std::strtol(hex_start_text.c_str(), nullptr, 16);
+  long num_end = std::strtol(hex_end_text.c_str(), nullptr, 16);
+  number_token_t start_hex_token(start_pos, token_t::NUMBER_TOKEN, std::move(hex_start_text), static_cast<double>(num_start), alloc);
+  number_token_t end_hex_token(end_pos, token_t::NUMBER_TOKEN, std::move(hex_end_text), static_cast<double>(num_end), alloc);
+  start_hex_token.set_type_flag(token_t::type_flag_t::INTEGER);
+  end_hex_token.set_type_flag(token_t::type_flag_t::INTEGER);
+  return unicode_range_token_t::make(start_hex_token, end_hex_token, alloc);
+}
+
+template <typename policy_t>
+token_list_t basic_lexer_t<policy_t>::lex() {
+  YOURCSS_LEXER_SPAN("lex");
+  token_list_t tokens(alloc);
+  while (auto token = next()) {
+    tokens.push_back(std::move(token));
+  }
+  return tokens;
+}
+
+template <typename policy_t>
+std::shared_ptr<token_t> basic_lexer_t<policy_t>::next() {
+  if constexpr (policy_t::recover) {
+    for (;;) {
+      try {
+        return lex_next();
+      } catch (const lexer_error_t &error) {
+        errors.push_back(error);
+        anchor = nullptr;
+        pending.reset();
+        /* Skip the character we choked on and start a fresh token. */
+        reset_cursor(cursor, pos);
+        pop();
+      }
+    }
+  } else {
+    return lex_next();
+  }
 }
 
-std::vector<std::shared_ptr<token_t>> lexer_t::lex() {
+template <typename policy_t>
+std::shared_ptr<token_t> basic_lexer_t<policy_t>::lex_next() {
   enum {
     start,
     whitespace,
@@ -951,7 +1253,6 @@ std::vector<std::shared_ptr<token_t>> lexer_t::lex() {
             break;
           }
           case '\0': {
-            set_anchor();
             go = false;
             break;
           }
@@ -964,8 +1265,9 @@ std::vector<std::shared_ptr<token_t>> lexer_t::lex() {
           case '\\': {
             if (peek_is_escape()) {
               auto token = lex_ident_token();
+              add_token(std::move(token));
             } else {
-              throw lexer_error_t(this, "unexpected escape character in lex()::start");
+              fail(lexer_error_t::BAD_ESCAPE, "unexpected escape character in lex()::start");
             }
             break;
           }
@@ -1010,7 +1312,7 @@ std::vector<std::shared_ptr<token_t>> lexer_t::lex() {
             peek();
             auto string_pos = pos;
             auto text = consume_string('"');
-            tokens.push_back(token_t::make(string_pos, token_t::STRING_TOKEN, std::move(text)));
+            add_token(string_pos, token_t::STRING_TOKEN, std::move(text));
             break;
           }
           case '\'': {
@@ -1018,7 +1320,7 @@ std::vector<std::shared_ptr<token_t>> lexer_t::lex() {
             peek();
             auto string_pos = pos;
             auto text = consume_string('\'');
-            tokens.push_back(token_t::make(string_pos, token_t::STRING_TOKEN, std::move(text)));
+            add_token(string_pos, token_t::STRING_TOKEN, std::move(text));
             break;
           }
           case '#': {
@@ -1090,7 +1392,7 @@ std::vector<std::shared_ptr<token_t>> lexer_t::lex() {
           default: {
             if (isdigit(c)) {
               auto token = lex_numeric_token();
-              tokens.push_back(token);
+              add_token(std::move(token));
               break;
             } else if (isspace(c) || c == '\n') {
               set_anchor();
@@ -1099,12 +1401,13 @@ std::vector<std::shared_ptr<token_t>> lexer_t::lex() {
               break;
             } else if (is_name_start(c)) {
               auto token = lex_ident_token();
-              tokens.push_back(token);
+              add_token(std::move(token));
               state = start;
               break;
             } else {
-              std::string delimeter_text(cursor, size_t(1));
-              tokens.push_back(token_t::make(pos, token_t::DELIM_TOKEN, std::move(delimeter_text)));
+              std::pmr::string delimeter_text(cursor, size_t(1), alloc);
+              add_token(pos, token_t::DELIM_TOKEN, std::move(delimeter_text));
+              pop();
               break;
             }
           }
@@ -1117,13 +1420,13 @@ std::vector<std::shared_ptr<token_t>> lexer_t::lex() {
           case '=': {
             pop();
             auto text = pop_anchor();
-            tokens.push_back(token_t::make(anchor_pos, token_t::INCLUDE_MATCH_TOKEN, std::move(text)));
+            add_token(anchor_pos, token_t::INCLUDE_MATCH_TOKEN, std::move(text));
             state = start;
             break;
           }
           default: {
             auto text = pop_anchor();
-            tokens.push_back(token_t::make(anchor_pos, token_t::DELIM_TOKEN, std::move(text)));
+            add_token(anchor_pos, token_t::DELIM_TOKEN, std::move(text));
             state = start;
             break;
           }
@@ -1136,20 +1439,20 @@ std::vector<std::shared_ptr<token_t>> lexer_t::lex() {
           case '=': {
             pop();
             auto text = pop_anchor();
-            tokens.push_back(token_t::make(anchor_pos, token_t::DASH_MATCH_TOKEN, std::move(text)));
+            add_token(anchor_pos, token_t::DASH_MATCH_TOKEN, std::move(text));
             state = start;
             break;
           }
           case '|': {
             pop();
             auto text = pop_anchor();
-            tokens.push_back(token_t::make(anchor_pos, token_t::COLUMN_TOKEN, std::move(text)));
+            add_token(anchor_pos, token_t::COLUMN_TOKEN, std::move(text));
             state = start;
             break;
           }
           default: {
             auto text = pop_anchor();
-            tokens.push_back(token_t::make(anchor_pos, token_t::DELIM_TOKEN, std::move(text)));
+            add_token(anchor_pos, token_t::DELIM_TOKEN, std::move(text));
             state = start;
           }
         }
@@ -1161,18 +1464,18 @@ std::vector<std::shared_ptr<token_t>> lexer_t::lex() {
           pop();
           c = peek();
           if (isxdigit(c) || c == '?') {
-            pop_anchor();
+            drop_anchor();
             auto token = lex_unicode_range();
-            tokens.push_back(token);
+            add_token(std::move(token));
             state = start;
             break;
           }
         }
 
-        reset_cursor(anchor);
-        pop_anchor();
+        reset_cursor(anchor, anchor_pos);
+        drop_anchor();
         auto token = lex_ident_token();
-        tokens.push_back(token);
+        add_token(std::move(token));
         state = start;
         break;
       }
@@ -1181,11 +1484,11 @@ std::vector<std::shared_ptr<token_t>> lexer_t::lex() {
         if (c == '=') {
           pop();
           auto text = pop_anchor();
-          tokens.push_back(token_t::make(anchor_pos, token_t::PREFIX_MATCH_TOKEN, std::move(text)));
+          add_token(anchor_pos, token_t::PREFIX_MATCH_TOKEN, std::move(text));
           state = start;
         } else {
           auto text = pop_anchor();
-          tokens.push_back(token_t::make(anchor_pos, token_t::DELIM_TOKEN, std::move(text)));
+          add_token(anchor_pos, token_t::DELIM_TOKEN, std::move(text));
           state = start;
         }
         break;
@@ -1202,22 +1505,21 @@ std::vector<std::shared_ptr<token_t>> lexer_t::lex() {
               if (c == '-') {
                 pop();
                 auto text = pop_anchor();
-                tokens.push_back(token_t::make(anchor_pos, token_t::CDO_TOKEN, std::move(text)));
+                add_token(anchor_pos, token_t::CDO_TOKEN, std::move(text));
                 state = start;
                 break;
               }
             }
-            reset_cursor(anchor);
+            reset_cursor(anchor, anchor_pos);
             pop();
             auto text = pop_anchor();
-            auto token = token_t::make(anchor_pos, token_t::DELIM_TOKEN, std::move(text));
-            tokens.push_back(token);
+            add_token(anchor_pos, token_t::DELIM_TOKEN, std::move(text));
+            state = start;
             break;
           }
           default: {
             auto text = pop_anchor();
-            auto token = token_t::make(anchor_pos, token_t::DELIM_TOKEN, std::move(text));
-            tokens.push_back(token);
+            add_token(anchor_pos, token_t::DELIM_TOKEN, std::move(text));
             state = start;
             break;
           }
@@ -1227,14 +1529,14 @@ std::vector<std::shared_ptr<token_t>> lexer_t::lex() {
 
       case at_start: {
         if (peek_is_identifier()) {
-          reset_cursor(anchor);
-          pop_anchor();
+          reset_cursor(anchor, anchor_pos);
+          drop_anchor();
           auto token = lex_at_keyword_token();
-          tokens.push_back(token);
+          add_token(std::move(token));
           state = start;
         } else {
           auto text = pop_anchor();
-          tokens.push_back(token_t::make(anchor_pos, token_t::DELIM_TOKEN, std::move(text)));
+          add_token(anchor_pos, token_t::DELIM_TOKEN, std::move(text));
           state = start;
         }
         break;
@@ -1242,16 +1544,14 @@ std::vector<std::shared_ptr<token_t>> lexer_t::lex() {
 
       case slash_start: {
         if (c == '*') {
-          reset_cursor(anchor);
-          pop_anchor();
+          reset_cursor(anchor, anchor_pos);
+          drop_anchor();
           auto token = lex_comment_token();
-          if (!discard_comments) {
-            tokens.push_back(token);
-          }
+          add_token(std::move(token));
           state = start;
         } else {
           auto text = pop_anchor();
-          tokens.push_back(token_t::make(anchor_pos, token_t::DELIM_TOKEN, std::move(text)));
+          add_token(anchor_pos, token_t::DELIM_TOKEN, std::move(text));
           state = start;
         }
         break;
@@ -1259,14 +1559,14 @@ std::vector<std::shared_ptr<token_t>> lexer_t::lex() {
 
       case period_start: {
         if (isdigit(c)) {
-          reset_cursor(anchor);
-          pop_anchor();
+          reset_cursor(anchor, anchor_pos);
+          drop_anchor();
           auto token = lex_numeric_token();
-          tokens.push_back(token);
+          add_token(std::move(token));
           state = start;
         } else {
           auto text = pop_anchor();
-          tokens.push_back(token_t::make(anchor_pos, token_t::DELIM_TOKEN, std::move(text)));
+          add_token(anchor_pos, token_t::DELIM_TOKEN, std::move(text));
           state = start;
         }
         break;
@@ -1274,14 +1574,14 @@ std::vector<std::shared_ptr<token_t>> lexer_t::lex() {
 
       case plus_start: {
         if (isdigit(c) || c == '.') {
-          reset_cursor(anchor);
-          pop_anchor();
+          reset_cursor(anchor, anchor_pos);
+          drop_anchor();
           auto token = lex_numeric_token();
-          tokens.push_back(token);
+          add_token(std::move(token));
           state = start;
         } else {
           auto text = pop_anchor();
-          tokens.push_back(token_t::make(anchor_pos, token_t::DELIM_TOKEN, std::move(text)));
+          add_token(anchor_pos, token_t::DELIM_TOKEN, std::move(text));
           state = start;
         }
         break;
@@ -1294,26 +1594,31 @@ std::vector<std::shared_ptr<token_t>> lexer_t::lex() {
           if (c == '>') {
             pop();
             auto text = pop_anchor();
-            tokens.push_back(token_t::make(anchor_pos, token_t::CDC_TOKEN, std::move(text)));
+            add_token(anchor_pos, token_t::CDC_TOKEN, std::move(text));
             state = start;
             break;
           }
-          reset_cursor(anchor);
-          pop();
-          c = peek();
-          auto text = pop_anchor();
-          auto token = token_t::make(anchor_pos, token_t::DELIM_TOKEN, std::move(text));
-          tokens.push_back(token);
+          /* Two hyphens start an ident, such as a custom property name. */
+          reset_cursor(anchor, anchor_pos);
+          drop_anchor();
+          add_token(lex_ident_token());
+          state = start;
           break;
+        } else if (is_name_start(c) || peek_is_escape()) {
+          /* A vendor prefix or other ident starting with a hyphen. */
+          reset_cursor(anchor, anchor_pos);
+          drop_anchor();
+          add_token(lex_ident_token());
+          state = start;
         } else if (isdigit(c) || c == '.') {
-          reset_cursor(anchor);
-          pop_anchor();
+          reset_cursor(anchor, anchor_pos);
+          drop_anchor();
           auto token = lex_numeric_token();
-          tokens.push_back(token);
+          add_token(std::move(token));
           state = start;
         } else {
           auto text = pop_anchor();
-          tokens.push_back(token_t::make(anchor_pos, token_t::DELIM_TOKEN, std::move(text)));
+          add_token(anchor_pos, token_t::DELIM_TOKEN, std::move(text));
           state = start;
         }
         break;
@@ -1324,11 +1629,11 @@ std::vector<std::shared_ptr<token_t>> lexer_t::lex() {
           pop();
           c = peek();
           auto text = pop_anchor();
-          tokens.push_back(token_t::make(anchor_pos, token_t::SUBSTRING_MATCH_TOKEN, std::move(text)));
+          add_token(anchor_pos, token_t::SUBSTRING_MATCH_TOKEN, std::move(text));
           state = start;
         } else {
           auto text = pop_anchor();
-          tokens.push_back(token_t::make(anchor_pos, token_t::DELIM_TOKEN, std::move(text)));
+          add_token(anchor_pos, token_t::DELIM_TOKEN, std::move(text));
           state = start;
         }
         break;
@@ -1339,11 +1644,11 @@ std::vector<std::shared_ptr<token_t>> lexer_t::lex() {
           pop();
           c = peek();
           auto text = pop_anchor();
-          tokens.push_back(token_t::make(anchor_pos, token_t::SUFFIX_MATCH_TOKEN, std::move(text)));
+          add_token(anchor_pos, token_t::SUFFIX_MATCH_TOKEN, std::move(text));
           state = start;
         } else {
           auto text = pop_anchor();
-          tokens.push_back(token_t::make(anchor_pos, token_t::DELIM_TOKEN, std::move(text)));
+          add_token(anchor_pos, token_t::DELIM_TOKEN, std::move(text));
           state = start;
         }
         break;
@@ -1354,28 +1659,42 @@ std::vector<std::shared_ptr<token_t>> lexer_t::lex() {
           pop();
           break;
         }
-        pop_anchor();
-        tokens.push_back(token_t::make(anchor_pos, token_t::WHITESPACE_TOKEN));
+        drop_anchor();
+        if (keeps(token_t::WHITESPACE_TOKEN)) {
+          add_token(token_t::make(anchor_pos, token_t::WHITESPACE_TOKEN, alloc));
+        }
+        preceded_by_whitespace = true;
         state = start;
         break;
       }
 
       case hash_start: {
-        if (peek_is_identifier()) {
-          pop_anchor();
+        /* Any name makes a hash, #000 included, but only one which could
+           start an identifier makes an ID. */
+        if (is_name_point(peek()) || peek_is_escape()) {
+          auto type_flag = peek_is_identifier() ? token_t::ID : token_t::UNRESTRICTED;
+          drop_anchor();
           auto text = consume_name();
-          tokens.push_back(token_t::make(anchor_pos, token_t::HASH_TOKEN, std::move(text)));
+          if (keeps(token_t::HASH_TOKEN)) {
+            auto token = token_t::make(anchor_pos, token_t::HASH_TOKEN, std::pmr::string(text, alloc));
+            token->set_type_flag(type_flag);
+            add_token(std::move(token));
+          }
         } else {
           auto text = pop_anchor();
-          tokens.push_back(token_t::make(anchor_pos, token_t::DELIM_TOKEN, std::move(text)));
+          add_token(anchor_pos, token_t::DELIM_TOKEN, std::move(text));
         }
         state = start;
         break;
       }
 
     }
-  } while (go);
-  return tokens;
+  } while (go && !pending);
+  return std::move(pending);
 }
 
+template class basic_lexer_t<lexer_policy_t>;
+
+template class basic_lexer_t<bulk_lexer_policy_t>;
+
 }   // yourcss
@@ -1,15 +1,19 @@
 #pragma once
 
 #include <cctype>
+#include <cstdlib>
 #include <iostream>
 #include <map>
 #include <vector>
 #include <memory>
+#include <memory_resource>
+#include <string_view>
 
 #include "error.h"
 #include "ice.h"
 #include "token.h"
 #include "pos.h"
+#include "trace.h"
 #include "tokens/dimension_token.h"
 #include "tokens/at_keyword_token.h"
 #include "tokens/function_token.h"
@@ -17,22 +21,140 @@
 #include "tokens/number_token.h"
 namespace yourcss {
 
-/* Convert source text into a vector of tokens. */
-class lexer_t final {
+/* An error in lexing.  Holds just a code, the byte offset and a pointer
+   to a static description; see error_t for when it's formatted. */
+class lexer_error_t final: public error_t {
 
 public:
 
-  /* An error in lexing. */
-  class lexer_error_t final: public error_t {
+  /* The kinds of thing that can go wrong. */
+  enum code_t {
+    BAD_ESCAPE,
+    BAD_STRING,
+    BAD_NUMBER,
+    BAD_UNICODE_RANGE,
+    BAD_URL,
+    UNSUPPORTED,
+  };  // code_t
 
-  public:
+  /* Report the position and what we found there.  The detail must
+     outlive us; in practice it is a string literal. */
+  lexer_error_t(const pos_t &pos, uint64_t offset, code_t code, const char *detail) noexcept;
 
-    /* Report the position and what we found there. */
-    lexer_error_t(const lexer_t *lexer, const char *msg);
+  /* See code_t. */
+  code_t get_code() const noexcept;
 
-    virtual ~lexer_error_t();
+  /* How far into the source text the error is, in bytes. */
+  uint64_t get_offset() const noexcept;
 
-  };  // lexer_t::lexer_error_t
+  /* What we found. */
+  const char *get_detail() const noexcept;
+
+  virtual ~lexer_error_t();
+
+private:
+
+  /* Writes our detail. */
+  virtual void write_msg(std::ostream &strm) const override;
+
+  /* See accessor. */
+  code_t code;
+
+  /* See accessor. */
+  uint64_t offset;
+
+  /* See accessor. */
+  const char *detail;
+
+};  // lexer_error_t
+
+/* The options basic_lexer_t takes at compile time.  A policy is a struct
+   with these same static members; each one turns a runtime check in the
+   hot loop into a constant, so the compiler drops the dead branches.
+   This one is the behavior lexer_t has always had. */
+struct lexer_policy_t {
+
+  /* If false, tokens and errors all carry the starting position and we
+     skip line and column bookkeeping on every character.  Errors still
+     report their byte offset. */
+  static constexpr bool track_pos = true;
+
+  /* Kinds of token which are never returned, on top of any filter set at
+     runtime.  Whitespace and comments are consumed but never allocated. */
+  static constexpr token_t::kind_mask_t filter = 0;
+
+  /* If true, errors are collected (see get_errors()) and the offending
+     character is skipped, instead of being thrown. */
+  static constexpr bool recover = false;
+
+  /* If true, the sub-lexers record trace spans. */
+  static constexpr bool trace = trace_t::is_compiled_in;
+
+};  // lexer_policy_t
+
+/* For bulk jobs over large corpora: no positions, no whitespace or
+   comment tokens, no tracing, and errors never stop the lexer. */
+struct bulk_lexer_policy_t {
+
+  static constexpr bool track_pos = false;
+
+  static constexpr token_t::kind_mask_t filter =
+      token_t::get_mask(token_t::WHITESPACE_TOKEN) |
+      token_t::get_mask(token_t::COMMENT_TOKEN);
+
+  static constexpr bool recover = true;
+
+  static constexpr bool trace = false;
+
+};  // bulk_lexer_policy_t
+
+/* The options a lexer takes at runtime.  A config never changes once
+   made, so one can be shared by any number of lexers on any number of
+   threads without locking. */
+class lexer_config_t final {
+
+public:
+
+  /* Cache the options.  See basic_lexer_t::set_filter(). */
+  explicit lexer_config_t(
+      token_t::kind_mask_t filter = token_t::get_mask(token_t::COMMENT_TOKEN),
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource()) noexcept;
+
+  /* The kinds of token lexers don't return. */
+  token_t::kind_mask_t get_filter() const noexcept;
+
+  /* The resource lexers allocate from.  If lexers on several threads
+     share a config, this must be safe to use from all of them at once, as
+     the default resource and synchronized_pool_resource are. */
+  std::pmr::memory_resource *get_resource() const noexcept;
+
+private:
+
+  /* See accessor. */
+  token_t::kind_mask_t filter;
+
+  /* See accessor. */
+  std::pmr::memory_resource *resource;
+
+};  // lexer_config_t
+
+/* Convert source text into a vector of tokens.  The policy fixes some
+   options at compile time; see lexer_policy_t.  The lexers for the
+   policies above are instantiated in lexer.cc, and any other policy needs
+   its own instantiation there.
+
+   A lexer is just a cursor over one text, cheap to make and not safe to
+   share: each thread makes its own, from a shared lexer_config_t.  Our
+   const members really don't change us, so they can be called from
+   several threads at once. */
+template <typename policy_t>
+class basic_lexer_t final {
+
+public:
+
+  /* Errors don't depend on the policy, so all our lexers can share one
+     catch. */
+  using lexer_error_t = yourcss::lexer_error_t;
 
   /* Heper method to print tokens returned from lex */
   static void print_tokens(const std::vector<token_t> &tokens);
@@ -40,11 +162,45 @@ public:
   /* Heper method to print tokens returned from lex */
   static void print_tokens(const std::vector<std::shared_ptr<token_t>> &tokens);
 
-  /* Used by our public lex function. */
-  lexer_t(const char *next_cursor);
-
-  /* Used by our public lex function. */
-  std::vector<std::shared_ptr<token_t>> lex();
+  /* Heper method to print tokens returned from lex */
+  static void print_tokens(const token_list_t &tokens);
+
+  /* Used by our public lex function.  Every token, and the strings and
+     vectors we use along the way, are allocated from resource. */
+  basic_lexer_t(const char *next_cursor, std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+  /* Lex the bytes from begin up to end, which need not be null-terminated,
+     such as a file mapped with mmap.  A null byte before end still ends the
+     text.  Positions are reported relative to start, so a text too large to
+     map at once can be lexed a piece at a time. */
+  basic_lexer_t(
+      const char *begin, const char *end, const pos_t &start = pos_t(),
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+  /* Lex the null-terminated text with the config's options.  We copy what
+     we need, so the config can go away before we do. */
+  basic_lexer_t(const lexer_config_t &config, const char *next_cursor);
+
+  /* Lex the bytes from begin up to end with the config's options; see
+     above. */
+  basic_lexer_t(
+      const lexer_config_t &config,
+      const char *begin, const char *end, const pos_t &start = pos_t());
+
+  /* Lex all the remaining source text. */
+  token_list_t lex();
+
+  /* Hand each token to the visitor as soon as it's lexed.  The visitor
+     returns false to stop, and then we stop at once, having read only as
+     far as the token it was given.  Returns false if the visitor stopped
+     us, true if we reached the end. */
+  template <typename visitor_t>
+  bool lex(visitor_t &&visitor);
+
+  /* Lex just the next token, or return null at the end of the source
+     text.  Lexing a token at a time keeps only one token alive at once,
+     however long the source text is. */
+  std::shared_ptr<token_t> next();
 
   /* Lex a numeric token. */
   std::shared_ptr<token_t> lex_numeric_token();
@@ -64,14 +220,15 @@ public:
   /* Lex a unicode token. Assumes u+ has already been consumed */
   std::shared_ptr<token_t> lex_unicode_range();
 
-  /* Consume string token */
-  std::string consume_string(char ending_point);
+  /* Consume string token, returning its text as a view of the source.
+     Nothing is allocated until the caller knows it keeps the token. */
+  std::string_view consume_string(char ending_point);
 
-  /* Consume a name token */
-  std::string consume_name();
+  /* Consume a name token, returning its text as a view of the source. */
+  std::string_view consume_name();
 
   /* Consume escaped code point */
-  std::string consume_escape();
+  std::pmr::string consume_escape();
 
   /* Checks if next 1-3 input code points would start an identifier */
   bool peek_is_identifier();
@@ -85,8 +242,8 @@ public:
   /* Check if sequence of current cursor would start a name */
   bool is_name_start(char c);
 
-  /* Set the string and position to be tokenized, and keep state */
-  char reset_cursor(const char *next_);
+  /* Go back to a cursor we peeked at before, and the position it had. */
+  char reset_cursor(const char *saved_cursor, const pos_t &saved_pos);
 
   /* Check if char is non-ascii */
   bool is_non_ascii(char c);
@@ -97,11 +254,56 @@ public:
   /* If true comments are not returned during tokenization */
   void set_discard_comments(bool);
 
+  /* Tokens whose kinds are in the mask, or in the policy's filter, are
+     not returned during tokenization.  They are still consumed but never
+     allocated; the sub-lexers above return null for them.  Whether a
+     token came right after whitespace is kept on the token either way.
+     Defaults to just comments. */
+  void set_filter(token_t::kind_mask_t filter);
+
+  /* See set_filter(). */
+  token_t::kind_mask_t get_filter() const;
+
+  /* The memory resource we allocate from. */
+  std::pmr::memory_resource *get_resource() const;
+
+  /* The errors we've recovered from so far, if the policy recovers. */
+  const std::pmr::vector<lexer_error_t> &get_errors() const;
+
+  /* The first character, and its position, which isn't part of a token
+     we've returned.  Lexing again from here picks up where we left off. */
+  const char *get_next_cursor() const;
+
+  /* See get_next_cursor(). */
+  const pos_t &get_next_pos() const;
+
+  /* True if we've passed whitespace since the last token we returned.
+     Carry this over to a lexer which picks up where we left off. */
+  bool has_passed_whitespace() const;
+
+  /* See has_passed_whitespace(). */
+  void set_passed_whitespace(bool passed_whitespace);
+
+  /* True once we've looked at the end of bounded text, even if we then
+     backed up.  Until then, every token we've returned is whole no matter
+     what comes after the end. */
+  bool has_reached_limit() const;
+
 private:
 
+  /* The state machine behind next(). */
+  std::shared_ptr<token_t> lex_next();
+
+  /* Report an error at the current character. */
+  [[noreturn]] void fail(lexer_error_t::code_t code, const char *detail) const;
+
   /* Return the current character from the source text but don't advance to
      the next one. */
-  char peek() const;
+  char peek();
+
+  /* Return the character count places past the current one without
+     moving, or null if the text ends first. */
+  char peek_ahead(size_t count);
 
   /* Return the current character from the source text and advance to the
      next one. */
@@ -110,10 +312,34 @@ private:
   /* Sets an anchor at the current cursor position. Throws if
      anchor is alread defined. Anchor should not be set if
      a previous anchor was dropped. */
-  void set_anchor() const;
+  void set_anchor();
 
   /* Return the lexeme starting from anchor, and set anchor to null */
-  std::string pop_anchor();
+  std::pmr::string pop_anchor();
+
+  /* Set anchor to null without making the lexeme. */
+  void drop_anchor();
+
+  /* True if tokens of this kind are not filtered out. */
+  bool keeps(token_t::kind_t kind) const;
+
+  /* Note whether the token came after whitespace and make it the pending
+     token, unless it is null or filtered out. */
+  void add_token(std::shared_ptr<token_t> &&token);
+
+  /* Make a token and add it, unless its kind is filtered out. */
+  void add_token(const pos_t &at, token_t::kind_t kind, std::pmr::string &&text);
+
+  /* Copy the text into a token and add it, unless its kind is filtered
+     out, in which case nothing is allocated. */
+  void add_token(const pos_t &at, token_t::kind_t kind, std::string_view text);
+
+  /* Make the comment token lex_comment_token() has consumed, unless
+     comments are filtered out. */
+  std::shared_ptr<token_t> make_comment_token();
+
+  /* Convert the text of a numeric token to its value. */
+  double to_number(const std::pmr::string &text) const;
 
   /* Add a token at the current position, set anchor, advance 1 character
      and reset anchor. Used for tokens using only one character that can
@@ -121,35 +347,74 @@ private:
      etc.*/
   void add_single_token(token_t::kind_t kind);
 
-  /* Temporarily holds tokens while lexing */
-  std::vector<std::shared_ptr<token_t>> tokens;
+  /* Allocates from the memory resource we were given. */
+  token_t::allocator_type alloc;
+
+  /* See accessor. */
+  std::pmr::vector<lexer_error_t> errors;
+
+  /* The token next() will return, once it has been lexed. */
+  std::shared_ptr<token_t> pending;
+
+  /* The kinds of token we don't return. */
+  token_t::kind_mask_t filter;
 
-  /* Should comments be ignored? Defaults to true */
-  bool discard_comments;
+  /* True if we've passed whitespace since the last token we returned. */
+  bool preceded_by_whitespace;
+
+  /* The start of the source text. */
+  const char *origin;
+
+  /* The end of the source text, or null if it's null-terminated. */
+  const char *limit;
+
+  /* See accessor. */
+  bool reached_limit;
 
   /* Our next position within the source text. */
-  mutable const char *next_cursor;
+  const char *next_cursor;
 
   /* The (line, col) of next_cursor. */
-  mutable pos_t next_pos;
+  pos_t next_pos;
 
   /* If true, then cursor and pos, below, are valid; otherwise,
      those fields contain junk.  Peeking makes us ready, popping makes us
      unready. */
-  mutable bool is_ready;
+  bool is_ready;
 
   /* Our current position within the source text, when ready. */
-  mutable const char *cursor;
+  const char *cursor;
 
   /* The (line, col) cursor, when ready. */
-  mutable pos_t pos;
+  pos_t pos;
 
   /* The (line, col) cursor of an anchor. Usually the start of a lexeme. */
-  mutable pos_t anchor_pos;
+  pos_t anchor_pos;
 
   /* Position in source text for anchor */
-  mutable const char *anchor;
+  const char *anchor;
+
+};  // basic_lexer_t<policy_t>
+
+template <typename policy_t>
+template <typename visitor_t>
+bool basic_lexer_t<policy_t>::lex(visitor_t &&visitor) {
+  while (auto token = next()) {
+    if (!visitor(std::move(token))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+extern template class basic_lexer_t<lexer_policy_t>;
+
+extern template class basic_lexer_t<bulk_lexer_policy_t>;
+
+/* The lexer with the options it has always had. */
+using lexer_t = basic_lexer_t<lexer_policy_t>;
 
-};  // lexer_t
+/* See bulk_lexer_policy_t. */
+using bulk_lexer_t = basic_lexer_t<bulk_lexer_policy_t>;
 
 }   // yourcss
@@ -0,0 +1,402 @@
+#include "matcher.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace yourcss {
+
+namespace {
+
+char to_lower(char c) {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+bool is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+/* True if the text equals the expected text or, if we ignore case, the
+   text lowered equals it; the expected text is lowered already. */
+bool equals(std::string_view text, std::string_view expected, bool is_case_insensitive) {
+  if (!is_case_insensitive) {
+    return text == expected;
+  }
+  if (text.size() != expected.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < text.size(); ++i) {
+    if (to_lower(text[i]) != expected[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* The number, up to limit, of the element's siblings before it, or after
+   it if is_forward, which have its tag or, unless is_of_type, any. */
+int32_t count_siblings(const element_t &element, bool is_forward, bool is_of_type, int32_t limit) {
+  int32_t count = 0;
+  auto tag = is_of_type ? element.get_tag() : std::string_view();
+  for (auto sibling = is_forward ? element.get_next_sibling() : element.get_previous_sibling();
+      sibling && count < limit;
+      sibling = is_forward ? sibling->get_next_sibling() : sibling->get_previous_sibling()) {
+    if (!is_of_type || sibling->get_tag() == tag) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+/* True if position is a*n+b for some n >= 0. */
+bool matches_nth(const nth_t &nth, int32_t position) {
+  if (nth.a == 0) {
+    return position == nth.b;
+  }
+  int64_t diff = int64_t(position) - nth.b;
+  return diff % nth.a == 0 && diff / nth.a >= 0;
+}
+
+}  // namespace
+
+bool element_t::matches_pseudo_class(std::string_view, std::string_view) const {
+  return false;
+}
+
+element_t::~element_t() = default;
+
+ancestor_filter_t::ancestor_filter_t() noexcept:
+  counters() {}
+
+void ancestor_filter_t::add(uint32_t hash) noexcept {
+  for (auto idx: {hash >> (32 - bits_per_index), (hash >> 8) & ((1u << bits_per_index) - 1)}) {
+    if (counters[idx] != UINT8_MAX) {
+      ++counters[idx];
+    }
+  }
+}
+
+void ancestor_filter_t::remove(uint32_t hash) noexcept {
+  for (auto idx: {hash >> (32 - bits_per_index), (hash >> 8) & ((1u << bits_per_index) - 1)}) {
+    /* A saturated counter has lost count, so it stays put. */
+    if (counters[idx] != UINT8_MAX) {
+      --counters[idx];
+    }
+  }
+}
+
+bool ancestor_filter_t::may_contain(uint32_t hash) const noexcept {
+  return counters[hash >> (32 - bits_per_index)] && counters[(hash >> 8) & ((1u << bits_per_index) - 1)];
+}
+
+uint32_t ancestor_filter_t::get_hash(simple_selector_t::kind_t kind, uint32_t atom) noexcept {
+  /* Fibonacci hashing spreads consecutive atoms over the high bits, which
+     pick the first counter. */
+  uint32_t hash = (atom * 4 + kind + 1) * 0x9e3779b1u;
+  return hash ? hash : 1;
+}
+
+std::array<uint32_t, ancestor_filter_t::max_hash_count> ancestor_filter_t::get_hashes(
+    const selector_table_t &table, const selector_t &selector) noexcept {
+  std::array<uint32_t, max_hash_count> hashes;
+  size_t count = 0;
+  auto simple = table.get_simple_selectors().data() + selector.first;
+  auto end = simple + selector.count;
+  /* The first compound is the element's own.  One reached by a
+     descendant or child combinator is an ancestor's, of the element or of
+     a sibling, which comes to the same thing; one reached by a sibling
+     combinator isn't. */
+  for (bool is_ancestor = false; simple != end && count < max_hash_count; ++simple) {
+    if (is_ancestor && (simple->kind == simple_selector_t::ID || simple->kind == simple_selector_t::CLASS
+        || simple->kind == simple_selector_t::TAG)) {
+      hashes[count++] = get_hash(simple->kind, simple->name);
+    }
+    if (simple->relation != simple_selector_t::SAME_COMPOUND) {
+      is_ancestor = (simple->relation == simple_selector_t::DESCENDANT || simple->relation == simple_selector_t::CHILD);
+    }
+  }
+  for (; count < max_hash_count; ++count) {
+    hashes[count] = 0;
+  }
+  return hashes;
+}
+
+matcher_t::matcher_t(const selector_table_t &table_):
+  table(table_),
+  filtered_count(0) {
+  selector_hashes.reserve(table.get_selectors().size());
+  for (const auto &selector: table.get_selectors()) {
+    selector_hashes.push_back(ancestor_filter_t::get_hashes(table, selector));
+  }
+}
+
+void matcher_t::push(const element_t &element) {
+  const auto &atoms = table.get_atoms();
+  uint32_t count = 0;
+  /* Names nobody interned can't be in any selector, so leave them out. */
+  auto add = [&](simple_selector_t::kind_t kind, std::string_view name) {
+    auto atom = atoms.find(name);
+    if (atom != atom_table_t::none) {
+      auto hash = ancestor_filter_t::get_hash(kind, atom);
+      filter.add(hash);
+      ancestor_hashes.push_back(hash);
+      ++count;
+    }
+  };
+  add(simple_selector_t::TAG, element.get_tag());
+  add(simple_selector_t::ID, element.get_id());
+  for (size_t i = 0, class_count = element.get_class_count(); i < class_count; ++i) {
+    add(simple_selector_t::CLASS, element.get_class(i));
+  }
+  ancestor_hash_counts.push_back(count);
+  ancestors.push_back(&element);
+}
+
+void matcher_t::pop() {
+  size_t count = ancestor_hash_counts.back();
+  for (size_t i = ancestor_hashes.size() - count; i < ancestor_hashes.size(); ++i) {
+    filter.remove(ancestor_hashes[i]);
+  }
+  ancestor_hashes.resize(ancestor_hashes.size() - count);
+  ancestor_hash_counts.pop_back();
+  ancestors.pop_back();
+}
+
+bool matcher_t::matches(const selector_t &selector, const element_t &element) const {
+  if (has_ancestors_of(element)) {
+    const auto &hashes = selector_hashes[static_cast<size_t>(&selector - table.get_selectors().data())];
+    for (auto hash: hashes) {
+      if (!hash) {
+        break;
+      }
+      if (!filter.may_contain(hash)) {
+        ++filtered_count;
+        return false;
+      }
+    }
+  }
+  return matches_from(table.get_simple_selectors().data() + selector.first, element);
+}
+
+void matcher_t::match(const element_t &element, std::vector<const selector_t *> &matched) const {
+  for (const auto &selector: table.get_selectors()) {
+    if (matches(selector, element)) {
+      matched.push_back(&selector);
+    }
+  }
+}
+
+void matcher_t::match(
+    const element_t &element, const rule_index_t &index, std::vector<const selector_t *> &matched) const {
+  const auto &atoms = table.get_atoms();
+  const auto &selectors = table.get_selectors();
+  auto mark = matched.end() - matched.begin();
+  auto try_bucket = [&](rule_index_t::bucket_t bucket) {
+    for (auto idx: bucket) {
+      if (matches(selectors[idx], element)) {
+        matched.push_back(&selectors[idx]);
+      }
+    }
+  };
+  try_bucket(index.get_universal());
+  try_bucket(index.find(simple_selector_t::TAG, atoms.find(element.get_tag())));
+  try_bucket(index.find(simple_selector_t::ID, atoms.find(element.get_id())));
+  for (size_t i = 0, class_count = element.get_class_count(); i < class_count; ++i) {
+    try_bucket(index.find(simple_selector_t::CLASS, atoms.find(element.get_class(i))));
+  }
+  /* Each bucket is in order, but they need merging, and a class the
+     element has twice brings its bucket in twice. */
+  std::sort(matched.begin() + mark, matched.end());
+  matched.erase(std::unique(matched.begin() + mark, matched.end()), matched.end());
+}
+
+size_t matcher_t::get_filtered_count() const noexcept {
+  return filtered_count;
+}
+
+bool matcher_t::has_ancestors_of(const element_t &element) const noexcept {
+  auto parent = element.get_parent();
+  if (ancestors.empty()) {
+    return !parent;
+  }
+  return parent == ancestors.back() && !ancestors.front()->get_parent();
+}
+
+bool matcher_t::matches_from(const simple_selector_t *simple, const element_t &element) const {
+  for (;; ++simple) {
+    if (!matches_simple(*simple, element)) {
+      return false;
+    }
+    if (simple->relation != simple_selector_t::SAME_COMPOUND) {
+      break;
+    }
+  }
+  auto next = simple + 1;
+  switch (simple->relation) {
+    case simple_selector_t::LAST: {
+      return true;
+    }
+    case simple_selector_t::CHILD: {
+      auto parent = element.get_parent();
+      return parent && matches_from(next, *parent);
+    }
+    case simple_selector_t::DESCENDANT: {
+      for (auto ancestor = element.get_parent(); ancestor; ancestor = ancestor->get_parent()) {
+        if (matches_from(next, *ancestor)) {
+          return true;
+        }
+      }
+      return false;
+    }
+    case simple_selector_t::NEXT_SIBLING: {
+      auto sibling = element.get_previous_sibling();
+      return sibling && matches_from(next, *sibling);
+    }
+    case simple_selector_t::SUBSEQUENT_SIBLING: {
+      for (auto sibling = element.get_previous_sibling(); sibling; sibling = sibling->get_previous_sibling()) {
+        if (matches_from(next, *sibling)) {
+          return true;
+        }
+      }
+      return false;
+    }
+    case simple_selector_t::SAME_COMPOUND: {
+      break;
+    }
+  }
+  return false;
+}
+
+bool matcher_t::matches_simple(const simple_selector_t &simple, const element_t &element) const {
+  auto name = table.get_atoms().get_text(simple.name);
+  switch (simple.kind) {
+    case simple_selector_t::ID: {
+      return element.get_id() == name;
+    }
+    case simple_selector_t::CLASS: {
+      for (size_t i = 0, count = element.get_class_count(); i < count; ++i) {
+        if (element.get_class(i) == name) {
+          return true;
+        }
+      }
+      return false;
+    }
+    case simple_selector_t::TAG: {
+      return element.get_tag() == name;
+    }
+    case simple_selector_t::ATTRIBUTE: {
+      return matches_attribute(simple, element);
+    }
+    case simple_selector_t::PSEUDO_CLASS:
+    case simple_selector_t::NTH: {
+      return matches_pseudo_class(simple, element);
+    }
+    case simple_selector_t::NOT: {
+      return !matches_any(simple.arguments, element);
+    }
+    case simple_selector_t::IS: {
+      return matches_any(simple.arguments, element);
+    }
+    case simple_selector_t::UNIVERSAL: {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool matcher_t::matches_any(const selector_range_t &arguments, const element_t &element) const {
+  for (uint32_t i = 0; i < arguments.count; ++i) {
+    const auto &selector = table.get_arguments()[arguments.first + i];
+    if (matches_from(table.get_simple_selectors().data() + selector.first, element)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool matcher_t::matches_attribute(const simple_selector_t &simple, const element_t &element) const {
+  const auto &atoms = table.get_atoms();
+  std::string_view value;
+  if (!element.get_attribute(atoms.get_text(simple.name), value)) {
+    return false;
+  }
+  auto expected = atoms.get_text(simple.value);
+  bool is_case_insensitive = simple.is_case_insensitive;
+  switch (simple.match) {
+    case simple_selector_t::EXISTS: {
+      return true;
+    }
+    case simple_selector_t::EQUALS: {
+      return equals(value, expected, is_case_insensitive);
+    }
+    case simple_selector_t::INCLUDES: {
+      /* One of the whitespace-separated words.  A word can't be empty or
+         have whitespace in it. */
+      if (expected.empty() || std::any_of(expected.begin(), expected.end(), is_space)) {
+        return false;
+      }
+      for (size_t start = 0; start < value.size();) {
+        size_t stop = start;
+        while (stop < value.size() && !is_space(value[stop])) {
+          ++stop;
+        }
+        if (equals(value.substr(start, stop - start), expected, is_case_insensitive)) {
+          return true;
+        }
+        start = stop + 1;
+      }
+      return false;
+    }
+    case simple_selector_t::DASH: {
+      return value.size() >= expected.size()
+          && equals(value.substr(0, expected.size()), expected, is_case_insensitive)
+          && (value.size() == expected.size() || value[expected.size()] == '-');
+    }
+    case simple_selector_t::PREFIX: {
+      return !expected.empty() && value.size() >= expected.size()
+          && equals(value.substr(0, expected.size()), expected, is_case_insensitive);
+    }
+    case simple_selector_t::SUFFIX: {
+      return !expected.empty() && value.size() >= expected.size()
+          && equals(value.substr(value.size() - expected.size()), expected, is_case_insensitive);
+    }
+    case simple_selector_t::SUBSTRING: {
+      if (expected.empty()) {
+        return false;
+      }
+      for (size_t i = 0; i + expected.size() <= value.size(); ++i) {
+        if (equals(value.substr(i, expected.size()), expected, is_case_insensitive)) {
+          return true;
+        }
+      }
+      return false;
+    }
+  }
+  return false;
+}
+
+bool matcher_t::matches_pseudo_class(const simple_selector_t &simple, const element_t &element) const {
+  const auto &atoms = table.get_atoms();
+  auto name = atoms.get_text(simple.name);
+  bool is_of_type = name.size() > 8 && name.substr(name.size() - 8) == "-of-type";
+  if (simple.kind == simple_selector_t::NTH) {
+    bool is_last = name.compare(0, 8, "nth-last") == 0;
+    return matches_nth(simple.nth, count_siblings(element, is_last, is_of_type, INT32_MAX) + 1);
+  }
+  if (simple.value == atom_table_t::none) {
+    if (name == "root") {
+      return !element.get_parent();
+    }
+    if (name == "first-child" || name == "first-of-type") {
+      return !count_siblings(element, false, is_of_type, 1);
+    }
+    if (name == "last-child" || name == "last-of-type") {
+      return !count_siblings(element, true, is_of_type, 1);
+    }
+    if (name == "only-child" || name == "only-of-type") {
+      return !count_siblings(element, false, is_of_type, 1) && !count_siblings(element, true, is_of_type, 1);
+    }
+  }
+  return element.matches_pseudo_class(name, atoms.get_text(simple.value));
+}
+
+}  // yourcss
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "rule_index.h"
+#include "selector.h"
+
+namespace yourcss {
+
+/* An element of the caller's document, as much of it as selectors can
+   see.  Implement this over your own DOM; we hold on to elements only by
+   pointer, for as long as they're pushed onto a matcher_t. */
+class element_t {
+
+public:
+
+  /* The parent element, or null for the root. */
+  virtual const element_t *get_parent() const = 0;
+
+  /* The element siblings just before and after us, or null. */
+  virtual const element_t *get_previous_sibling() const = 0;
+
+  /* See get_previous_sibling(). */
+  virtual const element_t *get_next_sibling() const = 0;
+
+  /* The local name, in lower case if it's an HTML element. */
+  virtual std::string_view get_tag() const = 0;
+
+  /* The id attribute, or empty. */
+  virtual std::string_view get_id() const = 0;
+
+  /* The classes in the class attribute. */
+  virtual size_t get_class_count() const = 0;
+
+  /* See get_class_count(). */
+  virtual std::string_view get_class(size_t idx) const = 0;
+
+  /* Look up the attribute whose name, in lower case, is given.  Returns
+     false if there isn't one. */
+  virtual bool get_attribute(std::string_view name, std::string_view &value) const = 0;
+
+  /* True if we're in the state the pseudo-class names, such as :hover or
+     :checked; the argument, if any, is as written, as for :lang(en).  The
+     structural pseudo-classes, such as :first-child, and those which take
+     selectors are worked out by the matcher and never get here.  Returns
+     false unless overridden. */
+  virtual bool matches_pseudo_class(std::string_view name, std::string_view argument) const;
+
+protected:
+
+  virtual ~element_t();
+
+};  // element_t
+
+/* A counting Bloom filter of the names of an element's ancestors.  A
+   selector whose ancestor compounds need an ID, class or type which isn't
+   in the filter can't match, so it is rejected without our walking up the
+   tree.  The filter may say a name is there when it isn't, but never the
+   other way round.  The counts let names be taken out again as a tree
+   walk leaves each element; one which saturates stays in for good. */
+class ancestor_filter_t final {
+
+public:
+
+  /* The most names of a selector's ancestor compounds we test. */
+  static constexpr size_t max_hash_count = 4;
+
+  /* Empty. */
+  ancestor_filter_t() noexcept;
+
+  /* Count one more of the hashed name. */
+  void add(uint32_t hash) noexcept;
+
+  /* Count one fewer of the hashed name, which must have been added. */
+  void remove(uint32_t hash) noexcept;
+
+  /* False if the hashed name certainly isn't in. */
+  bool may_contain(uint32_t hash) const noexcept;
+
+  /* The hash of the interned ID, class or type name.  Never 0. */
+  static uint32_t get_hash(simple_selector_t::kind_t kind, uint32_t atom) noexcept;
+
+  /* The hashes of up to max_hash_count IDs, classes and types which an
+     element's ancestors must have for the selector to match it, followed
+     by 0s. */
+  static std::array<uint32_t, max_hash_count> get_hashes(
+      const selector_table_t &table, const selector_t &selector) noexcept;
+
+private:
+
+  /* The number of bits of a hash which pick a counter. */
+  static constexpr unsigned bits_per_index = 12;
+
+  /* The counters, two for each name. */
+  uint8_t counters[size_t(1) << bits_per_index];
+
+};  // ancestor_filter_t
+
+/* Matches the selectors of a selector_table_t against elements.
+
+   We match a selector right to left, as it's laid out: the element must
+   match the first compound, then some ancestor or sibling the next, and
+   so on, backtracking as need be.  That's cheap for the first compound
+   and dear for descendant combinators, which can send us to the root and
+   back for every selector, so while the caller walks the tree they push
+   each element they enter and pop it when they leave, and we keep an
+   ancestor_filter_t of the ancestors' names.  Matching an element whose
+   parent is the last element pushed, with the root first, checks the
+   filter before it walks anywhere.
+
+   One per thread; the table may be shared. */
+class matcher_t final {
+
+public:
+
+  /* Matching the table's selectors, which must outlive us. */
+  explicit matcher_t(const selector_table_t &table_);
+
+  /* Enter the element, whose children are to be matched next. */
+  void push(const element_t &element);
+
+  /* Leave the element last pushed. */
+  void pop();
+
+  /* True if the selector, which must be one of the table's
+     get_selectors(), matches the element.  A pseudo-element is ignored;
+     the selector matches the element it would belong to. */
+  bool matches(const selector_t &selector, const element_t &element) const;
+
+  /* Append the table's selectors which match the element, in order. */
+  void match(const element_t &element, std::vector<const selector_t *> &matched) const;
+
+  /* As above, but trying only the selectors in the index's buckets for
+     the element's ID, classes and type, and its universal bucket.  The
+     index must be of our table. */
+  void match(const element_t &element, const rule_index_t &index, std::vector<const selector_t *> &matched) const;
+
+  /* The number of times matches() found the answer in the filter. */
+  size_t get_filtered_count() const noexcept;
+
+private:
+
+  /* True if the filter holds all the element's ancestors. */
+  bool has_ancestors_of(const element_t &element) const noexcept;
+
+  /* True if the element matches the selector whose simple selectors
+     start at simple, starting from the compound at simple. */
+  bool matches_from(const simple_selector_t *simple, const element_t &element) const;
+
+  /* True if the element matches the simple selector. */
+  bool matches_simple(const simple_selector_t &simple, const element_t &element) const;
+
+  /* True if the element matches any of the selectors in the arguments. */
+  bool matches_any(const selector_range_t &arguments, const element_t &element) const;
+
+  /* True if the element matches the attribute selector. */
+  bool matches_attribute(const simple_selector_t &simple, const element_t &element) const;
+
+  /* True if the element matches the PSEUDO_CLASS or NTH. */
+  bool matches_pseudo_class(const simple_selector_t &simple, const element_t &element) const;
+
+  /* See constructor. */
+  const selector_table_t &table;
+
+  /* The hashes of the ancestor names of each of the table's selectors;
+     see ancestor_filter_t::get_hashes(). */
+  std::vector<std::array<uint32_t, ancestor_filter_t::max_hash_count>> selector_hashes;
+
+  /* The elements pushed, root first. */
+  std::vector<const element_t *> ancestors;
+
+  /* The hashes of the names of the elements pushed, in the order they
+     were added to the filter. */
+  std::vector<uint32_t> ancestor_hashes;
+
+  /* For each element pushed, the number of its hashes. */
+  std::vector<uint32_t> ancestor_hash_counts;
+
+  /* See ancestor_filter_t. */
+  ancestor_filter_t filter;
+
+  /* See accessor. */
+  mutable size_t filtered_count;
+
+};  // matcher_t
+
+}  // yourcss
@@ -0,0 +1,640 @@
+#include "minifier.h"
+
+#include <cstring>
+#include <memory_resource>
+
+namespace yourcss {
+
+namespace {
+
+bool is_digit(char c) noexcept {
+  return c >= '0' && c <= '9';
+}
+
+bool is_hex(char c) noexcept {
+  return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+bool is_space(char c) noexcept {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+char to_lower(char c) noexcept {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+/* True if the text is the word, which is in lower case, regardless of
+   ASCII case. */
+bool is_word(std::string_view text, std::string_view word) noexcept {
+  if (text.size() != word.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < text.size(); ++i) {
+    if (to_lower(text[i]) != word[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* True if a zero of the unit is the same as a plain 0. */
+bool is_length_unit(std::string_view unit) noexcept {
+  static constexpr std::string_view units[] = {
+    "px", "em", "rem", "ex", "ch", "vw", "vh", "vmin", "vmax",
+    "cm", "mm", "q", "in", "pt", "pc",
+  };
+  for (auto word: units) {
+    if (is_word(unit, word)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* True if the block of the at-rule holds rules rather than declarations.
+   A vendor prefix is ignored. */
+bool holds_rules(std::string_view at_keyword) noexcept {
+  static constexpr std::string_view names[] = {
+    "media", "supports", "document", "layer", "container", "scope", "keyframes", "starting-style",
+  };
+  auto name = at_keyword.substr(1);
+  if (name.size() > 1 && name[0] == '-' && name[1] != '-') {
+    auto dash = name.find('-', 1);
+    name = (dash == std::string_view::npos) ? std::string_view() : name.substr(dash + 1);
+  }
+  for (auto word: names) {
+    if (is_word(name, word)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* True if the property is flex, or a prefixed flex, whose basis must keep
+   its unit so it isn't taken for a shrink factor. */
+bool is_flex(std::string_view property) noexcept {
+  return property.size() >= 4 && is_word(property.substr(property.size() - 4), "flex");
+}
+
+}  // namespace
+
+minifier_t::minifier_t(const char *src, std::ostream &strm_, size_t buffer_size):
+  minifier_t(src, src + std::strlen(src), strm_, buffer_size) {}
+
+minifier_t::minifier_t(const char *begin, const char *end, std::ostream &strm_, size_t buffer_size):
+  origin(begin),
+  limit(end),
+  strm(strm_),
+  buffer(buffer_size < 64 ? 64 : buffer_size),
+  used(0),
+  drained(0),
+  held_kind(token_t::WHITESPACE_TOKEN),
+  held_offset(0),
+  holding(false),
+  next_kind(token_t::WHITESPACE_TOKEN),
+  last_kind(token_t::WHITESPACE_TOKEN),
+  last_c('\0'),
+  started(false),
+  space_pending(false),
+  semicolon_pending(false),
+  source_map(nullptr),
+  source(0),
+  out_line(0),
+  line_start(0),
+  block_depth(0),
+  paren_depth(0),
+  declaration_blocks(0),
+  at_statement_start(true),
+  rules_block_next(false) {}
+
+minifier_t::~minifier_t() {
+  finish();
+}
+
+void minifier_t::minify(
+    const char *begin, const char *end, std::ostream &strm,
+    source_map_writer_t *source_map) {
+  std::pmr::unsynchronized_pool_resource pool;
+  lexer_config_t config(0, &pool);
+  minifier_t minifier(begin, end, strm);
+  minifier.set_source_map(source_map);
+  lexer_t(config, begin, end).lex(minifier);
+  minifier.finish();
+}
+
+void minifier_t::set_source_map(source_map_writer_t *source_map_, uint32_t source_) noexcept {
+  source_map = source_map_;
+  source = source_;
+}
+
+void minifier_t::write(const token_t &token) {
+  auto size = static_cast<uint64_t>(limit - origin);
+  auto offset = token.get_pos().get_offset();
+  if (offset > size) {
+    offset = size;
+  }
+  auto pos = token.get_pos();
+  auto start = find_start(token.get_kind(), offset);
+  if (start < offset) {
+    /* Move the position back to the start too.  Only a url( split over
+       lines takes us back a line, and then we look for where it began. */
+    uint64_t newlines = 0;
+    for (auto at = start; at < offset; ++at) {
+      newlines += (origin[at] == '\n');
+    }
+    if (!newlines) {
+      pos = pos_t(pos.get_line(), pos.get_col() - (offset - start), start);
+    } else {
+      auto line_begin = start;
+      while (line_begin && origin[line_begin - 1] != '\n') {
+        --line_begin;
+      }
+      pos = pos_t(pos.get_line() - newlines, start - line_begin + 1, start);
+    }
+  }
+  if (holding) {
+    next_kind = token.get_kind();
+    emit(held_kind, held_pos, origin + held_offset, origin + start);
+  }
+  held_kind = token.get_kind();
+  held_pos = pos;
+  held_offset = start;
+  holding = true;
+}
+
+bool minifier_t::operator()(const std::shared_ptr<token_t> &token) {
+  write(*token);
+  return true;
+}
+
+void minifier_t::finish() {
+  if (holding) {
+    next_kind = token_t::WHITESPACE_TOKEN;
+    emit(held_kind, held_pos, origin + held_offset, limit);
+    holding = false;
+  }
+  if (semicolon_pending) {
+    put(';');
+    semicolon_pending = false;
+  }
+  drain();
+  strm.flush();
+}
+
+uint64_t minifier_t::get_byte_count() const noexcept {
+  return drained + used;
+}
+
+uint64_t minifier_t::find_start(token_t::kind_t kind, uint64_t offset) const noexcept {
+  switch (kind) {
+    case token_t::STRING_TOKEN:
+    case token_t::BAD_STRING_TOKEN: {
+      return offset ? offset - 1 : offset;
+    }
+    case token_t::URL_TOKEN:
+    case token_t::BAD_URL_TOKEN: {
+      auto at = offset;
+      if (at && (origin[at - 1] == '"' || origin[at - 1] == '\'')) {
+        --at;
+      }
+      while (at && is_space(origin[at - 1])) {
+        --at;
+      }
+      return (at >= 4 && std::memcmp(origin + at - 4, "url(", 4) == 0) ? at - 4 : offset;
+    }
+    case token_t::UNICODE_RANGE_TOKEN: {
+      return (offset >= 2 && origin[offset - 1] == '+') ? offset - 2 : offset;
+    }
+    default: {
+      return offset;
+    }
+  }
+}
+
+void minifier_t::emit(token_t::kind_t kind, const pos_t &pos, const char *start, const char *stop) {
+  std::string_view text(start, static_cast<size_t>(stop - start));
+  switch (kind) {
+    case token_t::WHITESPACE_TOKEN: {
+      space_pending = true;
+      return;
+    }
+    case token_t::COMMENT_TOKEN: {
+      return;
+    }
+    case token_t::SEMICOLON_TOKEN: {
+      semicolon_pending = true;
+      property = std::string_view();
+      candidate = std::string_view();
+      rules_block_next = false;
+      at_statement_start = true;
+      paren_depth = 0;
+      return;
+    }
+    default: {
+      break;
+    }
+  }
+  char c = text.empty() ? '\0' : text[0];
+  if (semicolon_pending) {
+    semicolon_pending = false;
+    if (kind != token_t::RIGHT_BRACE_TOKEN) {
+      put(';');
+      last_kind = token_t::SEMICOLON_TOKEN;
+      last_c = ';';
+    }
+  }
+  if (started && ((space_pending && !can_drop_space(kind, c)) || must_separate(kind, c))) {
+    put(' ');
+  }
+  space_pending = false;
+  if (source_map) {
+    map(kind, pos);
+  }
+  auto written = kind;
+  switch (kind) {
+    case token_t::NUMBER_TOKEN:
+    case token_t::PERCENTAGE_TOKEN:
+    case token_t::DIMENSION_TOKEN: {
+      if (can_rewrite_value()) {
+        written = put_numeric(kind, text);
+      } else {
+        put(text);
+      }
+      break;
+    }
+    case token_t::HASH_TOKEN: {
+      put_hash(text);
+      break;
+    }
+    case token_t::STRING_TOKEN:
+    case token_t::BAD_STRING_TOKEN:
+    case token_t::URL_TOKEN:
+    case token_t::BAD_URL_TOKEN: {
+      /* These alone can hold a newline, escaped or in a url's
+         whitespace, which moves us on a line of output. */
+      put(text);
+      if (source_map) {
+        for (auto at = text.find('\n'); at != std::string_view::npos; at = text.find('\n', at + 1)) {
+          ++out_line;
+          line_start = get_byte_count() - (text.size() - at - 1);
+        }
+      }
+      break;
+    }
+    default: {
+      put(text);
+      break;
+    }
+  }
+  last_kind = written;
+  last_c = c;
+  started = true;
+  /* Keep track of where we are: in which kind of block, and whether in a
+     declaration's value. */
+  bool statement_start = false;
+  std::string_view next_candidate;
+  switch (kind) {
+    case token_t::LEFT_BRACE_TOKEN: {
+      if (block_depth < max_depth) {
+        auto bit = uint64_t(1) << block_depth;
+        declaration_blocks = rules_block_next ? (declaration_blocks & ~bit) : (declaration_blocks | bit);
+      }
+      ++block_depth;
+      statement_start = true;
+      break;
+    }
+    case token_t::RIGHT_BRACE_TOKEN: {
+      if (block_depth) {
+        --block_depth;
+      }
+      statement_start = true;
+      break;
+    }
+    case token_t::FUNCTION_TOKEN:
+    case token_t::LEFT_PAREN_TOKEN:
+    case token_t::LEFT_BRACKET_TOKEN: {
+      ++paren_depth;
+      break;
+    }
+    case token_t::RIGHT_PAREN_TOKEN:
+    case token_t::RIGHT_BRACKET_TOKEN: {
+      if (paren_depth) {
+        --paren_depth;
+      }
+      break;
+    }
+    case token_t::AT_KEYWORD_TOKEN: {
+      if (at_statement_start) {
+        rules_block_next = holds_rules(text);
+      }
+      break;
+    }
+    case token_t::IDENT_TOKEN: {
+      if (at_statement_start && in_declarations()) {
+        next_candidate = text;
+      }
+      break;
+    }
+    case token_t::COLON_TOKEN: {
+      if (is_value_colon()) {
+        property = candidate;
+      }
+      break;
+    }
+    default: {
+      break;
+    }
+  }
+  if (statement_start) {
+    property = std::string_view();
+    rules_block_next = false;
+    paren_depth = 0;
+  }
+  at_statement_start = statement_start;
+  candidate = next_candidate;
+}
+
+void minifier_t::map(token_t::kind_t kind, const pos_t &pos) {
+  switch (kind) {
+    case token_t::COLON_TOKEN:
+    case token_t::COMMA_TOKEN:
+    case token_t::LEFT_BRACKET_TOKEN:
+    case token_t::RIGHT_BRACKET_TOKEN:
+    case token_t::LEFT_PAREN_TOKEN:
+    case token_t::RIGHT_PAREN_TOKEN:
+    case token_t::LEFT_BRACE_TOKEN:
+    case token_t::RIGHT_BRACE_TOKEN: {
+      return;
+    }
+    default: {
+      source_map->add(out_line, get_byte_count() - line_start, pos, source);
+    }
+  }
+}
+
+token_t::kind_t minifier_t::put_numeric(token_t::kind_t kind, std::string_view text) {
+  auto size = text.size();
+  size_t i = 0;
+  bool negative = false;
+  if (i < size && (text[i] == '+' || text[i] == '-')) {
+    negative = (text[i] == '-');
+    ++i;
+  }
+  auto int_start = i;
+  while (i < size && is_digit(text[i])) {
+    ++i;
+  }
+  auto int_end = i;
+  auto frac_start = i, frac_end = i;
+  if (i + 1 < size && text[i] == '.' && is_digit(text[i + 1])) {
+    frac_start = ++i;
+    while (i < size && is_digit(text[i])) {
+      ++i;
+    }
+    frac_end = i;
+  }
+  auto exp_start = i, exp_end = i;
+  bool exp_negative = false;
+  if (i < size && (text[i] == 'e' || text[i] == 'E')) {
+    auto j = i + 1;
+    bool sign = false;
+    if (j < size && (text[j] == '+' || text[j] == '-')) {
+      sign = (text[j] == '-');
+      ++j;
+    }
+    if (j < size && is_digit(text[j])) {
+      exp_negative = sign;
+      exp_start = i = j;
+      while (i < size && is_digit(text[i])) {
+        ++i;
+      }
+      exp_end = i;
+    }
+  }
+  auto unit = text.substr(i);
+  while (int_start < int_end && text[int_start] == '0') {
+    ++int_start;
+  }
+  while (frac_end > frac_start && text[frac_end - 1] == '0') {
+    --frac_end;
+  }
+  while (exp_start < exp_end && text[exp_start] == '0') {
+    ++exp_start;
+  }
+  if (int_start == int_end && frac_start == frac_end) {
+    put('0');
+    if (kind == token_t::DIMENSION_TOKEN && !paren_depth && !is_flex(property) && is_length_unit(unit)) {
+      return token_t::NUMBER_TOKEN;
+    }
+    put(unit);
+    return kind;
+  }
+  if (negative) {
+    put('-');
+  }
+  put(text.substr(int_start, int_end - int_start));
+  if (frac_start < frac_end) {
+    put('.');
+    put(text.substr(frac_start, frac_end - frac_start));
+  }
+  if (exp_start < exp_end) {
+    put(exp_negative ? "e-" : "e");
+    put(text.substr(exp_start, exp_end - exp_start));
+  }
+  put(unit);
+  return kind;
+}
+
+void minifier_t::put_hash(std::string_view text) {
+  auto digits = text.substr(1);
+  auto size = digits.size();
+  if (!can_rewrite_value() || (size != 3 && size != 4 && size != 6 && size != 8)) {
+    put(text);
+    return;
+  }
+  char color[8];
+  for (size_t i = 0; i < size; ++i) {
+    if (!is_hex(digits[i])) {
+      put(text);
+      return;
+    }
+    color[i] = to_lower(digits[i]);
+  }
+  if (size >= 6) {
+    bool pairs = true;
+    for (size_t i = 0; i < size; i += 2) {
+      pairs = pairs && color[i] == color[i + 1];
+    }
+    if (pairs) {
+      for (size_t i = 0; i < size / 2; ++i) {
+        color[i] = color[i * 2];
+      }
+      size /= 2;
+    }
+  }
+  put('#');
+  put(color, size);
+}
+
+bool minifier_t::can_drop_space(token_t::kind_t kind, char c) const noexcept {
+  switch (last_kind) {
+    case token_t::LEFT_BRACE_TOKEN:
+    case token_t::RIGHT_BRACE_TOKEN:
+    case token_t::SEMICOLON_TOKEN:
+    case token_t::COMMA_TOKEN:
+    case token_t::COLON_TOKEN:
+    case token_t::FUNCTION_TOKEN:
+    case token_t::LEFT_PAREN_TOKEN:
+    case token_t::LEFT_BRACKET_TOKEN:
+    case token_t::INCLUDE_MATCH_TOKEN:
+    case token_t::DASH_MATCH_TOKEN:
+    case token_t::PREFIX_MATCH_TOKEN:
+    case token_t::SUFFIX_MATCH_TOKEN:
+    case token_t::SUBSTRING_MATCH_TOKEN:
+    case token_t::COLUMN_TOKEN: {
+      return true;
+    }
+    case token_t::DELIM_TOKEN: {
+      if (last_c == '>' || last_c == '~' || last_c == '!' || (last_c == '+' && !paren_depth)) {
+        return true;
+      }
+      break;
+    }
+    default: {
+      break;
+    }
+  }
+  switch (kind) {
+    case token_t::LEFT_BRACE_TOKEN:
+    case token_t::RIGHT_BRACE_TOKEN:
+    case token_t::COMMA_TOKEN:
+    case token_t::RIGHT_PAREN_TOKEN:
+    case token_t::RIGHT_BRACKET_TOKEN:
+    case token_t::INCLUDE_MATCH_TOKEN:
+    case token_t::DASH_MATCH_TOKEN:
+    case token_t::PREFIX_MATCH_TOKEN:
+    case token_t::SUFFIX_MATCH_TOKEN:
+    case token_t::SUBSTRING_MATCH_TOKEN:
+    case token_t::COLUMN_TOKEN: {
+      return true;
+    }
+    case token_t::COLON_TOKEN: {
+      /* Only between a property and its value; in a selector, a :hover
+         is not a:hover. */
+      return is_value_colon();
+    }
+    case token_t::DELIM_TOKEN: {
+      return c == '>' || c == '~' || c == '!' || (c == '+' && !paren_depth);
+    }
+    default: {
+      return false;
+    }
+  }
+}
+
+bool minifier_t::must_separate(token_t::kind_t kind, char c) const noexcept {
+  bool is_delim = (kind == token_t::DELIM_TOKEN);
+  bool ident_like =
+      kind == token_t::IDENT_TOKEN || kind == token_t::FUNCTION_TOKEN ||
+      kind == token_t::URL_TOKEN || kind == token_t::BAD_URL_TOKEN ||
+      (is_delim && c == '-');
+  bool numeric =
+      kind == token_t::NUMBER_TOKEN || kind == token_t::PERCENTAGE_TOKEN ||
+      kind == token_t::DIMENSION_TOKEN;
+  switch (last_kind) {
+    case token_t::IDENT_TOKEN: {
+      return ident_like || numeric || kind == token_t::CDC_TOKEN || kind == token_t::LEFT_PAREN_TOKEN;
+    }
+    case token_t::AT_KEYWORD_TOKEN:
+    case token_t::HASH_TOKEN:
+    case token_t::DIMENSION_TOKEN: {
+      return ident_like || numeric || kind == token_t::CDC_TOKEN;
+    }
+    case token_t::NUMBER_TOKEN: {
+      return ident_like || numeric || (is_delim && c == '%');
+    }
+    case token_t::DELIM_TOKEN: {
+      switch (last_c) {
+        case '#':
+        case '-': return ident_like || numeric;
+        case '@': return ident_like;
+        case '.':
+        case '+': return numeric;
+        case '/': return is_delim && c == '*';
+        /* Not in the table, but these would run together into match
+           tokens or a column. */
+        case '~':
+        case '^':
+        case '$':
+        case '*': return is_delim && c == '=';
+        case '|': return is_delim && (c == '=' || c == '|');
+        default: return false;
+      }
+    }
+    default: {
+      return false;
+    }
+  }
+}
+
+bool minifier_t::is_value_colon() const noexcept {
+  if (candidate.empty()) {
+    return false;
+  }
+  switch (next_kind) {
+    case token_t::IDENT_TOKEN:
+    case token_t::FUNCTION_TOKEN:
+    case token_t::COLON_TOKEN:
+    case token_t::COMMENT_TOKEN: {
+      return false;
+    }
+    default: {
+      return true;
+    }
+  }
+}
+
+bool minifier_t::in_declarations() const noexcept {
+  if (!block_depth) {
+    return false;
+  }
+  return block_depth > max_depth || ((declaration_blocks >> (block_depth - 1)) & 1);
+}
+
+bool minifier_t::can_rewrite_value() const noexcept {
+  return !property.empty() && !(property.size() >= 2 && property[0] == '-' && property[1] == '-');
+}
+
+void minifier_t::put(const char *data, size_t size) {
+  if (size > buffer.size() - used) {
+    drain();
+    if (size > buffer.size()) {
+      strm.write(data, static_cast<std::streamsize>(size));
+      drained += size;
+      return;
+    }
+  }
+  std::memcpy(buffer.data() + used, data, size);
+  used += size;
+}
+
+void minifier_t::put(std::string_view text) {
+  put(text.data(), text.size());
+}
+
+void minifier_t::put(char c) {
+  if (used == buffer.size()) {
+    drain();
+  }
+  buffer[used++] = c;
+}
+
+void minifier_t::drain() {
+  if (used) {
+    strm.write(buffer.data(), static_cast<std::streamsize>(used));
+    drained += used;
+    used = 0;
+  }
+}
+
+}  // yourcss
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string_view>
+#include <vector>
+#include "lexer.h"
+#include "pos.h"
+#include "source_map.h"
+#include "token.h"
+
+namespace yourcss {
+
+/* Writes the tokens of a stylesheet back out as small as we safely can,
+   in one pass, through a buffer of our own:
+
+     - comments go, and whitespace goes wherever it can't matter: next
+       to { } , and match tokens, inside ( ) and [ ], around > ~ ! and
+       a + outside parentheses, and after a property's name; elsewhere
+       it's kept as a single space, since a b and a.b, or the a - b of
+       calc(), mean something else without it;
+     - numbers in declarations' values lose a + sign, leading and
+       trailing zeros and any exponent of 0, so 0.50px is .5px and -0 is
+       0, and a zero length outside any function loses its unit;
+     - hex colors in declarations' values are lowercased and, if each
+       pair of digits is a repeat, halved, so #FFFFFF is #fff;
+     - the last semicolon in a block goes, as do repeated ones.
+
+   Where dropping whitespace would make two tokens run together into
+   something else, an ident and a number, say, we put a space between
+   them, following the table in section 9.2 of CSS Syntax Level 3.
+
+   Everything else is copied as it was written.  We work from the source
+   text rather than tokens' text, slicing each token out of it by its
+   offset and the next token's, so escapes and quotes survive untouched.
+   That means we must be given every token, whitespace and comments
+   included; lex with a filter of 0, or comments the lexer drops end up
+   in the output.  The source text must stay where it is until we're
+   finished, and offsets must start from its beginning.
+
+   Given a source map, we add a mapping for each token we write, other
+   than punctuation, from where it lands in the output to where it was
+   in the source.
+
+   We're a visitor, so a lexer can hand its tokens straight to us, and we
+   hold on to just one of them at a time.  We allocate nothing after
+   we're constructed, and keep track of which blocks hold declarations
+   for up to max_depth levels of nesting; deeper blocks are assumed to.
+
+     minifier_t minifier(src, std::cout);
+     lexer_t(lexer_config_t(0), src).lex(minifier);
+     minifier.finish();
+*/
+class minifier_t final {
+
+public:
+
+  /* The buffer size we use unless told otherwise. */
+  static constexpr size_t default_buffer_size = 1 << 16;
+
+  /* The levels of nesting of blocks we keep track of. */
+  static constexpr size_t max_depth = 64;
+
+  /* Minify the tokens of the null-terminated text to the stream, holding
+     up to buffer_size bytes before writing them. */
+  minifier_t(const char *src, std::ostream &strm, size_t buffer_size = default_buffer_size);
+
+  /* Minify the tokens of the bytes from begin up to end. */
+  minifier_t(const char *begin, const char *end, std::ostream &strm, size_t buffer_size = default_buffer_size);
+
+  minifier_t(const minifier_t &) = delete;
+
+  minifier_t &operator=(const minifier_t &) = delete;
+
+  /* Finishes. */
+  ~minifier_t();
+
+  /* Minify the bytes from begin up to end to the stream, lexing them with
+     a pool of memory which is reused from token to token, and mapping
+     them in the source map, if there is one, as its source 0. */
+  static void minify(
+      const char *begin, const char *end, std::ostream &strm,
+      source_map_writer_t *source_map = nullptr);
+
+  /* Map each token we write from here on in the source map, as coming
+     from the source with the index.  The map must outlive us. */
+  void set_source_map(source_map_writer_t *source_map_, uint32_t source_ = 0) noexcept;
+
+  /* Take the next token. */
+  void write(const token_t &token);
+
+  /* Take the next token.  Always returns true, so lexing carries on. */
+  bool operator()(const std::shared_ptr<token_t> &token);
+
+  /* Write out the last token, which runs to the end of the source text,
+     and flush.  Call once every token has been given to us. */
+  void finish();
+
+  /* The number of bytes of output so far, counting any not yet written
+     to the stream. */
+  uint64_t get_byte_count() const noexcept;
+
+private:
+
+  /* Where the token of the kind at the offset really starts.  The lexer
+     puts strings, urls and unicode ranges just past their opening quote,
+     url( or u+, which is what skimmer_t reports, so we look back for
+     them. */
+  uint64_t find_start(token_t::kind_t kind, uint64_t offset) const noexcept;
+
+  /* Write out the token of the kind, from the position, whose text runs
+     from start up to stop. */
+  void emit(token_t::kind_t kind, const pos_t &pos, const char *start, const char *stop);
+
+  /* Map what we write next, a token of the kind, to the position in our
+     source map.  Punctuation isn't worth a mapping of its own; a lookup
+     falls back to the token before. */
+  void map(token_t::kind_t kind, const pos_t &pos);
+
+  /* Write out a number, percentage or dimension, shortened; returns the
+     kind it ends up as. */
+  token_t::kind_t put_numeric(token_t::kind_t kind, std::string_view text);
+
+  /* Write out a hash, shortened if it's a color. */
+  void put_hash(std::string_view text);
+
+  /* True if whitespace between the last token we wrote and the next,
+     which is of the kind and starts with c, can go. */
+  bool can_drop_space(token_t::kind_t kind, char c) const noexcept;
+
+  /* True if the last token we wrote and the next would run together
+     without something between them. */
+  bool must_separate(token_t::kind_t kind, char c) const noexcept;
+
+  /* True if the colon we're about to write is between a property's name
+     and its value: it follows an ident at the start of a statement, and
+     what comes after it can't start a pseudo-class, as the hover of a
+     nested p:hover { } does. */
+  bool is_value_colon() const noexcept;
+
+  /* True if the block we're in holds declarations. */
+  bool in_declarations() const noexcept;
+
+  /* True if we're in a declaration's value and may rewrite it. */
+  bool can_rewrite_value() const noexcept;
+
+  /* Append the bytes to the buffer, writing it first if they don't fit.
+     Bytes too many for even an empty buffer go straight to the stream. */
+  void put(const char *data, size_t size);
+
+  void put(std::string_view text);
+
+  void put(char c);
+
+  /* Write the buffer to the stream and empty it. */
+  void drain();
+
+  /* The source text. */
+  const char *origin, *limit;
+
+  /* Where we write to. */
+  std::ostream &strm;
+
+  /* Bytes not yet written. */
+  std::vector<char> buffer;
+
+  /* The number of bytes used in buffer. */
+  size_t used;
+
+  /* The bytes written to the stream so far. */
+  uint64_t drained;
+
+  /* The token we're holding until we know where it ends. */
+  token_t::kind_t held_kind;
+
+  pos_t held_pos;
+
+  uint64_t held_offset;
+
+  bool holding;
+
+  /* The kind of the token after the one we're writing out, or whitespace
+     if the text has run out. */
+  token_t::kind_t next_kind;
+
+  /* The kind of the last token we wrote, and its first byte. */
+  token_t::kind_t last_kind;
+
+  char last_c;
+
+  /* True once we've written anything. */
+  bool started;
+
+  /* True if whitespace came since the last token we wrote. */
+  bool space_pending;
+
+  /* True if a semicolon came since the last token we wrote. */
+  bool semicolon_pending;
+
+  /* See set_source_map(). */
+  source_map_writer_t *source_map;
+
+  uint32_t source;
+
+  /* The line of output we're on, from 0, and the byte count at its
+     start. */
+  uint64_t out_line, line_start;
+
+  /* The depth of nesting in blocks and in parentheses, brackets and
+     functions. */
+  size_t block_depth, paren_depth;
+
+  /* A bit for each level of blocks, set if it holds declarations. */
+  uint64_t declaration_blocks;
+
+  /* True at the start of a rule or declaration. */
+  bool at_statement_start;
+
+  /* True if the rule being started is an at-rule whose block holds
+     rules. */
+  bool rules_block_next;
+
+  /* The ident which started the current statement, if it may be a
+     property name. */
+  std::string_view candidate;
+
+  /* The property whose value we're in, or empty if we're not in one. */
+  std::string_view property;
+
+};  // minifier_t
+
+}  // yourcss
@@ -0,0 +1,641 @@
+#include "parser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <type_traits>
+
+namespace yourcss {
+
+namespace {
+
+char to_lower(char c) {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+/* True if the text is the given lower-case word, in any case. */
+bool equals_lower(std::string_view text, std::string_view word) {
+  if (text.size() != word.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < text.size(); ++i) {
+    if (to_lower(text[i]) != word[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* The at-rules whose blocks hold rules. */
+constexpr std::string_view rule_list_names[] = {
+  "container", "document", "keyframes", "layer", "media", "scope",
+  "starting-style", "supports",
+};
+
+/* The at-rules whose blocks hold declarations, including those which
+   appear only inside @page and @font-feature-values. */
+constexpr std::string_view declaration_list_names[] = {
+  "annotation", "bottom-center", "bottom-left", "bottom-left-corner",
+  "bottom-right", "bottom-right-corner", "character-variant",
+  "counter-style", "font-face", "font-feature-values",
+  "font-palette-values", "left-bottom", "left-middle", "left-top", "ornaments",
+  "page", "property", "right-bottom", "right-middle", "right-top",
+  "styleset", "stylistic", "swash", "top-center", "top-left",
+  "top-left-corner", "top-right", "top-right-corner", "viewport",
+};
+
+/* Find the '}' which closes a block whose '{' is just before cursor, the
+   way the parser would: a '}' inside parentheses or brackets doesn't
+   close it, and nor does one in a string, a comment, an escape or a url.
+   Returns the end of the text if the block isn't closed. */
+const char *find_closing_brace(const char *cursor, const char *end, std::string &closers) {
+  closers.clear();
+  const char *brace = cursor - 1;
+  while (cursor != end) {
+    switch (*cursor) {
+      case '\0': {
+        /* A null byte ends the text, as it does for the lexer. */
+        return cursor;
+      }
+      case '\\': {
+        /* An escaped character is never a bracket.  The hex digits of a
+           longer escape don't matter here. */
+        if (++cursor == end) {
+          return end;
+        }
+        break;
+      }
+      case '"':
+      case '\'': {
+        char quote = *cursor;
+        while (++cursor != end && *cursor != quote && *cursor != '\n') {
+          if (*cursor == '\\' && cursor + 1 != end) {
+            ++cursor;
+          }
+        }
+        if (cursor == end) {
+          return end;
+        }
+        break;
+      }
+      case '/': {
+        if (cursor + 1 != end && cursor[1] == '*') {
+          ++cursor;
+          do {
+            cursor = static_cast<const char *>(std::memchr(cursor + 1, '*', static_cast<size_t>(end - cursor - 1)));
+            if (!cursor) {
+              return end;
+            }
+          } while (cursor + 1 == end || cursor[1] != '/');
+          ++cursor;
+        }
+        break;
+      }
+      case '(': {
+        if (structural_index_t::is_url_open(brace, cursor)) {
+          /* A url is one token, whatever is in it. */
+          cursor = structural_index_t::skip_url(cursor + 1, end);
+          continue;
+        }
+        closers.push_back(')');
+        break;
+      }
+      case '[': {
+        closers.push_back(']');
+        break;
+      }
+      case '{': {
+        closers.push_back('}');
+        break;
+      }
+      case ')':
+      case ']':
+      case '}': {
+        if (closers.empty()) {
+          if (*cursor == '}') {
+            return cursor;
+          }
+        } else if (closers.back() == *cursor) {
+          closers.pop_back();
+        }
+        break;
+      }
+      default: {
+        break;
+      }
+    }
+    ++cursor;
+  }
+  return end;
+}
+
+/* Pieces smaller than this aren't worth parsing on their own. */
+constexpr uint64_t min_piece_size = 64 * 1024;
+
+/* The number of pieces to aim for on each thread, so that a thread which
+   gets the slow ones doesn't hold the rest up. */
+constexpr uint64_t pieces_per_thread = 8;
+
+/* The position of end, given that begin is at pos. */
+pos_t advance_pos(pos_t pos, const char *begin, const char *end) {
+  uint64_t line = pos.get_line(), col = pos.get_col();
+  const char *line_start = begin;
+  while (auto newline = static_cast<const char *>(std::memchr(line_start, '\n', static_cast<size_t>(end - line_start)))) {
+    ++line;
+    col = 1;
+    line_start = newline + 1;
+  }
+  col += static_cast<uint64_t>(end - line_start);
+  return pos_t(line, col, pos.get_offset() + static_cast<uint64_t>(end - begin));
+}
+
+}  // namespace
+
+parser_error_t::parser_error_t(const pos_t &pos, code_t code_, const char *detail_) noexcept:
+  error_t(pos),
+  code(code_),
+  detail(detail_) {}
+
+parser_error_t::code_t parser_error_t::get_code() const noexcept {
+  return code;
+}
+
+const char *parser_error_t::get_detail() const noexcept {
+  return detail;
+}
+
+void parser_error_t::write_msg(std::ostream &strm) const {
+  strm << detail;
+}
+
+parser_error_t::~parser_error_t() = default;
+
+block_t::kind_t block_t::get_at_rule_kind(std::string_view name) {
+  /* Drop a vendor prefix, such as the -webkit- of @-webkit-keyframes. */
+  if (name.size() > 1 && name[0] == '-' && name[1] != '-') {
+    auto hyphen = name.find('-', 1);
+    if (hyphen != std::string_view::npos) {
+      name.remove_prefix(hyphen + 1);
+    }
+  }
+  for (auto known: rule_list_names) {
+    if (equals_lower(name, known)) {
+      return RULES;
+    }
+  }
+  for (auto known: declaration_list_names) {
+    if (equals_lower(name, known)) {
+      return DECLARATIONS;
+    }
+  }
+  return VALUES;
+}
+
+stylesheet_t::stylesheet_t(std::pmr::memory_resource *upstream):
+  arena(std::make_unique<std::pmr::monotonic_buffer_resource>(upstream)) {}
+
+const node_list_t<rule_t> &stylesheet_t::get_rules() const noexcept {
+  return rules;
+}
+
+const std::vector<parser_error_t> &stylesheet_t::get_errors() const noexcept {
+  return errors;
+}
+
+std::pmr::memory_resource *stylesheet_t::get_arena() const noexcept {
+  return arena.get();
+}
+
+const block_t &stylesheet_t::expand(const block_t &block) {
+  if (block.is_deferred) {
+    /* We only hand our nodes out as const, but they're ours to change. */
+    parser_t(*this, block).consume_deferred(const_cast<block_t &>(block));
+  }
+  return block;
+}
+
+parser_t::parser_t(const char *src, std::pmr::memory_resource *upstream):
+  parser_t(src, src + std::strlen(src), pos_t(), upstream) {}
+
+parser_t::parser_t(const char *begin, const char *end_, const pos_t &start, std::pmr::memory_resource *upstream):
+  lexer(begin, end_, start, &scratch),
+  end(end_),
+  lazy(false),
+  next_structural(0),
+  block_depth(0),
+  sheet(upstream),
+  target(&sheet) {
+  /* Whether whitespace came before a token is kept on the token, so we
+     never need the whitespace itself. */
+  lexer.set_filter(token_t::get_mask(token_t::WHITESPACE_TOKEN) | token_t::get_mask(token_t::COMMENT_TOKEN));
+}
+
+parser_t::parser_t(stylesheet_t &target_, const block_t &block):
+  parser_t(
+      block.source.data(), block.source.data() + block.source.size(),
+      /* The source starts just past the '{', which is never a newline. */
+      pos_t(block.pos.get_line(), block.pos.get_col() + 1, block.pos.get_offset() + 1)) {
+  target = &target_;
+}
+
+stylesheet_t parser_t::parse_stylesheet() {
+  if (lazy) {
+    index.emplace(lexer.get_next_cursor(), end);
+  }
+  advance();
+  sheet.rules = consume_rule_list(true);
+  return std::move(sheet);
+}
+
+stylesheet_t parser_t::parse_stylesheet(thread_pool_t &pool) {
+  const char *begin = lexer.get_next_cursor();
+  structural_index_t splitter(begin, end);
+  auto size = static_cast<uint64_t>(splitter.get_end() - begin);
+  uint64_t min_gap = std::max(size / (pool.get_thread_count() * pieces_per_thread), min_piece_size);
+  auto ends = splitter.find_rule_ends(min_gap);
+  if (ends.empty() || (ends.size() == 1 && ends.back() == size)) {
+    return parse_stylesheet();
+  }
+  /* What became of each piece. */
+  struct piece_t final {
+    const char *begin, *end;
+    pos_t start;
+    std::optional<stylesheet_t> sheet;
+    std::exception_ptr error;
+  };  // piece_t
+  std::vector<piece_t> pieces;
+  pieces.reserve(ends.size() + 1);
+  const char *piece_begin = begin;
+  pos_t start = lexer.get_next_pos();
+  if (ends.back() != size) {
+    ends.push_back(size);
+  }
+  for (auto offset: ends) {
+    const char *piece_end = begin + offset;
+    pieces.push_back(piece_t{piece_begin, piece_end, start, std::nullopt, nullptr});
+    start = advance_pos(start, piece_begin, piece_end);
+    piece_begin = piece_end;
+  }
+  auto upstream = sheet.arena->upstream_resource();
+  for (auto &piece: pieces) {
+    pool.submit([&piece, upstream, this] {
+      try {
+        parser_t parser(piece.begin, piece.end, piece.start, upstream);
+        parser.set_lazy(lazy);
+        piece.sheet.emplace(parser.parse_stylesheet());
+      } catch (...) {
+        piece.error = std::current_exception();
+      }
+    });
+  }
+  pool.wait();
+  for (auto &piece: pieces) {
+    if (piece.error) {
+      std::rethrow_exception(piece.error);
+    }
+  }
+  /* The nodes stay where they are; only the top-level list is new. */
+  for (auto &piece: pieces) {
+    rule_stack.insert(rule_stack.end(), piece.sheet->rules.begin(), piece.sheet->rules.end());
+    sheet.errors.insert(sheet.errors.end(), piece.sheet->errors.begin(), piece.sheet->errors.end());
+    sheet.merged_arenas.push_back(std::move(piece.sheet->arena));
+  }
+  sheet.rules = finish(rule_stack, 0);
+  return std::move(sheet);
+}
+
+void parser_t::set_lazy(bool lazy_) {
+  lazy = lazy_;
+}
+
+bool parser_t::is_lazy() const noexcept {
+  return lazy;
+}
+
+void parser_t::consume_deferred(block_t &block) {
+  advance();
+  ++block_depth;
+  consume_declaration_list(block);
+  --block_depth;
+  block.is_deferred = false;
+}
+
+node_list_t<rule_t> parser_t::consume_rule_list(bool is_top_level) {
+  size_t mark = rule_stack.size();
+  while (!is_at_end()) {
+    switch (current->get_kind()) {
+      case token_t::CDO_TOKEN:
+      case token_t::CDC_TOKEN: {
+        if (is_top_level) {
+          advance();
+          break;
+        }
+        rule_t rule{};
+        if (consume_qualified_rule(rule)) {
+          rule_stack.push_back(rule);
+        }
+        break;
+      }
+      case token_t::AT_KEYWORD_TOKEN: {
+        rule_t rule{};
+        consume_at_rule(rule);
+        rule_stack.push_back(rule);
+        break;
+      }
+      default: {
+        rule_t rule{};
+        if (consume_qualified_rule(rule)) {
+          rule_stack.push_back(rule);
+        }
+      }
+    }
+  }
+  return finish(rule_stack, mark);
+}
+
+void parser_t::consume_at_rule(rule_t &rule) {
+  rule.kind = rule_t::AT;
+  rule.pos = current->get_pos();
+  rule.name = copy(current->get_text_view().substr(1));
+  advance();
+  size_t mark = value_stack.size();
+  for (;;) {
+    if (is_at_end()) {
+      add_error(parser_error_t::UNEXPECTED_END, "at-rule not ended");
+      break;
+    }
+    if (is_at(token_t::SEMICOLON_TOKEN)) {
+      advance();
+      break;
+    }
+    if (is_at(token_t::LEFT_BRACE_TOKEN)) {
+      rule.prelude = finish(value_stack, mark);
+      consume_block(block_t::get_at_rule_kind(rule.name), rule.block);
+      return;
+    }
+    push_component_value();
+  }
+  rule.prelude = finish(value_stack, mark);
+}
+
+bool parser_t::consume_qualified_rule(rule_t &rule) {
+  rule.kind = rule_t::QUALIFIED;
+  rule.pos = current->get_pos();
+  size_t mark = value_stack.size();
+  for (;;) {
+    if (is_at_end()) {
+      add_error(parser_error_t::UNEXPECTED_END, "qualified rule has no block");
+      value_stack.resize(mark);
+      return false;
+    }
+    if (is_at(token_t::LEFT_BRACE_TOKEN)) {
+      rule.prelude = finish(value_stack, mark);
+      consume_block(block_t::DECLARATIONS, rule.block);
+      return true;
+    }
+    push_component_value();
+  }
+}
+
+void parser_t::consume_block(block_t::kind_t kind, block_t &block) {
+  block.kind = kind;
+  block.pos = current->get_pos();
+  if (lazy && kind == block_t::DECLARATIONS) {
+    defer_block(block);
+    return;
+  }
+  advance();
+  ++block_depth;
+  switch (kind) {
+    case block_t::RULES: {
+      block.rules = consume_rule_list(false);
+      break;
+    }
+    case block_t::DECLARATIONS: {
+      consume_declaration_list(block);
+      break;
+    }
+    default: {
+      size_t mark = value_stack.size();
+      while (!is_at_end()) {
+        push_component_value();
+      }
+      block.values = finish(value_stack, mark);
+    }
+  }
+  --block_depth;
+  if (current) {
+    advance();
+  } else {
+    add_error(parser_error_t::UNEXPECTED_END, "block not closed");
+  }
+}
+
+void parser_t::defer_block(block_t &block) {
+  /* The lexer has just given us the '{', so it's ready to start on the
+     character after it. */
+  const char *begin = lexer.get_next_cursor();
+  const char *brace = find_in_index(begin - 1);
+  if (!brace) {
+    brace = find_closing_brace(begin, end, closers);
+  }
+  block.is_deferred = true;
+  block.source = copy(std::string_view(begin, static_cast<size_t>(brace - begin)));
+  bool is_closed = (brace != end && *brace == '}');
+  const char *resume = is_closed ? brace + 1 : brace;
+  lexer.reset_cursor(resume, advance_pos(lexer.get_next_pos(), begin, resume));
+  lexer.set_passed_whitespace(false);
+  advance();
+  if (!is_closed) {
+    add_error(parser_error_t::UNEXPECTED_END, "block not closed");
+  }
+}
+
+const char *parser_t::find_in_index(const char *open) {
+  const auto &offsets = index->get_offsets();
+  auto offset = static_cast<uint64_t>(open - index->get_begin());
+  /* We only ever move forward, so the '{' can't be behind us. */
+  auto iter = std::lower_bound(offsets.begin() + static_cast<std::ptrdiff_t>(next_structural), offsets.end(), offset);
+  if (iter == offsets.end() || *iter != offset) {
+    return nullptr;
+  }
+  size_t closing = index->find_closing(static_cast<size_t>(iter - offsets.begin()));
+  if (closing == offsets.size()) {
+    next_structural = closing;
+    return index->get_end();
+  }
+  next_structural = closing + 1;
+  return index->get_begin() + offsets[closing];
+}
+
+void parser_t::consume_declaration_list(block_t &block) {
+  size_t declaration_mark = declaration_stack.size(), rule_mark = rule_stack.size();
+  while (!is_at_end()) {
+    switch (current->get_kind()) {
+      case token_t::SEMICOLON_TOKEN: {
+        advance();
+        break;
+      }
+      case token_t::AT_KEYWORD_TOKEN: {
+        rule_t rule{};
+        consume_at_rule(rule);
+        rule_stack.push_back(rule);
+        break;
+      }
+      case token_t::IDENT_TOKEN: {
+        declaration_t declaration{};
+        if (consume_declaration(declaration)) {
+          declaration_stack.push_back(declaration);
+        }
+        break;
+      }
+      default: {
+        add_error(parser_error_t::BAD_DECLARATION, "expected a declaration");
+        skip_to_semicolon();
+      }
+    }
+  }
+  block.declarations = finish(declaration_stack, declaration_mark);
+  block.rules = finish(rule_stack, rule_mark);
+}
+
+bool parser_t::consume_declaration(declaration_t &declaration) {
+  declaration.pos = current->get_pos();
+  declaration.name = copy(current->get_text_view());
+  advance();
+  if (!is_at(token_t::COLON_TOKEN)) {
+    add_error(parser_error_t::BAD_DECLARATION, "expected a colon after the property");
+    skip_to_semicolon();
+    return false;
+  }
+  advance();
+  size_t mark = value_stack.size();
+  while (!is_at_end() && !is_at(token_t::SEMICOLON_TOKEN)) {
+    push_component_value();
+  }
+  size_t size = value_stack.size();
+  if (size - mark >= 2) {
+    const auto &bang = value_stack[size - 2], &word = value_stack[size - 1];
+    if (bang.kind == component_value_t::TOKEN && bang.token_kind == token_t::DELIM_TOKEN && bang.text == "!" &&
+        word.kind == component_value_t::TOKEN && word.token_kind == token_t::IDENT_TOKEN && equals_lower(word.text, "important")) {
+      declaration.important = true;
+      value_stack.resize(size - 2);
+    }
+  }
+  declaration.value = finish(value_stack, mark);
+  return true;
+}
+
+void parser_t::skip_to_semicolon() {
+  component_value_t ignored;
+  while (!is_at_end() && !is_at(token_t::SEMICOLON_TOKEN)) {
+    consume_component_value(ignored);
+  }
+}
+
+void parser_t::push_component_value() {
+  /* Nested values go on the stack while we're consuming this one, so it
+     can't go there until we're done. */
+  component_value_t value;
+  consume_component_value(value);
+  value_stack.push_back(value);
+}
+
+void parser_t::consume_component_value(component_value_t &value) {
+  switch (current->get_kind()) {
+    case token_t::LEFT_BRACE_TOKEN: {
+      consume_nested(token_t::RIGHT_BRACE_TOKEN, value);
+      break;
+    }
+    case token_t::LEFT_BRACKET_TOKEN: {
+      consume_nested(token_t::RIGHT_BRACKET_TOKEN, value);
+      break;
+    }
+    case token_t::LEFT_PAREN_TOKEN: {
+      consume_nested(token_t::RIGHT_PAREN_TOKEN, value);
+      break;
+    }
+    case token_t::FUNCTION_TOKEN: {
+      consume_nested(token_t::RIGHT_PAREN_TOKEN, value);
+      break;
+    }
+    default: {
+      value.kind = component_value_t::TOKEN;
+      set_token(*current, value, 0, 0);
+      advance();
+    }
+  }
+}
+
+void parser_t::consume_nested(token_t::kind_t ending, component_value_t &value) {
+  if (is_at(token_t::FUNCTION_TOKEN)) {
+    value.kind = component_value_t::FUNCTION;
+    set_token(*current, value, 0, 1);
+  } else {
+    value.kind = component_value_t::BLOCK;
+    set_token(*current, value, 0, current->get_text_view().size());
+  }
+  advance();
+  size_t mark = value_stack.size();
+  while (current && !is_at(ending)) {
+    push_component_value();
+  }
+  value.values = finish(value_stack, mark);
+  if (current) {
+    advance();
+  } else {
+    add_error(parser_error_t::UNEXPECTED_END, "block or function not closed");
+  }
+}
+
+void parser_t::set_token(const token_t &token, component_value_t &value, size_t prefix_size, size_t suffix_size) {
+  auto text = token.get_text_view();
+  value.token_kind = token.get_kind();
+  value.type_flag = token.get_type_flag();
+  value.preceded_by_whitespace = token.is_preceded_by_whitespace();
+  value.pos = token.get_pos();
+  value.text = copy(text.substr(prefix_size, text.size() - prefix_size - suffix_size));
+  value.value = get_numeric_value(token);
+}
+
+bool parser_t::is_at_end() const {
+  return !current || (block_depth && current->get_kind() == token_t::RIGHT_BRACE_TOKEN);
+}
+
+bool parser_t::is_at(token_t::kind_t kind) const {
+  return current && current->get_kind() == kind;
+}
+
+void parser_t::advance() {
+  current = lexer.next();
+}
+
+void parser_t::add_error(parser_error_t::code_t code, const char *detail) {
+  target->errors.emplace_back(current ? current->get_pos() : lexer.get_next_pos(), code, detail);
+}
+
+template <typename node_t>
+node_list_t<node_t> parser_t::finish(std::vector<node_t> &stack, size_t mark) {
+  static_assert(std::is_trivially_destructible<node_t>::value, "nodes are never destroyed");
+  size_t count = stack.size() - mark;
+  if (!count) {
+    return node_list_t<node_t>();
+  }
+  auto first = static_cast<node_t *>(target->arena->allocate(sizeof(node_t) * count, alignof(node_t)));
+  std::uninitialized_copy(stack.begin() + static_cast<std::ptrdiff_t>(mark), stack.end(), first);
+  stack.resize(mark);
+  return node_list_t<node_t>(first, count);
+}
+
+std::string_view parser_t::copy(std::string_view text) {
+  if (text.empty()) {
+    return std::string_view();
+  }
+  auto data = static_cast<char *>(target->arena->allocate(text.size(), 1));
+  std::memcpy(data, text.data(), text.size());
+  return std::string_view(data, text.size());
+}
+
+}  // yourcss
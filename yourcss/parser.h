@@ -0,0 +1,481 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "error.h"
+#include "lexer.h"
+#include "pos.h"
+#include "structural_index.h"
+#include "thread_pool.h"
+#include "token.h"
+
+namespace yourcss {
+
+/* A recoverable error in parsing.  CSS never gives up on a stylesheet:
+   the parser drops what it can't make sense of, records one of these and
+   carries on, so they're collected on the stylesheet rather than thrown.
+   The detail must outlive us; in practice it is a string literal. */
+class parser_error_t final: public error_t {
+
+public:
+
+  /* The kinds of thing that can go wrong. */
+  enum code_t {
+
+    /* The text ended inside a rule, block or function. */
+    UNEXPECTED_END,
+
+    /* Something in a declaration list which isn't a declaration. */
+    BAD_DECLARATION,
+
+    /* A style rule whose prelude isn't a selector list we can compile;
+       see selector_table_t. */
+    BAD_SELECTOR,
+
+  };  // code_t
+
+  parser_error_t(const pos_t &pos, code_t code, const char *detail) noexcept;
+
+  /* See code_t. */
+  code_t get_code() const noexcept;
+
+  /* What we found. */
+  const char *get_detail() const noexcept;
+
+  virtual ~parser_error_t();
+
+private:
+
+  /* Writes our detail. */
+  virtual void write_msg(std::ostream &strm) const override;
+
+  /* See accessor. */
+  code_t code;
+
+  /* See accessor. */
+  const char *detail;
+
+};  // parser_error_t
+
+/* Nodes allocated together, end to end, from a stylesheet's arena. */
+template <typename node_t>
+class node_list_t final {
+
+public:
+
+  /* Empty. */
+  constexpr node_list_t() noexcept:
+    first(nullptr),
+    count(0) {}
+
+  /* The count nodes starting at first. */
+  constexpr node_list_t(const node_t *first_, size_t count_) noexcept:
+    first(first_),
+    count(count_) {}
+
+  const node_t *begin() const noexcept {
+    return first;
+  }
+
+  const node_t *end() const noexcept {
+    return first + count;
+  }
+
+  size_t size() const noexcept {
+    return count;
+  }
+
+  bool empty() const noexcept {
+    return count == 0;
+  }
+
+  const node_t &operator[](size_t idx) const noexcept {
+    return first[idx];
+  }
+
+private:
+
+  /* See constructor. */
+  const node_t *first;
+
+  /* See constructor. */
+  size_t count;
+
+};  // node_list_t<node_t>
+
+/* A preserved token, a function or a simple block.  Whitespace and
+   comments aren't kept as values of their own; whether whitespace came
+   before a value is kept on the value, which is all that's needed to
+   tell, say, a descendant combinator from a compound selector. */
+struct component_value_t final {
+
+  /* What we are. */
+  enum kind_t {
+    TOKEN,
+    FUNCTION,
+    BLOCK,
+  };  // component_value_t::kind_t
+
+  /* See kind_t. */
+  kind_t kind;
+
+  /* For a TOKEN, the token's kind; for a FUNCTION, FUNCTION_TOKEN; for a
+     BLOCK, the kind of token which opened it, LEFT_BRACE_TOKEN,
+     LEFT_BRACKET_TOKEN or LEFT_PAREN_TOKEN. */
+  token_t::kind_t token_kind;
+
+  /* See token_t. */
+  token_t::type_flag_t type_flag;
+
+  /* See token_t. */
+  bool preceded_by_whitespace;
+
+  /* Where we start. */
+  pos_t pos;
+
+  /* The token's text, or the function's name without the '('.  Empty for
+     a block. */
+  std::string_view text;
+
+  /* The value of a number, percentage or dimension; otherwise 0. */
+  double value;
+
+  /* The function's arguments or the block's contents. */
+  node_list_t<component_value_t> values;
+
+};  // component_value_t
+
+/* A property and its value. */
+struct declaration_t final {
+
+  /* The property, as written. */
+  std::string_view name;
+
+  /* Where the name starts. */
+  pos_t pos;
+
+  /* The value, without any !important. */
+  node_list_t<component_value_t> value;
+
+  /* True if the value ended with !important. */
+  bool important;
+
+};  // declaration_t
+
+struct rule_t;
+
+/* The {}-block of a rule.  What the block holds depends on the rule: a
+   style rule holds declarations, @media holds more rules, and an at-rule
+   we don't know just holds component values. */
+struct block_t final {
+
+  /* What the block holds. */
+  enum kind_t {
+
+    /* There's no block; the rule ended with a semicolon. */
+    NONE,
+
+    /* A list of rules, in rules. */
+    RULES,
+
+    /* A list of declarations, in declarations, and any at-rules among
+       them, in rules. */
+    DECLARATIONS,
+
+    /* Component values, in values. */
+    VALUES,
+
+  };  // block_t::kind_t
+
+  /* See kind_t. */
+  kind_t kind;
+
+  /* Where the '{' is. */
+  pos_t pos;
+
+  /* See kind_t. */
+  node_list_t<rule_t> rules;
+
+  /* See kind_t. */
+  node_list_t<declaration_t> declarations;
+
+  /* See kind_t. */
+  node_list_t<component_value_t> values;
+
+  /* True if the block was skipped by a lazy parser and hasn't been
+     expanded yet.  Until it is, declarations and rules are empty; see
+     stylesheet_t::expand(). */
+  bool is_deferred;
+
+  /* For a block a lazy parser skipped, the text between the braces;
+     otherwise empty. */
+  std::string_view source;
+
+  /* What the block of the named at-rule holds, ignoring case and any
+     vendor prefix. */
+  static kind_t get_at_rule_kind(std::string_view name);
+
+};  // block_t
+
+/* A qualified rule, such as a style rule, or an at-rule. */
+struct rule_t final {
+
+  /* What we are. */
+  enum kind_t {
+    QUALIFIED,
+    AT,
+  };  // rule_t::kind_t
+
+  /* See kind_t. */
+  kind_t kind;
+
+  /* Where we start. */
+  pos_t pos;
+
+  /* An at-rule's name, without the '@'.  Empty for a qualified rule. */
+  std::string_view name;
+
+  /* Everything before the block, such as a selector list or a media
+     query. */
+  node_list_t<component_value_t> prelude;
+
+  /* See block_t. */
+  block_t block;
+
+};  // rule_t
+
+/* A parsed stylesheet.  Every node and every piece of text in it is
+   allocated from our own arena and freed all at once when we go, so
+   nodes are plain data, pointing at each other, which can be copied
+   freely as long as we're alive. */
+class stylesheet_t final {
+
+public:
+
+  /* Empty, with an arena whose chunks come from upstream. */
+  explicit stylesheet_t(std::pmr::memory_resource *upstream = std::pmr::get_default_resource());
+
+  stylesheet_t(stylesheet_t &&) noexcept = default;
+
+  stylesheet_t &operator=(stylesheet_t &&) noexcept = default;
+
+  /* The top-level rules, in order. */
+  const node_list_t<rule_t> &get_rules() const noexcept;
+
+  /* The errors we recovered from, in order. */
+  const std::vector<parser_error_t> &get_errors() const noexcept;
+
+  /* The arena our nodes come from. */
+  std::pmr::memory_resource *get_arena() const noexcept;
+
+  /* The block, with its declarations and rules parsed if a lazy parser
+     skipped them.  The first call parses the block's source into our
+     arena and records any errors; later calls just return it.  Not safe
+     to call from more than one thread at once.  Lexing errors are
+     thrown, as parser_t throws them. */
+  const block_t &expand(const block_t &block);
+
+private:
+
+  /* Fills us in. */
+  friend class parser_t;
+
+  /* See accessor.  Held by pointer so that moving us doesn't move the
+     nodes. */
+  std::unique_ptr<std::pmr::monotonic_buffer_resource> arena;
+
+  /* The arenas of the stylesheets parsed in parallel and merged into us,
+     which hold most of our nodes. */
+  std::vector<std::unique_ptr<std::pmr::monotonic_buffer_resource>> merged_arenas;
+
+  /* See accessor. */
+  node_list_t<rule_t> rules;
+
+  /* See accessor. */
+  std::vector<parser_error_t> errors;
+
+};  // stylesheet_t
+
+/* Parses source text into a stylesheet as CSS Syntax Level 3 says to.
+   We pull tokens from a lexer one at a time and never hold more than one,
+   so the source text is read once, start to end, and the only memory
+   which grows with it is the stylesheet itself. */
+class parser_t final {
+
+public:
+
+  /* Parse the null-terminated text.  The stylesheet's arena gets its
+     chunks from upstream. */
+  explicit parser_t(const char *src, std::pmr::memory_resource *upstream = std::pmr::get_default_resource());
+
+  /* Parse the bytes from begin up to end; see lexer_t. */
+  parser_t(
+      const char *begin, const char *end, const pos_t &start = pos_t(),
+      std::pmr::memory_resource *upstream = std::pmr::get_default_resource());
+
+  /* Parse the whole text as a stylesheet.  Call at most once.  Lexing
+     errors are thrown, as lexer_t throws them; parsing errors are
+     recovered from and collected on the stylesheet. */
+  stylesheet_t parse_stylesheet();
+
+  /* Parse the whole text as a stylesheet, as above, but in pieces on the
+     pool.  We cut the text between top-level rules, where a
+     structural_index_t says they end, parse the pieces at once, each
+     into an arena of its own, and merge the results in order.  The
+     stylesheet, its positions and its errors are just as the serial
+     parse would make them, and if more than one piece fails to lex, the
+     error thrown is the first piece's.  A text too small to be worth
+     cutting is parsed serially.  Call at most once, and not from one of
+     the pool's tasks. */
+  stylesheet_t parse_stylesheet(thread_pool_t &pool);
+
+  /* If true, the blocks of declarations are skipped rather than parsed:
+     we index the structural characters of the text up front (see
+     structural_index_t), find each closing brace by matching brackets in
+     the index, and keep the text in between for stylesheet_t::expand().
+     Selectors and at-rule preludes are parsed as usual.  Defaults to
+     false. */
+  void set_lazy(bool lazy_);
+
+  /* See set_lazy(). */
+  bool is_lazy() const noexcept;
+
+private:
+
+  /* Expands deferred blocks with us. */
+  friend class stylesheet_t;
+
+  /* Parse the deferred block's source into the target's arena. */
+  parser_t(stylesheet_t &target_, const block_t &block);
+
+  /* Consume the declarations of the block we were made for. */
+  void consume_deferred(block_t &block);
+
+  /* Consume rules until the end of the text or, if we're in a block, the
+     '}' which closes it. */
+  node_list_t<rule_t> consume_rule_list(bool is_top_level);
+
+  /* Consume the at-rule whose at-keyword is the current token. */
+  void consume_at_rule(rule_t &rule);
+
+  /* Consume a qualified rule.  Returns false if there wasn't one. */
+  bool consume_qualified_rule(rule_t &rule);
+
+  /* Consume the '{' which is the current token, what's in the block as
+     the kind says, and the '}'. */
+  void consume_block(block_t::kind_t kind, block_t &block);
+
+  /* Skip the block whose '{' is the current token, keeping its text,
+     and move on past its '}'. */
+  void defer_block(block_t &block);
+
+  /* The '}' which closes the '{' at open, or the end of the text if
+     there isn't one, found in the index.  Null if the index doesn't have
+     a '{' at open, which it always should. */
+  const char *find_in_index(const char *open);
+
+  /* Consume declarations and at-rules until the '}' which closes the
+     block. */
+  void consume_declaration_list(block_t &block);
+
+  /* Consume the declaration whose name is the current token.  Returns
+     false if it isn't one. */
+  bool consume_declaration(declaration_t &declaration);
+
+  /* Consume component values up to the next ';' at this level, or the
+     end of the block, and drop them. */
+  void skip_to_semicolon();
+
+  /* Consume the current token as a component value and push it. */
+  void push_component_value();
+
+  /* Consume the current token as a component value. */
+  void consume_component_value(component_value_t &value);
+
+  /* Consume the contents of the simple block or function the current
+     token opens, and its ending token. */
+  void consume_nested(token_t::kind_t ending, component_value_t &value);
+
+  /* Copy the token into the value, with the text cut to length. */
+  void set_token(const token_t &token, component_value_t &value, size_t prefix_size, size_t suffix_size);
+
+  /* True at the end of the text or, if we're in a block, at the '}' which
+     closes it. */
+  bool is_at_end() const;
+
+  /* True if the current token is of the kind. */
+  bool is_at(token_t::kind_t kind) const;
+
+  /* Move on to the next token. */
+  void advance();
+
+  /* Record an error at the current token, or at the end. */
+  void add_error(parser_error_t::code_t code, const char *detail);
+
+  /* Copy the nodes on the stack from mark up into the arena and pop
+     them. */
+  template <typename node_t>
+  node_list_t<node_t> finish(std::vector<node_t> &stack, size_t mark);
+
+  /* Copy the text into the arena. */
+  std::string_view copy(std::string_view text);
+
+  /* Tokens come from here and are given back as soon as we're done with
+     them. */
+  std::pmr::unsynchronized_pool_resource scratch;
+
+  /* Where the tokens come from. */
+  lexer_t lexer;
+
+  /* The end of the source text. */
+  const char *end;
+
+  /* See accessor. */
+  bool lazy;
+
+  /* The structural characters of the text, if we're lazy. */
+  std::optional<structural_index_t> index;
+
+  /* The index in the index of the first structural character we haven't
+     passed. */
+  size_t next_structural;
+
+  /* The closing brackets a skipped block is waiting for, innermost last,
+     if we have to find its end without the index.  Kept here so that
+     allocates only when the nesting gets deeper than it's been before. */
+  std::string closers;
+
+  /* The current token, or null at the end of the text. */
+  std::shared_ptr<token_t> current;
+
+  /* The number of {}-blocks we're in. */
+  size_t block_depth;
+
+  /* Nodes we've made but don't yet know how many of there'll be in their
+     list.  Each list is pushed here, node by node, then copied into the
+     arena whole, so after the first few rules nothing is allocated but
+     the nodes themselves. */
+  std::vector<component_value_t> value_stack;
+
+  /* See value_stack. */
+  std::vector<declaration_t> declaration_stack;
+
+  /* See value_stack. */
+  std::vector<rule_t> rule_stack;
+
+  /* What parse_stylesheet() builds. */
+  stylesheet_t sheet;
+
+  /* Where our nodes and errors go: our own sheet, or the one whose
+     block we're expanding. */
+  stylesheet_t *target;
+
+};  // parser_t
+
+}  // yourcss
@@ -2,23 +2,15 @@
 
 namespace yourcss {
 
-pos_t::pos_t() noexcept: line_number(1), col_number(1) {}
-
 void pos_t::next_col() {
   ++col_number;
+  ++offset;
 }
 
 void pos_t::next_line() {
   ++line_number;
   col_number = 1;
-}
-
-int pos_t::get_line() const {
-  return line_number;
-}
-
-int pos_t::get_col() const {
-  return col_number;
+  ++offset;
 }
 
 std::ostream &operator<<(std::ostream &strm, const pos_t &that) {
@@ -1,28 +1,50 @@
 #pragma once
 
+#include <cstdint>
 #include <ostream>
 
 namespace yourcss {
 
+/* A position in the source text.  Everything is 64-bit so that a single
+   minified line several gigabytes long doesn't overflow. */
 class pos_t final {
 
 public:
 
-  pos_t() noexcept;
+  /* The start of the text: line 1, col 1, offset 0.  Defined here, and
+     constexpr, so positions can be made in constant evaluation. */
+  constexpr pos_t() noexcept: line_number(1), col_number(1), offset(0) {}
+
+  /* Somewhere other than the start, such as the start of a piece of a
+     larger text which is being lexed a piece at a time. */
+  constexpr pos_t(uint64_t line_number_, uint64_t col_number_, uint64_t offset_) noexcept:
+    line_number(line_number_),
+    col_number(col_number_),
+    offset(offset_) {}
 
   void next_col();
 
   void next_line();
 
-  int get_line() const;
+  constexpr uint64_t get_line() const {
+    return line_number;
+  }
+
+  constexpr uint64_t get_col() const {
+    return col_number;
+  }
 
-  int get_col() const;
+  /* The number of bytes from the start of the text.  Slice the source with
+     this rather than re-walking lines and columns. */
+  constexpr uint64_t get_offset() const {
+    return offset;
+  }
 
   friend std::ostream &operator<<(std::ostream &strm, const pos_t &that);
 
 private:
 
-  int line_number, col_number;
+  uint64_t line_number, col_number, offset;
 
 };  // pos_t
 
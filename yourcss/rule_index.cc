@@ -0,0 +1,110 @@
+#include "rule_index.h"
+
+#include <unordered_map>
+
+namespace yourcss {
+
+rule_index_t::rule_index_t(const selector_table_t &table_):
+  table(&table_),
+  universal_count(0),
+  slot_bits(0),
+  bucket_count(0) {
+  const auto &selectors = table->get_selectors();
+  /* Number the keys as we meet them and count each one's selectors, then
+     lay the buckets out end to end and fill them in order. */
+  std::unordered_map<uint32_t, uint32_t> bucket_numbers;
+  std::vector<uint32_t> keys, bucket_of(selectors.size()), counts = {0};
+  for (size_t i = 0; i < selectors.size(); ++i) {
+    auto simple = get_key(*table, selectors[i]);
+    uint32_t bucket = 0;
+    if (simple) {
+      auto key = make_key(simple->kind, simple->name);
+      auto result = bucket_numbers.emplace(key, static_cast<uint32_t>(counts.size()));
+      if (result.second) {
+        keys.push_back(key);
+        counts.push_back(0);
+      }
+      bucket = result.first->second;
+    }
+    bucket_of[i] = bucket;
+    ++counts[bucket];
+  }
+  std::vector<uint32_t> starts(counts.size());
+  for (size_t bucket = 1; bucket < counts.size(); ++bucket) {
+    starts[bucket] = starts[bucket - 1] + counts[bucket - 1];
+  }
+  entries.resize(selectors.size());
+  auto next = starts;
+  for (size_t i = 0; i < selectors.size(); ++i) {
+    entries[next[bucket_of[i]]++] = static_cast<uint32_t>(i);
+  }
+  universal_count = counts[0];
+  bucket_count = keys.size();
+  slot_bits = 1;
+  while ((size_t(1) << slot_bits) < bucket_count * 2) {
+    ++slot_bits;
+  }
+  slots.assign(size_t(1) << slot_bits, slot_t{0, 0, 0});
+  for (size_t bucket = 1; bucket < counts.size(); ++bucket) {
+    auto key = keys[bucket - 1];
+    auto idx = get_home(key);
+    while (slots[idx].key) {
+      idx = (idx + 1) & (slots.size() - 1);
+    }
+    slots[idx] = slot_t{key, starts[bucket], counts[bucket]};
+  }
+}
+
+const selector_table_t &rule_index_t::get_table() const noexcept {
+  return *table;
+}
+
+rule_index_t::bucket_t rule_index_t::find(simple_selector_t::kind_t kind, uint32_t atom) const noexcept {
+  if (atom == atom_table_t::none) {
+    return bucket_t();
+  }
+  auto key = make_key(kind, atom);
+  for (auto idx = get_home(key);; idx = (idx + 1) & (slots.size() - 1)) {
+    const auto &slot = slots[idx];
+    if (slot.key == key) {
+      return bucket_t(entries.data() + slot.first, slot.count);
+    }
+    if (!slot.key) {
+      return bucket_t();
+    }
+  }
+}
+
+rule_index_t::bucket_t rule_index_t::get_universal() const noexcept {
+  return bucket_t(entries.data(), universal_count);
+}
+
+size_t rule_index_t::get_bucket_count() const noexcept {
+  return bucket_count;
+}
+
+const simple_selector_t *rule_index_t::get_key(const selector_table_t &table, const selector_t &selector) noexcept {
+  /* A compound is sorted ID, CLASS, TAG and then the rest, so its first
+     simple selector is the one to key on, if any is. */
+  const auto &simple = table.get_simple_selectors()[selector.first];
+  switch (simple.kind) {
+    case simple_selector_t::ID:
+    case simple_selector_t::CLASS:
+    case simple_selector_t::TAG: {
+      return &simple;
+    }
+    default: {
+      return nullptr;
+    }
+  }
+}
+
+uint32_t rule_index_t::make_key(simple_selector_t::kind_t kind, uint32_t atom) noexcept {
+  return (atom << 2) | (kind + 1u);
+}
+
+size_t rule_index_t::get_home(uint32_t key) const noexcept {
+  return (key * 0x9e3779b1u) >> (32 - slot_bits);
+}
+
+}  // yourcss
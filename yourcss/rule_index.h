@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "selector.h"
+
+namespace yourcss {
+
+/* The selectors of a selector_table_t, bucketed by the most selective
+   name in their rightmost compound: the ID if there is one, else the
+   first class, else the type.  Those with none of these, such as * or
+   [href], go in the universal bucket.  An element can only match the
+   selectors in the universal bucket and in the buckets of its own ID,
+   classes and type, so those are all a matcher need look at.
+
+   The buckets are laid end to end in one array, in order within each,
+   and found through a flat, open-addressed hash table keyed on the
+   interned name, so a lookup is a multiply and a probe or two.  Built
+   once and never changed, we can be shared by any number of threads. */
+class rule_index_t final {
+
+public:
+
+  /* A bucket: the indices in the table's get_selectors() of its
+     selectors, in order. */
+  class bucket_t final {
+
+  public:
+
+    /* Empty. */
+    constexpr bucket_t() noexcept:
+      first(nullptr),
+      count(0) {}
+
+    /* The count indices starting at first. */
+    constexpr bucket_t(const uint32_t *first_, size_t count_) noexcept:
+      first(first_),
+      count(count_) {}
+
+    const uint32_t *begin() const noexcept {
+      return first;
+    }
+
+    const uint32_t *end() const noexcept {
+      return first + count;
+    }
+
+    size_t size() const noexcept {
+      return count;
+    }
+
+    bool empty() const noexcept {
+      return count == 0;
+    }
+
+  private:
+
+    /* See constructor. */
+    const uint32_t *first;
+
+    /* See constructor. */
+    size_t count;
+
+  };  // rule_index_t::bucket_t
+
+  /* Indexing the table's selectors.  The table must outlive us. */
+  explicit rule_index_t(const selector_table_t &table_);
+
+  rule_index_t(rule_index_t &&) noexcept = default;
+
+  /* The table we index. */
+  const selector_table_t &get_table() const noexcept;
+
+  /* The bucket of the ID, CLASS or TAG whose name is the atom.  Empty if
+     there's no such bucket, or the atom is none. */
+  bucket_t find(simple_selector_t::kind_t kind, uint32_t atom) const noexcept;
+
+  /* The selectors which aren't keyed on a name. */
+  bucket_t get_universal() const noexcept;
+
+  /* The number of buckets, not counting the universal one. */
+  size_t get_bucket_count() const noexcept;
+
+  /* The simple selector the table's selector is bucketed under, or null
+     if it's in the universal bucket. */
+  static const simple_selector_t *get_key(const selector_table_t &table, const selector_t &selector) noexcept;
+
+private:
+
+  /* A slot of the hash table. */
+  struct slot_t final {
+
+    /* The key's atom and kind, as make_key() packs them; 0 if the slot is
+       empty. */
+    uint32_t key;
+
+    /* Where the bucket starts in entries. */
+    uint32_t first;
+
+    /* The number of entries in the bucket. */
+    uint32_t count;
+
+  };  // rule_index_t::slot_t
+
+  /* The key of the slot for the atom and kind.  Never 0. */
+  static uint32_t make_key(simple_selector_t::kind_t kind, uint32_t atom) noexcept;
+
+  /* The slot to start probing at for the key. */
+  size_t get_home(uint32_t key) const noexcept;
+
+  /* See accessor. */
+  const selector_table_t *table;
+
+  /* The buckets, end to end, the universal one first. */
+  std::vector<uint32_t> entries;
+
+  /* The number of entries in the universal bucket. */
+  uint32_t universal_count;
+
+  /* The hash table, a power of two in size and never more than half
+     full. */
+  std::vector<slot_t> slots;
+
+  /* The number of bits of a hash which pick the home slot. */
+  unsigned slot_bits;
+
+  /* See accessor. */
+  size_t bucket_count;
+
+};  // rule_index_t
+
+}  // yourcss
@@ -0,0 +1,618 @@
+#include "selector.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace yourcss {
+
+namespace {
+
+char to_lower(char c) {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+/* True if the text is the given lower-case word, in any case. */
+bool equals_lower(std::string_view text, std::string_view word) {
+  if (text.size() != word.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < text.size(); ++i) {
+    if (to_lower(text[i]) != word[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* True if the lower-case name is one of the names. */
+template <size_t size>
+bool is_one_of(std::string_view name, const std::string_view (&names)[size]) {
+  return std::find(names, names + size, name) != names + size;
+}
+
+/* The pseudo-elements which may be written with one colon, as in CSS 2. */
+constexpr std::string_view legacy_pseudo_element_names[] = {
+  "after", "before", "first-letter", "first-line",
+};
+
+/* The pseudo-classes whose argument is an+b. */
+constexpr std::string_view nth_names[] = {
+  "nth-child", "nth-last-child", "nth-last-of-type", "nth-of-type",
+};
+
+/* The pseudo-classes which match if any selector in their argument does;
+   see simple_selector_t::IS. */
+constexpr std::string_view is_names[] = {
+  "-moz-any", "-webkit-any", "any", "is", "matches", "where",
+};
+
+bool is_token(const component_value_t &value, token_t::kind_t kind) {
+  return value.kind == component_value_t::TOKEN && value.token_kind == kind;
+}
+
+bool is_delim(const component_value_t &value, char c) {
+  return is_token(value, token_t::DELIM_TOKEN) && value.text.size() == 1 && value.text[0] == c;
+}
+
+/* True if cursor is at a token, or a function, of the kind which follows
+   what came before with no whitespace between. */
+bool is_next(const component_value_t *cursor, const component_value_t *end, token_t::kind_t kind) {
+  return cursor != end && !cursor->preceded_by_whitespace && cursor->token_kind == kind
+      && cursor->kind != component_value_t::BLOCK;
+}
+
+/* The combinator the value is, or SAME_COMPOUND if it isn't one. */
+simple_selector_t::relation_t get_combinator(const component_value_t &value) {
+  if (is_delim(value, '>')) {
+    return simple_selector_t::CHILD;
+  }
+  if (is_delim(value, '+')) {
+    return simple_selector_t::NEXT_SIBLING;
+  }
+  if (is_delim(value, '~')) {
+    return simple_selector_t::SUBSEQUENT_SIBLING;
+  }
+  return simple_selector_t::SAME_COMPOUND;
+}
+
+/* True if the at-rule is @keyframes, with or without a vendor prefix. */
+bool is_keyframes(std::string_view name) {
+  if (name.size() > 1 && name[0] == '-' && name[1] != '-') {
+    auto hyphen = name.find('-', 1);
+    if (hyphen != std::string_view::npos) {
+      name.remove_prefix(hyphen + 1);
+    }
+  }
+  return equals_lower(name, "keyframes");
+}
+
+/* Append the values much as they were written, give or take whitespace
+   and comments. */
+void append_text(const node_list_t<component_value_t> &values, std::string &text) {
+  for (const auto &value: values) {
+    if (value.preceded_by_whitespace && !text.empty() && text.back() != '(' && text.back() != '[') {
+      text += ' ';
+    }
+    if (value.kind == component_value_t::FUNCTION) {
+      text += value.text;
+      text += '(';
+      append_text(value.values, text);
+      text += ')';
+      continue;
+    }
+    if (value.kind == component_value_t::BLOCK) {
+      const char *brackets = (value.token_kind == token_t::LEFT_BRACKET_TOKEN)
+          ? "[]" : (value.token_kind == token_t::LEFT_PAREN_TOKEN) ? "()" : "{}";
+      text += brackets[0];
+      append_text(value.values, text);
+      text += brackets[1];
+      continue;
+    }
+    switch (value.token_kind) {
+      case token_t::HASH_TOKEN: {
+        text += '#';
+        text += value.text;
+        break;
+      }
+      case token_t::STRING_TOKEN: {
+        text += '"';
+        text += value.text;
+        text += '"';
+        break;
+      }
+      case token_t::COLON_TOKEN: {
+        text += ':';
+        break;
+      }
+      case token_t::COMMA_TOKEN: {
+        text += ',';
+        break;
+      }
+      default: {
+        text += value.text;
+      }
+    }
+  }
+}
+
+/* Parse the text, which has no whitespace in it, as an+b, odd or even. */
+bool parse_nth(std::string_view text, nth_t &nth) {
+  if (equals_lower(text, "odd")) {
+    nth = nth_t{2, 1};
+    return true;
+  }
+  if (equals_lower(text, "even")) {
+    nth = nth_t{2, 0};
+    return true;
+  }
+  size_t i = 0;
+  /* Read an optional sign and then digits, if there are any, into sign
+     and number.  Returns false if there are more digits than fit. */
+  int32_t sign, number;
+  bool has_digits;
+  auto read = [&] {
+    sign = 1;
+    if (i < text.size() && (text[i] == '+' || text[i] == '-')) {
+      sign = (text[i] == '-') ? -1 : 1;
+      ++i;
+    }
+    number = 0;
+    has_digits = false;
+    for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i) {
+      if (number > 99999999) {
+        return false;
+      }
+      number = number * 10 + (text[i] - '0');
+      has_digits = true;
+    }
+    return true;
+  };
+  if (!read()) {
+    return false;
+  }
+  if (i == text.size() || to_lower(text[i]) != 'n') {
+    nth = nth_t{0, sign * number};
+    return has_digits && i == text.size();
+  }
+  nth.a = sign * (has_digits ? number : 1);
+  ++i;
+  if (i == text.size()) {
+    nth.b = 0;
+    return true;
+  }
+  if (text[i] != '+' && text[i] != '-') {
+    return false;
+  }
+  if (!read()) {
+    return false;
+  }
+  nth.b = sign * number;
+  return has_digits && i == text.size();
+}
+
+}  // namespace
+
+atom_table_t::atom_table_t():
+  arena(std::make_unique<std::pmr::monotonic_buffer_resource>()),
+  texts(1) {
+  atoms.emplace(std::string_view(), none);
+}
+
+uint32_t atom_table_t::intern(std::string_view text) {
+  auto iter = atoms.find(text);
+  if (iter != atoms.end()) {
+    return iter->second;
+  }
+  auto data = static_cast<char *>(arena->allocate(text.size(), 1));
+  std::memcpy(data, text.data(), text.size());
+  std::string_view copy(data, text.size());
+  auto atom = static_cast<uint32_t>(texts.size());
+  texts.push_back(copy);
+  atoms.emplace(copy, atom);
+  return atom;
+}
+
+uint32_t atom_table_t::intern_lower(std::string_view text) {
+  if (std::none_of(text.begin(), text.end(), [](char c) { return c >= 'A' && c <= 'Z'; })) {
+    return intern(text);
+  }
+  std::string lower(text);
+  for (auto &c: lower) {
+    c = to_lower(c);
+  }
+  return intern(lower);
+}
+
+uint32_t atom_table_t::find(std::string_view text) const {
+  auto iter = atoms.find(text);
+  return (iter != atoms.end()) ? iter->second : none;
+}
+
+std::string_view atom_table_t::get_text(uint32_t atom) const noexcept {
+  return texts[atom];
+}
+
+size_t atom_table_t::size() const noexcept {
+  return texts.size();
+}
+
+struct selector_table_t::counts_t final {
+
+  /* Add the packed specificity. */
+  void add(uint32_t specificity) {
+    ids += specificity >> 20;
+    classes += (specificity >> 10) & 1023;
+    types += specificity & 1023;
+  }
+
+  uint32_t ids = 0;
+
+  uint32_t classes = 0;
+
+  uint32_t types = 0;
+
+};  // selector_table_t::counts_t
+
+selector_table_t::selector_table_t() = default;
+
+selector_table_t::selector_table_t(const stylesheet_t &sheet, const group_filter_t &filter) {
+  add_rules(sheet.get_rules(), filter);
+}
+
+void selector_table_t::add_rules(const node_list_t<rule_t> &rules, const group_filter_t &filter) {
+  for (const auto &rule: rules) {
+    if (rule.kind == rule_t::QUALIFIED) {
+      add_rule(rule);
+    } else if (
+        rule.block.kind == block_t::RULES && !is_keyframes(rule.name) &&
+        (!filter || filter(rule))) {
+      add_rules(rule.block.rules, filter);
+    }
+  }
+}
+
+bool selector_table_t::add_rule(const rule_t &rule) {
+  size_t selector_count = selectors.size();
+  size_t argument_count = arguments.size();
+  size_t simple_selector_count = simple_selectors.size();
+  if (compile_list(rule.prelude, rule.pos, &rule, selectors)) {
+    return true;
+  }
+  selectors.resize(selector_count);
+  arguments.resize(argument_count);
+  simple_selectors.resize(simple_selector_count);
+  compound_stack.clear();
+  return false;
+}
+
+const std::vector<selector_t> &selector_table_t::get_selectors() const noexcept {
+  return selectors;
+}
+
+const std::vector<selector_t> &selector_table_t::get_arguments() const noexcept {
+  return arguments;
+}
+
+const std::vector<simple_selector_t> &selector_table_t::get_simple_selectors() const noexcept {
+  return simple_selectors;
+}
+
+const atom_table_t &selector_table_t::get_atoms() const noexcept {
+  return atoms;
+}
+
+const std::vector<parser_error_t> &selector_table_t::get_errors() const noexcept {
+  return errors;
+}
+
+uint32_t selector_table_t::make_specificity(uint32_t ids, uint32_t classes, uint32_t types) noexcept {
+  return (std::min(ids, 1023u) << 20) | (std::min(classes, 1023u) << 10) | std::min(types, 1023u);
+}
+
+bool selector_table_t::compile_list(
+    const node_list_t<component_value_t> &values, const pos_t &pos, const rule_t *rule,
+    std::vector<selector_t> &out) {
+  auto cursor = values.begin(), end = values.end();
+  for (;;) {
+    auto comma = std::find_if(cursor, end, [](const component_value_t &value) {
+      return is_token(value, token_t::COMMA_TOKEN);
+    });
+    if (cursor == comma) {
+      return fail((cursor != end) ? cursor->pos : pos, "expected a selector");
+    }
+    selector_t selector;
+    if (!compile_selector(cursor, comma, !rule, selector)) {
+      return false;
+    }
+    selector.rule = rule;
+    out.push_back(selector);
+    if (comma == end) {
+      return true;
+    }
+    cursor = comma + 1;
+    if (cursor == end) {
+      return fail(comma->pos, "expected a selector after ','");
+    }
+  }
+}
+
+bool selector_table_t::compile_selector(
+    const component_value_t *begin, const component_value_t *end, bool is_argument, selector_t &selector) {
+  size_t mark = compound_stack.size();
+  selector.pseudo_element = atom_table_t::none;
+  counts_t counts;
+  auto relation = simple_selector_t::LAST;
+  for (auto cursor = begin;;) {
+    size_t start = compound_stack.size();
+    auto compound_begin = cursor;
+    while (cursor != end && get_combinator(*cursor) == simple_selector_t::SAME_COMPOUND
+        && (cursor == compound_begin || !cursor->preceded_by_whitespace)) {
+      if (!compile_simple(cursor, end, cursor == compound_begin, is_argument, selector, counts)) {
+        compound_stack.resize(mark);
+        return false;
+      }
+    }
+    if (cursor == compound_begin) {
+      compound_stack.resize(mark);
+      return fail(cursor->pos, "expected a compound selector");
+    }
+    finish_compound(start, relation);
+    if (cursor == end) {
+      break;
+    }
+    relation = get_combinator(*cursor);
+    if (relation == simple_selector_t::SAME_COMPOUND) {
+      relation = simple_selector_t::DESCENDANT;
+    } else if (++cursor == end) {
+      compound_stack.resize(mark);
+      return fail(cursor[-1].pos, "selector ends with a combinator");
+    }
+    if (selector.pseudo_element != atom_table_t::none) {
+      compound_stack.resize(mark);
+      return fail(cursor->pos, "pseudo-element not at the end of the selector");
+    }
+  }
+  /* The compounds are on the stack left to right, each with its last
+     simple selector linked to the one before, so lay them out from the
+     top down. */
+  selector.first = static_cast<uint32_t>(simple_selectors.size());
+  for (size_t top = compound_stack.size(); top > mark;) {
+    size_t start = top - 1;
+    while (start > mark && compound_stack[start - 1].relation == simple_selector_t::SAME_COMPOUND) {
+      --start;
+    }
+    simple_selectors.insert(
+        simple_selectors.end(), compound_stack.begin() + static_cast<std::ptrdiff_t>(start),
+        compound_stack.begin() + static_cast<std::ptrdiff_t>(top));
+    top = start;
+  }
+  compound_stack.resize(mark);
+  selector.count = static_cast<uint32_t>(simple_selectors.size()) - selector.first;
+  selector.specificity = make_specificity(counts.ids, counts.classes, counts.types);
+  return true;
+}
+
+bool selector_table_t::compile_simple(
+    const component_value_t *&cursor, const component_value_t *end, bool is_first, bool is_argument,
+    selector_t &selector, counts_t &counts) {
+  const auto &value = *cursor++;
+  if (selector.pseudo_element != atom_table_t::none && !is_token(value, token_t::COLON_TOKEN)) {
+    return fail(value.pos, "only pseudo-classes may follow a pseudo-element");
+  }
+  simple_selector_t simple{};
+  if (is_token(value, token_t::IDENT_TOKEN) || is_delim(value, '*') || is_delim(value, '|')) {
+    if (!is_first) {
+      return fail(value.pos, "type selector not at the start of a compound");
+    }
+    /* We don't keep namespaces, so ns|name, *|name and |name all select
+       name in any namespace. */
+    const component_value_t *type = &value;
+    bool has_namespace = is_delim(value, '|');
+    if (!has_namespace && cursor != end && !cursor->preceded_by_whitespace && is_delim(*cursor, '|')) {
+      has_namespace = true;
+      ++cursor;
+    }
+    if (has_namespace) {
+      if (!is_next(cursor, end, token_t::IDENT_TOKEN) && !(is_next(cursor, end, token_t::DELIM_TOKEN) && is_delim(*cursor, '*'))) {
+        return fail(value.pos, "expected a type or '*' after the namespace");
+      }
+      type = cursor++;
+    }
+    if (is_delim(*type, '*')) {
+      simple.kind = simple_selector_t::UNIVERSAL;
+    } else {
+      simple.kind = simple_selector_t::TAG;
+      simple.name = atoms.intern_lower(type->text);
+      ++counts.types;
+    }
+  } else if (is_token(value, token_t::HASH_TOKEN) && value.type_flag == token_t::ID) {
+    /* Only a hash whose name could start an identifier is an ID; #12 is
+       not, and fails below. */
+    simple.kind = simple_selector_t::ID;
+    simple.name = atoms.intern(value.text);
+    ++counts.ids;
+  } else if (is_delim(value, '.')) {
+    if (!is_next(cursor, end, token_t::IDENT_TOKEN)) {
+      return fail(value.pos, "expected a class name after '.'");
+    }
+    simple.kind = simple_selector_t::CLASS;
+    simple.name = atoms.intern(cursor->text);
+    ++cursor;
+    ++counts.classes;
+  } else if (value.kind == component_value_t::BLOCK && value.token_kind == token_t::LEFT_BRACKET_TOKEN) {
+    if (!compile_attribute(value, simple)) {
+      return false;
+    }
+    ++counts.classes;
+  } else if (is_token(value, token_t::COLON_TOKEN)) {
+    bool is_element = is_next(cursor, end, token_t::COLON_TOKEN);
+    if (is_element) {
+      ++cursor;
+    }
+    if (!is_next(cursor, end, token_t::IDENT_TOKEN) && !is_next(cursor, end, token_t::FUNCTION_TOKEN)) {
+      return fail(value.pos, "expected a name after ':'");
+    }
+    const auto &pseudo = *cursor++;
+    auto name = atoms.intern_lower(pseudo.text);
+    if (!is_element && pseudo.kind == component_value_t::TOKEN) {
+      is_element = is_one_of(atoms.get_text(name), legacy_pseudo_element_names);
+    }
+    if (is_element) {
+      if (is_argument) {
+        return fail(value.pos, "pseudo-element in the argument of a pseudo-class");
+      }
+      if (selector.pseudo_element != atom_table_t::none) {
+        return fail(value.pos, "more than one pseudo-element");
+      }
+      /* Any argument, as in ::part(name), isn't kept. */
+      selector.pseudo_element = name;
+      ++counts.types;
+      return true;
+    }
+    if (pseudo.kind == component_value_t::FUNCTION) {
+      if (!compile_pseudo_function(pseudo, simple, counts)) {
+        return false;
+      }
+    } else {
+      simple.kind = simple_selector_t::PSEUDO_CLASS;
+      simple.name = name;
+      ++counts.classes;
+    }
+  } else {
+    return fail(value.pos, "unexpected in a selector");
+  }
+  compound_stack.push_back(simple);
+  return true;
+}
+
+bool selector_table_t::compile_attribute(const component_value_t &block, simple_selector_t &simple) {
+  auto cursor = block.values.begin(), end = block.values.end();
+  /* As for types, we drop any namespace. */
+  if (end - cursor >= 3 && (is_token(cursor[0], token_t::IDENT_TOKEN) || is_delim(cursor[0], '*'))
+      && is_delim(cursor[1], '|') && is_token(cursor[2], token_t::IDENT_TOKEN)) {
+    ++cursor;
+  }
+  if (cursor != end && is_delim(*cursor, '|')) {
+    ++cursor;
+  }
+  if (cursor == end || !is_token(*cursor, token_t::IDENT_TOKEN)) {
+    return fail(block.pos, "expected an attribute name");
+  }
+  simple.kind = simple_selector_t::ATTRIBUTE;
+  simple.name = atoms.intern_lower(cursor->text);
+  if (++cursor == end) {
+    simple.match = simple_selector_t::EXISTS;
+    return true;
+  }
+  if (is_delim(*cursor, '=')) {
+    simple.match = simple_selector_t::EQUALS;
+  } else if (is_token(*cursor, token_t::INCLUDE_MATCH_TOKEN)) {
+    simple.match = simple_selector_t::INCLUDES;
+  } else if (is_token(*cursor, token_t::DASH_MATCH_TOKEN)) {
+    simple.match = simple_selector_t::DASH;
+  } else if (is_token(*cursor, token_t::PREFIX_MATCH_TOKEN)) {
+    simple.match = simple_selector_t::PREFIX;
+  } else if (is_token(*cursor, token_t::SUFFIX_MATCH_TOKEN)) {
+    simple.match = simple_selector_t::SUFFIX;
+  } else if (is_token(*cursor, token_t::SUBSTRING_MATCH_TOKEN)) {
+    simple.match = simple_selector_t::SUBSTRING;
+  } else {
+    return fail(cursor->pos, "expected an attribute matcher");
+  }
+  if (++cursor == end || !(is_token(*cursor, token_t::IDENT_TOKEN) || is_token(*cursor, token_t::STRING_TOKEN))) {
+    return fail(block.pos, "expected an attribute value");
+  }
+  auto text = cursor->text;
+  if (++cursor != end && is_token(*cursor, token_t::IDENT_TOKEN)
+      && (equals_lower(cursor->text, "i") || equals_lower(cursor->text, "s"))) {
+    simple.is_case_insensitive = equals_lower(cursor->text, "i");
+    ++cursor;
+  }
+  if (cursor != end) {
+    return fail(cursor->pos, "unexpected in an attribute selector");
+  }
+  simple.value = simple.is_case_insensitive ? atoms.intern_lower(text) : atoms.intern(text);
+  return true;
+}
+
+bool selector_table_t::compile_pseudo_function(
+    const component_value_t &function, simple_selector_t &simple, counts_t &counts) {
+  simple.name = atoms.intern_lower(function.text);
+  auto name = atoms.get_text(simple.name);
+  bool is_not = (name == "not");
+  if (is_not || is_one_of(name, is_names)) {
+    /* The argument's own arguments are added to the table as they're
+       compiled, so hold on to its selectors until it's done. */
+    std::vector<selector_t> list;
+    if (!compile_list(function.values, function.pos, nullptr, list)) {
+      return false;
+    }
+    simple.kind = is_not ? simple_selector_t::NOT : simple_selector_t::IS;
+    simple.arguments = selector_range_t{static_cast<uint32_t>(arguments.size()), static_cast<uint32_t>(list.size())};
+    arguments.insert(arguments.end(), list.begin(), list.end());
+    /* They count as their most specific argument, except for :where(),
+       which doesn't count at all. */
+    if (name != "where") {
+      uint32_t specificity = 0;
+      for (const auto &selector: list) {
+        specificity = std::max(specificity, selector.specificity);
+      }
+      counts.add(specificity);
+    }
+    return true;
+  }
+  ++counts.classes;
+  if (is_one_of(name, nth_names)) {
+    std::string text;
+    for (const auto &value: function.values) {
+      if (value.kind != component_value_t::TOKEN || (is_token(value, token_t::IDENT_TOKEN) && equals_lower(value.text, "of"))) {
+        return fail(value.pos, "only an+b is supported as the argument of an :nth-*()");
+      }
+      text += value.text;
+    }
+    if (!parse_nth(text, simple.nth)) {
+      return fail(function.pos, "expected an+b");
+    }
+    simple.kind = simple_selector_t::NTH;
+    return true;
+  }
+  std::string text;
+  append_text(function.values, text);
+  simple.kind = simple_selector_t::PSEUDO_CLASS;
+  simple.value = atoms.intern(text);
+  return true;
+}
+
+void selector_table_t::finish_compound(size_t start, simple_selector_t::relation_t relation) {
+  auto first = compound_stack.begin() + static_cast<std::ptrdiff_t>(start);
+  if (first == compound_stack.end()) {
+    /* Just a pseudo-element, which is as if there were a '*'. */
+    simple_selector_t simple{};
+    simple.kind = simple_selector_t::UNIVERSAL;
+    compound_stack.push_back(simple);
+    first = compound_stack.begin() + static_cast<std::ptrdiff_t>(start);
+  } else if (compound_stack.end() - first > 1) {
+    /* A '*' with anything else matches nothing the rest doesn't. */
+    compound_stack.erase(
+        std::remove_if(first, compound_stack.end(), [](const simple_selector_t &simple) {
+          return simple.kind == simple_selector_t::UNIVERSAL;
+        }),
+        compound_stack.end());
+    first = compound_stack.begin() + static_cast<std::ptrdiff_t>(start);
+  }
+  std::stable_sort(first, compound_stack.end(), [](const simple_selector_t &a, const simple_selector_t &b) {
+    return a.kind < b.kind;
+  });
+  for (auto iter = first; iter != compound_stack.end(); ++iter) {
+    iter->relation = simple_selector_t::SAME_COMPOUND;
+  }
+  compound_stack.back().relation = relation;
+}
+
+bool selector_table_t::fail(const pos_t &pos, const char *detail) {
+  errors.emplace_back(pos, parser_error_t::BAD_SELECTOR, detail);
+  return false;
+}
+
+}  // yourcss
@@ -0,0 +1,333 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "parser.h"
+#include "pos.h"
+
+namespace yourcss {
+
+/* Interns names, handing out a small number for each distinct one, so
+   that names can be compared, hashed and stored as integers.  Atom 0 is
+   the empty name and stands for "none". */
+class atom_table_t final {
+
+public:
+
+  /* The atom of the empty name. */
+  static constexpr uint32_t none = 0;
+
+  /* Holding only the empty name. */
+  atom_table_t();
+
+  atom_table_t(atom_table_t &&) noexcept = default;
+
+  atom_table_t &operator=(atom_table_t &&) noexcept = default;
+
+  /* The text's atom, interning it if it's new. */
+  uint32_t intern(std::string_view text);
+
+  /* The atom of the text with ASCII letters lowered, interning it if it's
+     new. */
+  uint32_t intern_lower(std::string_view text);
+
+  /* The text's atom, or none if it was never interned.  A name nobody
+     interned can't be in any selector, so a matcher can look up an
+     element's names with this and skip those it doesn't find. */
+  uint32_t find(std::string_view text) const;
+
+  /* The text of the atom. */
+  std::string_view get_text(uint32_t atom) const noexcept;
+
+  /* The number of atoms, the empty name included. */
+  size_t size() const noexcept;
+
+private:
+
+  /* Where the texts live.  Held by pointer so that moving us doesn't move
+     them out from under the map's keys. */
+  std::unique_ptr<std::pmr::monotonic_buffer_resource> arena;
+
+  /* Text to atom. */
+  std::unordered_map<std::string_view, uint32_t> atoms;
+
+  /* Atom to text. */
+  std::vector<std::string_view> texts;
+
+};  // atom_table_t
+
+/* The a and b of an :nth-child(an+b) and the like. */
+struct nth_t final {
+
+  int32_t a;
+
+  int32_t b;
+
+};  // nth_t
+
+/* A run of selectors in a selector_table_t. */
+struct selector_range_t final {
+
+  /* The index of the first. */
+  uint32_t first;
+
+  /* How many there are. */
+  uint32_t count;
+
+};  // selector_range_t
+
+/* One simple selector of a compiled selector; see selector_t. */
+struct simple_selector_t final {
+
+  /* What we are.  The kinds are in the order we test them within a
+     compound, those most likely to rule an element out cheaply first. */
+  enum kind_t: uint8_t {
+
+    /* #name */
+    ID,
+
+    /* .name */
+    CLASS,
+
+    /* A type selector.  The name is lowered. */
+    TAG,
+
+    /* [name], [name=value] and so on; see match_t.  The name is lowered. */
+    ATTRIBUTE,
+
+    /* :name, or :name(value) for a function we keep the argument of as
+       written, such as :lang(en).  The name is lowered. */
+    PSEUDO_CLASS,
+
+    /* :nth-child(an+b), :nth-last-child(), :nth-of-type() or
+       :nth-last-of-type(), in name, with a and b in nth. */
+    NTH,
+
+    /* :not(), with its selector list in arguments. */
+    NOT,
+
+    /* :is(), :where(), :matches() or :any(), with its selector list in
+       arguments. */
+    IS,
+
+    /* '*', which is kept only in a compound which would otherwise be
+       empty. */
+    UNIVERSAL,
+
+  };  // simple_selector_t::kind_t
+
+  /* What follows us. */
+  enum relation_t: uint8_t {
+
+    /* The next simple selector, in the same compound. */
+    SAME_COMPOUND,
+
+    /* We're the last in our compound, and the next compound must match a
+       proper ancestor of the element, its parent, its previous sibling or
+       a previous sibling. */
+    DESCENDANT,
+    CHILD,
+    NEXT_SIBLING,
+    SUBSEQUENT_SIBLING,
+
+    /* We're the last in the selector. */
+    LAST,
+
+  };  // simple_selector_t::relation_t
+
+  /* How an attribute selector compares the value. */
+  enum match_t: uint8_t {
+    EXISTS,
+    EQUALS,
+    INCLUDES,
+    DASH,
+    PREFIX,
+    SUFFIX,
+    SUBSTRING,
+  };  // simple_selector_t::match_t
+
+  /* See kind_t. */
+  kind_t kind;
+
+  /* See relation_t. */
+  relation_t relation;
+
+  /* See match_t.  EXISTS for anything but an attribute selector. */
+  match_t match;
+
+  /* True if an attribute selector had the i flag.  Its value is lowered
+     already, so only the attribute's own value need be. */
+  bool is_case_insensitive;
+
+  /* The name's atom.  Atom none for a UNIVERSAL. */
+  uint32_t name;
+
+  /* The atom of an attribute selector's value, or of a PSEUDO_CLASS's
+     argument; otherwise none. */
+  uint32_t value;
+
+  union {
+
+    /* For an NTH. */
+    nth_t nth;
+
+    /* For a NOT or an IS, its selectors in the table's arguments. */
+    selector_range_t arguments;
+
+  };
+
+};  // simple_selector_t
+
+/* A compiled complex selector.  Its simple selectors lie end to end in
+   the table, compound by compound from right to left, the way a matcher
+   walks them: the first compound is the one the element itself must
+   match, and each compound's last simple selector says how to get from
+   there to the next. */
+struct selector_t final {
+
+  /* The index of our first simple selector. */
+  uint32_t first;
+
+  /* The number of simple selectors. */
+  uint32_t count;
+
+  /* See selector_table_t::make_specificity(). */
+  uint32_t specificity;
+
+  /* The atom of the pseudo-element we select, lowered, or none.  It
+     isn't among our simple selectors; they match the element it belongs
+     to. */
+  uint32_t pseudo_element;
+
+  /* The style rule we came from, or null for a selector in the argument
+     of a :not() or an :is(). */
+  const rule_t *rule;
+
+};  // selector_t
+
+/* The selectors of a stylesheet's style rules, compiled for matching.
+   Every selector, simple selector and name lives in one of a few arrays
+   here, in order, rather than in nodes of their own, so a matcher going
+   through them runs through memory rather than chasing pointers, and
+   compares integers rather than strings.  The nodes of the stylesheet
+   we compiled need outlive us only for selector_t::rule. */
+class selector_table_t final {
+
+public:
+
+  /* Says whether to take the style rules in the block of an at-rule such
+     as @media, @supports or @container, by looking at its name and
+     prelude.  We keep nothing to say which condition a selector was
+     under, so this is where a caller who cares decides. */
+  using group_filter_t = std::function<bool (const rule_t &)>;
+
+  /* Empty. */
+  selector_table_t();
+
+  /* Holding the selectors of the sheet's style rules; see add_rules(). */
+  explicit selector_table_t(const stylesheet_t &sheet, const group_filter_t &filter = nullptr);
+
+  selector_table_t(selector_table_t &&) noexcept = default;
+
+  selector_table_t &operator=(selector_table_t &&) noexcept = default;
+
+  /* Add the selectors of the style rules, in order.  Those in the block
+     of an at-rule such as @media or @supports are added if the filter
+     takes the at-rule, at each level of nesting; with no filter, all of
+     them are, as if every condition held, so @media print's rules apply
+     on screen too.  Those in @keyframes, which select keyframes rather
+     than elements, are always passed over. */
+  void add_rules(const node_list_t<rule_t> &rules, const group_filter_t &filter = nullptr);
+
+  /* Compile the style rule's prelude as a selector list and add its
+     selectors.  Returns false, having added nothing and recorded an
+     error, if it isn't a valid selector list, in which case the rule
+     should be dropped, as CSS says. */
+  bool add_rule(const rule_t &rule);
+
+  /* The selectors of the rules we've added, in order. */
+  const std::vector<selector_t> &get_selectors() const noexcept;
+
+  /* The selectors in the arguments of :not() and :is(). */
+  const std::vector<selector_t> &get_arguments() const noexcept;
+
+  /* The simple selectors of all the above. */
+  const std::vector<simple_selector_t> &get_simple_selectors() const noexcept;
+
+  /* The names in the simple selectors. */
+  const atom_table_t &get_atoms() const noexcept;
+
+  /* Why the rules we dropped were dropped, in order. */
+  const std::vector<parser_error_t> &get_errors() const noexcept;
+
+  /* Specificity packed into one number, so that one selector is more
+     specific than another just when its number is bigger: the number of
+     IDs, then of classes, attributes and pseudo-classes, then of types
+     and pseudo-elements, in 10 bits each, with any count over 1023 taken
+     as 1023. */
+  static uint32_t make_specificity(uint32_t ids, uint32_t classes, uint32_t types) noexcept;
+
+private:
+
+  /* Specificity, unpacked. */
+  struct counts_t;
+
+  /* Compile the comma-separated selectors in the values, which start at
+     pos, and append them to out.  They're from the rule or, if it's
+     null, from an argument. */
+  bool compile_list(
+      const node_list_t<component_value_t> &values, const pos_t &pos, const rule_t *rule,
+      std::vector<selector_t> &out);
+
+  /* Compile the selector in the values from begin to end. */
+  bool compile_selector(
+      const component_value_t *begin, const component_value_t *end, bool is_argument, selector_t &selector);
+
+  /* Compile the simple selector or pseudo-element at cursor, pushing it
+     if it's a simple selector, and move cursor past it. */
+  bool compile_simple(
+      const component_value_t *&cursor, const component_value_t *end, bool is_first, bool is_argument,
+      selector_t &selector, counts_t &counts);
+
+  /* Compile the attribute selector in the []-block. */
+  bool compile_attribute(const component_value_t &block, simple_selector_t &simple);
+
+  /* Compile the functional pseudo-class. */
+  bool compile_pseudo_function(const component_value_t &function, simple_selector_t &simple, counts_t &counts);
+
+  /* Sort the simple selectors on the compound stack from start, and link
+     the last to the compound before by the relation. */
+  void finish_compound(size_t start, simple_selector_t::relation_t relation);
+
+  /* Record why we're dropping the rule, and return false. */
+  bool fail(const pos_t &pos, const char *detail);
+
+  /* See accessor. */
+  std::vector<selector_t> selectors;
+
+  /* See accessor. */
+  std::vector<selector_t> arguments;
+
+  /* See accessor. */
+  std::vector<simple_selector_t> simple_selectors;
+
+  /* See accessor. */
+  atom_table_t atoms;
+
+  /* See accessor. */
+  std::vector<parser_error_t> errors;
+
+  /* The simple selectors of the selectors we're compiling, left to right,
+     before they're laid out right to left.  A selector in an argument is
+     compiled on top of the one it's in. */
+  std::vector<simple_selector_t> compound_stack;
+
+};  // selector_table_t
+
+}  // yourcss
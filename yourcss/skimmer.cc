@@ -0,0 +1,210 @@
+#include "skimmer.h"
+
+#include <cstring>
+
+namespace yourcss {
+
+namespace {
+
+/* The characters which could start something we care about: a comment,
+   a string, an escape, an @import or a url(.  Like lexer_t, we take only
+   a lower-case url( as a url token. */
+struct interesting_t final {
+
+  constexpr interesting_t(): table{} {
+    for (unsigned char c: {'/', '"', '\'', '\\', '@', 'u'}) {
+      table[c] = true;
+    }
+  }
+
+  bool table[256];
+
+};  // interesting_t
+
+constexpr interesting_t interesting;
+
+bool is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+bool is_name_point(char c) {
+  return
+      (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+      (c >= '0' && c <= '9') || c == '_' || c == '-' ||
+      static_cast<unsigned char>(c) > 127;
+}
+
+char to_lower(char c) {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+/* True if the text at cursor is the given lower-case word, in any case. */
+bool matches(const char *cursor, const char *limit, const char *word) {
+  for (; *word; ++cursor, ++word) {
+    if (cursor == limit || to_lower(*cursor) != *word) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+skimmer_t::skimmer_t(const char *src):
+  skimmer_t(src, src + std::strlen(src)) {}
+
+skimmer_t::skimmer_t(const char *begin, const char *end):
+  origin(begin),
+  limit(end),
+  counted(begin) {
+  /* Like lexer_t, stop at a null byte. */
+  if (auto nul = static_cast<const char *>(std::memchr(begin, '\0', static_cast<size_t>(end - begin)))) {
+    limit = nul;
+  }
+}
+
+std::vector<reference_t> skimmer_t::skim() {
+  std::vector<reference_t> refs;
+  const char *cursor = origin;
+  while (cursor < limit) {
+    if (!interesting.table[static_cast<unsigned char>(*cursor)]) {
+      ++cursor;
+      continue;
+    }
+    switch (*cursor) {
+      case '/': {
+        cursor = (cursor + 1 < limit && cursor[1] == '*') ? skip_comment(cursor) : cursor + 1;
+        break;
+      }
+      case '"':
+      case '\'': {
+        std::string_view text;
+        cursor = skip_string(cursor, text);
+        break;
+      }
+      case '\\': {
+        cursor = (cursor + 2 < limit) ? cursor + 2 : limit;
+        break;
+      }
+      case '@': {
+        if (!matches(cursor + 1, limit, "import") ||
+            (cursor + 7 < limit && is_name_point(cursor[7]))) {
+          ++cursor;
+          break;
+        }
+        cursor = skip_space(cursor + 7);
+        std::string_view text;
+        if (cursor < limit && (*cursor == '"' || *cursor == '\'')) {
+          cursor = skip_string(cursor, text);
+          add(refs, reference_t::IMPORT, text);
+        } else if (is_url(cursor)) {
+          cursor = skip_url(cursor, text);
+          if (!text.empty()) {
+            add(refs, reference_t::IMPORT, text);
+          }
+        }
+        break;
+      }
+      default: {
+        if (!is_url(cursor)) {
+          ++cursor;
+          break;
+        }
+        std::string_view text;
+        cursor = skip_url(cursor, text);
+        if (!text.empty()) {
+          add(refs, reference_t::URL, text);
+        }
+      }
+    }  // switch
+  }
+  return refs;
+}
+
+const char *skimmer_t::skip_comment(const char *cursor) const {
+  cursor += 2;
+  while (cursor < limit) {
+    auto star = static_cast<const char *>(std::memchr(cursor, '*', static_cast<size_t>(limit - cursor)));
+    if (!star || star + 1 == limit) {
+      return limit;
+    }
+    if (star[1] == '/') {
+      return star + 2;
+    }
+    cursor = star + 1;
+  }
+  return limit;
+}
+
+const char *skimmer_t::skip_string(const char *cursor, std::string_view &text) const {
+  char quote = *cursor++;
+  const char *start = cursor;
+  while (cursor < limit) {
+    char c = *cursor;
+    if (c == quote) {
+      text = std::string_view(start, static_cast<size_t>(cursor - start));
+      return cursor + 1;
+    }
+    if (c == '\n') {
+      /* lexer_t throws here; we take the string as ending. */
+      break;
+    }
+    cursor += (c == '\\' && cursor + 1 < limit) ? 2 : 1;
+  }
+  text = std::string_view(start, static_cast<size_t>(cursor - start));
+  return cursor;
+}
+
+const char *skimmer_t::skip_space(const char *cursor) const {
+  while (cursor < limit) {
+    if (is_space(*cursor)) {
+      ++cursor;
+    } else if (*cursor == '/' && cursor + 1 < limit && cursor[1] == '*') {
+      cursor = skip_comment(cursor);
+    } else {
+      break;
+    }
+  }
+  return cursor;
+}
+
+bool skimmer_t::is_url(const char *cursor) const {
+  return
+      limit - cursor >= 4 && std::memcmp(cursor, "url(", 4) == 0 &&
+      structural_index_t::is_url_open(origin, cursor + 3);
+}
+
+const char *skimmer_t::skip_url(const char *cursor, std::string_view &text) const {
+  const char *end = structural_index_t::skip_url(cursor + 4, limit);
+  auto offset = static_cast<uint64_t>(cursor - origin);
+  try {
+    auto token = lexer_t(cursor, end, pos_t(1, 1, offset)).next();
+    if (token && token->get_kind() == token_t::URL_TOKEN) {
+      text = std::string_view(origin + token->get_pos().get_offset(), token->get_text_view().size());
+    }
+  } catch (const lexer_t::lexer_error_t &) {
+    /* Such as a newline in a quoted url; lexer_t would stop here, and we
+       take it as bad. */
+  }
+  return end;
+}
+
+void skimmer_t::add(std::vector<reference_t> &refs, reference_t::kind_t kind, std::string_view text) {
+  uint64_t line = counted_pos.get_line(), col = counted_pos.get_col();
+  const char *target = text.data();
+  while (counted < target) {
+    auto newline = static_cast<const char *>(std::memchr(counted, '\n', static_cast<size_t>(target - counted)));
+    if (!newline) {
+      col += static_cast<uint64_t>(target - counted);
+      break;
+    }
+    ++line;
+    col = 1;
+    counted = newline + 1;
+  }
+  counted = target;
+  counted_pos = pos_t(line, col, static_cast<uint64_t>(target - origin));
+  refs.push_back(reference_t{kind, text, counted_pos});
+}
+
+}  // yourcss
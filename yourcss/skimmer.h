@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "lexer.h"
+#include "pos.h"
+#include "structural_index.h"
+
+namespace yourcss {
+
+/* A reference to another resource, found by skimmer_t. */
+struct reference_t final {
+
+  /* How the resource is referred to. */
+  enum kind_t {
+
+    /* By url(), quoted or not, anywhere but in an @import. */
+    URL,
+
+    /* By @import, with either a string or url(). */
+    IMPORT,
+
+  };  // reference_t::kind_t
+
+  /* See kind_t. */
+  kind_t kind;
+
+  /* The reference as written, without quotes or url(), and with any
+     escapes left as they are.  A view into the source text. */
+  std::string_view text;
+
+  /* Where the text starts. */
+  pos_t pos;
+
+};  // reference_t
+
+/* Finds the url() and @import references in source text without lexing
+   all of it.  We skip comments and strings, and treat escapes, the way
+   lexer_t does, and pass over everything else a byte at a time, looking
+   only for the few characters which could start something we care about.
+   Where a url( starts, and how far its token runs, we leave to
+   structural_index_t, and what the url refers to, and whether it's bad, we
+   leave to lexer_t, lexing just that one token; so we find exactly the
+   references a full lex would.  Skimming is many times faster than
+   lexing with a filter that keeps only urls, strings and at-keywords. */
+class skimmer_t final {
+
+public:
+
+  /* Skim the null-terminated text. */
+  explicit skimmer_t(const char *src);
+
+  /* Skim the bytes from begin up to end; see lexer_t. */
+  skimmer_t(const char *begin, const char *end);
+
+  /* Every reference in the text, in order. */
+  std::vector<reference_t> skim();
+
+private:
+
+  /* Past the comment starting at cursor. */
+  const char *skip_comment(const char *cursor) const;
+
+  /* Past the string whose opening quote is at cursor, and the contents of
+     the string in text. */
+  const char *skip_string(const char *cursor, std::string_view &text) const;
+
+  /* Past any whitespace and comments. */
+  const char *skip_space(const char *cursor) const;
+
+  /* True if a url token starts at cursor. */
+  bool is_url(const char *cursor) const;
+
+  /* Past the url token starting at cursor, and what it refers to in text,
+     which is left empty for a bad url. */
+  const char *skip_url(const char *cursor, std::string_view &text) const;
+
+  /* Add a reference, working out its position. */
+  void add(std::vector<reference_t> &refs, reference_t::kind_t kind, std::string_view text);
+
+  /* The start of the source text. */
+  const char *origin;
+
+  /* The end of the source text. */
+  const char *limit;
+
+  /* The last place we worked out a position for, and the position.  We
+     count lines from here, so each byte is counted once. */
+  const char *counted;
+
+  /* See counted. */
+  pos_t counted_pos;
+
+};  // skimmer_t
+
+}  // yourcss
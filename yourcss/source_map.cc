@@ -0,0 +1,139 @@
+#include "source_map.h"
+
+#include <stdexcept>
+
+namespace yourcss {
+
+namespace {
+
+/* Write the text as a JSON string, quotes and all. */
+void write_json_string(std::ostream &strm, std::string_view text) {
+  static constexpr char hex[] = "0123456789abcdef";
+  strm << '"';
+  for (char c: text) {
+    auto u = static_cast<unsigned char>(c);
+    switch (c) {
+      case '"': strm << "\\\""; break;
+      case '\\': strm << "\\\\"; break;
+      case '\n': strm << "\\n"; break;
+      case '\r': strm << "\\r"; break;
+      case '\t': strm << "\\t"; break;
+      default: {
+        if (u < 0x20) {
+          strm << "\\u00" << hex[u >> 4] << hex[u & 0xf];
+        } else {
+          strm << c;
+        }
+      }
+    }
+  }
+  strm << '"';
+}
+
+}  // namespace
+
+source_map_writer_t::source_map_writer_t():
+  mapping_count(0),
+  line(0),
+  last_col(0),
+  last_original_line(0),
+  last_original_col(0),
+  last_source(0),
+  line_started(false) {}
+
+uint32_t source_map_writer_t::add_source(std::string_view name) {
+  sources.emplace_back(name);
+  return static_cast<uint32_t>(sources.size() - 1);
+}
+
+void source_map_writer_t::add(uint64_t line_, uint64_t col, const pos_t &original, uint32_t source) {
+  if (line_ < line || (line_ == line && line_started && col < last_col)) {
+    throw std::invalid_argument("source map mappings out of order");
+  }
+  if (line_ > line) {
+    mappings.append(static_cast<size_t>(line_ - line), ';');
+    line = line_;
+    last_col = 0;
+    line_started = false;
+  }
+  /* Lines and columns are 0-based in a source map, 1-based in a pos_t. */
+  uint64_t original_line = original.get_line() - 1;
+  uint64_t original_col = original.get_col() - 1;
+  /* Encode the whole segment, comma and all, then append it in one go. */
+  char segment[1 + 4 * 13];
+  size_t size = 0;
+  if (line_started) {
+    segment[size++] = ',';
+  }
+  size += encode_vlq(segment + size, static_cast<int64_t>(col - last_col));
+  size += encode_vlq(segment + size, static_cast<int64_t>(source) - static_cast<int64_t>(last_source));
+  size += encode_vlq(segment + size, static_cast<int64_t>(original_line - last_original_line));
+  size += encode_vlq(segment + size, static_cast<int64_t>(original_col - last_original_col));
+  mappings.append(segment, size);
+  last_col = col;
+  last_source = source;
+  last_original_line = original_line;
+  last_original_col = original_col;
+  line_started = true;
+  ++mapping_count;
+}
+
+std::string_view source_map_writer_t::get_mappings() const noexcept {
+  return mappings;
+}
+
+uint64_t source_map_writer_t::get_mapping_count() const noexcept {
+  return mapping_count;
+}
+
+void source_map_writer_t::write(std::ostream &strm, std::string_view file) const {
+  strm << "{\"version\":3,";
+  if (!file.empty()) {
+    strm << "\"file\":";
+    write_json_string(strm, file);
+    strm << ',';
+  }
+  strm << "\"sources\":[";
+  for (size_t i = 0; i < sources.size(); ++i) {
+    if (i) {
+      strm << ',';
+    }
+    write_json_string(strm, sources[i]);
+  }
+  /* The mappings are all base64 digits, commas and semicolons, so they
+     need no escaping. */
+  strm << "],\"names\":[],\"mappings\":\"";
+  strm.write(mappings.data(), static_cast<std::streamsize>(mappings.size()));
+  strm << "\"}\n";
+}
+
+void source_map_writer_t::put_vlq(std::string &out, int64_t n) {
+  char encoded[13];
+  out.append(encoded, encode_vlq(encoded, n));
+}
+
+size_t source_map_writer_t::encode_vlq(char *out, int64_t n) noexcept {
+  static constexpr char digits[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  /* The sign goes in the lowest bit of the first digit, then five bits
+     of the magnitude to a digit, lowest first, with the sixth bit set on
+     all but the last.  The first digit has room for four bits, which is
+     all most changes from one token to the next need. */
+  uint64_t magnitude = (n < 0) ? 0 - static_cast<uint64_t>(n) : static_cast<uint64_t>(n);
+  uint64_t digit = ((magnitude & 0xf) << 1) | (n < 0 ? 1 : 0);
+  magnitude >>= 4;
+  size_t size = 0;
+  for (;;) {
+    if (magnitude) {
+      digit |= 0x20;
+    }
+    out[size++] = digits[digit];
+    if (!magnitude) {
+      return size;
+    }
+    digit = magnitude & 0x1f;
+    magnitude >>= 5;
+  }
+}
+
+}  // yourcss
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "pos.h"
+
+namespace yourcss {
+
+/* Builds a version 3 source map as a serializer writes its output.  Tell
+   us where each token lands in the output and where it came from, and
+   we encode the mapping there and then, as base64 VLQs relative to the
+   last one, onto the end of one growing buffer.  Nothing is allocated
+   per mapping beyond that buffer's growth.
+
+   Output positions are 0-based lines and byte columns.  Mappings must be
+   added in output order.  Original positions are pos_ts, and their
+   columns are bytes too, as the lexer counts them; source maps want
+   UTF-16 code units, which is the same thing for ASCII.
+
+     source_map_writer_t map;
+     map.add_source("a.css");
+     minifier_t::minify(src, src + size, out, &map);
+     map.write(map_strm, "a.min.css");
+*/
+class source_map_writer_t final {
+
+public:
+
+  /* No sources, no mappings. */
+  source_map_writer_t();
+
+  /* Add the named source, returning its index. */
+  uint32_t add_source(std::string_view name);
+
+  /* Map the output position to the original one in the source with the
+     index.  Throws std::invalid_argument if the output position comes
+     before the last one mapped. */
+  void add(uint64_t line, uint64_t col, const pos_t &original, uint32_t source = 0);
+
+  /* The mappings so far, ready to go in the map's "mappings". */
+  std::string_view get_mappings() const noexcept;
+
+  /* The number of mappings added. */
+  uint64_t get_mapping_count() const noexcept;
+
+  /* Write the map as JSON, naming the output file it's for, if it has a
+     name. */
+  void write(std::ostream &strm, std::string_view file = std::string_view()) const;
+
+  /* Append the number as a base64 VLQ. */
+  static void put_vlq(std::string &out, int64_t n);
+
+  /* Write the number as a base64 VLQ of at most 13 digits, returning
+     how many. */
+  static size_t encode_vlq(char *out, int64_t n) noexcept;
+
+private:
+
+  /* The names of the sources, in order. */
+  std::vector<std::string> sources;
+
+  /* See accessor. */
+  std::string mappings;
+
+  /* See accessor. */
+  uint64_t mapping_count;
+
+  /* The output line we're on. */
+  uint64_t line;
+
+  /* The fields of the last mapping, which the next is relative to.  The
+     output column is relative to the last on the same line only. */
+  uint64_t last_col, last_original_line, last_original_col;
+
+  uint32_t last_source;
+
+  /* True if a mapping has been added on the current line. */
+  bool line_started;
+
+};  // source_map_writer_t
+
+}  // yourcss
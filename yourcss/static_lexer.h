@@ -0,0 +1,499 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+
+#include "flat_token.h"
+#include "lexer.h"
+#include "pos.h"
+#include "token.h"
+
+namespace yourcss {
+
+/* The tokens lex_static() makes from a string literal.  Each token's text
+   is its exact slice of the source, quotes and all. */
+template <size_t max_token_count>
+class static_token_list_t final {
+
+public:
+
+  /* An empty list over the given source. */
+  constexpr explicit static_token_list_t(const char *src_):
+    src(src_),
+    tokens{},
+    token_count(0) {}
+
+  /* The number of tokens. */
+  constexpr size_t size() const {
+    return token_count;
+  }
+
+  /* The token at the given index. */
+  constexpr const flat_token_t &operator[](size_t idx) const {
+    return tokens[idx];
+  }
+
+  constexpr const flat_token_t *begin() const {
+    return tokens;
+  }
+
+  constexpr const flat_token_t *end() const {
+    return tokens + token_count;
+  }
+
+  /* The source text of one of our tokens. */
+  constexpr std::string_view get_text(const flat_token_t &token) const {
+    return std::string_view(src + token.text_offset, token.text_size);
+  }
+
+  /* Append a token. */
+  constexpr void add(const flat_token_t &token) {
+    tokens[token_count++] = token;
+  }
+
+private:
+
+  /* The source text, which is a string literal so it outlives us. */
+  const char *src;
+
+  /* See accessor. */
+  flat_token_t tokens[max_token_count];
+
+  /* See accessor. */
+  size_t token_count;
+
+};  // static_token_list_t<max_token_count>
+
+/* The subset of the lexer which can run in constant evaluation.  It
+   follows CSS Syntax Level 3 and, like lexer_t, drops comments.  Escapes
+   and unicode ranges aren't supported and raise a lexer_error_t, as does
+   anything malformed; in constant evaluation that is a compile error.
+   Call it through lex_static(). */
+template <size_t max_token_count>
+class static_lexer_t final {
+
+public:
+
+  /* Lex the first size bytes of src. */
+  constexpr static_lexer_t(const char *src_, size_t size_):
+    src(src_),
+    size(size_),
+    idx(0),
+    line_number(1),
+    col_number(1),
+    preceded_by_whitespace(false) {}
+
+  /* Lex everything. */
+  constexpr static_token_list_t<max_token_count> lex() {
+    static_token_list_t<max_token_count> tokens(src);
+    while (idx < size) {
+      size_t start = idx;
+      pos_t start_pos(line_number, col_number, idx);
+      double value = 0;
+      token_t::type_flag_t type_flag = token_t::UNKNOWN;
+      token_t::kind_t kind = lex_one(value, type_flag);
+      if (kind == token_t::COMMENT_TOKEN) {
+        continue;
+      }
+      flat_token_t token{};
+      token.kind = kind;
+      token.type_flag = type_flag;
+      token.preceded_by_whitespace = preceded_by_whitespace;
+      token.pos = start_pos;
+      token.value = value;
+      token.text_offset = static_cast<uint32_t>(start);
+      token.text_size = static_cast<uint32_t>(idx - start);
+      tokens.add(token);
+      preceded_by_whitespace = (kind == token_t::WHITESPACE_TOKEN);
+    }
+    return tokens;
+  }
+
+private:
+
+  /* Past this, any exponent overflows or underflows whatever the digits
+     before it, so we stop counting. */
+  static constexpr size_t max_exponent = 400;
+
+  static constexpr bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+  }
+
+  static constexpr bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+  }
+
+  static constexpr bool is_name_start(char c) {
+    return
+        (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' ||
+        static_cast<unsigned char>(c) > 127;
+  }
+
+  static constexpr bool is_name_point(char c) {
+    return is_name_start(c) || is_digit(c) || c == '-';
+  }
+
+  static constexpr bool is_hex_digit(char c) {
+    return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+  }
+
+  /* The byte count places past the cursor, or null past the end. */
+  constexpr char peek(size_t count = 0) const {
+    return idx + count < size ? src[idx + count] : '\0';
+  }
+
+  /* Advance past one byte. */
+  constexpr void pop() {
+    if (src[idx] == '\n') {
+      ++line_number;
+      col_number = 1;
+    } else {
+      ++col_number;
+    }
+    ++idx;
+  }
+
+  /* Throw a lexer_error_t.  Not constexpr, so reaching it in constant
+     evaluation is a compile error whose trace names the call, and so the
+     detail. */
+  [[noreturn]] void fail(lexer_error_t::code_t code, const char *detail) const {
+    throw lexer_error_t(pos_t(line_number, col_number, idx), idx, code, detail);
+  }
+
+  /* True if the bytes from count past the cursor start an identifier. */
+  constexpr bool starts_ident(size_t count) const {
+    char c = peek(count);
+    if (c == '-') {
+      c = peek(count + 1);
+      return is_name_start(c) || c == '-' || c == '\\';
+    }
+    return is_name_start(c) || c == '\\';
+  }
+
+  /* True if the bytes from the cursor start a number. */
+  constexpr bool starts_number() const {
+    size_t count = (peek() == '+' || peek() == '-') ? 1 : 0;
+    if (is_digit(peek(count))) {
+      return true;
+    }
+    return peek(count) == '.' && is_digit(peek(count + 1));
+  }
+
+  constexpr void consume_name() {
+    for (;;) {
+      char c = peek();
+      if (c == '\\') {
+        fail(lexer_error_t::UNSUPPORTED, "escapes aren't supported in lex_static()");
+      }
+      if (!is_name_point(c)) {
+        break;
+      }
+      pop();
+    }
+  }
+
+  constexpr double consume_digits(double value, size_t &count) {
+    for (count = 0; is_digit(peek()); ++count) {
+      value = value * 10 + (peek() - '0');
+      pop();
+    }
+    return value;
+  }
+
+  /* Ten to the exponent, squaring our way up to it.  Exact up to 1e22,
+     and finite up to 1e308. */
+  static constexpr double power_of_ten(size_t exponent) {
+    double result = 1, power = 10;
+    for (; exponent; exponent >>= 1) {
+      if (exponent & 1) {
+        result *= power;
+      }
+      if (exponent > 1) {
+        power *= power;
+      }
+    }
+    return result;
+  }
+
+  /* The value times, or if negative divided by, ten to the exponent, in
+     as few steps as keep the power finite; one step, exact, for the
+     exponents anyone writes.  Constant evaluation won't overflow to
+     infinity, so we return it ourselves when the result is too big. */
+  static constexpr double scale(double value, size_t exponent, bool negative) {
+    while (value != 0 && exponent) {
+      size_t step = (exponent < 300) ? exponent : 300;
+      double power = power_of_ten(step);
+      if (!negative && value > std::numeric_limits<double>::max() / power) {
+        return std::numeric_limits<double>::infinity();
+      }
+      value = negative ? value / power : value * power;
+      exponent -= step;
+    }
+    return value;
+  }
+
+  constexpr token_t::kind_t lex_numeric(double &value, token_t::type_flag_t &type_flag) {
+    double sign = 1;
+    if (peek() == '+' || peek() == '-') {
+      sign = (peek() == '-') ? -1 : 1;
+      pop();
+    }
+    /* Gather every digit into one whole number, and scale it once at the
+       end, so the value is rounded as few times as we can manage. */
+    size_t count = 0;
+    value = consume_digits(0, count);
+    type_flag = token_t::INTEGER;
+    size_t fraction_count = 0;
+    if (peek() == '.' && is_digit(peek(1))) {
+      pop();
+      value = consume_digits(value, fraction_count);
+      type_flag = token_t::NUMBER;
+    }
+    size_t exponent = 0;
+    bool negative = false;
+    if ((peek() == 'e' || peek() == 'E') &&
+        (is_digit(peek(1)) || ((peek(1) == '+' || peek(1) == '-') && is_digit(peek(2))))) {
+      pop();
+      negative = (peek() == '-');
+      if (peek() == '+' || peek() == '-') {
+        pop();
+      }
+      for (; is_digit(peek()); pop()) {
+        if (exponent < max_exponent) {
+          exponent = exponent * 10 + static_cast<size_t>(peek() - '0');
+        }
+      }
+      if (exponent > max_exponent) {
+        exponent = max_exponent;
+      }
+      type_flag = token_t::NUMBER;
+    }
+    if (negative) {
+      exponent += fraction_count;
+    } else if (exponent >= fraction_count) {
+      exponent -= fraction_count;
+    } else {
+      exponent = fraction_count - exponent;
+      negative = true;
+    }
+    value = scale(value, exponent, negative);
+    value *= sign;
+    if (peek() == '%') {
+      pop();
+      return token_t::PERCENTAGE_TOKEN;
+    }
+    if (starts_ident(0)) {
+      consume_name();
+      return token_t::DIMENSION_TOKEN;
+    }
+    return token_t::NUMBER_TOKEN;
+  }
+
+  constexpr void consume_string(char ending) {
+    pop();
+    for (;;) {
+      char c = peek();
+      if (idx >= size || c == '\n') {
+        fail(lexer_error_t::BAD_STRING, "unterminated string in lex_static()");
+      }
+      if (c == '\\') {
+        fail(lexer_error_t::UNSUPPORTED, "escapes aren't supported in lex_static()");
+      }
+      pop();
+      if (c == ending) {
+        break;
+      }
+    }
+  }
+
+  /* Consume the rest of an unquoted url(, which has been consumed. */
+  constexpr void consume_url() {
+    while (is_space(peek())) {
+      pop();
+    }
+    for (;;) {
+      char c = peek();
+      if (idx >= size) {
+        fail(lexer_error_t::BAD_URL, "unterminated url in lex_static()");
+      }
+      if (c == ')') {
+        pop();
+        break;
+      }
+      if (is_space(c)) {
+        while (is_space(peek())) {
+          pop();
+        }
+        if (peek() != ')') {
+          fail(lexer_error_t::BAD_URL, "whitespace inside url in lex_static()");
+        }
+        continue;
+      }
+      if (c == '"' || c == '\'' || c == '(' || c == '\\') {
+        fail(lexer_error_t::BAD_URL, "unexpected character in url in lex_static()");
+      }
+      pop();
+    }
+  }
+
+  constexpr token_t::kind_t lex_ident_like() {
+    size_t start = idx;
+    consume_name();
+    if (peek() != '(') {
+      return token_t::IDENT_TOKEN;
+    }
+    bool is_url =
+        idx - start == 3 &&
+        (src[start] == 'u' || src[start] == 'U') &&
+        (src[start + 1] == 'r' || src[start + 1] == 'R') &&
+        (src[start + 2] == 'l' || src[start + 2] == 'L');
+    pop();
+    if (is_url) {
+      size_t count = 0;
+      while (is_space(peek(count))) {
+        ++count;
+      }
+      if (peek(count) != '"' && peek(count) != '\'') {
+        consume_url();
+        return token_t::URL_TOKEN;
+      }
+    }
+    return token_t::FUNCTION_TOKEN;
+  }
+
+  /* Consume one token and return its kind.  Comments come back as
+     COMMENT_TOKEN for lex() to drop. */
+  constexpr token_t::kind_t lex_one(double &value, token_t::type_flag_t &type_flag) {
+    char c = peek();
+    if (is_space(c)) {
+      while (is_space(peek())) {
+        pop();
+      }
+      return token_t::WHITESPACE_TOKEN;
+    }
+    if (is_digit(c) || ((c == '+' || c == '-' || c == '.') && starts_number())) {
+      return lex_numeric(value, type_flag);
+    }
+    if ((c == 'u' || c == 'U') && peek(1) == '+' && (is_hex_digit(peek(2)) || peek(2) == '?')) {
+      fail(lexer_error_t::UNSUPPORTED, "unicode ranges aren't supported in lex_static()");
+    }
+    if (c == '\\') {
+      fail(lexer_error_t::UNSUPPORTED, "escapes aren't supported in lex_static()");
+    }
+    if (c == '-' && peek(1) == '-' && peek(2) == '>') {
+      pop();
+      pop();
+      pop();
+      return token_t::CDC_TOKEN;
+    }
+    if (starts_ident(0)) {
+      return lex_ident_like();
+    }
+    if (c == '"' || c == '\'') {
+      consume_string(c);
+      return token_t::STRING_TOKEN;
+    }
+    pop();
+    switch (c) {
+      case '#': {
+        if (!is_name_point(peek())) {
+          return token_t::DELIM_TOKEN;
+        }
+        type_flag = starts_ident(0) ? token_t::ID : token_t::UNRESTRICTED;
+        consume_name();
+        return token_t::HASH_TOKEN;
+      }
+      case '@': {
+        if (!starts_ident(0)) {
+          return token_t::DELIM_TOKEN;
+        }
+        consume_name();
+        return token_t::AT_KEYWORD_TOKEN;
+      }
+      case '/': {
+        if (peek() != '*') {
+          return token_t::DELIM_TOKEN;
+        }
+        pop();
+        while (idx < size && !(peek() == '*' && peek(1) == '/')) {
+          pop();
+        }
+        if (idx < size) {
+          pop();
+          pop();
+        }
+        return token_t::COMMENT_TOKEN;
+      }
+      case '<': {
+        if (peek() == '!' && peek(1) == '-' && peek(2) == '-') {
+          pop();
+          pop();
+          pop();
+          return token_t::CDO_TOKEN;
+        }
+        return token_t::DELIM_TOKEN;
+      }
+      case '~':
+      case '|':
+      case '^':
+      case '$':
+      case '*': {
+        if (c == '|' && peek() == '|') {
+          pop();
+          return token_t::COLUMN_TOKEN;
+        }
+        if (peek() != '=') {
+          return token_t::DELIM_TOKEN;
+        }
+        pop();
+        switch (c) {
+          case '~': return token_t::INCLUDE_MATCH_TOKEN;
+          case '|': return token_t::DASH_MATCH_TOKEN;
+          case '^': return token_t::PREFIX_MATCH_TOKEN;
+          case '$': return token_t::SUFFIX_MATCH_TOKEN;
+          default: return token_t::SUBSTRING_MATCH_TOKEN;
+        }
+      }
+      case '(': return token_t::LEFT_PAREN_TOKEN;
+      case ')': return token_t::RIGHT_PAREN_TOKEN;
+      case '[': return token_t::LEFT_BRACKET_TOKEN;
+      case ']': return token_t::RIGHT_BRACKET_TOKEN;
+      case '{': return token_t::LEFT_BRACE_TOKEN;
+      case '}': return token_t::RIGHT_BRACE_TOKEN;
+      case ',': return token_t::COMMA_TOKEN;
+      case ':': return token_t::COLON_TOKEN;
+      case ';': return token_t::SEMICOLON_TOKEN;
+      default: return token_t::DELIM_TOKEN;
+    }
+  }
+
+  /* The source text. */
+  const char *src;
+
+  /* The number of bytes in the source text. */
+  size_t size;
+
+  /* The offset of our cursor. */
+  size_t idx;
+
+  /* The (line, col) of our cursor. */
+  uint64_t line_number, col_number;
+
+  /* True if the last token we made was whitespace. */
+  bool preceded_by_whitespace;
+
+};  // static_lexer_t<max_token_count>
+
+/* Lex a string literal, in constant evaluation if the result is constexpr:
+
+     constexpr auto tokens = lex_static(R"(a { color: red; })");
+
+   There can't be more tokens than bytes, so the list holds that many. */
+template <size_t size>
+constexpr static_token_list_t<size> lex_static(const char (&src)[size]) {
+  return static_lexer_t<size>(src, size - 1).lex();
+}
+
+}  // yourcss
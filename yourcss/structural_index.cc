@@ -0,0 +1,604 @@
+#include "structural_index.h"
+
+#include <cstring>
+#include <string>
+
+#if !defined(YOURCSS_DISABLE_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#define YOURCSS_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace yourcss {
+
+namespace {
+
+/* What the first stage finds in a block of 64 bytes.  Bit i of each mask
+   is byte i of the block. */
+struct masks_t final {
+  uint64_t backslash, double_quote, single_quote, newline, slash, star, structural, paren, ell;
+};  // masks_t
+
+/* The structural characters. */
+constexpr char structurals[] = {'{', '}', '(', ')', '[', ']', ';', ':', ','};
+
+unsigned count_trailing_zeros(uint64_t bits) {
+#if defined(_MSC_VER)
+  unsigned long idx;
+  _BitScanForward64(&idx, bits);
+  return static_cast<unsigned>(idx);
+#else
+  return static_cast<unsigned>(__builtin_ctzll(bits));
+#endif
+}
+
+/* True if the character can be part of a name, as lexer_t has it. */
+bool is_name_point(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+      c == '-' || c == '_' || static_cast<unsigned char>(c) > 127;
+}
+
+bool is_hex_digit(char c) {
+  return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+/* As isspace() has it in the C locale, which is what lexer_t uses. */
+bool is_space(char c) {
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/* True if the character at is escaped: it comes after an odd run of
+   backslashes, none of them before begin. */
+bool is_escaped_at(const char *begin, const char *at) {
+  const char *run = at;
+  while (run != begin && run[-1] == '\\') {
+    --run;
+  }
+  return ((at - run) & 1) != 0;
+}
+
+/* The bits from first up to and including last. */
+uint64_t get_span(unsigned first, unsigned last) {
+  uint64_t upto = (last == 63) ? ~uint64_t(0) : (uint64_t(1) << (last + 1)) - 1;
+  return upto & (~uint64_t(0) << first);
+}
+
+/* Each bit xored with all those below it, so that a bit is set from one
+   set bit up to the next. */
+uint64_t get_prefix_xor(uint64_t bits) {
+  bits ^= bits << 1;
+  bits ^= bits << 2;
+  bits ^= bits << 4;
+  bits ^= bits << 8;
+  bits ^= bits << 16;
+  bits ^= bits << 32;
+  return bits;
+}
+
+#ifdef YOURCSS_SSE2
+
+/* The 64 bytes of a block, 16 at a time. */
+struct chunks_t final {
+  __m128i chunks[4];
+};  // chunks_t
+
+/* The bits of the bytes for which the comparison is true. */
+template <typename compare_t>
+uint64_t match(const chunks_t &block, const compare_t &compare) {
+  uint64_t bits[4];
+  for (unsigned idx = 0; idx < 4; ++idx) {
+    bits[idx] = static_cast<uint32_t>(_mm_movemask_epi8(compare(block.chunks[idx])));
+  }
+  return bits[0] | (bits[1] << 16) | (bits[2] << 32) | (bits[3] << 48);
+}
+
+/* The bits of the bytes equal to c. */
+uint64_t match(const chunks_t &block, char c) {
+  __m128i needle = _mm_set1_epi8(c);
+  return match(block, [needle](__m128i chunk) {
+    return _mm_cmpeq_epi8(chunk, needle);
+  });
+}
+
+masks_t classify(const char *data) {
+  chunks_t block;
+  for (unsigned idx = 0; idx < 4; ++idx) {
+    block.chunks[idx] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + idx * 16));
+  }
+  masks_t masks;
+  masks.backslash = match(block, '\\');
+  masks.double_quote = match(block, '"');
+  masks.single_quote = match(block, '\'');
+  masks.newline = match(block, '\n');
+  masks.slash = match(block, '/');
+  masks.star = match(block, '*');
+  masks.paren = match(block, '(');
+  masks.ell = match(block, 'l');
+  /* Each pair of structural characters differs in one bit, so five
+     comparisons find all nine: '[' and '{', ']' and '}', '(' and ')',
+     ':' and ';', and ','. */
+  __m128i case_bit = _mm_set1_epi8(0x20), low_bit = _mm_set1_epi8(~1);
+  __m128i open_brace = _mm_set1_epi8('{'), close_brace = _mm_set1_epi8('}');
+  __m128i paren = _mm_set1_epi8('('), colon = _mm_set1_epi8(':'), comma = _mm_set1_epi8(',');
+  masks.structural = match(block, [&](__m128i chunk) {
+    __m128i folded = _mm_or_si128(chunk, case_bit), paired = _mm_and_si128(chunk, low_bit);
+    return _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(folded, open_brace), _mm_cmpeq_epi8(folded, close_brace)),
+        _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(paired, paren), _mm_cmpeq_epi8(paired, colon)),
+            _mm_cmpeq_epi8(chunk, comma)));
+  });
+  return masks;
+}
+
+#else
+
+/* The mask each character sets, as a bit for each member of masks_t. */
+struct classes_t final {
+
+  enum {
+    BACKSLASH = 1 << 0,
+    DOUBLE_QUOTE = 1 << 1,
+    SINGLE_QUOTE = 1 << 2,
+    NEWLINE = 1 << 3,
+    SLASH = 1 << 4,
+    STAR = 1 << 5,
+    STRUCTURAL = 1 << 6,
+    PAREN = 1 << 7,
+    ELL = 1 << 8,
+  };
+
+  constexpr classes_t(): table{} {
+    table[static_cast<unsigned char>('\\')] = BACKSLASH;
+    table[static_cast<unsigned char>('"')] = DOUBLE_QUOTE;
+    table[static_cast<unsigned char>('\'')] = SINGLE_QUOTE;
+    table[static_cast<unsigned char>('\n')] = NEWLINE;
+    table[static_cast<unsigned char>('/')] = SLASH;
+    table[static_cast<unsigned char>('*')] = STAR;
+    for (char c: structurals) {
+      table[static_cast<unsigned char>(c)] = STRUCTURAL;
+    }
+    table[static_cast<unsigned char>('(')] |= PAREN;
+    table[static_cast<unsigned char>('l')] = ELL;
+  }
+
+  uint16_t table[256];
+
+};  // classes_t
+
+constexpr classes_t classes;
+
+masks_t classify(const char *block) {
+  masks_t masks{};
+  for (unsigned idx = 0; idx < 64; ++idx) {
+    unsigned found = classes.table[static_cast<unsigned char>(block[idx])];
+    if (!found) {
+      continue;
+    }
+    uint64_t bit = uint64_t(1) << idx;
+    masks.backslash |= (found & classes_t::BACKSLASH) ? bit : 0;
+    masks.double_quote |= (found & classes_t::DOUBLE_QUOTE) ? bit : 0;
+    masks.single_quote |= (found & classes_t::SINGLE_QUOTE) ? bit : 0;
+    masks.newline |= (found & classes_t::NEWLINE) ? bit : 0;
+    masks.slash |= (found & classes_t::SLASH) ? bit : 0;
+    masks.star |= (found & classes_t::STAR) ? bit : 0;
+    masks.structural |= (found & classes_t::STRUCTURAL) ? bit : 0;
+    masks.paren |= (found & classes_t::PAREN) ? bit : 0;
+    masks.ell |= (found & classes_t::ELL) ? bit : 0;
+  }
+  return masks;
+}
+
+#endif
+
+/* The second stage: what the first stage found, block by block, to the
+   offsets of the structural characters outside strings, comments and
+   urls.  We look at the text itself only at a '(' after an 'l', to see
+   whether it opens a url. */
+class resolver_t final {
+
+public:
+
+  resolver_t(std::vector<uint64_t> &offsets_, const char *begin_, const char *end_):
+    offsets(offsets_),
+    begin(begin_),
+    end(end_),
+    count(0),
+    state(NORMAL),
+    is_escaped(0),
+    is_slash(false),
+    is_star(false),
+    is_ell(false),
+    min_end(0),
+    url_end(0) {}
+
+  /* Take in the next block, which starts at base. */
+  void resolve(const masks_t &masks, uint64_t base) {
+    uint64_t escaped = find_escaped(masks.backslash);
+    uint64_t double_quote = masks.double_quote & ~escaped;
+    uint64_t single_quote = masks.single_quote & ~escaped;
+    uint64_t newline = masks.newline & ~escaped;
+    uint64_t slash = masks.slash & ~escaped;
+    /* A comment opens at a slash followed by a star, and closes at a star
+       followed by a slash, escaped or not. */
+    uint64_t opening = slash & (masks.star >> 1);
+    uint64_t closing = masks.slash & ((masks.star << 1) | (is_star ? 1 : 0));
+    /* A url( ends in l(, and l( is rare enough to check each one. */
+    uint64_t url = masks.paren & ((masks.ell << 1) | (is_ell ? 1 : 0));
+    uint64_t inside = 0;
+    unsigned at = 0;
+    if (state == NORMAL && is_slash && (masks.star & 1)) {
+      /* The slash was the last byte of the block before. */
+      state = COMMENT;
+      inside |= 1;
+      min_end = 2;
+      at = 1;
+    } else if (state != COMMENT && state != URL) {
+      /* Most blocks have no comments and strings with only one kind of
+         quote, if any, and then each quote just flips us in or out of a
+         string, so we can find what's in them all at once. */
+      bool is_single = (state == SINGLE_QUOTE) || (state == NORMAL && !double_quote);
+      uint64_t quote = is_single ? single_quote : double_quote;
+      uint64_t other = is_single ? double_quote : single_quote;
+      uint64_t in = get_prefix_xor(quote) ^ ((state == NORMAL) ? 0 : ~uint64_t(0));
+      if (!((opening | other | url) & ~in) && !(newline & in)) {
+        inside = in | quote;
+        state = !(in >> 63) ? NORMAL : is_single ? SINGLE_QUOTE : DOUBLE_QUOTE;
+        at = 64;
+      }
+    }
+    while (at < 64) {
+      uint64_t ahead = ~uint64_t(0) << at;
+      switch (state) {
+        case NORMAL: {
+          uint64_t events = (double_quote | single_quote | opening | url) & ahead;
+          if (!events) {
+            at = 64;
+            break;
+          }
+          unsigned idx = count_trailing_zeros(events);
+          uint64_t bit = uint64_t(1) << idx;
+          at = idx + 1;
+          if (url & bit) {
+            const char *paren = begin + base + idx;
+            if (structural_index_t::is_url_open(begin, paren)) {
+              inside |= bit;
+              state = URL;
+              url_end = static_cast<uint64_t>(structural_index_t::skip_url(paren + 1, end) - begin);
+            }
+            break;
+          }
+          inside |= bit;
+          if (double_quote & bit) {
+            state = DOUBLE_QUOTE;
+          } else if (single_quote & bit) {
+            state = SINGLE_QUOTE;
+          } else {
+            state = COMMENT;
+            /* The star after the slash doesn't close it. */
+            min_end = static_cast<int>(idx) + 3;
+          }
+          break;
+        }
+        case DOUBLE_QUOTE:
+        case SINGLE_QUOTE: {
+          /* A string ends at its quote or, though lexer_t throws, at a
+             newline. */
+          uint64_t ends = ((state == DOUBLE_QUOTE) ? double_quote : single_quote) | newline;
+          at = end_span(ends & ahead, at, inside);
+          break;
+        }
+        case COMMENT: {
+          uint64_t from = (min_end >= 64) ? 0 : (~uint64_t(0) << min_end);
+          at = end_span(closing & ahead & from, at, inside);
+          break;
+        }
+        case URL: {
+          /* We found where it ends when we found it open. */
+          if (url_end >= base + 64) {
+            inside |= get_span(at, 63);
+            at = 64;
+            break;
+          }
+          auto idx = static_cast<unsigned>(url_end - base);
+          if (idx > at) {
+            inside |= get_span(at, idx - 1);
+          }
+          state = NORMAL;
+          at = idx;
+          break;
+        }
+      }  // switch
+    }
+    min_end = (min_end > 64) ? min_end - 64 : 0;
+    is_star = (masks.star >> 63) != 0;
+    is_ell = (masks.ell >> 63) != 0;
+    is_slash = state == NORMAL && (slash >> 63) && !(inside >> 63);
+    /* Make room for a whole block's worth up front, so that we can write
+       the offsets without checking. */
+    if (offsets.size() - count < 64) {
+      offsets.resize(offsets.size() * 2 + 64);
+    }
+    uint64_t *offset = offsets.data() + count;
+    for (uint64_t found = masks.structural & ~escaped & ~inside; found; found &= found - 1) {
+      *offset++ = base + count_trailing_zeros(found);
+    }
+    count = static_cast<size_t>(offset - offsets.data());
+  }
+
+  /* Drop the room we made but didn't use. */
+  void finish() {
+    offsets.resize(count);
+  }
+
+private:
+
+  /* Where we are at the end of a block. */
+  enum state_t {
+    NORMAL,
+    DOUBLE_QUOTE,
+    SINGLE_QUOTE,
+    COMMENT,
+    URL,
+  };  // state_t
+
+  /* The bits of the characters escaped by a backslash: those after an
+     odd-length run of backslashes.  This is simdjson's trick: adding the
+     starts of the runs on odd bits to the backslashes carries each of
+     them out of its run, which tells us whether the run started on an
+     odd or an even bit. */
+  uint64_t find_escaped(uint64_t backslash) {
+    if (!backslash && !is_escaped) {
+      return 0;
+    }
+    constexpr uint64_t even_bits = 0x5555555555555555;
+    backslash &= ~is_escaped;
+    uint64_t follows_escape = (backslash << 1) | is_escaped;
+    uint64_t odd_starts = backslash & ~even_bits & ~follows_escape;
+    uint64_t sum = odd_starts + backslash;
+    is_escaped = (sum < odd_starts) ? 1 : 0;
+    uint64_t invert = sum << 1;
+    return (even_bits ^ invert) & follows_escape;
+  }
+
+  /* Mark what's inside from at up to the first of the ends, or to the
+     end of the block if there isn't one, and return where to go on
+     from. */
+  unsigned end_span(uint64_t ends, unsigned at, uint64_t &inside) {
+    if (!ends) {
+      inside |= get_span(at, 63);
+      return 64;
+    }
+    unsigned idx = count_trailing_zeros(ends);
+    inside |= get_span(at, idx);
+    state = NORMAL;
+    return idx + 1;
+  }
+
+  /* Where the offsets go. */
+  std::vector<uint64_t> &offsets;
+
+  /* The text, which we look at only to check a url(. */
+  const char *begin, *end;
+
+  /* The number of them we've written. */
+  size_t count;
+
+  /* See state_t. */
+  state_t state;
+
+  /* 1 if the last block ended in an odd run of backslashes. */
+  uint64_t is_escaped;
+
+  /* True if the last block ended in a slash which could open a comment. */
+  bool is_slash;
+
+  /* True if the last block ended in a star which could close one. */
+  bool is_star;
+
+  /* True if the last block ended in an 'l', which could start a url(. */
+  bool is_ell;
+
+  /* The first bit of this block at which a comment may close. */
+  int min_end;
+
+  /* The offset just past the url we're in. */
+  uint64_t url_end;
+
+};  // resolver_t
+
+}  // namespace
+
+structural_index_t::structural_index_t(const char *begin_, const char *end_):
+  begin(begin_),
+  end(end_) {
+  /* Like lexer_t, stop at a null byte. */
+  if (auto nul = static_cast<const char *>(std::memchr(begin, '\0', static_cast<size_t>(end - begin)))) {
+    end = nul;
+  }
+  size_t size = static_cast<size_t>(end - begin);
+  /* Structural characters are seldom more than one byte in four. */
+  offsets.resize(size / 4 + 64);
+  resolver_t resolver(offsets, begin, end);
+  size_t whole = size - size % 64;
+  for (size_t base = 0; base < whole; base += 64) {
+    resolver.resolve(classify(begin + base), base);
+  }
+  if (whole < size) {
+    /* Pad the last block with nulls, which are never anything. */
+    char block[64] = {};
+    std::memcpy(block, begin + whole, size - whole);
+    resolver.resolve(classify(block), whole);
+  }
+  resolver.finish();
+}
+
+const char *structural_index_t::get_begin() const noexcept {
+  return begin;
+}
+
+const char *structural_index_t::get_end() const noexcept {
+  return end;
+}
+
+const std::vector<uint64_t> &structural_index_t::get_offsets() const noexcept {
+  return offsets;
+}
+
+char structural_index_t::at(size_t idx) const noexcept {
+  return begin[offsets[idx]];
+}
+
+size_t structural_index_t::find_closing(size_t idx) const {
+  char opener = at(idx);
+  char closer = (opener == '{') ? '}' : (opener == '[') ? ']' : ')';
+  std::string closers;
+  for (size_t count = offsets.size(); ++idx < count;) {
+    char c = at(idx);
+    switch (c) {
+      case '{': {
+        closers.push_back('}');
+        break;
+      }
+      case '[': {
+        closers.push_back(']');
+        break;
+      }
+      case '(': {
+        closers.push_back(')');
+        break;
+      }
+      case '}':
+      case ']':
+      case ')': {
+        if (closers.empty()) {
+          if (c == closer) {
+            return idx;
+          }
+        } else if (closers.back() == c) {
+          closers.pop_back();
+        }
+        break;
+      }
+      default: {
+        break;
+      }
+    }  // switch
+  }
+  return offsets.size();
+}
+
+std::vector<uint64_t> structural_index_t::find_rule_ends(uint64_t min_gap) const {
+  std::vector<uint64_t> ends;
+  std::string closers;
+  uint64_t last = 0;
+  for (size_t idx = 0, count = offsets.size(); idx < count; ++idx) {
+    char c = at(idx);
+    switch (c) {
+      case '{': {
+        closers.push_back('}');
+        break;
+      }
+      case '[': {
+        closers.push_back(']');
+        break;
+      }
+      case '(': {
+        closers.push_back(')');
+        break;
+      }
+      case '}':
+      case ']':
+      case ')': {
+        /* A closer with nothing to close, even a '}', is just part of the
+           next rule's prelude. */
+        if (closers.empty() || closers.back() != c) {
+          break;
+        }
+        closers.pop_back();
+        uint64_t end = offsets[idx] + 1;
+        if (closers.empty() && c == '}' && end - last >= min_gap) {
+          ends.push_back(end);
+          last = end;
+        }
+        break;
+      }
+      default: {
+        break;
+      }
+    }  // switch
+  }
+  return ends;
+}
+
+bool structural_index_t::is_url_open(const char *begin, const char *paren) noexcept {
+  if (paren - begin < 3 || paren[-3] != 'u' || paren[-2] != 'r' || paren[-1] != 'l') {
+    return false;
+  }
+  const char *name = paren - 3;
+  if (name == begin) {
+    return true;
+  }
+  char c = name[-1];
+  if (c == '-') {
+    /* Part of a longer name, unless it ends a <!--. */
+    return name - begin >= 4 && std::memcmp(name - 4, "<!--", 4) == 0 && !is_escaped_at(begin, name - 4);
+  }
+  if (is_name_point(c) || c == '\\' || c == '#' || c == '@' || is_escaped_at(begin, name - 1)) {
+    /* Part of a longer name, escapes included, or the name of a hash or
+       an at-keyword. */
+    return false;
+  }
+  if (is_space(c)) {
+    /* Unless the space ends a hex escape, and so is part of the name. */
+    const char *digits = name - 1;
+    while (digits != begin && is_hex_digit(digits[-1]) && name - 1 - digits < 6) {
+      --digits;
+    }
+    return digits == name - 1 || digits == begin || digits[-1] != '\\' || !is_escaped_at(begin, digits);
+  }
+  return true;
+}
+
+const char *structural_index_t::skip_url(const char *cursor, const char *end) noexcept {
+  while (cursor != end && is_space(*cursor)) {
+    ++cursor;
+  }
+  if (cursor != end && (*cursor == '"' || *cursor == '\'')) {
+    /* The string ends as any string does, at its quote or a newline. */
+    char quote = *cursor;
+    while (++cursor != end && *cursor != quote && *cursor != '\n' && *cursor != '\0') {
+      if (*cursor == '\\' && cursor + 1 != end) {
+        ++cursor;
+      }
+    }
+    if (cursor != end && *cursor == quote) {
+      ++cursor;
+    }
+  }
+  /* Then, good or bad, the url ends at the first ')' not escaped.  The
+     hex digits of a longer escape don't matter here. */
+  for (; cursor != end && *cursor != '\0'; ++cursor) {
+    if (*cursor == '\\') {
+      if (++cursor == end) {
+        break;
+      }
+    } else if (*cursor == ')') {
+      return cursor + 1;
+    }
+  }
+  return cursor;
+}
+
+bool structural_index_t::is_vectorized() noexcept {
+#ifdef YOURCSS_SSE2
+  return true;
+#else
+  return false;
+#endif
+}
+
+}  // yourcss
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace yourcss {
+
+/* Where the structural characters of a text are: the brackets, braces and
+   parentheses, semicolons, colons and commas which aren't in a string or
+   a comment and aren't escaped.  Those are all it takes to split a
+   stylesheet into rules and to match brackets, so with this in hand a
+   parser can jump from one to the next instead of lexing what's between.
+
+   We build it in two stages, as simdjson does.  The first classifies the
+   text 64 bytes at a time, with SSE2 where we have it, into bitmasks of
+   quotes, backslashes, comment delimiters and structural characters, and
+   works out which characters are escaped without looking at them one by
+   one.  The second walks only the quotes and comment delimiters, in
+   order, to mask out what's in strings and comments, and keeps the
+   offsets of the structural characters that are left.  A url( which
+   starts a url token is an event there too: everything up to its ')' is
+   part of the token, as it is for lexer_t, so it's masked out whether
+   it's quoted or not, good or bad.  Strings, comments, escapes and urls
+   are taken exactly as lexer_t takes them.  Build with
+   YOURCSS_DISABLE_SIMD (see scalar.cfg) to use the portable first stage
+   everywhere. */
+class structural_index_t final {
+
+public:
+
+  /* Index the bytes from begin up to end or, as for lexer_t, up to a null
+     byte before it. */
+  structural_index_t(const char *begin_, const char *end_);
+
+  /* The start of the text. */
+  const char *get_begin() const noexcept;
+
+  /* The end of the text: end, or the null byte before it. */
+  const char *get_end() const noexcept;
+
+  /* The offsets from begin of the structural characters, in order. */
+  const std::vector<uint64_t> &get_offsets() const noexcept;
+
+  /* The structural character at the idx'th offset. */
+  char at(size_t idx) const noexcept;
+
+  /* The index of the offset of the bracket which closes the '{', '[' or
+     '(' at the idx'th offset, or the number of offsets if it isn't
+     closed.  As in the parser, a bracket of another kind doesn't close
+     it, and one with nothing to close is passed over. */
+  size_t find_closing(size_t idx) const;
+
+  /* The offsets just past each '}' which closes a top-level block, such
+     as a style rule's or an @media's, keeping only those at least
+     min_gap bytes past the last one kept.  A parser at any of these is
+     between top-level rules, so the text can be cut there into pieces
+     which parse on their own. */
+  std::vector<uint64_t> find_rule_ends(uint64_t min_gap) const;
+
+  /* True if the '(' at paren, in the text from begin, is the end of a
+     url( which starts a url token as lexer_t lexes it: the name is
+     exactly "url", and nothing before it makes it part of a longer
+     token. */
+  static bool is_url_open(const char *begin, const char *paren) noexcept;
+
+  /* Just past the url token whose url( ends just before cursor: past its
+     ')', or the end of the text if it isn't closed.  Whitespace, a
+     string and the remnants of a bad url are all part of the token. */
+  static const char *skip_url(const char *cursor, const char *end) noexcept;
+
+  /* True if the first stage is vectorised in this build. */
+  static bool is_vectorized() noexcept;
+
+private:
+
+  /* See accessor. */
+  const char *begin;
+
+  /* See accessor. */
+  const char *end;
+
+  /* See accessor. */
+  std::vector<uint64_t> offsets;
+
+};  // structural_index_t
+
+}  // yourcss
@@ -0,0 +1,131 @@
+#include "thread_pool.h"
+
+namespace yourcss {
+
+thread_pool_t::thread_pool_t(size_t thread_count):
+  next_queue(0),
+  queued_count(0),
+  steal_count(0),
+  unfinished_count(0),
+  is_stopping(false) {
+  if (!thread_count) {
+    thread_count = std::thread::hardware_concurrency();
+    if (!thread_count) {
+      thread_count = 1;
+    }
+  }
+  queues.reserve(thread_count);
+  for (size_t i = 0; i < thread_count; ++i) {
+    queues.push_back(std::make_unique<queue_t>());
+  }
+  threads.reserve(thread_count);
+  for (size_t i = 0; i < thread_count; ++i) {
+    threads.emplace_back(&thread_pool_t::run, this, i);
+  }
+}
+
+thread_pool_t::~thread_pool_t() {
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    all_done.wait(lock, [this] { return unfinished_count == 0; });
+    is_stopping = true;
+  }
+  work_ready.notify_all();
+  for (auto &thread: threads) {
+    thread.join();
+  }
+}
+
+void thread_pool_t::submit(task_t &&task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++unfinished_count;
+  }
+  auto &queue = *queues[next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size()];
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+  }
+  queued_count.fetch_add(1);
+  /* Take the lock so a worker can't miss the signal between checking
+     queued_count and going to sleep. */
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+  }
+  work_ready.notify_one();
+}
+
+void thread_pool_t::wait() {
+  std::exception_ptr first_error;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    all_done.wait(lock, [this] { return unfinished_count == 0; });
+    std::swap(first_error, error);
+  }
+  if (first_error) {
+    std::rethrow_exception(first_error);
+  }
+}
+
+size_t thread_pool_t::get_thread_count() const noexcept {
+  return threads.size();
+}
+
+size_t thread_pool_t::get_steal_count() const noexcept {
+  return steal_count.load(std::memory_order_relaxed);
+}
+
+void thread_pool_t::run(size_t index) {
+  for (;;) {
+    task_t task;
+    if (take(index, task)) {
+      std::exception_ptr task_error;
+      try {
+        task();
+      } catch (...) {
+        task_error = std::current_exception();
+      }
+      task = nullptr;
+      std::lock_guard<std::mutex> lock(mutex);
+      if (task_error && !error) {
+        error = task_error;
+      }
+      if (--unfinished_count == 0) {
+        all_done.notify_all();
+      }
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    work_ready.wait(lock, [this] { return is_stopping || queued_count.load() > 0; });
+    if (is_stopping && queued_count.load() == 0) {
+      return;
+    }
+  }
+}
+
+bool thread_pool_t::take(size_t index, task_t &task) {
+  {
+    auto &own = *queues[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.front());
+      own.tasks.pop_front();
+      queued_count.fetch_sub(1);
+      return true;
+    }
+  }
+  for (size_t i = 1; i < queues.size(); ++i) {
+    auto &other = *queues[(index + i) % queues.size()];
+    std::lock_guard<std::mutex> lock(other.mutex);
+    if (!other.tasks.empty()) {
+      task = std::move(other.tasks.back());
+      other.tasks.pop_back();
+      queued_count.fetch_sub(1);
+      steal_count.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // yourcss
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace yourcss {
+
+/* A fixed set of worker threads, each with a queue of its own, which
+   steal from each other when they run out.
+
+   Tasks are dealt to the queues in turn, in the order they're submitted,
+   and each worker runs its own queue from the front.  So if the biggest
+   tasks are submitted first, they're the first ones started.  A worker
+   with nothing left steals from the back of another worker's queue,
+   where the smallest tasks are, which keeps the stealing cheap and the
+   tail short. */
+class thread_pool_t final {
+
+public:
+
+  /* Something to do. */
+  using task_t = std::function<void ()>;
+
+  /* Start the given number of workers, or one per core if zero. */
+  explicit thread_pool_t(size_t thread_count = 0);
+
+  thread_pool_t(const thread_pool_t &) = delete;
+
+  thread_pool_t &operator=(const thread_pool_t &) = delete;
+
+  /* Waits for every task, then stops the workers. */
+  ~thread_pool_t();
+
+  /* Queue a task.  Safe to call from any thread, including from a task. */
+  void submit(task_t &&task);
+
+  /* Wait until every task submitted so far has finished.  If any task
+     threw, rethrows the first exception.  Don't call this from a task. */
+  void wait();
+
+  /* The number of workers. */
+  size_t get_thread_count() const noexcept;
+
+  /* The number of tasks a worker took from a queue not its own. */
+  size_t get_steal_count() const noexcept;
+
+private:
+
+  /* One worker's tasks. */
+  struct queue_t final {
+
+    /* Guards tasks. */
+    std::mutex mutex;
+
+    /* The tasks, to be run from the front. */
+    std::deque<task_t> tasks;
+
+  };  // thread_pool_t::queue_t
+
+  /* The body of the worker thread. */
+  void run(size_t index);
+
+  /* Take a task from our own queue or, failing that, someone else's. */
+  bool take(size_t index, task_t &task);
+
+  /* One per worker. */
+  std::vector<std::unique_ptr<queue_t>> queues;
+
+  /* The workers. */
+  std::vector<std::thread> threads;
+
+  /* The queue the next task goes to. */
+  std::atomic<size_t> next_queue;
+
+  /* Tasks queued and not yet taken. */
+  std::atomic<size_t> queued_count;
+
+  /* See accessor. */
+  std::atomic<size_t> steal_count;
+
+  /* Guards the rest, and is what idle workers and waiters sleep on. */
+  std::mutex mutex;
+
+  /* Signalled when a task is queued, or when we're stopping. */
+  std::condition_variable work_ready;
+
+  /* Signalled when the last unfinished task finishes. */
+  std::condition_variable all_done;
+
+  /* Tasks submitted and not yet finished. */
+  size_t unfinished_count;
+
+  /* The first exception a task threw, until wait() rethrows it. */
+  std::exception_ptr error;
+
+  /* Set when we're being destroyed. */
+  bool is_stopping;
+
+};  // thread_pool_t
+
+}  // yourcss
@@ -2,24 +2,47 @@
 
 namespace yourcss {
 
-token_t::token_t(token_t::kind_t kind_):
+token_t::token_t(token_t::kind_t kind_, allocator_type alloc):
   kind(kind_),
-  type_flag(type_flag_t::UNKNOWN) {}
+  text(alloc),
+  type_flag(type_flag_t::UNKNOWN),
+  preceded_by_whitespace(false) {}
 
-token_t::token_t(const pos_t &pos_, token_t::kind_t kind_):
+token_t::token_t(const pos_t &pos_, token_t::kind_t kind_, allocator_type alloc):
   pos(pos_),
   kind(kind_),
-  type_flag(type_flag_t::UNKNOWN) {}
+  text(alloc),
+  type_flag(type_flag_t::UNKNOWN),
+  preceded_by_whitespace(false) {}
 
-token_t::token_t(const pos_t &pos_, token_t::kind_t kind_, std::string &&text_):
+token_t::token_t(const pos_t &pos_, token_t::kind_t kind_, std::string &&text_, allocator_type alloc):
   pos(pos_),
   kind(kind_),
-  text(std::move(text_)),
-  type_flag(type_flag_t::UNKNOWN) {}
+  text(text_.data(), text_.size(), alloc),
+  type_flag(type_flag_t::UNKNOWN),
+  preceded_by_whitespace(false) {}
+
+token_t::token_t(const pos_t &pos_, token_t::kind_t kind_, std::pmr::string &&text_, allocator_type alloc):
+  pos(pos_),
+  kind(kind_),
+  text(std::move(text_), alloc),
+  type_flag(type_flag_t::UNKNOWN),
+  preceded_by_whitespace(false) {}
+
+token_t::token_t(const token_t &that, allocator_type alloc):
+  pos(that.pos),
+  kind(that.kind),
+  text(that.text, alloc),
+  type_flag(that.type_flag),
+  preceded_by_whitespace(that.preceded_by_whitespace) {}
 
 token_t::~token_t() = default;
 
 std::string token_t::get_desc(token_t::kind_t kind) {
+  return std::string(get_desc_view(kind));
+}
+
+std::string_view token_t::get_desc_view(token_t::kind_t kind) {
   switch(kind) {
     case IDENT_TOKEN: return "IDENT_TOKEN";
     case FUNCTION_TOKEN: return "FUNCTION_TOKEN";
@@ -69,9 +92,17 @@ token_t::kind_t token_t::get_kind() const {
 }
 
 std::string token_t::get_text() const {
+  return std::string(text.data(), text.size());
+}
+
+std::string_view token_t::get_text_view() const {
   return text;
 }
 
+token_t::allocator_type token_t::get_allocator() const {
+  return text.get_allocator();
+}
+
 std::string token_t::get_name() const {
   return token_t::get_desc(kind);
 }
@@ -86,6 +117,14 @@ std::string token_t::get_type_flag_name() const {
   }
 }
 
+bool token_t::is_preceded_by_whitespace() const {
+  return preceded_by_whitespace;
+}
+
+void token_t::set_preceded_by_whitespace(bool preceded_by_whitespace_) {
+  preceded_by_whitespace = preceded_by_whitespace_;
+}
+
 pos_t token_t::get_pos() const {
   return pos;
 }
@@ -102,10 +141,32 @@ std::shared_ptr<token_t> token_t::make(const pos_t &pos, token_t::kind_t kind, s
   return std::make_shared<token_t>(pos, kind, std::move(text));
 }
 
+std::shared_ptr<token_t> token_t::make(const pos_t &pos, token_t::kind_t kind, allocator_type alloc) {
+  return std::allocate_shared<token_t>(std::pmr::polymorphic_allocator<token_t>(alloc), pos, kind);
+}
+
+std::shared_ptr<token_t> token_t::make(const pos_t &pos, token_t::kind_t kind, std::pmr::string &&text) {
+  std::pmr::polymorphic_allocator<token_t> alloc(text.get_allocator());
+  return std::allocate_shared<token_t>(alloc, pos, kind, std::move(text));
+}
+
+std::pmr::string token_t::concat(std::initializer_list<std::string_view> pieces, allocator_type alloc) {
+  size_t size = 0;
+  for (auto piece: pieces) {
+    size += piece.size();
+  }
+  std::pmr::string result(alloc);
+  result.reserve(size);
+  for (auto piece: pieces) {
+    result.append(piece.data(), piece.size());
+  }
+  return result;
+}
+
 /* Writes a human-readable dump of the token.  This is for debugging
  purposes only. In production, a user never sees tokens directly. */
 std::ostream &operator<<(std::ostream &strm, const token_t &that) {
-  strm << that.pos << "; " << token_t::get_desc(that.kind);
+  strm << that.pos << "; " << token_t::get_desc_view(that.kind);
   if (!that.text.empty()) {
     strm << "; \"" << that.text << '"';
   }
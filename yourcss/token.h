@@ -1,10 +1,15 @@
 #pragma once
 
+#include <cstdint>
+#include <initializer_list>
 #include <ostream>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <map>
 #include <memory>
+#include <memory_resource>
+#include <vector>
 #include "pos.h"
 
 namespace yourcss {
@@ -62,6 +67,14 @@ public:
     COMMENT_TOKEN,
   };  // kind_t
 
+  /* A set of kinds, one bit per kind. */
+  using kind_mask_t = uint64_t;
+
+  /* The mask holding just the given kind. */
+  static constexpr kind_mask_t get_mask(kind_t kind) {
+    return kind_mask_t(1) << kind;
+  }
+
   /* The type flag. */
   enum type_flag_t {
     UNKNOWN,
@@ -71,21 +84,44 @@ public:
     NUMBER,
   };  // type_t
 
+  /* The allocator our text, and any tokens we're made of, come from.  Every
+     constructor takes one last, so polymorphic allocators can construct
+     us in place. */
+  using allocator_type = std::pmr::polymorphic_allocator<char>;
+
   /* Cache the kind. */
-  token_t(kind_t kind);
+  token_t(kind_t kind, allocator_type alloc = {});
 
   /* Cache the position and kind and set the text to the empty string. */
-  token_t(const pos_t &pos, kind_t kind);
+  token_t(const pos_t &pos, kind_t kind, allocator_type alloc = {});
 
   /* Cache the position and kind and the text. */
-  token_t(const pos_t &pos, kind_t kind, std::string &&text);
+  token_t(const pos_t &pos, kind_t kind, std::string &&text, allocator_type alloc = {});
+
+  /* Cache the position and kind and the text.  The text is moved, not
+     copied, if it came from alloc. */
+  token_t(const pos_t &pos, kind_t kind, std::pmr::string &&text, allocator_type alloc = {});
+
+  token_t(const token_t &that) = default;
+
+  /* Copy that token, allocating from alloc. */
+  token_t(const token_t &that, allocator_type alloc);
 
   static std::string get_desc(kind_t kind);
 
+  /* The same as get_desc(), without allocating. */
+  static std::string_view get_desc_view(kind_t kind);
+
   kind_t get_kind() const;
 
   std::string get_text() const;
 
+  /* Our text, without copying it. */
+  std::string_view get_text_view() const;
+
+  /* The allocator our text came from. */
+  allocator_type get_allocator() const;
+
   /* Returns kind as a string */
   std::string get_name() const;
 
@@ -99,16 +135,32 @@ public:
   /* Returns type_flag as a string */
   std::string get_type_flag_name() const;
 
+  /* True if whitespace came between us and the token before us.  This is
+     kept even when the lexer drops whitespace tokens, so whitespace which
+     matters (a descendant combinator, say) can still be recovered. */
+  bool is_preceded_by_whitespace() const;
+
+  void set_preceded_by_whitespace(bool preceded_by_whitespace);
+
   static std::shared_ptr<token_t> make(kind_t kind);
 
   static std::shared_ptr<token_t> make(const pos_t &pos, kind_t kind);
 
   static std::shared_ptr<token_t> make(const pos_t &pos, kind_t kind, std::string &&text);
 
+  /* Make a token allocated from alloc. */
+  static std::shared_ptr<token_t> make(const pos_t &pos, kind_t kind, allocator_type alloc);
+
+  /* Make a token allocated from wherever the text was. */
+  static std::shared_ptr<token_t> make(const pos_t &pos, kind_t kind, std::pmr::string &&text);
+
   virtual ~token_t();
 
 protected:
 
+  /* Join pieces of text into one string allocated from alloc. */
+  static std::pmr::string concat(std::initializer_list<std::string_view> pieces, allocator_type alloc);
+
   /* Writes a human-readable dump of the token. */
   friend std::ostream &operator<<(std::ostream &strm, const token_t &that);
 
@@ -121,11 +173,18 @@ protected:
   kind_t kind;
 
   /* See accessor. */
-  std::string text;
+  std::pmr::string text;
 
   /* See accessor */
   type_flag_t type_flag;
 
+  /* See accessor. */
+  bool preceded_by_whitespace;
+
 };  // token_t
 
+/* The tokens produced by a lexer, allocated from the lexer's memory
+   resource. */
+using token_list_t = std::pmr::vector<std::shared_ptr<token_t>>;
+
 }   // yourcss
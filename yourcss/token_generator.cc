@@ -0,0 +1,23 @@
+#include "token_generator.h"
+
+#if __cplusplus >= 202002L
+
+namespace yourcss {
+
+generator_t<token_ref_t> generate_tokens(lexer_t &lexer) {
+  while (auto token = lexer.next()) {
+    co_yield std::move(token);
+  }
+}
+
+generator_t<token_ref_t> filter_tokens(generator_t<token_ref_t> tokens, token_t::kind_mask_t filter) {
+  for (auto &token: tokens) {
+    if (!(filter & token_t::get_mask(token->get_kind()))) {
+      co_yield token;
+    }
+  }
+}
+
+}  // yourcss
+
+#endif
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <memory>
+#include "lexer.h"
+#include "generator.h"
+#include "token.h"
+
+#if __cplusplus >= 202002L
+
+namespace yourcss {
+
+/* A handle on a token which keeps it alive for as long as the consumer
+   holds on to it. */
+using token_ref_t = std::shared_ptr<token_t>;
+
+/* Drive the lexer a token at a time, as the consumer asks for them.  The
+   lexer must outlive the generator. */
+generator_t<token_ref_t> generate_tokens(lexer_t &lexer);
+
+/* Pass on the tokens whose kinds are not in the mask. */
+generator_t<token_ref_t> filter_tokens(generator_t<token_ref_t> tokens, token_t::kind_mask_t filter);
+
+}  // yourcss
+
+#endif
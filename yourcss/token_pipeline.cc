@@ -0,0 +1,168 @@
+#include "token_pipeline.h"
+
+#include <memory_resource>
+
+namespace yourcss {
+
+namespace {
+
+/* Let the other side run while we wait on it. */
+void wait_for_other_side() {
+  std::this_thread::yield();
+}
+
+size_t round_up_to_power_of_two(size_t n) {
+  size_t result = 1;
+  while (result < n) {
+    result <<= 1;
+  }
+  return result;
+}
+
+}  // namespace
+
+void token_batch_t::clear() {
+  token_count = 0;
+  text.clear();
+  if (text.capacity() < max_text_size) {
+    text.reserve(max_text_size);
+  }
+}
+
+bool token_batch_t::has_room() const {
+  return token_count < max_token_count && text.size() < max_text_size;
+}
+
+void token_batch_t::add(const token_t &token) {
+  flat_token_t &flat = tokens[token_count++];
+  flat.kind = token.get_kind();
+  flat.type_flag = token.get_type_flag();
+  flat.preceded_by_whitespace = token.is_preceded_by_whitespace();
+  flat.pos = token.get_pos();
+  auto token_text = token.get_text_view();
+  flat.value = get_numeric_value(token);
+  flat.text_offset = static_cast<uint32_t>(text.size());
+  flat.text_size = static_cast<uint32_t>(token_text.size());
+  text.append(token_text.data(), token_text.size());
+}
+
+std::string_view token_batch_t::get_text(const flat_token_t &token) const {
+  return std::string_view(text.data() + token.text_offset, token.text_size);
+}
+
+token_ring_t::token_ring_t(size_t capacity):
+  batches(new token_batch_t[round_up_to_power_of_two(capacity)]),
+  mask(round_up_to_power_of_two(capacity) - 1),
+  head(0),
+  tail(0),
+  closed(false),
+  stopped(false) {}
+
+token_batch_t *token_ring_t::acquire_write() {
+  size_t next = tail.load(std::memory_order_relaxed);
+  while (next - head.load(std::memory_order_acquire) > mask) {
+    if (stopped.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    wait_for_other_side();
+  }
+  if (stopped.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+  return &batches[next & mask];
+}
+
+void token_ring_t::publish() {
+  tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void token_ring_t::close() {
+  closed.store(true, std::memory_order_release);
+}
+
+const token_batch_t *token_ring_t::acquire_read() {
+  size_t next = head.load(std::memory_order_relaxed);
+  while (next == tail.load(std::memory_order_acquire)) {
+    if (closed.load(std::memory_order_acquire)) {
+      /* The producer may have published its last batch just before
+         closing. */
+      if (next == tail.load(std::memory_order_acquire)) {
+        return nullptr;
+      }
+      break;
+    }
+    wait_for_other_side();
+  }
+  return &batches[next & mask];
+}
+
+void token_ring_t::release() {
+  head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void token_ring_t::stop() {
+  stopped.store(true, std::memory_order_release);
+}
+
+token_pipeline_t::token_pipeline_t(const char *src, token_t::kind_mask_t filter, size_t ring_capacity):
+  ring(ring_capacity),
+  is_reading(false),
+  producer(&token_pipeline_t::produce, this, src, filter) {}
+
+token_pipeline_t::~token_pipeline_t() {
+  ring.stop();
+  producer.join();
+}
+
+const token_batch_t *token_pipeline_t::next_batch() {
+  if (is_reading) {
+    ring.release();
+    is_reading = false;
+  }
+  auto batch = ring.acquire_read();
+  if (!batch) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    return nullptr;
+  }
+  is_reading = true;
+  return batch;
+}
+
+void token_pipeline_t::produce(const char *src, token_t::kind_mask_t filter) {
+  token_batch_t *batch = nullptr;
+  try {
+    /* Each token lives only until it's flattened, so a pool lets the
+       lexer reuse the same few blocks over and over. */
+    std::pmr::unsynchronized_pool_resource pool;
+    lexer_t lexer(src, &pool);
+    lexer.set_filter(filter);
+    bool done = false;
+    while (!done) {
+      batch = ring.acquire_write();
+      if (!batch) {
+        break;
+      }
+      batch->clear();
+      while (batch->has_room()) {
+        auto token = lexer.next();
+        if (!token) {
+          done = true;
+          break;
+        }
+        batch->add(*token);
+      }
+      ring.publish();
+      batch = nullptr;
+    }
+  } catch (...) {
+    error = std::current_exception();
+    if (batch) {
+      ring.publish();
+    }
+  }
+  ring.close();
+}
+
+}  // yourcss
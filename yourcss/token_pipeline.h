@@ -0,0 +1,155 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include "flat_token.h"
+#include "lexer.h"
+#include "token.h"
+
+namespace yourcss {
+
+/* The size we align shared data to, so that the producer and consumer
+   never write to the same cache line. */
+constexpr size_t cache_line_size = 64;
+
+/* A batch of flat tokens and their text, handed from producer to
+   consumer as a unit. */
+struct alignas(cache_line_size) token_batch_t final {
+
+  /* The most tokens we'll put in a batch. */
+  static constexpr size_t max_token_count = 512;
+
+  /* We stop adding tokens once this much text has piled up.  A single
+     token with more text than this still fits. */
+  static constexpr size_t max_text_size = 16384;
+
+  /* Empty the batch, keeping its storage. */
+  void clear();
+
+  /* True if the batch has room for another token. */
+  bool has_room() const;
+
+  /* Flatten a token and its text into the batch. */
+  void add(const token_t &token);
+
+  /* The text of one of our tokens. */
+  std::string_view get_text(const flat_token_t &token) const;
+
+  /* The number of tokens in use. */
+  size_t token_count = 0;
+
+  /* The tokens. */
+  flat_token_t tokens[max_token_count];
+
+  /* The text of all the tokens, end to end.  Its capacity is kept between
+     uses, so once warmed up a batch allocates nothing. */
+  std::string text;
+
+};  // token_batch_t
+
+/* A bounded single-producer, single-consumer ring of token batches.
+   Each side touches an atomic once per batch, not once per token, and
+   waits when the ring is full (or empty) so the producer can never run
+   more than the ring's capacity ahead. */
+class token_ring_t final {
+
+public:
+
+  /* Make a ring holding at least the given number of batches. */
+  explicit token_ring_t(size_t capacity);
+
+  token_ring_t(const token_ring_t &) = delete;
+
+  token_ring_t &operator=(const token_ring_t &) = delete;
+
+  /* Producer: wait for a free batch and return it.  Return null if the
+     consumer has stopped. */
+  token_batch_t *acquire_write();
+
+  /* Producer: hand the batch from acquire_write() to the consumer. */
+  void publish();
+
+  /* Producer: there will be no more batches. */
+  void close();
+
+  /* Consumer: wait for a published batch and return it.  Return null
+     once the producer has closed the ring and every batch is consumed. */
+  const token_batch_t *acquire_read();
+
+  /* Consumer: give the batch from acquire_read() back to the producer. */
+  void release();
+
+  /* Consumer: we want no more batches; the producer should give up. */
+  void stop();
+
+private:
+
+  /* The batches; the count is a power of two. */
+  std::unique_ptr<token_batch_t[]> batches;
+
+  /* The batch count, less one. */
+  size_t mask;
+
+  /* The number of batches the consumer has released.  Written only by
+     the consumer. */
+  alignas(cache_line_size) std::atomic<size_t> head;
+
+  /* The number of batches the producer has published.  Written only by
+     the producer. */
+  alignas(cache_line_size) std::atomic<size_t> tail;
+
+  /* Set by the producer when it's done and the consumer when it is. */
+  alignas(cache_line_size) std::atomic<bool> closed, stopped;
+
+};  // token_ring_t
+
+/* Lexes source text on a producer thread while the caller consumes the
+   tokens, batch by batch, on its own thread. */
+class token_pipeline_t final {
+
+public:
+
+  /* Start lexing.  The source text must outlive us.  The filter is as for
+     lexer_t::set_filter(). */
+  token_pipeline_t(
+      const char *src,
+      token_t::kind_mask_t filter = token_t::get_mask(token_t::COMMENT_TOKEN),
+      size_t ring_capacity = 8);
+
+  token_pipeline_t(const token_pipeline_t &) = delete;
+
+  token_pipeline_t &operator=(const token_pipeline_t &) = delete;
+
+  /* Stop the producer, if it hasn't finished, and wait for it. */
+  ~token_pipeline_t();
+
+  /* Wait for the next batch of tokens and return it, or return null at the
+     end of the text.  The batch is ours again when this is next called.
+     Rethrows anything the lexer threw. */
+  const token_batch_t *next_batch();
+
+private:
+
+  /* The body of the producer thread. */
+  void produce(const char *src, token_t::kind_mask_t filter);
+
+  /* Hands batches across. */
+  token_ring_t ring;
+
+  /* True if we're holding a batch from the ring. */
+  bool is_reading;
+
+  /* Whatever the producer threw; read only after the ring is closed. */
+  std::exception_ptr error;
+
+  /* Runs produce(). */
+  std::thread producer;
+
+};  // token_pipeline_t
+
+}  // yourcss
@@ -0,0 +1,214 @@
+#include "token_writer.h"
+
+#include <cstring>
+
+namespace yourcss {
+
+token_writer_t::token_writer_t(std::ostream &strm_, format_t format_, size_t buffer_size):
+  strm(strm_),
+  format(format_),
+  buffer(buffer_size < 64 ? 64 : buffer_size),
+  used(0),
+  token_count(0),
+  last_offset(0),
+  last_line(0) {
+  if (format == BINARY) {
+    put(magic);
+  }
+}
+
+token_writer_t::~token_writer_t() {
+  flush();
+}
+
+void token_writer_t::begin_source(std::string_view name) {
+  switch (format) {
+    case TEXT: {
+      put("source \"");
+      put(name);
+      put("\"\n");
+      break;
+    }
+    case NDJSON: {
+      put("{\"source\":\"");
+      put_json_escaped(name);
+      put("\"}\n");
+      break;
+    }
+    case BINARY: {
+      reserve(11);
+      put(static_cast<char>(source_marker));
+      put_varint(name.size());
+      put(name);
+      last_offset = 0;
+      last_line = 0;
+      break;
+    }
+  }
+}
+
+void token_writer_t::write(const token_t &token) {
+  switch (format) {
+    case TEXT: {
+      write_text(token);
+      break;
+    }
+    case NDJSON: {
+      write_ndjson(token);
+      break;
+    }
+    case BINARY: {
+      write_binary(token);
+      break;
+    }
+  }
+  ++token_count;
+}
+
+bool token_writer_t::operator()(const std::shared_ptr<token_t> &token) {
+  write(*token);
+  return true;
+}
+
+void token_writer_t::flush() {
+  drain();
+  strm.flush();
+}
+
+uint64_t token_writer_t::get_token_count() const noexcept {
+  return token_count;
+}
+
+void token_writer_t::write_text(const token_t &token) {
+  pos_t pos = token.get_pos();
+  put("line ");
+  put_decimal(pos.get_line());
+  put(", col ");
+  put_decimal(pos.get_col());
+  put("; ");
+  put(token_t::get_desc_view(token.get_kind()));
+  auto text = token.get_text_view();
+  if (!text.empty()) {
+    put("; \"");
+    put(text);
+    put('"');
+  }
+  put('\n');
+}
+
+void token_writer_t::write_ndjson(const token_t &token) {
+  pos_t pos = token.get_pos();
+  put("{\"line\":");
+  put_decimal(pos.get_line());
+  put(",\"col\":");
+  put_decimal(pos.get_col());
+  put(",\"offset\":");
+  put_decimal(pos.get_offset());
+  put(",\"kind\":\"");
+  put(token_t::get_desc_view(token.get_kind()));
+  put("\",\"text\":\"");
+  put_json_escaped(token.get_text_view());
+  put(token.is_preceded_by_whitespace() ? "\",\"ws\":true}\n" : "\",\"ws\":false}\n");
+}
+
+void token_writer_t::write_binary(const token_t &token) {
+  pos_t pos = token.get_pos();
+  auto text = token.get_text_view();
+  /* One byte of kind, four varints of at most ten bytes each. */
+  reserve(41);
+  unsigned char kind = static_cast<unsigned char>(token.get_kind());
+  if (token.is_preceded_by_whitespace()) {
+    kind |= 0x80;
+  }
+  put(static_cast<char>(kind));
+  put_varint(pos.get_offset() - last_offset);
+  put_varint(pos.get_line() - last_line);
+  put_varint(pos.get_col());
+  put_varint(text.size());
+  put(text);
+  last_offset = pos.get_offset();
+  last_line = pos.get_line();
+}
+
+void token_writer_t::put(const char *data, size_t size) {
+  if (size > buffer.size() - used) {
+    drain();
+    if (size > buffer.size()) {
+      strm.write(data, static_cast<std::streamsize>(size));
+      return;
+    }
+  }
+  std::memcpy(buffer.data() + used, data, size);
+  used += size;
+}
+
+void token_writer_t::put(std::string_view text) {
+  put(text.data(), text.size());
+}
+
+void token_writer_t::put(char c) {
+  reserve(1);
+  buffer[used++] = c;
+}
+
+void token_writer_t::put_decimal(uint64_t n) {
+  char digits[20];
+  char *cursor = digits + sizeof(digits);
+  do {
+    *--cursor = static_cast<char>('0' + n % 10);
+    n /= 10;
+  } while (n);
+  put(cursor, static_cast<size_t>(digits + sizeof(digits) - cursor));
+}
+
+void token_writer_t::put_varint(uint64_t n) {
+  reserve(10);
+  while (n >= 0x80) {
+    buffer[used++] = static_cast<char>((n & 0x7f) | 0x80);
+    n >>= 7;
+  }
+  buffer[used++] = static_cast<char>(n);
+}
+
+void token_writer_t::put_json_escaped(std::string_view text) {
+  static constexpr char hex[] = "0123456789abcdef";
+  const char *run = text.data();
+  const char *end = run + text.size();
+  for (const char *cursor = run; cursor < end; ++cursor) {
+    unsigned char c = static_cast<unsigned char>(*cursor);
+    if (c >= 0x20 && c != '"' && c != '\\') {
+      continue;
+    }
+    /* Copy the run of plain characters before this one in one go. */
+    put(run, static_cast<size_t>(cursor - run));
+    run = cursor + 1;
+    switch (c) {
+      case '"': put("\\\""); break;
+      case '\\': put("\\\\"); break;
+      case '\n': put("\\n"); break;
+      case '\r': put("\\r"); break;
+      case '\t': put("\\t"); break;
+      case '\f': put("\\f"); break;
+      default: {
+        char escape[] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf] };
+        put(escape, sizeof(escape));
+      }
+    }
+  }
+  put(run, static_cast<size_t>(end - run));
+}
+
+void token_writer_t::reserve(size_t size) {
+  if (size > buffer.size() - used) {
+    drain();
+  }
+}
+
+void token_writer_t::drain() {
+  if (used) {
+    strm.write(buffer.data(), static_cast<std::streamsize>(used));
+    used = 0;
+  }
+}
+
+}  // yourcss
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string_view>
+#include <vector>
+#include "token.h"
+
+namespace yourcss {
+
+/* Writes tokens to a stream through a buffer of our own, so a dump of
+   millions of tokens costs a handful of large writes rather than a flush
+   per token.  Nothing is allocated once we're constructed: names come
+   from token_t::get_desc_view(), text from token_t::get_text_view() and
+   numbers are formatted in place.
+
+   We're a visitor, so a lexer can hand its tokens straight to us:
+
+     token_writer_t writer(std::cout, token_writer_t::NDJSON);
+     lexer.lex(writer);
+*/
+class token_writer_t final {
+
+public:
+
+  /* How we write each token. */
+  enum format_t {
+
+    /* One line per token, the same as operator<<. */
+    TEXT,
+
+    /* One JSON object per line:
+
+         {"line":1,"col":1,"offset":0,"kind":"IDENT_TOKEN","text":"a","ws":false}
+
+       The text is escaped as JSON requires and otherwise passed through
+       as it was, so it's UTF-8 if the source was. */
+    NDJSON,
+
+    /* The magic number, then one record per token or source:
+
+         kind         1 byte; the high bit is set if preceded by whitespace
+         offset       varint; the change from the last token's offset
+         line         varint; the change from the last token's line
+         col          varint
+         text length  varint
+         text         bytes
+
+       Varints are unsigned LEB128.  The first token's changes are from
+       offset 0 and line 0.  Every token moves forward through the source,
+       so the changes are never negative.
+
+       A source record is the byte source_marker, the length of the name
+       as a varint and the name.  The changes in the tokens after it start
+       again from offset 0 and line 0. */
+    BINARY,
+
+  };  // format_t
+
+  /* The first bytes of a BINARY dump; the last is the format version. */
+  static constexpr std::string_view magic = std::string_view("YCSSTOK\x01", 8);
+
+  /* The kind byte of a BINARY source record.  No token kind comes near
+     it. */
+  static constexpr unsigned char source_marker = 0x7f;
+
+  /* The buffer size we use unless told otherwise. */
+  static constexpr size_t default_buffer_size = 1 << 16;
+
+  /* Write to the stream in the given format, holding up to buffer_size
+     bytes before writing them. */
+  token_writer_t(std::ostream &strm, format_t format, size_t buffer_size = default_buffer_size);
+
+  token_writer_t(const token_writer_t &) = delete;
+
+  token_writer_t &operator=(const token_writer_t &) = delete;
+
+  /* Flushes. */
+  ~token_writer_t();
+
+  /* Say that the tokens which follow come from the named source, such as
+     a file.  Only needed when writing the tokens of more than one. */
+  void begin_source(std::string_view name);
+
+  /* Write the token. */
+  void write(const token_t &token);
+
+  /* Write the token.  Always returns true, so lexing carries on. */
+  bool operator()(const std::shared_ptr<token_t> &token);
+
+  /* Write whatever's in the buffer, then flush the stream. */
+  void flush();
+
+  /* The number of tokens written so far. */
+  uint64_t get_token_count() const noexcept;
+
+private:
+
+  void write_text(const token_t &token);
+
+  void write_ndjson(const token_t &token);
+
+  void write_binary(const token_t &token);
+
+  /* Append the bytes to the buffer, writing it first if they don't fit.
+     Bytes too many for even an empty buffer go straight to the stream. */
+  void put(const char *data, size_t size);
+
+  void put(std::string_view text);
+
+  void put(char c);
+
+  /* Append the number in decimal. */
+  void put_decimal(uint64_t n);
+
+  /* Append the number as an unsigned LEB128 varint. */
+  void put_varint(uint64_t n);
+
+  /* Append the text as the inside of a JSON string. */
+  void put_json_escaped(std::string_view text);
+
+  /* Make sure there's room for size more bytes. */
+  void reserve(size_t size);
+
+  /* Write the buffer to the stream and empty it. */
+  void drain();
+
+  /* Where we write to. */
+  std::ostream &strm;
+
+  /* See format_t. */
+  format_t format;
+
+  /* Bytes not yet written. */
+  std::vector<char> buffer;
+
+  /* The number of bytes used in buffer. */
+  size_t used;
+
+  /* See accessor. */
+  uint64_t token_count;
+
+  /* The offset and line of the last token written, for BINARY. */
+  uint64_t last_offset, last_line;
+
+};  // token_writer_t
+
+}  // yourcss
@@ -2,10 +2,10 @@
 
 namespace yourcss {
 
-at_keyword_token_t::at_keyword_token_t(const token_t &at_, const token_t &identifier_):
-  token_t(at_.get_pos(), token_t::AT_KEYWORD_TOKEN, at_.get_text() + identifier_.get_text()),
-  at(at_),
-  identifier(identifier_) {}
+at_keyword_token_t::at_keyword_token_t(const token_t &at_, const token_t &identifier_, allocator_type alloc):
+  token_t(at_.get_pos(), token_t::AT_KEYWORD_TOKEN, concat({at_.get_text_view(), identifier_.get_text_view()}, alloc), alloc),
+  at(at_, alloc),
+  identifier(identifier_, alloc) {}
 
 token_t at_keyword_token_t::get_at() {
   return at;
@@ -15,8 +15,9 @@ token_t at_keyword_token_t::get_identifier() {
   return identifier;
 }
 
-std::shared_ptr<at_keyword_token_t> at_keyword_token_t::make(const token_t &at, const token_t &identifier) {
-  return std::make_shared<at_keyword_token_t>(at, identifier);
+std::shared_ptr<at_keyword_token_t> at_keyword_token_t::make(const token_t &at, const token_t &identifier, allocator_type alloc) {
+  std::pmr::polymorphic_allocator<at_keyword_token_t> token_alloc(alloc);
+  return std::allocate_shared<at_keyword_token_t>(token_alloc, at, identifier);
 }
 
 at_keyword_token_t::~at_keyword_token_t() {};
@@ -6,13 +6,13 @@ class at_keyword_token_t: public token_t {
 
 public:
 
-  at_keyword_token_t(const token_t &at_, const token_t &identifier_);
+  at_keyword_token_t(const token_t &at_, const token_t &identifier_, allocator_type alloc = {});
 
   token_t get_at();
 
   token_t get_identifier();
 
-  static std::shared_ptr<at_keyword_token_t> make(const token_t &at, const token_t &identifier);
+  static std::shared_ptr<at_keyword_token_t> make(const token_t &at, const token_t &identifier, allocator_type alloc = {});
 
   virtual ~at_keyword_token_t();
 
@@ -2,10 +2,11 @@
 
 namespace yourcss {
 
-dimension_token_t::dimension_token_t(const token_t &number_, const token_t &identifier_):
-  token_t(number_.get_pos(), token_t::DIMENSION_TOKEN, number_.get_text() + identifier_.get_text()),
-  number(number_),
-  identifier(identifier_) {}
+dimension_token_t::dimension_token_t(const number_token_t &number_, const token_t &identifier_, allocator_type alloc):
+  token_t(number_.get_pos(), token_t::DIMENSION_TOKEN, concat({number_.get_text_view(), identifier_.get_text_view()}, alloc), alloc),
+  number(number_, alloc),
+  identifier(identifier_, alloc),
+  value(number_.get_value()) {}
 
 token_t dimension_token_t::get_number() {
   return number;
@@ -15,8 +16,13 @@ token_t dimension_token_t::get_identifier() {
   return identifier;
 }
 
-std::shared_ptr<dimension_token_t> dimension_token_t::make(const token_t &number, const token_t &identifier) {
-  return std::make_shared<dimension_token_t>(number, identifier);
+double dimension_token_t::get_value() const {
+  return value;
+}
+
+std::shared_ptr<dimension_token_t> dimension_token_t::make(const number_token_t &number, const token_t &identifier, allocator_type alloc) {
+  std::pmr::polymorphic_allocator<dimension_token_t> token_alloc(alloc);
+  return std::allocate_shared<dimension_token_t>(token_alloc, number, identifier);
 }
 
 dimension_token_t::~dimension_token_t() {};
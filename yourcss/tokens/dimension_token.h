@@ -1,4 +1,7 @@
+#pragma once
+
 #include <yourcss/token.h>
+#include <yourcss/tokens/number_token.h>
 
 namespace yourcss {
 
@@ -6,13 +9,16 @@ class dimension_token_t: public token_t {
 
 public:
 
-  dimension_token_t(const token_t &number_, const token_t &identifier_);
+  dimension_token_t(const number_token_t &number_, const token_t &identifier_, allocator_type alloc = {});
 
   token_t get_number();
 
   token_t get_identifier();
 
-  static std::shared_ptr<dimension_token_t> make(const token_t &number, const token_t &identifier);
+  /* The value of the number, as the lexer worked it out. */
+  double get_value() const;
+
+  static std::shared_ptr<dimension_token_t> make(const number_token_t &number, const token_t &identifier, allocator_type alloc = {});
 
   virtual ~dimension_token_t();
 
@@ -22,6 +28,9 @@ private:
 
   token_t identifier;
 
+  /* See accessor. */
+  double value;
+
 };  // dimension_token_t
 
 } // yourcss
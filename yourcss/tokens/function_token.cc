@@ -2,10 +2,10 @@
 
 namespace yourcss {
 
-function_token_t::function_token_t(const token_t &identifier_, const token_t &left_paren_):
-  token_t(identifier_.get_pos(), token_t::FUNCTION_TOKEN, identifier_.get_text() + left_paren_.get_text()),
-  identifier(identifier_),
-  left_paren(left_paren_) {}
+function_token_t::function_token_t(const token_t &identifier_, const token_t &left_paren_, allocator_type alloc):
+  token_t(identifier_.get_pos(), token_t::FUNCTION_TOKEN, concat({identifier_.get_text_view(), left_paren_.get_text_view()}, alloc), alloc),
+  identifier(identifier_, alloc),
+  left_paren(left_paren_, alloc) {}
 
 token_t function_token_t::get_identifier() {
   return left_paren;
@@ -15,8 +15,9 @@ token_t function_token_t::get_left_paren() {
   return identifier;
 }
 
-std::shared_ptr<function_token_t> function_token_t::make(const token_t &at, const token_t &identifier) {
-  return std::make_shared<function_token_t>(at, identifier);
+std::shared_ptr<function_token_t> function_token_t::make(const token_t &at, const token_t &identifier, allocator_type alloc) {
+  std::pmr::polymorphic_allocator<function_token_t> token_alloc(alloc);
+  return std::allocate_shared<function_token_t>(token_alloc, at, identifier);
 }
 
 function_token_t::~function_token_t() {};
@@ -6,13 +6,13 @@ class function_token_t: public token_t {
 
 public:
 
-  function_token_t(const token_t &identifier_, const token_t &left_paren_);
+  function_token_t(const token_t &identifier_, const token_t &left_paren_, allocator_type alloc = {});
 
   token_t get_identifier();
 
   token_t get_left_paren();
 
-  static std::shared_ptr<function_token_t> make(const token_t &identifier_, const token_t &left_paren_);
+  static std::shared_ptr<function_token_t> make(const token_t &identifier_, const token_t &left_paren_, allocator_type alloc = {});
 
   virtual ~function_token_t();
 
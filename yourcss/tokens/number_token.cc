@@ -1,16 +1,22 @@
 #include <yourcss/tokens/number_token.h>
 
+#include <yourcss/tokens/dimension_token.h>
+
 namespace yourcss {
 
-number_token_t::number_token_t(const pos_t &pos, kind_t kind, double value_):
-  token_t(pos, kind),
+number_token_t::number_token_t(const pos_t &pos, kind_t kind, double value_, allocator_type alloc):
+  token_t(pos, kind, alloc),
+  value(value_) {}
+
+number_token_t::number_token_t(const pos_t &pos, kind_t kind, std::string &&text, double value_, allocator_type alloc):
+  token_t(pos, kind, std::move(text), alloc),
   value(value_) {}
 
-number_token_t::number_token_t(const pos_t &pos, kind_t kind, std::string &&text, double value_):
-  token_t(pos, kind, std::move(text)),
+number_token_t::number_token_t(const pos_t &pos, kind_t kind, std::pmr::string &&text, double value_, allocator_type alloc):
+  token_t(pos, kind, std::move(text), alloc),
   value(value_) {}
 
-double number_token_t::get_value() {
+double number_token_t::get_value() const {
   return value;
 }
 
@@ -24,6 +30,29 @@ number_token_t::make(const pos_t &pos, kind_t kind, std::string &&text, double v
   return std::make_shared<number_token_t>(pos, kind, std::move(text), value);
 }
 
+std::shared_ptr<number_token_t>
+number_token_t::make(const pos_t &pos, kind_t kind, std::pmr::string &&text, double value) {
+  std::pmr::polymorphic_allocator<number_token_t> alloc(text.get_allocator());
+  return std::allocate_shared<number_token_t>(alloc, pos, kind, std::move(text), value);
+}
+
 number_token_t::~number_token_t() {}
 
+double get_numeric_value(const token_t &token) {
+  switch (token.get_kind()) {
+    case token_t::NUMBER_TOKEN:
+    case token_t::PERCENTAGE_TOKEN: {
+      auto number = dynamic_cast<const number_token_t *>(&token);
+      return number ? number->get_value() : 0;
+    }
+    case token_t::DIMENSION_TOKEN: {
+      auto dimension = dynamic_cast<const dimension_token_t *>(&token);
+      return dimension ? dimension->get_value() : 0;
+    }
+    default: {
+      return 0;
+    }
+  }
+}
+
 }
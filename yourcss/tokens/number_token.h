@@ -1,3 +1,5 @@
+#pragma once
+
 #include <yourcss/token.h>
 
 namespace yourcss {
@@ -6,16 +8,21 @@ class number_token_t: public token_t {
 
 public:
 
-  number_token_t(const pos_t &pos, kind_t kind, double value);
+  number_token_t(const pos_t &pos, kind_t kind, double value, allocator_type alloc = {});
+
+  number_token_t(const pos_t &pos, kind_t kind, std::string &&text, double value, allocator_type alloc = {});
 
-  number_token_t(const pos_t &pos, kind_t kind, std::string &&text, double value);
+  number_token_t(const pos_t &pos, kind_t kind, std::pmr::string &&text, double value, allocator_type alloc = {});
 
-  double get_value();
+  double get_value() const;
 
   static std::shared_ptr<number_token_t> make(const pos_t &pos, kind_t kind, double value);
 
   static std::shared_ptr<number_token_t> make(const pos_t &pos, kind_t kind, std::string &&text, double value);
 
+  /* Make a token allocated from wherever the text was. */
+  static std::shared_ptr<number_token_t> make(const pos_t &pos, kind_t kind, std::pmr::string &&text, double value);
+
   virtual ~number_token_t();
 
 private:
@@ -24,4 +31,8 @@ private:
 
 };  // function_token_t
 
+/* The value of a number, percentage or dimension token, as the lexer
+   worked it out, or 0 for any other token. */
+double get_numeric_value(const token_t &token);
+
 } // yourcss
@@ -2,10 +2,10 @@
 
 namespace yourcss {
 
-unicode_range_token_t::unicode_range_token_t(const token_t &start_, const token_t &end_):
-  token_t(start_.get_pos(), token_t::UNICODE_RANGE_TOKEN, start_.get_text() + "-" + end_.get_text()),
-  start(start_),
-  end(end_) {}
+unicode_range_token_t::unicode_range_token_t(const token_t &start_, const token_t &end_, allocator_type alloc):
+  token_t(start_.get_pos(), token_t::UNICODE_RANGE_TOKEN, concat({start_.get_text_view(), "-", end_.get_text_view()}, alloc), alloc),
+  start(start_, alloc),
+  end(end_, alloc) {}
 
 token_t unicode_range_token_t::get_start() {
   return start;
@@ -15,8 +15,9 @@ token_t unicode_range_token_t::get_end() {
   return end;
 }
 
-std::shared_ptr<unicode_range_token_t> unicode_range_token_t::make(const token_t &start, const token_t &end) {
-  return std::make_shared<unicode_range_token_t>(start, end);
+std::shared_ptr<unicode_range_token_t> unicode_range_token_t::make(const token_t &start, const token_t &end, allocator_type alloc) {
+  std::pmr::polymorphic_allocator<unicode_range_token_t> token_alloc(alloc);
+  return std::allocate_shared<unicode_range_token_t>(token_alloc, start, end);
 }
 
 unicode_range_token_t::~unicode_range_token_t() {}
@@ -6,13 +6,13 @@ class unicode_range_token_t: public token_t {
 
 public:
 
-  unicode_range_token_t(const token_t &start_, const token_t &end_);
+  unicode_range_token_t(const token_t &start_, const token_t &end_, allocator_type alloc = {});
 
   token_t get_start();
 
   token_t get_end();
 
-  static std::shared_ptr<unicode_range_token_t> make(const token_t &start, const token_t &end);
+  static std::shared_ptr<unicode_range_token_t> make(const token_t &start, const token_t &end, allocator_type alloc = {});
 
   virtual ~unicode_range_token_t();
 
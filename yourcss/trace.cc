@@ -0,0 +1,216 @@
+#include "trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace yourcss {
+
+namespace {
+
+/* Events are appended to fixed-size chunks which never move once
+   allocated, so a reader can walk them while their owner keeps appending.
+   The owner publishes each event by bumping size with release order. */
+struct chunk_t final {
+
+  static constexpr size_t capacity = 1024;
+
+  trace_t::event_t events[capacity];
+
+  std::atomic<size_t> size{0};
+
+  std::atomic<chunk_t *> next{nullptr};
+
+};  // chunk_t
+
+/* The events recorded by one thread. */
+struct buffer_t final {
+
+  explicit buffer_t(size_t tid_):
+    tid(tid_),
+    head(new chunk_t),
+    tail(head) {}
+
+  ~buffer_t() {
+    chunk_t *chunk = head;
+    while (chunk) {
+      chunk_t *next = chunk->next.load(std::memory_order_relaxed);
+      delete chunk;
+      chunk = next;
+    }
+  }
+
+  /* The thread id we report in the trace. */
+  size_t tid;
+
+  /* The first chunk; never changes. */
+  chunk_t *head;
+
+  /* The chunk we're appending to.  Only the owning thread touches this. */
+  chunk_t *tail;
+
+};  // buffer_t
+
+std::atomic<bool> enabled{false};
+
+/* Guards the list of buffers, not the buffers themselves.  A thread takes
+   it once, the first time it records an event. */
+std::mutex registry_mutex;
+
+std::vector<std::unique_ptr<buffer_t>> registry;
+
+buffer_t &get_buffer() {
+  thread_local buffer_t *buffer = nullptr;
+  if (!buffer) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    registry.push_back(std::make_unique<buffer_t>(registry.size() + 1));
+    buffer = registry.back().get();
+  }
+  return *buffer;
+}
+
+/* Chrome wants microseconds; keep the nanoseconds as a fraction. */
+void write_us(std::ostream &strm, uint64_t ns) {
+  auto fill = strm.fill('0');
+  strm << (ns / 1000) << '.' << std::setw(3) << (ns % 1000);
+  strm.fill(fill);
+}
+
+void write_string(std::ostream &strm, const char *text) {
+  strm << '"';
+  for (const char *c = text; *c; ++c) {
+    switch (*c) {
+      case '"':
+      case '\\': {
+        strm << '\\' << *c;
+        break;
+      }
+      default: {
+        strm << *c;
+      }
+    }
+  }
+  strm << '"';
+}
+
+}  // namespace
+
+trace_t::span_t::span_t(const char *name, size_t begin_offset):
+  cursor(nullptr),
+  origin(nullptr) {
+  if (!is_enabled()) {
+    event.name = nullptr;
+    return;
+  }
+  event.name = name;
+  event.begin_offset = begin_offset;
+  event.end_offset = begin_offset;
+  event.begin_ns = now_ns();
+}
+
+trace_t::span_t::span_t(const char *name, const char *const *cursor_, const char *origin_):
+  span_t(name, static_cast<size_t>(*cursor_ - origin_)) {
+  cursor = cursor_;
+  origin = origin_;
+}
+
+void trace_t::span_t::set_end_offset(size_t end_offset) {
+  event.end_offset = end_offset;
+}
+
+trace_t::span_t::~span_t() {
+  if (!event.name) {
+    return;
+  }
+  if (cursor) {
+    event.end_offset = static_cast<size_t>(*cursor - origin);
+  }
+  event.end_ns = now_ns();
+  record(event);
+}
+
+void trace_t::set_enabled(bool enabled_) {
+  enabled.store(enabled_, std::memory_order_relaxed);
+}
+
+bool trace_t::is_enabled() {
+  return enabled.load(std::memory_order_relaxed);
+}
+
+uint64_t trace_t::now_ns() {
+  auto since = std::chrono::steady_clock::now().time_since_epoch();
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(since).count());
+}
+
+void trace_t::record(const event_t &event) {
+  buffer_t &buffer = get_buffer();
+  chunk_t *chunk = buffer.tail;
+  size_t size = chunk->size.load(std::memory_order_relaxed);
+  if (size == chunk_t::capacity) {
+    chunk_t *next = new chunk_t;
+    chunk->next.store(next, std::memory_order_release);
+    buffer.tail = next;
+    chunk = next;
+    size = 0;
+  }
+  chunk->events[size] = event;
+  chunk->size.store(size + 1, std::memory_order_release);
+}
+
+size_t trace_t::get_event_count() {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  size_t count = 0;
+  for (const auto &buffer: registry) {
+    for (chunk_t *chunk = buffer->head; chunk; chunk = chunk->next.load(std::memory_order_acquire)) {
+      count += chunk->size.load(std::memory_order_acquire);
+    }
+  }
+  return count;
+}
+
+void trace_t::write_json(std::ostream &strm) {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  strm << "{\"traceEvents\":[";
+  bool sep_needed = false;
+  for (const auto &buffer: registry) {
+    for (chunk_t *chunk = buffer->head; chunk; chunk = chunk->next.load(std::memory_order_acquire)) {
+      size_t size = chunk->size.load(std::memory_order_acquire);
+      for (size_t i = 0; i < size; ++i) {
+        const event_t &event = chunk->events[i];
+        if (sep_needed) {
+          strm << ',';
+        }
+        sep_needed = true;
+        strm << "\n{\"name\":";
+        write_string(strm, event.name);
+        strm << ",\"cat\":\"yourcss\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid << ",\"ts\":";
+        write_us(strm, event.begin_ns);
+        strm << ",\"dur\":";
+        write_us(strm, event.end_ns - event.begin_ns);
+        strm
+          << ",\"args\":{\"begin\":" << event.begin_offset
+          << ",\"end\":" << event.end_offset << "}}";
+      }
+    }
+  }
+  strm << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+void trace_t::clear() {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  for (const auto &buffer: registry) {
+    chunk_t *chunk = buffer->head->next.exchange(nullptr, std::memory_order_relaxed);
+    while (chunk) {
+      chunk_t *next = chunk->next.load(std::memory_order_relaxed);
+      delete chunk;
+      chunk = next;
+    }
+    buffer->head->size.store(0, std::memory_order_relaxed);
+    buffer->tail = buffer->head;
+  }
+}
+
+}  // yourcss
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <type_traits>
+
+namespace yourcss {
+
+/* Records timed spans into per-thread buffers and writes them out as
+   Chrome trace event JSON, which chrome://tracing and Perfetto can load.
+
+   Appending a span only touches the calling thread's own buffer, so
+   recording never takes a lock.  The library's own spans are compiled in
+   only when YOURCSS_ENABLE_TRACE is defined (see trace.cfg); otherwise the
+   YOURCSS_TRACE_SPAN macro expands to nothing. */
+class trace_t final {
+
+public:
+
+  /* One completed span.  The name must outlive the trace; in practice it
+     is always a string literal. */
+  struct event_t {
+
+    /* What was being done. */
+    const char *name;
+
+    /* Steady-clock time at which the span opened and closed. */
+    uint64_t begin_ns, end_ns;
+
+    /* The range of source bytes the span covered. */
+    size_t begin_offset, end_offset;
+
+  };  // trace_t::event_t
+
+  /* Opens a span on construction and records it on destruction.  Does
+     nothing if tracing was disabled when the span opened. */
+  class span_t final {
+
+  public:
+
+    /* Open a span whose byte range starts at begin_offset.  Call
+       set_end_offset() before we close if the range is known. */
+    span_t(const char *name, size_t begin_offset);
+
+    /* Open a span that tracks a cursor into the text starting at origin.
+       The byte range is read from the cursor when we open and again when
+       we close. */
+    span_t(const char *name, const char *const *cursor, const char *origin);
+
+    span_t(const span_t &) = delete;
+
+    span_t &operator=(const span_t &) = delete;
+
+    /* Set the end of the byte range covered. */
+    void set_end_offset(size_t end_offset);
+
+    /* Record the span. */
+    ~span_t();
+
+  private:
+
+    /* If non-null, the cursor we read our byte range from. */
+    const char *const *cursor;
+
+    /* The start of the text the cursor moves through. */
+    const char *origin;
+
+    /* The event under construction; name is null if we're not recording. */
+    event_t event;
+
+  };  // trace_t::span_t
+
+  /* Takes the same arguments as span_t and does nothing with them. */
+  class no_span_t final {
+
+  public:
+
+    no_span_t(const char *, size_t) noexcept {}
+
+    no_span_t(const char *, const char *const *, const char *) noexcept {}
+
+  };  // trace_t::no_span_t
+
+  /* A span_t if enabled, otherwise a no_span_t, so templates can trace or
+     not at compile time. */
+  template <bool enabled>
+  using span_if_t = std::conditional_t<enabled, span_t, no_span_t>;
+
+  /* True if the library's own spans were compiled in. */
+#ifdef YOURCSS_ENABLE_TRACE
+  static constexpr bool is_compiled_in = true;
+#else
+  static constexpr bool is_compiled_in = false;
+#endif
+
+  /* Start or stop recording spans.  Disabled by default. */
+  static void set_enabled(bool enabled);
+
+  /* True if spans are being recorded. */
+  static bool is_enabled();
+
+  /* Nanoseconds on the clock used for spans. */
+  static uint64_t now_ns();
+
+  /* Add a completed event to the calling thread's buffer. */
+  static void record(const event_t &event);
+
+  /* The number of events recorded so far, over all threads. */
+  static size_t get_event_count();
+
+  /* Write every event recorded so far as Chrome trace event JSON.  Safe to
+     call while other threads are still recording; events they add during
+     the write may or may not appear. */
+  static void write_json(std::ostream &strm);
+
+  /* Throw away every recorded event.  Only call this when no other thread
+     is recording. */
+  static void clear();
+
+};  // trace_t
+
+}  // yourcss
+
+#define YOURCSS_TRACE_CAT2(a, b) a##b
+#define YOURCSS_TRACE_CAT(a, b) YOURCSS_TRACE_CAT2(a, b)
+
+#ifdef YOURCSS_ENABLE_TRACE
+/* Trace the rest of the enclosing scope, covering the bytes that the
+   cursor moves over relative to origin. */
+#define YOURCSS_TRACE_SPAN(name, cursor, origin) \
+  ::yourcss::trace_t::span_t YOURCSS_TRACE_CAT(yourcss_trace_span_, __LINE__)((name), (cursor), (origin))
+#else
+#define YOURCSS_TRACE_SPAN(name, cursor, origin)
+#endif
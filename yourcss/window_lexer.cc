@@ -0,0 +1,71 @@
+#include "window_lexer.h"
+
+#include <cstring>
+
+namespace yourcss {
+
+window_lexer_t::window_lexer_t(std::istream &strm_, const lexer_config_t &config_, size_t window_size):
+  strm(strm_),
+  config(config_),
+  window(window_size ? window_size : 1),
+  size(0),
+  start(0),
+  passed_whitespace(false),
+  is_exhausted(false) {}
+
+bool window_lexer_t::lex(const visitor_t &visitor) {
+  refill();
+  for (;;) {
+    const char *begin = window.data() + start;
+    lexer_t lexer(config, begin, window.data() + size, start_pos);
+    lexer.set_passed_whitespace(passed_whitespace);
+    bool is_whole = true;
+    try {
+      while (auto token = lexer.next()) {
+        if (lexer.has_reached_limit() && !is_exhausted) {
+          is_whole = false;
+          break;
+        }
+        start = static_cast<size_t>(lexer.get_next_cursor() - window.data());
+        start_pos = lexer.get_next_pos();
+        passed_whitespace = lexer.has_passed_whitespace();
+        if (!visitor(std::move(token))) {
+          return false;
+        }
+      }
+    } catch (const lexer_error_t &) {
+      /* The text may only be malformed because the window cut it short. */
+      if (!lexer.has_reached_limit() || is_exhausted) {
+        throw;
+      }
+      is_whole = false;
+    }
+    if (is_whole && (is_exhausted || !lexer.has_reached_limit())) {
+      return true;
+    }
+    refill();
+  }
+}
+
+size_t window_lexer_t::get_peak_window_size() const {
+  return window.size();
+}
+
+void window_lexer_t::refill() {
+  if (start == 0 && size == window.size()) {
+    window.resize(window.size() * 2);
+  } else if (start) {
+    std::memmove(window.data(), window.data() + start, size - start);
+    size -= start;
+    start = 0;
+  }
+  auto wanted = static_cast<std::streamsize>(window.size() - size);
+  strm.read(window.data() + size, wanted);
+  auto got = strm.gcount();
+  size += static_cast<size_t>(got);
+  if (got < wanted) {
+    is_exhausted = true;
+  }
+}
+
+}  // yourcss
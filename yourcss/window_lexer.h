@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <vector>
+#include "lexer.h"
+#include "pos.h"
+#include "token.h"
+
+namespace yourcss {
+
+/* Lexes a stream of any length through a fixed-size window, handing each
+   token to a visitor as soon as it's whole.  Memory use depends on the
+   window size and the longest token, never on the length of the stream.
+
+   A token which reaches the end of the window might go on past it, so we
+   don't hand it over.  Instead we slide the window up to the end of the
+   last token we did hand over, read more, and lex from there again.  If
+   one token fills the whole window, such as a very long comment, string
+   or url(), the window doubles until the token fits. */
+class window_lexer_t final {
+
+public:
+
+  /* Called with each token, which is ours to keep.  Return false to stop
+     lexing. */
+  using visitor_t = std::function<bool (std::shared_ptr<token_t> &&)>;
+
+  /* The window size we start with unless told otherwise. */
+  static constexpr size_t default_window_size = 65536;
+
+  /* Lex the stream with the config's options.  The window starts out
+     window_size bytes long. */
+  window_lexer_t(
+      std::istream &strm, const lexer_config_t &config = lexer_config_t(),
+      size_t window_size = default_window_size);
+
+  /* Lex the stream, passing each token to the visitor.  Returns false if
+     the visitor stopped us, true if we reached the end. */
+  bool lex(const visitor_t &visitor);
+
+  /* The biggest the window has grown to. */
+  size_t get_peak_window_size() const;
+
+private:
+
+  /* Slide the unused text to the front of the window, growing the window
+     if there was none we could let go of, then fill the rest from the
+     stream. */
+  void refill();
+
+  /* The stream we read from. */
+  std::istream &strm;
+
+  /* The options for each lexer we make. */
+  lexer_config_t config;
+
+  /* The window.  Its size is our capacity. */
+  std::vector<char> window;
+
+  /* The number of bytes in the window which hold text. */
+  size_t size;
+
+  /* The offset in the window of the first byte not yet part of a token
+     we've handed over. */
+  size_t start;
+
+  /* The position of the byte at start. */
+  pos_t start_pos;
+
+  /* True if there was whitespace between the last token we handed over
+     and start. */
+  bool passed_whitespace;
+
+  /* True once the stream has no more to give. */
+  bool is_exhausted;
+
+};  // window_lexer_t
+
+}  // yourcss